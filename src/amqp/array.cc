@@ -0,0 +1,66 @@
+#include "amqp/array.h"
+
+#include "amqp/string_field.h"
+
+namespace amqp {
+
+Array::Array(InBuffer& frame) {
+  uint32_t remaining = frame.NextUInt32();
+  while (remaining > 0) {
+    std::unique_ptr<Field> field(Field::Decode(frame));
+    if (!field) break;
+
+    // type octet + value
+    uint32_t consumed = 1 + field->size();
+    if (consumed > remaining) break;
+    remaining -= consumed;
+
+    fields_.push_back(std::shared_ptr<Field>(field.release()));
+  }
+}
+
+Array::Array(const Array& other) {
+  for (const auto& field : other.fields_) {
+    fields_.push_back(field->Clone());
+  }
+}
+
+Array& Array::operator=(const Array& other) {
+  if (this == &other) return *this;
+  fields_.clear();
+  for (const auto& field : other.fields_) {
+    fields_.push_back(field->Clone());
+  }
+  return *this;
+}
+
+const Field& Array::Get(size_t index) const {
+  static const Field* empty = new ShortString;
+  return index < fields_.size() ? *fields_[index] : *empty;
+}
+
+size_t Array::size() const {
+  size_t size = 4;
+  for (const auto& field : fields_) {
+    size += 1 + field->size();
+  }
+  return size;
+}
+
+void Array::Fill(OutBuffer& buffer) const {
+  buffer.Add(static_cast<uint32_t>(size() - 4));
+  for (const auto& field : fields_) {
+    buffer.Add(static_cast<uint8_t>(field->TypeId()));
+    field->Fill(buffer);
+  }
+}
+
+void Array::Output(std::ostream& os) const {
+  os << "array(";
+  for (size_t i = 0; i < fields_.size(); ++i) {
+    os << (i == 0 ? "" : ",") << *fields_[i];
+  }
+  os << ")";
+}
+
+} // namespace amqp
@@ -0,0 +1,53 @@
+#ifndef AMQP_ARRAY_H_
+#define AMQP_ARRAY_H_
+
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "amqp/field.h"
+#include "amqp/out_buffer.h"
+#include "amqp/in_buffer.h"
+
+namespace amqp {
+
+// AMQP field array: a long size followed by (type octet, value) entries.
+class Array : public Field {
+ public:
+  Array() {}
+  Array(InBuffer& frame);
+  Array(const Array& other);
+  Array(Array&& other) : fields_(std::move(other.fields_)) {}
+
+  virtual ~Array() {}
+
+  Array& operator=(const Array& other);
+
+  virtual std::shared_ptr<Field> Clone() const override {
+    return std::make_shared<Array>(*this);
+  }
+
+  Array& Push(const Field& value) {
+    fields_.push_back(value.Clone());
+    return *this;
+  }
+
+  // Returns an empty string field when |index| is out of range.
+  const Field& Get(size_t index) const;
+
+  size_t count() const { return fields_.size(); }
+
+  virtual size_t size() const override;
+  virtual void Fill(OutBuffer& buffer) const override;
+
+  virtual char TypeId() const override { return 'A'; }
+  virtual bool IsArray() const override { return true; }
+
+  virtual void Output(std::ostream& os) const override;
+
+ private:
+  std::vector<std::shared_ptr<Field>> fields_;
+};
+
+} // namespace amqp
+#endif // AMQP_ARRAY_H_
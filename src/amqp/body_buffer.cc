@@ -0,0 +1,95 @@
+#include "amqp/body_buffer.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+void BodyBufferTraits::Destruct(const BodyBuffer* buffer) {
+  BodyBuffer* mutable_buffer = const_cast<BodyBuffer*>(buffer);
+  mutable_buffer->pool_->Release(mutable_buffer);
+}
+
+BodyBuffer::BodyBuffer(BodyPool* pool, size_t allocated)
+  : pool_(pool),
+    data_(new char[allocated]),
+    allocated_(allocated),
+    capacity_(0),
+    size_(0) {}
+
+bool BodyBuffer::Append(const char* data, size_t size) {
+  DCHECK(HasOneRef()) << "BodyBuffer written after it was shared";
+  if (size > remaining()) return false;
+  memcpy(data_.get() + size_, data, size);
+  size_ += size;
+  return true;
+}
+
+const size_t BodyPool::kDefaultChunkSize;
+
+BodyPool::BodyPool(size_t chunk_size, size_t max_free)
+  : chunk_size_(chunk_size),
+    max_free_(max_free),
+    outstanding_(0) {
+  CHECK_GT(chunk_size_, 0u);
+}
+
+BodyPool::~BodyPool() {
+  DCHECK_EQ(outstanding_, 0u) << "BodyBuffers outlive their pool";
+  for (BodyBuffer* buffer : free_) {
+    delete buffer;
+  }
+}
+
+scoped_ref_ptr<BodyBuffer> BodyPool::Allocate(size_t body_size) {
+  BodyBuffer* buffer = nullptr;
+  {
+    std::lock_guard<std::mutex> hold(lock_);
+    ++outstanding_;
+    if (body_size <= chunk_size_ && !free_.empty()) {
+      buffer = free_.back();
+      free_.pop_back();
+    }
+  }
+  if (buffer == nullptr) {
+    buffer = new BodyBuffer(this, std::max(body_size, chunk_size_));
+  }
+  // Pooled chunks are larger than most bodies; limit the capacity to the
+  // announced size so full() tells the receiver the body is complete.
+  buffer->capacity_ = body_size;
+  buffer->size_ = 0;
+  return scoped_ref_ptr<BodyBuffer>(buffer);
+}
+
+size_t BodyPool::outstanding() const {
+  std::lock_guard<std::mutex> hold(lock_);
+  return outstanding_;
+}
+
+size_t BodyPool::free_chunks() const {
+  std::lock_guard<std::mutex> hold(lock_);
+  return free_.size();
+}
+
+void BodyPool::Release(BodyBuffer* buffer) {
+  {
+    std::lock_guard<std::mutex> hold(lock_);
+    --outstanding_;
+    // Only chunk-sized allocations are interchangeable.
+    if (buffer->allocated_ == chunk_size_ && free_.size() < max_free_) {
+      free_.push_back(buffer);
+      return;
+    }
+  }
+  delete buffer;
+}
+
+BodySlice BodySlice::Slice(size_t offset, size_t size) const {
+  offset = std::min(offset, size_);
+  size = std::min(size, size_ - offset);
+  return BodySlice(buffer_, offset_ + offset, size);
+}
+
+} // namespace amqp
@@ -0,0 +1,139 @@
+#ifndef AMQP_BODY_BUFFER_H_
+#define AMQP_BODY_BUFFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/ref_counted.h"
+#include "base/string_piece.h"
+
+namespace amqp {
+
+class BodyBuffer;
+class BodyPool;
+
+struct BodyBufferTraits {
+  static void Destruct(const BodyBuffer* buffer);
+};
+
+// One received message body, assembled from its content body frames and
+// then shared read-only by everyone it is delivered to.
+//
+// The receiver fills it while it holds the only reference; once handed out
+// (as BodySlices) it is immutable, so handlers on different threads read it
+// without locking. When the last reference goes the buffer returns to the
+// BodyPool it came from instead of being freed.
+class BodyBuffer
+    : public base::RefCountedThreadSafe<BodyBuffer, BodyBufferTraits> {
+ public:
+  const char* data() const { return data_.get(); }
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  size_t remaining() const { return capacity_ - size_; }
+  bool full() const { return size_ == capacity_; }
+
+  // Receiver only, before the buffer is shared. Appends one content body
+  // frame; returns false if it would overflow the announced body size.
+  bool Append(const char* data, size_t size);
+
+ private:
+  friend class BodyPool;
+  friend struct BodyBufferTraits;
+
+  BodyBuffer(BodyPool* pool, size_t allocated);
+  ~BodyBuffer() {}
+
+  BodyPool* pool_;
+  std::unique_ptr<char[]> data_;
+  // Bytes behind data_; capacity_ is the body size it was last handed out
+  // for.
+  size_t allocated_;
+  size_t capacity_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(BodyBuffer);
+};
+
+// Recycles BodyBuffers of one chunk size between the receive path and the
+// handlers that release them.
+//
+// Bodies up to |chunk_size| get a pooled chunk; larger ones get a buffer of
+// their own that is freed, not cached, when released. At most |max_free|
+// chunks are kept idle. Allocate() and the release of buffers are
+// thread-safe. The pool must outlive every buffer it handed out.
+class BodyPool {
+ public:
+  static const size_t kDefaultChunkSize = 256 * 1024;
+
+  explicit BodyPool(size_t chunk_size = kDefaultChunkSize,
+                    size_t max_free = 64);
+  ~BodyPool();
+
+  // An empty buffer for a body of |body_size| bytes, as announced by the
+  // content header.
+  scoped_ref_ptr<BodyBuffer> Allocate(size_t body_size);
+
+  size_t chunk_size() const { return chunk_size_; }
+  // Buffers handed out and not yet released.
+  size_t outstanding() const;
+  size_t free_chunks() const;
+
+ private:
+  friend struct BodyBufferTraits;
+
+  void Release(BodyBuffer* buffer);
+
+  const size_t chunk_size_;
+  const size_t max_free_;
+
+  mutable std::mutex lock_;
+  std::vector<BodyBuffer*> free_;
+  size_t outstanding_;
+
+  DISALLOW_COPY_AND_ASSIGN(BodyPool);
+};
+
+// A cheap, copyable view of (part of) a shared BodyBuffer. Copying costs a
+// reference count increment, never the body bytes, so a delivery fanned out
+// to N handlers costs N references instead of N copies.
+class BodySlice {
+ public:
+  BodySlice() : offset_(0), size_(0) {}
+  // The whole body.
+  explicit BodySlice(scoped_ref_ptr<const BodyBuffer> buffer)
+    : buffer_(std::move(buffer)),
+      offset_(0),
+      size_(buffer_ ? buffer_->size() : 0) {}
+
+  const char* data() const {
+    return buffer_ ? buffer_->data() + offset_ : nullptr;
+  }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const scoped_ref_ptr<const BodyBuffer>& buffer() const { return buffer_; }
+
+  base::StringPiece as_string_piece() const {
+    return base::StringPiece(data(), size_);
+  }
+  std::string ToString() const { return as_string_piece().as_string(); }
+
+  // A sub-range sharing the same buffer; clamped to this slice.
+  BodySlice Slice(size_t offset, size_t size) const;
+
+ private:
+  BodySlice(const scoped_ref_ptr<const BodyBuffer>& buffer,
+            size_t offset, size_t size)
+    : buffer_(buffer), offset_(offset), size_(size) {}
+
+  scoped_ref_ptr<const BodyBuffer> buffer_;
+  size_t offset_;
+  size_t size_;
+};
+
+} // namespace amqp
+#endif // AMQP_BODY_BUFFER_H_
@@ -3,7 +3,7 @@
 
 #include "amqp/field.h"
 #include "amqp/out_buffer.h"
-#include "amqp/received_frame.h"
+#include "amqp/in_buffer.h"
 
 #include <ostream>
 
@@ -30,7 +30,7 @@ class BooleanSet : public Field {
     Set(7, v7);
   }
 
-  BooleanSet(ReceivedFrame& frame) {
+  BooleanSet(InBuffer& frame) {
     byte_ = frame.NextUInt8();
   }  
 
@@ -0,0 +1,334 @@
+#include "amqp/channel_pipeline.h"
+
+#include <algorithm>
+
+#include "amqp/method_frames.h"
+#include "amqp/numeric_field.h"
+#include "amqp/string_field.h"
+#include "amqp/topology_cache.h"
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+namespace {
+
+const char kMalformed[] = "malformed -Ok arguments";
+
+} // namespace
+
+ChannelPipeline::ChannelPipeline(uint16_t channel,
+                                 Delegate* delegate,
+                                 size_t buffer_size)
+  : channel_(channel),
+    delegate_(delegate),
+    buffer_size_(std::max<size_t>(buffer_size, kFrameMinSize)),
+    cache_(nullptr) {
+  DCHECK(delegate_);
+}
+
+ChannelPipeline::~ChannelPipeline() {}
+
+bool ChannelPipeline::Declaration::Cached(const TopologyCache& cache) const {
+  switch (entity) {
+    case ENTITY_EXCHANGE:
+      return cache.HasExchange(name, type, flags, arguments);
+    case ENTITY_QUEUE:
+      return cache.HasQueue(name, flags, arguments);
+    case ENTITY_BINDING:
+      return cache.HasBinding(name, exchange, routing_key, arguments);
+  }
+  return false;
+}
+
+void ChannelPipeline::Declaration::Record(TopologyCache* cache) const {
+  switch (entity) {
+    case ENTITY_EXCHANGE:
+      cache->AddExchange(name, type, flags, arguments, generation);
+      break;
+    case ENTITY_QUEUE:
+      cache->AddQueue(name, flags, arguments, generation);
+      break;
+    case ENTITY_BINDING:
+      cache->AddBinding(name, exchange, routing_key, arguments, generation);
+      break;
+  }
+}
+
+template <typename Frame>
+ChannelPipeline::Expected& ChannelPipeline::Append(
+    const Frame& frame, Kind kind, const ErrorCallback& error) {
+  size_t size = frame.size();
+  if (buffer_ && buffer_->available() < size) Send();
+  if (!buffer_ || buffer_->capacity() < size) {
+    buffer_.reset(new OutBuffer(std::max(size, buffer_size_)));
+  }
+  frame.Fill(*buffer_);
+
+  expected_.push_back(Expected());
+  Expected& expected = expected_.back();
+  expected.class_id = frame.class_id();
+  expected.method_id = frame.method_id() + 1;
+  expected.kind = kind;
+  expected.local = false;
+  expected.error = error;
+  expected.deferred = nullptr;
+  return expected;
+}
+
+template <typename Frame>
+Deferred& ChannelPipeline::AppendDeferred(const Frame& frame) {
+  Deferred& deferred = deferreds_.Allocate();
+  Append(frame, KIND_DEFERRED, ErrorCallback()).deferred = &deferred;
+  return deferred;
+}
+
+template <typename Frame>
+ChannelPipeline::Expected& ChannelPipeline::Declare(
+    const Frame& frame, std::unique_ptr<Declaration> declaration, Kind kind,
+    const ErrorCallback& error) {
+  if (!declaration || !declaration->Cached(*cache_)) {
+    Expected& expected = Append(frame, kind, error);
+    expected.declaration = std::move(declaration);
+    return expected;
+  }
+  // Queued rather than completed here: the caller has yet to set the
+  // callbacks of a Deferred, and calls ahead of it must complete first.
+  expected_.push_back(Expected());
+  Expected& expected = expected_.back();
+  expected.class_id = 0;
+  expected.method_id = 0;
+  expected.kind = kind;
+  expected.local = true;
+  expected.error = error;
+  expected.deferred = nullptr;
+  expected.declaration = std::move(declaration);
+  return expected;
+}
+
+template <typename Frame>
+Deferred& ChannelPipeline::DeclareDeferred(
+    const Frame& frame, std::unique_ptr<Declaration> declaration) {
+  Deferred& deferred = deferreds_.Allocate();
+  Declare(frame, std::move(declaration), KIND_DEFERRED,
+          ErrorCallback()).deferred = &deferred;
+  return deferred;
+}
+
+std::unique_ptr<ChannelPipeline::Declaration> ChannelPipeline::NewDeclaration(
+    Declaration::Entity entity, const std::string& name, uint32_t flags,
+    const Table& arguments) const {
+  std::unique_ptr<Declaration> declaration;
+  if (!cache_) return declaration;
+  declaration.reset(new Declaration);
+  declaration->entity = entity;
+  declaration->name = name;
+  declaration->flags = flags;
+  declaration->arguments = arguments;
+  declaration->generation = cache_->generation();
+  return declaration;
+}
+
+std::unique_ptr<ChannelPipeline::Declaration> ChannelPipeline::NewExchange(
+    const std::string& name, const std::string& type, uint32_t flags,
+    const Table& arguments) const {
+  std::unique_ptr<Declaration> declaration =
+      NewDeclaration(Declaration::ENTITY_EXCHANGE, name, flags, arguments);
+  if (declaration) declaration->type = type;
+  return declaration;
+}
+
+std::unique_ptr<ChannelPipeline::Declaration> ChannelPipeline::NewQueue(
+    const std::string& name, uint32_t flags, const Table& arguments) const {
+  return NewDeclaration(Declaration::ENTITY_QUEUE, name, flags, arguments);
+}
+
+std::unique_ptr<ChannelPipeline::Declaration> ChannelPipeline::NewBinding(
+    const std::string& queue, const std::string& exchange,
+    const std::string& routing_key, const Table& arguments) const {
+  std::unique_ptr<Declaration> declaration =
+      NewDeclaration(Declaration::ENTITY_BINDING, queue, 0, arguments);
+  if (declaration) {
+    declaration->exchange = exchange;
+    declaration->routing_key = routing_key;
+  }
+  return declaration;
+}
+
+void ChannelPipeline::DeclareExchange(const std::string& name,
+                                      const std::string& type,
+                                      uint32_t flags,
+                                      const Table& arguments,
+                                      const SuccessCallback& success,
+                                      const ErrorCallback& error) {
+  ExchangeDeclareFrame frame(channel_, name, type, flags & ~kNoWait,
+                             arguments);
+  Declare(frame, NewExchange(name, type, flags, arguments), KIND_SUCCESS,
+          error).success = success;
+}
+
+void ChannelPipeline::DeclareQueue(const std::string& name,
+                                   uint32_t flags,
+                                   const Table& arguments,
+                                   const QueueCallback& success,
+                                   const ErrorCallback& error) {
+  QueueDeclareFrame frame(channel_, name, flags & ~kNoWait, arguments);
+  Declare(frame, NewQueue(name, flags, arguments), KIND_QUEUE,
+          error).queue = success;
+}
+
+void ChannelPipeline::BindQueue(const std::string& queue,
+                                const std::string& exchange,
+                                const std::string& routing_key,
+                                const Table& arguments,
+                                const SuccessCallback& success,
+                                const ErrorCallback& error) {
+  QueueBindFrame frame(channel_, queue, exchange, routing_key, 0, arguments);
+  Declare(frame, NewBinding(queue, exchange, routing_key, arguments),
+          KIND_SUCCESS, error).success = success;
+}
+
+void ChannelPipeline::SetQos(uint16_t prefetch_count,
+                             bool global,
+                             const SuccessCallback& success,
+                             const ErrorCallback& error) {
+  BasicQosFrame frame(channel_, prefetch_count, global);
+  Append(frame, KIND_SUCCESS, error).success = success;
+}
+
+Deferred& ChannelPipeline::DeclareExchange(const std::string& name,
+                                           const std::string& type,
+                                           uint32_t flags,
+                                           const Table& arguments) {
+  ExchangeDeclareFrame frame(channel_, name, type, flags & ~kNoWait,
+                             arguments);
+  return DeclareDeferred(frame, NewExchange(name, type, flags, arguments));
+}
+
+Deferred& ChannelPipeline::BindQueue(const std::string& queue,
+                                     const std::string& exchange,
+                                     const std::string& routing_key,
+                                     const Table& arguments) {
+  QueueBindFrame frame(channel_, queue, exchange, routing_key, 0, arguments);
+  return DeclareDeferred(frame,
+                         NewBinding(queue, exchange, routing_key, arguments));
+}
+
+Deferred& ChannelPipeline::SetQos(uint16_t prefetch_count, bool global) {
+  BasicQosFrame frame(channel_, prefetch_count, global);
+  return AppendDeferred(frame);
+}
+
+void ChannelPipeline::Consume(const std::string& queue,
+                              const std::string& consumer_tag,
+                              uint32_t flags,
+                              const Table& arguments,
+                              const ConsumeCallback& success,
+                              const ErrorCallback& error) {
+  BasicConsumeFrame frame(channel_, queue, consumer_tag, flags & ~kNoWait,
+                          arguments);
+  Append(frame, KIND_CONSUME, error).consume = success;
+}
+
+void ChannelPipeline::Flush() {
+  Send();
+  CompleteLocal();
+}
+
+void ChannelPipeline::Send() {
+  if (!buffer_ || buffer_->size() == 0) return;
+  delegate_->SendFrames(*buffer_);
+  buffer_->Clear();
+}
+
+void ChannelPipeline::CompleteLocal() {
+  while (!expected_.empty() && expected_.front().local) {
+    Expected expected = std::move(expected_.front());
+    expected_.pop_front();
+    Succeed(expected, nullptr);
+  }
+}
+
+bool ChannelPipeline::OnMethod(uint16_t class_id,
+                               uint16_t method_id,
+                               InBuffer& arguments) {
+  // Calls answered from the cache ahead of this -Ok's call go first.
+  CompleteLocal();
+  if (expected_.empty()) return false;
+  if (expected_.front().class_id != class_id ||
+      expected_.front().method_id != method_id) {
+    return false;
+  }
+
+  // Pop before running the callback: it may queue more calls.
+  Expected expected = std::move(expected_.front());
+  expected_.pop_front();
+  if (!Succeed(expected, &arguments)) return false;
+  CompleteLocal();
+  return true;
+}
+
+bool ChannelPipeline::Succeed(Expected& expected, InBuffer* arguments) {
+  switch (expected.kind) {
+    case KIND_SUCCESS:
+    case KIND_DEFERRED:
+      break;
+    case KIND_QUEUE: {
+      if (!arguments) {
+        if (expected.queue) expected.queue(expected.declaration->name, 0, 0);
+        return true;
+      }
+      ShortString name(*arguments);
+      ULong message_count(*arguments);
+      ULong consumer_count(*arguments);
+      if (!arguments->ok()) {
+        Fail(expected, kMalformed);
+        return false;
+      }
+      if (expected.declaration) expected.declaration->Record(cache_);
+      if (expected.queue) {
+        expected.queue(name.value(), message_count.value(),
+                       consumer_count.value());
+      }
+      return true;
+    }
+    case KIND_CONSUME: {
+      ShortString consumer_tag(*arguments);
+      if (!arguments->ok()) {
+        Fail(expected, kMalformed);
+        return false;
+      }
+      if (expected.consume) expected.consume(consumer_tag.value());
+      return true;
+    }
+  }
+
+  if (arguments && expected.declaration) expected.declaration->Record(cache_);
+  if (expected.deferred) {
+    expected.deferred->Resolve();
+  } else if (expected.success) {
+    expected.success();
+  }
+  return true;
+}
+
+void ChannelPipeline::OnChannelClose(const char* reason) {
+  // Whatever failed may have removed something the cache holds.
+  if (cache_) cache_->Invalidate();
+  // Nothing buffered will be accepted on a closed channel.
+  if (buffer_) buffer_->Clear();
+  std::deque<Expected> failed;
+  failed.swap(expected_);
+  for (Expected& expected : failed) Fail(expected, reason);
+}
+
+// static
+void ChannelPipeline::Fail(Expected& expected, const char* reason) {
+  if (expected.deferred) {
+    expected.deferred->Reject(reason);
+  } else if (expected.error) {
+    expected.error(reason);
+  }
+}
+
+} // namespace amqp
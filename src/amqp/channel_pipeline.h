@@ -0,0 +1,226 @@
+#ifndef AMQP_CHANNEL_PIPELINE_H_
+#define AMQP_CHANNEL_PIPELINE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "amqp/callbacks.h"
+#include "amqp/deferred.h"
+#include "amqp/in_buffer.h"
+#include "amqp/out_buffer.h"
+#include "amqp/table.h"
+#include "base/macros.h"
+
+namespace amqp {
+
+class TopologyCache;
+
+// Issues a channel's synchronous methods without waiting for each -Ok.
+//
+// AMQP answers the synchronous methods of a channel in the order they were
+// sent, so nothing forces a round trip per method: the pipeline encodes each
+// call into a shared buffer, remembers which -Ok it expects and the
+// callbacks to run, and sends the buffer on Flush() (or once it fills up).
+// Incoming -Ok methods are matched against the head of that FIFO. Declaring
+// a thousand queues with their bindings is then a few writes and one round
+// trip instead of two thousand.
+//
+// A failing method makes the broker close the channel; everything queued
+// behind it is discarded by the broker, so OnChannelClose() fails every
+// outstanding call with the close reason.
+//
+// kNoWait is ignored: pipelining gets the same throughput and still reports
+// the outcome.
+//
+// With a TopologyCache set, a declare or bind the cache already holds is
+// not sent; it completes in order with the calls around it, at the next
+// Flush() or once the -Ok ahead of it arrives. A Queue.Declare answered so
+// reports zero messages and consumers. Declares are recorded as their -Ok
+// arrives, and OnChannelClose() invalidates the cache.
+//
+//   ChannelPipeline pipeline(channel, &delegate);
+//   for (const std::string& name : queues) {
+//     pipeline.DeclareQueue(name, kDurable, Table(), on_queue, on_error);
+//     pipeline.BindQueue(name, "events", name, Table(), on_bound, on_error);
+//   }
+//   pipeline.Flush();
+//
+// Not thread-safe; use it on the channel's I/O thread.
+class ChannelPipeline {
+ public:
+  class Delegate {
+   public:
+    virtual ~Delegate() {}
+    virtual void SendFrames(const OutBuffer& frames) = 0;
+  };
+
+  static const size_t kDefaultBufferSize = 64 * 1024;
+
+  // |delegate| must outlive the pipeline.
+  ChannelPipeline(uint16_t channel, Delegate* delegate,
+                  size_t buffer_size = kDefaultBufferSize);
+  ~ChannelPipeline();
+
+  // Optional; |cache| must outlive the pipeline and is usually shared by
+  // the channels of a connection.
+  void set_topology_cache(TopologyCache* cache) { cache_ = cache; }
+
+  // Any callback may be null. The methods answered by a plain -Ok also
+  // come in a form that returns a Deferred from the pipeline's slab
+  // instead of taking callbacks.
+  void DeclareExchange(const std::string& name, const std::string& type,
+                       uint32_t flags, const Table& arguments,
+                       const SuccessCallback& success,
+                       const ErrorCallback& error);
+  void DeclareQueue(const std::string& name, uint32_t flags,
+                    const Table& arguments,
+                    const QueueCallback& success,
+                    const ErrorCallback& error);
+  void BindQueue(const std::string& queue, const std::string& exchange,
+                 const std::string& routing_key, const Table& arguments,
+                 const SuccessCallback& success,
+                 const ErrorCallback& error);
+  void SetQos(uint16_t prefetch_count, bool global,
+              const SuccessCallback& success,
+              const ErrorCallback& error);
+  Deferred& DeclareExchange(const std::string& name, const std::string& type,
+                            uint32_t flags, const Table& arguments);
+  Deferred& BindQueue(const std::string& queue, const std::string& exchange,
+                      const std::string& routing_key, const Table& arguments);
+  Deferred& SetQos(uint16_t prefetch_count, bool global);
+
+  void Consume(const std::string& queue, const std::string& consumer_tag,
+               uint32_t flags, const Table& arguments,
+               const ConsumeCallback& success,
+               const ErrorCallback& error);
+
+  // Sends everything encoded since the last flush and completes the calls
+  // answered from the topology cache that no longer wait on an -Ok.
+  void Flush();
+
+  // A method received on the channel. Returns false if it is an -Ok this
+  // pipeline did not expect next, or the expected one with malformed
+  // arguments (that call then fails); the caller should treat either as a
+  // protocol error. |arguments| is positioned after the method id.
+  bool OnMethod(uint16_t class_id, uint16_t method_id, InBuffer& arguments);
+
+  // The broker closed the channel (or the connection went away).
+  void OnChannelClose(const char* reason);
+
+  // Calls sent, buffered or answered from the cache that have not
+  // completed.
+  size_t outstanding() const { return expected_.size(); }
+  size_t buffered_bytes() const { return buffer_ ? buffer_->size() : 0; }
+  const DeferredSlab& deferreds() const { return deferreds_; }
+
+ private:
+  enum Kind {
+    KIND_SUCCESS,
+    KIND_DEFERRED,
+    KIND_QUEUE,
+    KIND_CONSUME,
+  };
+
+  // A declare or bind as the topology cache knows it: looked up before the
+  // call goes out, recorded when its -Ok arrives.
+  struct Declaration {
+    enum Entity {
+      ENTITY_EXCHANGE,
+      ENTITY_QUEUE,
+      ENTITY_BINDING,
+    };
+
+    Declaration() : entity(ENTITY_EXCHANGE), flags(0), generation(0) {}
+
+    bool Cached(const TopologyCache& cache) const;
+    void Record(TopologyCache* cache) const;
+
+    Entity entity;
+    // The exchange or queue declared, or the queue bound.
+    std::string name;
+    // Exchanges only.
+    std::string type;
+    // Bindings only.
+    std::string exchange;
+    std::string routing_key;
+    uint32_t flags;
+    Table arguments;
+    // The cache's generation when the call was issued.
+    uint64_t generation;
+  };
+
+  struct Expected {
+    uint16_t class_id;
+    uint16_t method_id;
+    Kind kind;
+    // Answered from the cache: nothing was sent and no -Ok will come.
+    bool local;
+    SuccessCallback success;
+    QueueCallback queue;
+    ConsumeCallback consume;
+    ErrorCallback error;
+    Deferred* deferred;
+    // Set only with a topology cache.
+    std::unique_ptr<Declaration> declaration;
+  };
+
+  // Encodes |frame| and queues an Expected for its -Ok, which is the next
+  // method id for every method here.
+  template <typename Frame>
+  Expected& Append(const Frame& frame, Kind kind, const ErrorCallback& error);
+  template <typename Frame>
+  Deferred& AppendDeferred(const Frame& frame);
+  // As Append(), but answers the call locally if |declaration| is cached.
+  // |declaration| is null without a cache.
+  template <typename Frame>
+  Expected& Declare(const Frame& frame,
+                    std::unique_ptr<Declaration> declaration, Kind kind,
+                    const ErrorCallback& error);
+  template <typename Frame>
+  Deferred& DeclareDeferred(const Frame& frame,
+                            std::unique_ptr<Declaration> declaration);
+  std::unique_ptr<Declaration> NewDeclaration(Declaration::Entity entity,
+                                              const std::string& name,
+                                              uint32_t flags,
+                                              const Table& arguments) const;
+  std::unique_ptr<Declaration> NewExchange(const std::string& name,
+                                           const std::string& type,
+                                           uint32_t flags,
+                                           const Table& arguments) const;
+  std::unique_ptr<Declaration> NewQueue(const std::string& name,
+                                        uint32_t flags,
+                                        const Table& arguments) const;
+  std::unique_ptr<Declaration> NewBinding(const std::string& queue,
+                                          const std::string& exchange,
+                                          const std::string& routing_key,
+                                          const Table& arguments) const;
+
+  // Sends the buffer without completing anything; Append() flushes with
+  // this, so callbacks never run in the middle of encoding a call.
+  void Send();
+  // Pops and completes the local calls at the head of the queue.
+  void CompleteLocal();
+  // Records the declaration of |expected| and runs its success callback or
+  // resolves its Deferred. Returns false, having failed the call, if
+  // |arguments| are malformed; null |arguments| stand for a call answered
+  // from the cache.
+  bool Succeed(Expected& expected, InBuffer* arguments);
+  // Reports |reason| through the error callback or Deferred of |expected|.
+  static void Fail(Expected& expected, const char* reason);
+
+  const uint16_t channel_;
+  Delegate* delegate_;
+  const size_t buffer_size_;
+  TopologyCache* cache_;
+  std::unique_ptr<OutBuffer> buffer_;
+  std::deque<Expected> expected_;
+  DeferredSlab deferreds_;
+
+  DISALLOW_COPY_AND_ASSIGN(ChannelPipeline);
+};
+
+} // namespace amqp
+#endif // AMQP_CHANNEL_PIPELINE_H_
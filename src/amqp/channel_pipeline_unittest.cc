@@ -0,0 +1,242 @@
+#include "amqp/channel_pipeline.h"
+
+#include <string>
+#include <vector>
+
+#include "amqp/method_frames.h"
+#include "amqp/numeric_field.h"
+#include "amqp/protocol.h"
+#include "amqp/string_field.h"
+#include "amqp/topology_cache.h"
+#include "base/byteorder.h"
+
+#include <gtest/gtest.h>
+
+namespace amqp {
+
+namespace {
+
+// Keeps the (class, method) of every method frame sent.
+class RecordingDelegate : public ChannelPipeline::Delegate {
+ public:
+  RecordingDelegate() : writes(0) {}
+
+  void SendFrames(const OutBuffer& frames) override {
+    ++writes;
+    const char* p = frames.data();
+    const char* end = p + frames.size();
+    while (p < end) {
+      uint32_t size;
+      memcpy(&size, p + 3, 4);
+      size = base::NetToHost32(size);
+      uint16_t ids[2];
+      memcpy(ids, p + kFrameHeaderSize, 4);
+      methods.push_back(base::NetToHost16(ids[0]) << 16 |
+                        base::NetToHost16(ids[1]));
+      p += kFrameOverhead + size;
+    }
+  }
+
+  int writes;
+  std::vector<uint32_t> methods;
+};
+
+uint32_t Method(uint16_t class_id, uint16_t method_id) {
+  return static_cast<uint32_t>(class_id) << 16 | method_id;
+}
+
+class ChannelPipelineTest : public testing::Test {
+ protected:
+  ChannelPipelineTest() : pipeline_(1, &delegate_) {}
+
+  bool Ok(uint16_t class_id, uint16_t method_id) {
+    InBuffer none("", 0);
+    return pipeline_.OnMethod(class_id, method_id, none);
+  }
+
+  bool QueueOk(const std::string& name, uint32_t messages,
+               uint32_t consumers) {
+    OutBuffer buffer(64);
+    ShortString(name).Fill(buffer);
+    buffer.Add(messages);
+    buffer.Add(consumers);
+    InBuffer arguments(buffer.data(), buffer.size());
+    return pipeline_.OnMethod(kClassQueue, kQueueDeclareOk, arguments);
+  }
+
+  SuccessCallback Push(int value) {
+    return [this, value]() { order_.push_back(value); };
+  }
+
+  ErrorCallback Error() {
+    return [this](const char* message) { errors_.push_back(message); };
+  }
+
+  RecordingDelegate delegate_;
+  ChannelPipeline pipeline_;
+  std::vector<int> order_;
+  std::vector<std::string> errors_;
+};
+
+TEST_F(ChannelPipelineTest, BatchesUntilFlush) {
+  pipeline_.DeclareExchange("ex", "topic", kDurable | kNoWait, Table(),
+                            Push(1), Error());
+  pipeline_.BindQueue("jobs", "ex", "k", Table(), Push(2), Error());
+  pipeline_.SetQos(10, false, Push(3), Error());
+  EXPECT_EQ(0, delegate_.writes);
+  EXPECT_GT(pipeline_.buffered_bytes(), 0u);
+  EXPECT_EQ(3u, pipeline_.outstanding());
+
+  pipeline_.Flush();
+  EXPECT_EQ(1, delegate_.writes);
+  EXPECT_EQ(0u, pipeline_.buffered_bytes());
+  EXPECT_EQ(std::vector<uint32_t>({Method(kClassExchange, kExchangeDeclare),
+                                   Method(kClassQueue, kQueueBind),
+                                   Method(kClassBasic, kBasicQos)}),
+            delegate_.methods);
+}
+
+TEST_F(ChannelPipelineTest, MatchesOksInOrder) {
+  pipeline_.DeclareExchange("ex", "topic", kDurable, Table(), Push(1),
+                            Error());
+  std::string queue;
+  uint32_t messages = 0;
+  pipeline_.DeclareQueue(
+      "jobs", kDurable, Table(),
+      [&](const std::string& name, uint32_t message_count, uint32_t) {
+        queue = name;
+        messages = message_count;
+      },
+      Error());
+  pipeline_.BindQueue("jobs", "ex", "k", Table()).OnSuccess(Push(3));
+  pipeline_.Flush();
+
+  // Not the head of the queue.
+  EXPECT_FALSE(Ok(kClassQueue, kQueueBindOk));
+  EXPECT_TRUE(Ok(kClassExchange, kExchangeDeclareOk));
+  EXPECT_EQ(std::vector<int>({1}), order_);
+  EXPECT_TRUE(QueueOk("jobs", 7, 0));
+  EXPECT_EQ("jobs", queue);
+  EXPECT_EQ(7u, messages);
+  EXPECT_EQ(1u, pipeline_.deferreds().outstanding());
+  EXPECT_TRUE(Ok(kClassQueue, kQueueBindOk));
+  EXPECT_EQ(std::vector<int>({1, 3}), order_);
+  EXPECT_EQ(0u, pipeline_.deferreds().outstanding());
+  EXPECT_EQ(0u, pipeline_.outstanding());
+  EXPECT_FALSE(Ok(kClassBasic, kBasicQosOk));
+  EXPECT_TRUE(errors_.empty());
+}
+
+TEST_F(ChannelPipelineTest, CallbacksMayQueueMoreCalls) {
+  pipeline_.SetQos(10, false, [this]() {
+    order_.push_back(1);
+    pipeline_.SetQos(20, false, Push(2), Error());
+  }, Error());
+  pipeline_.Flush();
+  EXPECT_TRUE(Ok(kClassBasic, kBasicQosOk));
+  EXPECT_EQ(1u, pipeline_.outstanding());
+  pipeline_.Flush();
+  EXPECT_TRUE(Ok(kClassBasic, kBasicQosOk));
+  EXPECT_EQ(std::vector<int>({1, 2}), order_);
+}
+
+TEST_F(ChannelPipelineTest, CachedDeclareWaitsForEarlierCalls) {
+  TopologyCache cache;
+  pipeline_.set_topology_cache(&cache);
+  pipeline_.DeclareExchange("ex", "topic", kDurable, Table(), Push(1),
+                            Error());
+  pipeline_.Flush();
+  ASSERT_TRUE(Ok(kClassExchange, kExchangeDeclareOk));
+  EXPECT_EQ(1u, cache.size());
+
+  pipeline_.SetQos(10, false, Push(2), Error());
+  pipeline_.DeclareExchange("ex", "topic", kDurable, Table())
+      .OnSuccess(Push(3));
+  pipeline_.Flush();
+  // Only Basic.Qos went out; the cached declare waits for its -Ok.
+  EXPECT_EQ(Method(kClassBasic, kBasicQos), delegate_.methods.back());
+  EXPECT_EQ(2u, delegate_.methods.size());
+  EXPECT_EQ(std::vector<int>({1}), order_);
+  EXPECT_EQ(2u, pipeline_.outstanding());
+
+  ASSERT_TRUE(Ok(kClassBasic, kBasicQosOk));
+  EXPECT_EQ(std::vector<int>({1, 2, 3}), order_);
+  EXPECT_EQ(0u, pipeline_.outstanding());
+
+  // With nothing ahead of it, a cached declare completes at the next
+  // Flush(), after the caller has had the chance to chain callbacks.
+  uint32_t consumers = 1;
+  pipeline_.DeclareQueue("jobs", kDurable, Table(), nullptr, Error());
+  pipeline_.Flush();
+  ASSERT_TRUE(QueueOk("jobs", 3, 2));
+  pipeline_.DeclareQueue(
+      "jobs", kDurable, Table(),
+      [&consumers](const std::string&, uint32_t, uint32_t count) {
+        consumers = count;
+      },
+      Error());
+  EXPECT_EQ(1u, pipeline_.outstanding());
+  pipeline_.Flush();
+  EXPECT_EQ(0u, consumers);
+  EXPECT_EQ(3u, delegate_.methods.size());
+  EXPECT_TRUE(errors_.empty());
+}
+
+TEST_F(ChannelPipelineTest, MalformedArgumentsFailTheCall) {
+  pipeline_.DeclareQueue("jobs", kDurable, Table(), nullptr, Error());
+  pipeline_.Consume("jobs", "tag", 0, Table(), nullptr, Error());
+  pipeline_.SetQos(1, false, Push(1), Error());
+  pipeline_.Flush();
+
+  // A Declare-Ok cut short after the name.
+  OutBuffer buffer(16);
+  ShortString("jobs").Fill(buffer);
+  InBuffer truncated(buffer.data(), buffer.size());
+  EXPECT_FALSE(pipeline_.OnMethod(kClassQueue, kQueueDeclareOk, truncated));
+  ASSERT_EQ(1u, errors_.size());
+
+  InBuffer empty("", 0);
+  EXPECT_FALSE(pipeline_.OnMethod(kClassBasic, kBasicConsumeOk, empty));
+  EXPECT_EQ(2u, errors_.size());
+  EXPECT_EQ(1u, pipeline_.outstanding());
+}
+
+TEST_F(ChannelPipelineTest, CloseFailsCallbacksAndDeferreds) {
+  TopologyCache cache;
+  pipeline_.set_topology_cache(&cache);
+  cache.AddExchange("ex", "topic", kDurable, Table(), cache.generation());
+
+  pipeline_.SetQos(1, false, Push(1), Error());
+  pipeline_.Flush();
+  std::vector<std::string> rejected;
+  int finalized = 0;
+  pipeline_.BindQueue("jobs", "ex", "k", Table())
+      .OnSuccess(Push(2))
+      .OnError([&rejected](const char* message) {
+        rejected.push_back(message);
+      })
+      .OnFinalize([&finalized]() { ++finalized; });
+  // Answered from the cache, but still behind Basic.Qos.
+  pipeline_.DeclareExchange("ex", "topic", kDurable, Table(), Push(3),
+                            Error());
+  EXPECT_GT(pipeline_.buffered_bytes(), 0u);
+
+  pipeline_.OnChannelClose("NOT_FOUND");
+  EXPECT_TRUE(order_.empty());
+  EXPECT_EQ(std::vector<std::string>({"NOT_FOUND", "NOT_FOUND"}), errors_);
+  EXPECT_EQ(std::vector<std::string>({"NOT_FOUND"}), rejected);
+  EXPECT_EQ(1, finalized);
+  EXPECT_EQ(0u, pipeline_.outstanding());
+  EXPECT_EQ(0u, pipeline_.buffered_bytes());
+  EXPECT_EQ(0u, pipeline_.deferreds().outstanding());
+  // The broker may have dropped what the cache remembered.
+  EXPECT_EQ(0u, cache.size());
+
+  // Nothing buffered before the close is sent afterwards.
+  pipeline_.Flush();
+  EXPECT_EQ(1, delegate_.writes);
+}
+
+} // namespace
+
+} // namespace amqp
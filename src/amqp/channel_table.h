@@ -0,0 +1,105 @@
+#ifndef AMQP_CHANNEL_TABLE_H_
+#define AMQP_CHANNEL_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "base/macros.h"
+
+namespace amqp {
+
+// Channel id -> T for one connection, as a dense array.
+//
+// Ids are bounded by the channel-max agreed in Connection.Tune and are
+// handed out lowest-first, so the table stays small and a lookup for every
+// incoming frame is a bounds check and an index. Channel 0 belongs to the
+// connection and is never stored.
+//
+// T is typically a pointer; a default constructed T marks a free slot only
+// in the sense that Find() will not return it.
+template <typename T>
+class ChannelTable {
+ public:
+  // 0 means no limit other than the 16-bit id space.
+  explicit ChannelTable(uint16_t channel_max = 0)
+    : channel_max_(channel_max ? channel_max : 0xffff),
+      size_(0),
+      first_free_(1) {}
+
+  uint16_t channel_max() const { return channel_max_; }
+  // Applied after tuning. Channels above a lowered limit stay reachable until
+  // erased, but Allocate() no longer hands such ids out.
+  void set_channel_max(uint16_t channel_max) {
+    channel_max_ = channel_max ? channel_max : 0xffff;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  T* Find(uint16_t id) {
+    return id < used_.size() && used_[id] ? &values_[id] : nullptr;
+  }
+  const T* Find(uint16_t id) const {
+    return id < used_.size() && used_[id] ? &values_[id] : nullptr;
+  }
+
+  // Returns the lowest free id, or 0 when all ids up to channel_max are
+  // taken. The id is not reserved until Insert().
+  uint16_t Allocate() const {
+    for (size_t id = first_free_; id <= channel_max_; ++id) {
+      if (id >= used_.size() || !used_[id]) return static_cast<uint16_t>(id);
+    }
+    return 0;
+  }
+
+  // Returns false if |id| is 0 or already in use.
+  bool Insert(uint16_t id, T value) {
+    if (id == 0) return false;
+    if (id >= used_.size()) {
+      used_.resize(id + 1, false);
+      values_.resize(id + 1);
+    }
+    if (used_[id]) return false;
+    used_[id] = true;
+    values_[id] = std::move(value);
+    ++size_;
+    if (id == first_free_) AdvanceFirstFree();
+    return true;
+  }
+
+  bool Erase(uint16_t id) {
+    if (id >= used_.size() || !used_[id]) return false;
+    used_[id] = false;
+    values_[id] = T();
+    --size_;
+    if (id < first_free_) first_free_ = id;
+    return true;
+  }
+
+  // Calls |f(id, value)| for every channel in id order.
+  template <typename F>
+  void ForEach(F f) {
+    for (size_t id = 1; id < used_.size(); ++id) {
+      if (used_[id]) f(static_cast<uint16_t>(id), values_[id]);
+    }
+  }
+
+ private:
+  void AdvanceFirstFree() {
+    while (first_free_ < used_.size() && used_[first_free_]) ++first_free_;
+  }
+
+  uint16_t channel_max_;
+  size_t size_;
+  // No id below this one is free.
+  size_t first_free_;
+  std::vector<bool> used_;
+  std::vector<T> values_;
+
+  DISALLOW_COPY_AND_ASSIGN(ChannelTable);
+};
+
+} // namespace amqp
+#endif // AMQP_CHANNEL_TABLE_H_
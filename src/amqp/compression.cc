@@ -0,0 +1,161 @@
+#include "amqp/compression.h"
+
+#include <string.h>
+
+#include "base/byteorder.h"
+#include "base/lz_block.h"
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+namespace {
+
+const size_t kSizeHeader = sizeof(uint32_t);
+
+} // namespace
+
+const char LzCodec::kName[] = "x-lz-block";
+
+LzCodec::LzCodec() : name_(kName) {}
+
+size_t LzCodec::MaxCompressedSize(size_t size) const {
+  return kSizeHeader + base::LzMaxCompressedSize(size);
+}
+
+size_t LzCodec::Compress(const char* data, size_t size, char* out) const {
+  CHECK_LE(size, 0xffffffffu);
+  uint32_t length = base::HostToNet32(static_cast<uint32_t>(size));
+  memcpy(out, &length, sizeof(length));
+  return kSizeHeader + base::LzCompress(data, size, out + kSizeHeader);
+}
+
+bool LzCodec::Decompress(const char* data, size_t size, size_t max_size,
+                         std::string* out) const {
+  if (size < kSizeHeader) return false;
+  uint32_t length;
+  memcpy(&length, data, sizeof(length));
+  length = base::NetToHost32(length);
+  // A block expands at most about 255x (one byte per 255-run of a
+  // match); refuse sizes no block of this length could produce.
+  if (length / 256 > size || length > max_size) return false;
+  out->resize(length);
+  if (!base::LzDecompress(data + kSizeHeader, size - kSizeHeader,
+                          length ? &(*out)[0] : nullptr, length)) {
+    out->clear();
+    return false;
+  }
+  return true;
+}
+
+CodecRegistry::CodecRegistry() {
+  codecs_.emplace_back(new LzCodec);
+}
+
+CodecRegistry::~CodecRegistry() {}
+
+void CodecRegistry::Register(std::unique_ptr<Codec> codec) {
+  for (std::unique_ptr<Codec>& existing : codecs_) {
+    if (existing->name() == codec->name()) {
+      existing = std::move(codec);
+      return;
+    }
+  }
+  codecs_.push_back(std::move(codec));
+}
+
+const Codec* CodecRegistry::Find(const base::StringPiece& name) const {
+  for (const std::unique_ptr<Codec>& codec : codecs_) {
+    if (name == codec->name()) return codec.get();
+  }
+  return nullptr;
+}
+
+CompressionStage::CompressionStage(const Options& options,
+                                   const CodecRegistry* registry)
+  : options_(options),
+    registry_(registry),
+    codec_(registry->Find(options.codec)),
+    sampling_(false),
+    until_sample_(0) {
+  CHECK(codec_) << "no codec registered as " << options_.codec;
+}
+
+CompressionStage::~CompressionStage() {}
+
+std::unique_ptr<OutBuffer> CompressionStage::Compress(const char* body,
+                                                      size_t size,
+                                                      MetaData* properties) {
+  if (size < options_.threshold ||
+      (properties && properties->Has(MetaData::kContentEncoding))) {
+    return nullptr;
+  }
+  if (sampling_) {
+    if (until_sample_ > 0) {
+      --until_sample_;
+      ++stats_.skipped;
+      return nullptr;
+    }
+    until_sample_ = options_.sample_interval > 0
+                        ? options_.sample_interval - 1 : 0;
+  }
+
+  std::unique_ptr<OutBuffer> buffer =
+      TakeChunk(codec_->MaxCompressedSize(size));
+  size_t compressed = codec_->Compress(body, size, buffer->tail());
+  DCHECK_LE(compressed, buffer->available());
+
+  if (compressed > options_.max_ratio * size) {
+    ++stats_.poor_ratio;
+    if (!sampling_) {
+      sampling_ = true;
+      until_sample_ = options_.sample_interval > 0
+                          ? options_.sample_interval - 1 : 0;
+    }
+    Recycle(std::move(buffer));
+    return nullptr;
+  }
+
+  sampling_ = false;
+  buffer->Advance(compressed);
+  if (properties) properties->set_content_encoding(codec_->name());
+  ++stats_.compressed;
+  stats_.bytes_in += size;
+  stats_.bytes_out += compressed;
+  return buffer;
+}
+
+void CompressionStage::Recycle(std::unique_ptr<OutBuffer> buffer) {
+  if (!buffer || buffer->capacity() != options_.chunk_size ||
+      free_chunks_.size() >= options_.max_free_chunks) {
+    return;
+  }
+  buffer->Clear();
+  free_chunks_.push_back(std::move(buffer));
+}
+
+std::unique_ptr<OutBuffer> CompressionStage::TakeChunk(size_t size) {
+  if (size > options_.chunk_size) {
+    return std::unique_ptr<OutBuffer>(new OutBuffer(size));
+  }
+  if (free_chunks_.empty()) {
+    return std::unique_ptr<OutBuffer>(new OutBuffer(options_.chunk_size));
+  }
+  std::unique_ptr<OutBuffer> chunk = std::move(free_chunks_.back());
+  free_chunks_.pop_back();
+  return chunk;
+}
+
+CompressionStage::DecodeResult CompressionStage::Decompress(
+    MetaData* properties, const char* body, size_t size,
+    std::string* out) const {
+  if (!properties->Has(MetaData::kContentEncoding)) return DECODE_PLAIN;
+  const Codec* codec = registry_->Find(properties->content_encoding());
+  if (codec == nullptr) return DECODE_PLAIN;
+  if (!codec->Decompress(body, size, options_.max_decoded_size, out))
+    return DECODE_FAILED;
+  properties->Clear(MetaData::kContentEncoding);
+  return DECODE_OK;
+}
+
+} // namespace amqp
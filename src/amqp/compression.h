@@ -0,0 +1,198 @@
+#ifndef AMQP_COMPRESSION_H_
+#define AMQP_COMPRESSION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "amqp/meta_data.h"
+#include "amqp/out_buffer.h"
+#include "base/macros.h"
+#include "base/string_piece.h"
+
+namespace amqp {
+
+// A body compression format, named by the content-encoding it is sent
+// with.
+class Codec {
+ public:
+  virtual ~Codec() {}
+
+  virtual const std::string& name() const = 0;
+  virtual size_t MaxCompressedSize(size_t size) const = 0;
+  // Writes at most MaxCompressedSize(size) bytes to |out| and returns how
+  // many.
+  virtual size_t Compress(const char* data, size_t size, char* out) const = 0;
+  // Replaces |out| with the original body. False if |data| is malformed
+  // or would decode to more than |max_size| bytes; the check comes before
+  // anything is allocated for the output.
+  virtual bool Decompress(const char* data, size_t size, size_t max_size,
+                          std::string* out) const = 0;
+};
+
+// The built-in codec: base/lz_block.h behind the uncompressed size, as a
+// 32-bit big-endian length. Sent as content-encoding "x-lz-block".
+class LzCodec : public Codec {
+ public:
+  static const char kName[];
+
+  LzCodec();
+  ~LzCodec() override {}
+
+  const std::string& name() const override { return name_; }
+  size_t MaxCompressedSize(size_t size) const override;
+  size_t Compress(const char* data, size_t size, char* out) const override;
+  bool Decompress(const char* data, size_t size, size_t max_size,
+                  std::string* out) const override;
+
+ private:
+  const std::string name_;
+
+  DISALLOW_COPY_AND_ASSIGN(LzCodec);
+};
+
+// The codecs a CompressionStage can publish with and decode, by name.
+// Starts out with LzCodec. Register() before the registry is shared;
+// lookups are const and may then run on any thread.
+class CodecRegistry {
+ public:
+  CodecRegistry();
+  ~CodecRegistry();
+
+  // Replaces a codec registered under the same name.
+  void Register(std::unique_ptr<Codec> codec);
+  // Null if there is none.
+  const Codec* Find(const base::StringPiece& name) const;
+
+ private:
+  // A handful at most; looked up linearly.
+  std::vector<std::unique_ptr<Codec>> codecs_;
+
+  DISALLOW_COPY_AND_ASSIGN(CodecRegistry);
+};
+
+// Compresses published bodies and decompresses consumed ones.
+//
+// On publish, bodies of at least |threshold| bytes whose properties carry
+// no content-encoding yet are compressed with the configured codec into a
+// pooled OutBuffer chunk, and content-encoding is set to the codec name.
+// A body that would not shrink below |max_ratio| of its size goes out as
+// it is.
+//
+// Compressing what does not compress wastes CPU, so the stage watches the
+// ratio it gets: once a body compresses poorly, only one body in
+// |sample_interval| is tried until one compresses well again. Use one
+// stage per kind of payload so JSON is not judged by the JPEGs sent
+// alongside it.
+//
+// On consume, bodies whose content-encoding names a registered codec are
+// decompressed and the content-encoding is cleared. A body claiming to
+// decode to more than |max_decoded_size| bytes fails without allocating.
+//
+// Publishes that go through a PublishTemplate pass no properties; they use
+// a second template carrying the codec's content-encoding for the bodies
+// that were compressed:
+//
+//   PublishTemplate plain(channel, "events", properties);
+//   PublishTemplate packed = plain.WithContentEncoding(stage.codec_name());
+//   std::unique_ptr<OutBuffer> body = stage.Compress(data, size, nullptr);
+//   if (body) {
+//     packed.Fill(buffer, key, body->data(), body->size(), id, now);
+//     stage.Recycle(std::move(body));
+//   } else {
+//     plain.Fill(buffer, key, data, size, id, now);
+//   }
+//
+// Compress() and Recycle() are not thread-safe; use a stage per
+// publishing thread. Decompress() is const.
+class CompressionStage {
+ public:
+  struct Options {
+    Options()
+      : codec(LzCodec::kName),
+        threshold(1024),
+        max_ratio(0.9),
+        sample_interval(32),
+        chunk_size(256 * 1024),
+        max_free_chunks(16),
+        max_decoded_size(128 * 1024 * 1024) {}
+
+    std::string codec;
+    size_t threshold;
+    double max_ratio;
+    uint32_t sample_interval;
+    // Compressed bodies that fit go into pooled chunks of this size; larger
+    // ones get a buffer of their own.
+    size_t chunk_size;
+    size_t max_free_chunks;
+    // Decompress() refuses bodies that would decode to more.
+    size_t max_decoded_size;
+  };
+
+  struct Stats {
+    Stats()
+      : compressed(0), poor_ratio(0), skipped(0), bytes_in(0),
+        bytes_out(0) {}
+    // Bodies sent compressed.
+    uint64_t compressed;
+    // Bodies tried but sent as they were.
+    uint64_t poor_ratio;
+    // Bodies above the threshold not tried while the ratio was poor.
+    uint64_t skipped;
+    // Sizes before and after, over the compressed bodies.
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+  };
+
+  enum DecodeResult {
+    // Not compressed, or with an encoding no codec is registered for; the
+    // body is to be used as it is.
+    DECODE_PLAIN,
+    DECODE_OK,
+    DECODE_FAILED,
+  };
+
+  // |registry| must outlive the stage and hold |options.codec|.
+  CompressionStage(const Options& options, const CodecRegistry* registry);
+  ~CompressionStage();
+
+  // Returns the compressed body and sets content-encoding in |properties|,
+  // or returns null if |body| is to be sent as it is. Hand the buffer back
+  // with Recycle() once its frames are encoded. With null |properties| the
+  // caller sends a returned body with content-encoding codec_name(), e.g.
+  // through PublishTemplate::WithContentEncoding().
+  std::unique_ptr<OutBuffer> Compress(const char* body, size_t size,
+                                      MetaData* properties);
+  void Recycle(std::unique_ptr<OutBuffer> buffer);
+
+  // With DECODE_OK, |out| holds the body and content-encoding is cleared
+  // from |properties|.
+  DecodeResult Decompress(MetaData* properties, const char* body,
+                          size_t size, std::string* out) const;
+
+  // The content-encoding compressed bodies are sent with.
+  const std::string& codec_name() const { return codec_->name(); }
+  const Stats& stats() const { return stats_; }
+  // Whether bodies are only being sampled because of a poor ratio.
+  bool sampling() const { return sampling_; }
+
+ private:
+  std::unique_ptr<OutBuffer> TakeChunk(size_t size);
+
+  const Options options_;
+  const CodecRegistry* registry_;
+  const Codec* codec_;
+
+  bool sampling_;
+  uint32_t until_sample_;
+  Stats stats_;
+
+  std::vector<std::unique_ptr<OutBuffer>> free_chunks_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompressionStage);
+};
+
+} // namespace amqp
+#endif // AMQP_COMPRESSION_H_
@@ -0,0 +1,204 @@
+#include "amqp/compression.h"
+
+#include <string.h>
+#include <memory>
+#include <string>
+
+#include "amqp/in_buffer.h"
+#include "amqp/protocol.h"
+#include "amqp/publish_template.h"
+#include "base/byteorder.h"
+
+#include <gtest/gtest.h>
+
+namespace amqp {
+
+namespace {
+
+std::string Compressible(size_t size) {
+  std::string body;
+  while (body.size() < size) body += "{\"id\": 12345, \"state\": \"ready\"} ";
+  body.resize(size);
+  return body;
+}
+
+// Random-looking bytes that do not compress.
+std::string Incompressible(size_t size) {
+  std::string body(size, '\0');
+  uint32_t x = 2463534242u;
+  for (size_t i = 0; i < size; ++i) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    body[i] = static_cast<char>(x);
+  }
+  return body;
+}
+
+// The properties and body of the one message in |frames|.
+void Parse(const OutBuffer& frames, std::unique_ptr<MetaData>* properties,
+           std::string* properties_bytes, std::string* body) {
+  const char* p = frames.data();
+  const char* end = p + frames.size();
+  body->clear();
+  while (p < end) {
+    uint8_t type = static_cast<uint8_t>(p[0]);
+    uint32_t size;
+    memcpy(&size, p + 3, 4);
+    size = base::NetToHost32(size);
+    const char* payload = p + kFrameHeaderSize;
+    if (type == kFrameHeader) {
+      // class, weight, body size
+      properties_bytes->assign(payload + 12, size - 12);
+      InBuffer in(properties_bytes->data(), properties_bytes->size());
+      properties->reset(new MetaData(in));
+    } else if (type == kFrameBody) {
+      body->append(payload, size);
+    }
+    p += kFrameOverhead + size;
+  }
+}
+
+TEST(CompressionTest, RoundTrip) {
+  CodecRegistry registry;
+  CompressionStage stage(CompressionStage::Options(), &registry);
+  std::string body = Compressible(64 * 1024);
+  MetaData properties;
+  std::unique_ptr<OutBuffer> packed =
+      stage.Compress(body.data(), body.size(), &properties);
+  ASSERT_TRUE(packed);
+  EXPECT_LT(packed->size(), body.size() / 4);
+  EXPECT_EQ(LzCodec::kName, properties.content_encoding());
+  EXPECT_EQ(1u, stage.stats().compressed);
+
+  std::string out;
+  EXPECT_EQ(CompressionStage::DECODE_OK,
+            stage.Decompress(&properties, packed->data(), packed->size(),
+                             &out));
+  EXPECT_EQ(body, out);
+  EXPECT_FALSE(properties.Has(MetaData::kContentEncoding));
+  EXPECT_TRUE(properties.content_encoding().empty());
+  stage.Recycle(std::move(packed));
+}
+
+TEST(CompressionTest, LeavesSmallEncodedAndPoorBodies) {
+  CodecRegistry registry;
+  CompressionStage::Options options;
+  options.sample_interval = 4;
+  CompressionStage stage(options, &registry);
+
+  MetaData properties;
+  std::string small = Compressible(100);
+  EXPECT_FALSE(stage.Compress(small.data(), small.size(), &properties));
+
+  std::string body = Compressible(8192);
+  MetaData encoded;
+  encoded.set_content_encoding("gzip");
+  EXPECT_FALSE(stage.Compress(body.data(), body.size(), &encoded));
+  EXPECT_EQ("gzip", encoded.content_encoding());
+
+  std::string noise = Incompressible(8192);
+  EXPECT_FALSE(stage.Compress(noise.data(), noise.size(), &properties));
+  EXPECT_EQ(1u, stage.stats().poor_ratio);
+  EXPECT_TRUE(stage.sampling());
+  // Only one body in four is tried while sampling.
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_FALSE(stage.Compress(body.data(), body.size(), &properties));
+  }
+  EXPECT_EQ(3u, stage.stats().skipped);
+  EXPECT_TRUE(stage.Compress(body.data(), body.size(), &properties));
+  EXPECT_FALSE(stage.sampling());
+}
+
+TEST(CompressionTest, PlainAndUnknownEncodings) {
+  CodecRegistry registry;
+  CompressionStage stage(CompressionStage::Options(), &registry);
+  std::string out;
+  MetaData plain;
+  EXPECT_EQ(CompressionStage::DECODE_PLAIN,
+            stage.Decompress(&plain, "abc", 3, &out));
+  MetaData gzip;
+  gzip.set_content_encoding("gzip");
+  EXPECT_EQ(CompressionStage::DECODE_PLAIN,
+            stage.Decompress(&gzip, "abc", 3, &out));
+  MetaData truncated;
+  truncated.set_content_encoding(LzCodec::kName);
+  EXPECT_EQ(CompressionStage::DECODE_FAILED,
+            stage.Decompress(&truncated, "ab", 2, &out));
+}
+
+TEST(CompressionTest, RefusesForgedDecodedSize) {
+  CodecRegistry registry;
+  CompressionStage::Options options;
+  options.max_decoded_size = 1 << 20;
+  CompressionStage stage(options, &registry);
+
+  // Within the codec's own expansion bound, but above the configured cap.
+  std::string forged(64 * 1024, '\0');
+  uint32_t length = base::HostToNet32(0xffffffffu);
+  memcpy(&forged[0], &length, sizeof(length));
+  MetaData properties;
+  properties.set_content_encoding(LzCodec::kName);
+  std::string out;
+  EXPECT_EQ(CompressionStage::DECODE_FAILED,
+            stage.Decompress(&properties, forged.data(), forged.size(),
+                             &out));
+  EXPECT_TRUE(out.empty());
+
+  // A real body over the cap fails the same way.
+  std::string body = Compressible(2 << 20);
+  MetaData sent;
+  std::unique_ptr<OutBuffer> packed =
+      stage.Compress(body.data(), body.size(), &sent);
+  ASSERT_TRUE(packed);
+  EXPECT_EQ(CompressionStage::DECODE_FAILED,
+            stage.Decompress(&sent, packed->data(), packed->size(), &out));
+}
+
+TEST(CompressionTest, PublishesThroughTemplates) {
+  CodecRegistry registry;
+  CompressionStage stage(CompressionStage::Options(), &registry);
+  MetaData properties;
+  properties.set_content_type("application/json");
+  properties.set_app_id("test");
+  PublishTemplate plain(1, "events", properties);
+  PublishTemplate packed = plain.WithContentEncoding(stage.codec_name());
+
+  std::string body = Compressible(16 * 1024);
+  std::unique_ptr<OutBuffer> compressed =
+      stage.Compress(body.data(), body.size(), nullptr);
+  ASSERT_TRUE(compressed);
+  OutBuffer frames(packed.size("key", "id-1", compressed->size()));
+  packed.Fill(frames, "key", compressed->data(), compressed->size(), "id-1",
+              42);
+  stage.Recycle(std::move(compressed));
+
+  std::unique_ptr<MetaData> received;
+  std::string raw_properties, received_body;
+  Parse(frames, &received, &raw_properties, &received_body);
+  ASSERT_TRUE(received);
+  EXPECT_EQ("application/json", received->content_type());
+  EXPECT_EQ("test", received->app_id());
+  EXPECT_EQ("id-1", received->message_id());
+  EXPECT_EQ(42u, received->timestamp());
+  EXPECT_EQ(LzCodec::kName, received->content_encoding());
+
+  std::string out;
+  EXPECT_EQ(CompressionStage::DECODE_OK,
+            stage.Decompress(received.get(), received_body.data(),
+                             received_body.size(), &out));
+  EXPECT_EQ(body, out);
+
+  // The plain template still sends no content-encoding.
+  std::string small = "tiny";
+  OutBuffer plain_frames(plain.size("key", "id-2", small.size()));
+  plain.Fill(plain_frames, "key", small.data(), small.size(), "id-2", 43);
+  Parse(plain_frames, &received, &raw_properties, &received_body);
+  EXPECT_FALSE(received->Has(MetaData::kContentEncoding));
+  EXPECT_EQ("application/json", received->content_type());
+  EXPECT_EQ(small, received_body);
+}
+
+} // namespace
+
+} // namespace amqp
@@ -0,0 +1,82 @@
+#include "amqp/confirm_tracker.h"
+
+#include <algorithm>
+
+namespace amqp {
+
+ConfirmTracker::ConfirmTracker(const ConfirmCallback& callback)
+  : callback_(callback),
+    unconfirmed_(0),
+    next_tag_(1),
+    next_id_(1),
+    histogram_(nullptr) {}
+
+ConfirmTracker::~ConfirmTracker() {}
+
+uint64_t ConfirmTracker::Track(std::string frames) {
+  uint64_t id = next_id_++;
+  pending_.emplace_back(next_tag_++, id, std::move(frames),
+                        histogram_ ? base::TimeTicks::Now()
+                                   : base::TimeTicks());
+  ++unconfirmed_;
+  return id;
+}
+
+void ConfirmTracker::Settle(uint64_t delivery_tag, bool multiple, bool ack) {
+  base::TimeTicks now;
+  if (histogram_) now = base::TimeTicks::Now();
+
+  if (multiple) {
+    while (!pending_.empty() && pending_.front().tag <= delivery_tag) {
+      Pending& front = pending_.front();
+      if (!front.settled) {
+        Sample(front, now);
+        --unconfirmed_;
+        callback_(front.id, ack);
+      }
+      pending_.pop_front();
+    }
+    return;
+  }
+
+  // Tags are increasing along the deque.
+  auto it = std::lower_bound(
+      pending_.begin(), pending_.end(), delivery_tag,
+      [](const Pending& p, uint64_t tag) { return p.tag < tag; });
+  if (it == pending_.end() || it->tag != delivery_tag || it->settled) return;
+  it->settled = true;
+  it->frames.clear();
+  Sample(*it, now);
+  --unconfirmed_;
+  callback_(it->id, ack);
+  PopSettled();
+}
+
+void ConfirmTracker::Sample(const Pending& pending, base::TimeTicks now) {
+  if (histogram_ && !pending.published.is_null())
+    histogram_->Record((now - pending.published).InMicroseconds());
+}
+
+void ConfirmTracker::PopSettled() {
+  while (!pending_.empty() && pending_.front().settled) pending_.pop_front();
+}
+
+void ConfirmTracker::Rebase(
+    const std::function<void(const std::string& frames)>& replay) {
+  std::deque<Pending> pending;
+  pending.swap(pending_);
+  next_tag_ = 1;
+  unconfirmed_ = 0;
+  for (Pending& p : pending) {
+    if (p.settled) continue;
+    if (p.frames.empty()) {
+      callback_(p.id, false);
+      continue;
+    }
+    replay(p.frames);
+    pending_.emplace_back(next_tag_++, p.id, std::move(p.frames), p.published);
+    ++unconfirmed_;
+  }
+}
+
+} // namespace amqp
@@ -0,0 +1,90 @@
+#ifndef AMQP_CONFIRM_TRACKER_H_
+#define AMQP_CONFIRM_TRACKER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <string>
+
+#include "base/histogram.h"
+#include "base/macros.h"
+#include "base/time.h"
+
+namespace amqp {
+
+// Publisher confirms for one channel in confirm mode.
+//
+// Every publish gets the next delivery tag, starting at 1 after
+// Confirm.Select-Ok; Basic.Ack / Basic.Nack settle one tag or, with
+// |multiple|, every tag up to it. Settled messages are reported through the
+// callback with the id they were given by Track(), which stays the same
+// across a reconnect even though the broker numbers the replayed messages
+// afresh.
+//
+// A publish can keep its encoded frames so it can be sent again if the
+// connection is lost before the broker confirms it; see Rebase().
+//
+// Not thread-safe; call from the channel's thread.
+class ConfirmTracker {
+ public:
+  typedef std::function<void(uint64_t id, bool ack)> ConfirmCallback;
+
+  explicit ConfirmTracker(const ConfirmCallback& callback);
+  ~ConfirmTracker();
+
+  // Records a publish and returns its id. |frames| may be empty if the
+  // message does not need to survive a reconnect.
+  uint64_t Track(std::string frames);
+
+  void OnAck(uint64_t delivery_tag, bool multiple) {
+    Settle(delivery_tag, multiple, true);
+  }
+  void OnNack(uint64_t delivery_tag, bool multiple) {
+    Settle(delivery_tag, multiple, false);
+  }
+
+  // Optional; gets every publish-to-confirm latency, in microseconds. A
+  // publish replayed by Rebase() counts from its first send.
+  void set_latency_histogram(base::Histogram* histogram) {
+    histogram_ = histogram;
+  }
+
+  size_t unconfirmed() const { return unconfirmed_; }
+  uint64_t next_delivery_tag() const { return next_tag_; }
+
+  // For a channel reopened in confirm mode after a reconnect: renumbers the
+  // unconfirmed publishes from delivery tag 1, in publish order, and calls
+  // |replay| with the frames of each so they can be sent again in that
+  // order. Publishes tracked without frames are reported as nacked.
+  void Rebase(const std::function<void(const std::string& frames)>& replay);
+
+ private:
+  struct Pending {
+    Pending(uint64_t t, uint64_t i, std::string f, base::TimeTicks p)
+      : tag(t), id(i), settled(false), frames(std::move(f)), published(p) {}
+    uint64_t tag;
+    uint64_t id;
+    bool settled;
+    std::string frames;
+    // Null without a histogram.
+    base::TimeTicks published;
+  };
+
+  void Settle(uint64_t delivery_tag, bool multiple, bool ack);
+  void Sample(const Pending& pending, base::TimeTicks now);
+  void PopSettled();
+
+  ConfirmCallback callback_;
+  // Unsettled publishes and settled ones not yet at the front, by tag.
+  std::deque<Pending> pending_;
+  size_t unconfirmed_;
+  uint64_t next_tag_;
+  uint64_t next_id_;
+  base::Histogram* histogram_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConfirmTracker);
+};
+
+} // namespace amqp
+#endif // AMQP_CONFIRM_TRACKER_H_
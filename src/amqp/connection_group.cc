@@ -0,0 +1,136 @@
+#include "amqp/connection_group.h"
+
+#include <unistd.h>
+#include <string>
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+namespace {
+
+size_t OnlineCpus() {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? static_cast<size_t>(n) : 1;
+}
+
+size_t HashAffinityKey(const base::StringPiece& key) {
+  if (key.empty()) return 0;
+  size_t hash = base::StringPieceHash()(key);
+  // 0 is reserved for "no affinity".
+  return hash == 0 ? 1 : hash;
+}
+
+} // namespace
+
+ConnectionGroup::ConnectionGroup(const Options& options)
+  : options_(options) {
+  size_t n = options_.num_threads ? options_.num_threads : OnlineCpus();
+  size_t cpus = OnlineCpus();
+  loads_.reset(new Load[n]);
+  threads_.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    int cpu = options_.pin_threads
+        ? static_cast<int>((options_.first_cpu + i) % cpus) : -1;
+    threads_.emplace_back(new base::EventLoopThread(
+        "amqp-io-" + std::to_string(i), cpu));
+  }
+}
+
+ConnectionGroup::~ConnectionGroup() {
+  Stop();
+}
+
+void ConnectionGroup::Start() {
+  for (auto& thread : threads_) {
+    thread->Start();
+  }
+}
+
+void ConnectionGroup::Stop() {
+  for (auto& thread : threads_) {
+    thread->Stop();
+  }
+}
+
+ConnectionGroup::Placement ConnectionGroup::Place(
+    const base::StringPiece& affinity_key, uint32_t channels) {
+  Placement placement;
+  placement.affinity = HashAffinityKey(affinity_key);
+  placement.channels = channels;
+
+  if (placement.affinity == 0) {
+    placement.loop = LeastLoaded();
+  } else {
+    std::lock_guard<std::mutex> lock(affinity_lock_);
+    AffinityGroup& group = affinity_[placement.affinity];
+    if (group.connections == 0 || Overloaded(group.loop)) {
+      // New key, or its loop is hot: move the key; existing members stay.
+      group.loop = LeastLoaded();
+    }
+    ++group.connections;
+    placement.loop = group.loop;
+  }
+
+  Load& load = loads_[placement.loop];
+  load.channels.fetch_add(channels, std::memory_order_relaxed);
+  load.connections.fetch_add(1, std::memory_order_relaxed);
+  return placement;
+}
+
+void ConnectionGroup::Remove(const Placement& placement) {
+  DCHECK_LT(placement.loop, threads_.size());
+  Load& load = loads_[placement.loop];
+  load.channels.fetch_sub(placement.channels, std::memory_order_relaxed);
+  load.connections.fetch_sub(1, std::memory_order_relaxed);
+  if (placement.affinity == 0) return;
+
+  std::lock_guard<std::mutex> lock(affinity_lock_);
+  auto it = affinity_.find(placement.affinity);
+  if (it != affinity_.end() && --it->second.connections == 0) {
+    affinity_.erase(it);
+  }
+}
+
+void ConnectionGroup::UpdateChannels(Placement* placement, uint32_t channels) {
+  Load& load = loads_[placement->loop];
+  if (channels > placement->channels) {
+    load.channels.fetch_add(channels - placement->channels,
+                            std::memory_order_relaxed);
+  } else {
+    load.channels.fetch_sub(placement->channels - channels,
+                            std::memory_order_relaxed);
+  }
+  placement->channels = channels;
+}
+
+size_t ConnectionGroup::LeastLoaded() const {
+  size_t best = 0;
+  uint32_t best_channels = channel_load(0);
+  uint32_t best_connections = connection_count(0);
+  for (size_t i = 1; i < threads_.size(); ++i) {
+    uint32_t channels = channel_load(i);
+    uint32_t connections = connection_count(i);
+    // Ties on channels, common while connections are still opening theirs,
+    // go to the loop with fewer connections rather than to loop 0.
+    if (channels < best_channels ||
+        (channels == best_channels && connections < best_connections)) {
+      best = i;
+      best_channels = channels;
+      best_connections = connections;
+    }
+  }
+  return best;
+}
+
+bool ConnectionGroup::Overloaded(size_t loop) const {
+  uint64_t total = 0;
+  for (size_t i = 0; i < threads_.size(); ++i) {
+    total += channel_load(i);
+  }
+  double mean = static_cast<double>(total) / threads_.size();
+  // The +1 keeps a nearly idle group from bouncing keys around.
+  return channel_load(loop) > options_.affinity_overload * mean + 1;
+}
+
+} // namespace amqp
@@ -0,0 +1,114 @@
+#ifndef AMQP_CONNECTION_GROUP_H_
+#define AMQP_CONNECTION_GROUP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "base/event_loop.h"
+#include "base/event_loop_thread.h"
+#include "base/macros.h"
+#include "base/string_piece.h"
+
+namespace amqp {
+
+// Shards connections over N event-loop threads, one per core.
+//
+// A connection is placed once and stays on its loop: its socket I/O and frame
+// encoding all happen there, so one connection never needs a lock. Placement
+// is affinity-aware: connections placed with the same affinity key (usually
+// the queue or exchange their channels work on) share a loop as long as that
+// loop is not overloaded. Everything else goes to the loop with the fewest
+// open channels, and among those to the one with the fewest connections, so
+// connections that have not opened channels yet still spread out.
+//
+// Any thread may hand work to a connection's loop with PostTask(); it goes
+// through the loop's lock-free MPSC inbox.
+class ConnectionGroup {
+ public:
+  struct Options {
+    Options()
+      : num_threads(0),
+        pin_threads(true),
+        first_cpu(0),
+        affinity_overload(1.5) {}
+
+    // 0 means one thread per online core.
+    size_t num_threads;
+    bool pin_threads;
+    int first_cpu;
+    // An affinity key keeps its loop until that loop carries more than this
+    // many times the mean channel load.
+    double affinity_overload;
+  };
+
+  struct Placement {
+    Placement() : loop(0), affinity(0), channels(0) {}
+
+    size_t loop;
+    size_t affinity;  // 0: none.
+    uint32_t channels;
+  };
+
+  explicit ConnectionGroup(const Options& options);
+  ~ConnectionGroup();
+
+  void Start();
+  void Stop();
+
+  // Thread-safe. An empty |affinity_key| only balances on load.
+  Placement Place(const base::StringPiece& affinity_key, uint32_t channels);
+  void Remove(const Placement& placement);
+  // A connection opened or closed channels after it was placed.
+  void UpdateChannels(Placement* placement, uint32_t channels);
+
+  base::EventLoop* LoopFor(const Placement& placement) {
+    return threads_[placement.loop]->loop();
+  }
+
+  void PostTask(const Placement& placement, base::EventLoop::Task task) {
+    LoopFor(placement)->PostTask(std::move(task));
+  }
+
+  size_t size() const { return threads_.size(); }
+  uint32_t channel_load(size_t loop) const {
+    return loads_[loop].channels.load(std::memory_order_relaxed);
+  }
+  uint32_t connection_count(size_t loop) const {
+    return loads_[loop].connections.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // One cache line per loop; Place() reads them all.
+  struct Load {
+    Load() : channels(0), connections(0) {}
+    std::atomic<uint32_t> channels;
+    std::atomic<uint32_t> connections;
+    char padding[64 - 2 * sizeof(std::atomic<uint32_t>)];
+  };
+
+  struct AffinityGroup {
+    AffinityGroup() : loop(0), connections(0) {}
+    size_t loop;
+    uint32_t connections;
+  };
+
+  size_t LeastLoaded() const;
+  bool Overloaded(size_t loop) const;
+
+  Options options_;
+  std::vector<std::unique_ptr<base::EventLoopThread>> threads_;
+  std::unique_ptr<Load[]> loads_;
+
+  std::mutex affinity_lock_;
+  std::unordered_map<size_t, AffinityGroup> affinity_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConnectionGroup);
+};
+
+} // namespace amqp
+#endif // AMQP_CONNECTION_GROUP_H_
@@ -0,0 +1,68 @@
+#include "amqp/connection_group.h"
+
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace amqp {
+
+namespace {
+
+// Placement never needs the loops running.
+ConnectionGroup::Options FourLoops() {
+  ConnectionGroup::Options options;
+  options.num_threads = 4;
+  options.pin_threads = false;
+  return options;
+}
+
+TEST(ConnectionGroupTest, SpreadsConnectionsWithoutChannels) {
+  ConnectionGroup group(FourLoops());
+  std::set<size_t> loops;
+  std::vector<ConnectionGroup::Placement> placements;
+  for (int i = 0; i < 4; ++i) {
+    placements.push_back(group.Place("", 0));
+    loops.insert(placements.back().loop);
+  }
+  EXPECT_EQ(4u, loops.size());
+  for (size_t loop = 0; loop < group.size(); ++loop) {
+    EXPECT_EQ(1u, group.connection_count(loop));
+  }
+
+  // Channels opened later still count first.
+  ConnectionGroup::Placement busy = placements[2];
+  group.UpdateChannels(&busy, 10);
+  group.Remove(placements[0]);
+  ConnectionGroup::Placement next = group.Place("", 0);
+  EXPECT_EQ(placements[0].loop, next.loop);
+  EXPECT_NE(busy.loop, group.Place("", 0).loop);
+}
+
+TEST(ConnectionGroupTest, BalancesOnChannelsFirst) {
+  ConnectionGroup group(FourLoops());
+  ConnectionGroup::Placement heavy = group.Place("", 8);
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_NE(heavy.loop, group.Place("", 1).loop);
+  }
+  EXPECT_EQ(8u, group.channel_load(heavy.loop));
+  EXPECT_EQ(1u, group.connection_count(heavy.loop));
+}
+
+TEST(ConnectionGroupTest, AffinityKeysShareALoop) {
+  ConnectionGroup group(FourLoops());
+  ConnectionGroup::Placement first = group.Place("orders", 1);
+  ConnectionGroup::Placement second = group.Place("orders", 1);
+  EXPECT_EQ(first.loop, second.loop);
+  EXPECT_NE(first.loop, group.Place("billing", 1).loop);
+  EXPECT_EQ(2u, group.connection_count(first.loop));
+
+  group.Remove(first);
+  group.Remove(second);
+  EXPECT_EQ(0u, group.connection_count(first.loop));
+  EXPECT_EQ(0u, group.channel_load(first.loop));
+}
+
+} // namespace
+
+} // namespace amqp
@@ -0,0 +1,106 @@
+#include "amqp/coroutine.h"
+
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+ConsumeCallback ConsumeOperation::OnSuccess(Consumer* consumer) {
+  return [this, consumer](const std::string& consumer_tag) {
+    consumer->consumer_tag_ = consumer_tag;
+    result_.ok = true;
+    result_.consumer_tag = consumer_tag;
+    Complete();
+  };
+}
+
+void Consumer::OnMessage(Message&& message, uint64_t delivery_tag,
+                         bool redelivered) {
+  DCHECK(!cancelled_) << "delivery after cancel";
+  queue_.emplace_back();
+  Delivery& delivery = queue_.back();
+  delivery.message = std::move(message);
+  delivery.delivery_tag = delivery_tag;
+  delivery.redelivered = redelivered;
+  Wake();
+}
+
+void Consumer::OnCancel() {
+  cancelled_ = true;
+  Wake();
+}
+
+bool Consumer::Pop(Delivery* delivery) {
+  if (queue_.empty()) return false;
+  *delivery = std::move(queue_.front());
+  queue_.pop_front();
+  return true;
+}
+
+void Consumer::Wake() {
+  if (!waiter_) return;
+  std::coroutine_handle<> waiter = waiter_;
+  waiter_ = nullptr;
+  waiter.resume();
+}
+
+CoroutineChannel::CoroutineChannel(ChannelPipeline* pipeline,
+                                   ChannelPipeline::Delegate* delegate)
+  : pipeline_(pipeline),
+    delegate_(delegate),
+    confirms_([this](uint64_t id, bool ack) { OnConfirm(id, ack); }),
+    first_id_(0) {}
+
+CoroutineChannel::~CoroutineChannel() {}
+
+void CoroutineChannel::Send(PublishOperation* operation,
+                            const PublishTemplate& message,
+                            const base::StringPiece& routing_key,
+                            const char* body,
+                            uint64_t body_size,
+                            const base::StringPiece& id,
+                            uint64_t timestamp) {
+  // Keep the publish behind the methods issued before it.
+  pipeline_->Flush();
+
+  size_t size = message.size(routing_key, id, body_size);
+  if (!publish_buffer_ || publish_buffer_->capacity() < size) {
+    publish_buffer_.reset(new OutBuffer(size));
+  }
+  publish_buffer_->Clear();
+  message.Fill(*publish_buffer_, routing_key, body, body_size, id, timestamp);
+  delegate_->SendFrames(*publish_buffer_);
+
+  uint64_t confirm_id = confirms_.Track(std::string());
+  if (publishes_.empty()) first_id_ = confirm_id;
+  DCHECK_EQ(first_id_ + publishes_.size(), confirm_id);
+  publishes_.push_back(operation);
+}
+
+void CoroutineChannel::OnConfirm(uint64_t id, bool ack) {
+  // Ids from before an OnChannelClose() are no longer waited for.
+  if (id < first_id_ || id - first_id_ >= publishes_.size()) return;
+  PublishOperation*& slot = publishes_[id - first_id_];
+  PublishOperation* operation = slot;
+  slot = nullptr;
+  while (!publishes_.empty() && publishes_.front() == nullptr) {
+    publishes_.pop_front();
+    ++first_id_;
+  }
+  // Last: the resumed coroutine may publish again.
+  if (operation) operation->Confirm(ack);
+}
+
+void CoroutineChannel::OnChannelClose(const char* reason) {
+  std::deque<PublishOperation*> failed;
+  failed.swap(publishes_);
+  pipeline_->OnChannelClose(reason);
+  for (PublishOperation* operation : failed) {
+    if (operation) operation->Confirm(false);
+  }
+}
+
+} // namespace amqp
+
+#endif // __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
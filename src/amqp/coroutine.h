@@ -0,0 +1,506 @@
+#ifndef AMQP_COROUTINE_H_
+#define AMQP_COROUTINE_H_
+
+// Awaitable channel operations. Needs C++20 coroutines; in older language
+// modes this header is empty.
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+
+#include <stddef.h>
+#include <stdint.h>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "amqp/channel_pipeline.h"
+#include "amqp/confirm_tracker.h"
+#include "amqp/message.h"
+#include "amqp/out_buffer.h"
+#include "amqp/publish_template.h"
+#include "amqp/table.h"
+#include "base/frame_pool.h"
+#include "base/macros.h"
+#include "base/string_piece.h"
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+template <typename T = void> class Task;
+inline void Spawn(Task<void> task);
+
+namespace internal {
+
+class PromiseBase {
+ public:
+  // Coroutine frames come from the FramePool, so a coroutine that is
+  // started over and over does not go to malloc each time.
+  static void* operator new(size_t size) {
+    return base::FramePool::Allocate(size);
+  }
+  static void operator delete(void* frame, size_t size) {
+    base::FramePool::Free(frame, size);
+  }
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<Promise> handle) noexcept {
+      PromiseBase& promise = handle.promise();
+      if (promise.continuation_) return promise.continuation_;
+      if (promise.detached_) handle.destroy();
+      return std::noop_coroutine();
+    }
+    void await_resume() noexcept {}
+  };
+  FinalAwaiter final_suspend() noexcept { return {}; }
+
+  void unhandled_exception() { std::terminate(); }
+
+ private:
+  template <typename T> friend class amqp::Task;
+  friend void amqp::Spawn(Task<void> task);
+
+  std::coroutine_handle<> continuation_;
+  bool detached_ = false;
+};
+
+template <typename T>
+class Promise : public PromiseBase {
+ public:
+  Task<T> get_return_object();
+  void return_value(T value) { value_ = std::move(value); }
+  T result() { return std::move(value_); }
+
+ private:
+  T value_;
+};
+
+template <>
+class Promise<void> : public PromiseBase {
+ public:
+  Task<void> get_return_object();
+  void return_void() {}
+  void result() {}
+};
+
+} // namespace internal
+
+// A lazily started coroutine returning T. Awaiting it starts it and resumes
+// the awaiter, without going through a scheduler, once it returns.
+//
+//   amqp::Task<QueueResult> Setup(CoroutineChannel& channel) {
+//     QueueResult queue = co_await channel.DeclareQueue("jobs", kDurable);
+//     if (queue.ok) co_await channel.BindQueue("jobs", "events", "job.#");
+//     co_return queue;
+//   }
+template <typename T>
+class Task {
+ public:
+  typedef internal::Promise<T> promise_type;
+  typedef std::coroutine_handle<promise_type> Handle;
+
+  Task() {}
+  explicit Task(Handle handle) : handle_(handle) {}
+  Task(Task&& other) noexcept : handle_(other.handle_) {
+    other.handle_ = nullptr;
+  }
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      if (handle_) handle_.destroy();
+      handle_ = other.handle_;
+      other.handle_ = nullptr;
+    }
+    return *this;
+  }
+  ~Task() {
+    if (handle_) handle_.destroy();
+  }
+
+  bool valid() const { return static_cast<bool>(handle_); }
+
+  struct Awaiter {
+    bool await_ready() noexcept { return false; }
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<> awaiter) noexcept {
+      handle.promise().continuation_ = awaiter;
+      return handle;
+    }
+    T await_resume() { return handle.promise().result(); }
+
+    Handle handle;
+  };
+  Awaiter operator co_await() && { return Awaiter{handle_}; }
+
+ private:
+  friend void Spawn(Task<void> task);
+
+  Handle handle_;
+
+  DISALLOW_COPY_AND_ASSIGN(Task);
+};
+
+namespace internal {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() {
+  return Task<T>(Task<T>::Handle::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() {
+  return Task<void>(Task<void>::Handle::from_promise(*this));
+}
+
+} // namespace internal
+
+// Starts |task| and lets it run to completion on its own; its frame is
+// freed when it returns.
+inline void Spawn(Task<void> task) {
+  Task<void>::Handle handle = task.handle_;
+  task.handle_ = nullptr;
+  handle.promise().detached_ = true;
+  handle.resume();
+}
+
+// Outcomes of the awaitable operations. |error| is the channel close reason
+// when |ok| is false.
+struct OperationResult {
+  bool ok = false;
+  std::string error;
+};
+
+struct QueueResult : public OperationResult {
+  std::string name;
+  uint32_t message_count = 0;
+  uint32_t consumer_count = 0;
+};
+
+struct ConsumeResult : public OperationResult {
+  std::string consumer_tag;
+};
+
+// One channel operation in flight. It is sent when the operation object is
+// created and only awaited later, so several operations can be created
+// back to back and go out in one write:
+//
+//   auto declared = channel.DeclareQueue("jobs", kDurable);
+//   auto bound = channel.BindQueue("jobs", "events", "job.#");
+//   if (!(co_await declared).ok || !(co_await bound).ok) ...
+//
+// The callbacks it hands to the channel hold only a pointer to it, which
+// std::function stores inline, so awaiting allocates nothing; for the same
+// reason it can be neither copied nor moved, and it must not be destroyed
+// before it completes. The first await sends whatever the channel still
+// has buffered.
+template <typename R>
+class Operation {
+ public:
+  ~Operation() { DCHECK(done_) << "channel operation destroyed in flight"; }
+
+  bool done() const { return done_; }
+
+  ErrorCallback OnError() {
+    return [this](const char* message) {
+      result_.ok = false;
+      result_.error = message ? message : "";
+      Complete();
+    };
+  }
+
+  bool await_ready() const noexcept { return done_; }
+  bool await_suspend(std::coroutine_handle<> waiter) {
+    waiter_ = waiter;
+    // A delegate may answer from within Flush(); resuming the waiter there
+    // would re-enter the coroutine that is still suspending.
+    suspending_ = true;
+    pipeline_->Flush();
+    suspending_ = false;
+    if (done_) waiter_ = nullptr;
+    return !done_;
+  }
+  R await_resume() { return std::move(result_); }
+
+ protected:
+  explicit Operation(ChannelPipeline* pipeline) : pipeline_(pipeline) {}
+
+  void Complete() {
+    done_ = true;
+    if (waiter_ && !suspending_) {
+      std::coroutine_handle<> waiter = waiter_;
+      waiter_ = nullptr;
+      waiter.resume();
+    }
+  }
+
+  R result_;
+
+ private:
+  ChannelPipeline* pipeline_;
+  std::coroutine_handle<> waiter_;
+  bool done_ = false;
+  bool suspending_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(Operation);
+};
+
+// The operations are issued by CoroutineChannel, which passes a functor
+// that starts the call with the operation's callbacks.
+class SuccessOperation : public Operation<OperationResult> {
+ public:
+  template <typename Issue>
+  SuccessOperation(ChannelPipeline* pipeline, const Issue& issue)
+    : Operation<OperationResult>(pipeline) {
+    issue(this);
+  }
+
+  SuccessCallback OnSuccess() {
+    return [this]() {
+      result_.ok = true;
+      Complete();
+    };
+  }
+};
+
+class QueueOperation : public Operation<QueueResult> {
+ public:
+  template <typename Issue>
+  QueueOperation(ChannelPipeline* pipeline, const Issue& issue)
+    : Operation<QueueResult>(pipeline) {
+    issue(this);
+  }
+
+  QueueCallback OnSuccess() {
+    return [this](const std::string& name, uint32_t message_count,
+                  uint32_t consumer_count) {
+      result_.ok = true;
+      result_.name = name;
+      result_.message_count = message_count;
+      result_.consumer_count = consumer_count;
+      Complete();
+    };
+  }
+};
+
+class Consumer;
+
+class ConsumeOperation : public Operation<ConsumeResult> {
+ public:
+  template <typename Issue>
+  ConsumeOperation(ChannelPipeline* pipeline, const Issue& issue)
+    : Operation<ConsumeResult>(pipeline) {
+    issue(this);
+  }
+
+  // Also gives |consumer| its tag.
+  ConsumeCallback OnSuccess(Consumer* consumer);
+};
+
+// A publish waiting for its confirm; resumes with true on Basic.Ack and
+// false on Basic.Nack or if the channel closes first.
+class PublishOperation : public Operation<bool> {
+ public:
+  template <typename Issue>
+  PublishOperation(ChannelPipeline* pipeline, const Issue& issue)
+    : Operation<bool>(pipeline) {
+    result_ = false;
+    issue(this);
+  }
+
+  void Confirm(bool ack) {
+    result_ = ack;
+    Complete();
+  }
+};
+
+// The deliveries of one consumer as an asynchronous stream:
+//
+//   Consumer consumer;
+//   ConsumeResult started = co_await channel.Consume("jobs", 0, &consumer);
+//   Consumer::Delivery delivery;
+//   while (co_await consumer.Next(&delivery)) {
+//     Handle(delivery.message);
+//   }
+//
+// Whoever receives Basic.Deliver for the consumer tag feeds it through
+// OnMessage() (or callback()); deliveries that arrive while nobody awaits
+// are queued. OnCancel() ends the stream once the queue is drained.
+class Consumer {
+ public:
+  struct Delivery {
+    Message message;
+    uint64_t delivery_tag = 0;
+    bool redelivered = false;
+  };
+
+  Consumer() {}
+  ~Consumer() {}
+
+  const std::string& consumer_tag() const { return consumer_tag_; }
+  size_t queued() const { return queue_.size(); }
+  bool cancelled() const { return cancelled_; }
+
+  void OnMessage(Message&& message, uint64_t delivery_tag, bool redelivered);
+  void OnCancel();
+
+  MessageCallback callback() {
+    return [this](Message&& message, uint64_t delivery_tag,
+                  bool redelivered) {
+      OnMessage(std::move(message), delivery_tag, redelivered);
+    };
+  }
+
+  struct NextAwaiter {
+    bool await_ready() const noexcept {
+      return !consumer->queue_.empty() || consumer->cancelled_;
+    }
+    void await_suspend(std::coroutine_handle<> waiter) {
+      consumer->waiter_ = waiter;
+    }
+    // False once the consumer is cancelled and drained.
+    bool await_resume() { return consumer->Pop(delivery); }
+
+    Consumer* consumer;
+    Delivery* delivery;
+  };
+  NextAwaiter Next(Delivery* delivery) { return NextAwaiter{this, delivery}; }
+
+ private:
+  friend class ConsumeOperation;
+
+  bool Pop(Delivery* delivery);
+  void Wake();
+
+  std::string consumer_tag_;
+  std::deque<Delivery> queue_;
+  std::coroutine_handle<> waiter_;
+  bool cancelled_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(Consumer);
+};
+
+// Coroutine front end for one channel: its synchronous methods go through
+// a ChannelPipeline, and publishes are tracked for confirms so awaiting one
+// resumes on its Basic.Ack or Basic.Nack.
+//
+// The owner routes incoming frames as usual: methods to the pipeline,
+// Basic.Ack/Basic.Nack to OnAck()/OnNack(), deliveries to the Consumer.
+// The channel must already be in confirm mode before the first Publish().
+//
+// Publishes are tracked without their frames, so a ConfirmTracker::Rebase()
+// after a reconnect reports them as nacked rather than replaying them.
+//
+// Not thread-safe; coroutines using it run on the channel's I/O thread.
+class CoroutineChannel {
+ public:
+  // |pipeline| and |delegate| (which sends the publishes) must outlive the
+  // channel. Publishes flush the pipeline first, so they stay in order with
+  // the methods issued before them.
+  CoroutineChannel(ChannelPipeline* pipeline,
+                   ChannelPipeline::Delegate* delegate);
+  ~CoroutineChannel();
+
+  QueueOperation DeclareQueue(const std::string& name, uint32_t flags = 0,
+                              const Table& arguments = Table()) {
+    return QueueOperation(pipeline_, [&](QueueOperation* operation) {
+      pipeline_->DeclareQueue(name, flags, arguments, operation->OnSuccess(),
+                              operation->OnError());
+    });
+  }
+
+  SuccessOperation DeclareExchange(const std::string& name,
+                                   const std::string& type,
+                                   uint32_t flags = 0,
+                                   const Table& arguments = Table()) {
+    return SuccessOperation(pipeline_, [&](SuccessOperation* operation) {
+      pipeline_->DeclareExchange(name, type, flags, arguments,
+                                 operation->OnSuccess(),
+                                 operation->OnError());
+    });
+  }
+
+  SuccessOperation BindQueue(const std::string& queue,
+                             const std::string& exchange,
+                             const std::string& routing_key,
+                             const Table& arguments = Table()) {
+    return SuccessOperation(pipeline_, [&](SuccessOperation* operation) {
+      pipeline_->BindQueue(queue, exchange, routing_key, arguments,
+                           operation->OnSuccess(), operation->OnError());
+    });
+  }
+
+  SuccessOperation SetQos(uint16_t prefetch_count, bool global = false) {
+    return SuccessOperation(pipeline_, [&](SuccessOperation* operation) {
+      pipeline_->SetQos(prefetch_count, global, operation->OnSuccess(),
+                        operation->OnError());
+    });
+  }
+
+  // Once it succeeds, |consumer| has its tag and receives the deliveries
+  // the owner routes to it.
+  ConsumeOperation Consume(const std::string& queue, uint32_t flags,
+                           Consumer* consumer,
+                           const std::string& consumer_tag = std::string(),
+                           const Table& arguments = Table()) {
+    return ConsumeOperation(pipeline_, [&](ConsumeOperation* operation) {
+      pipeline_->Consume(queue, consumer_tag, flags, arguments,
+                         operation->OnSuccess(consumer),
+                         operation->OnError());
+    });
+  }
+
+  // Sends the message at once; awaiting the result waits for its confirm.
+  PublishOperation Publish(const PublishTemplate& message,
+                           const base::StringPiece& routing_key,
+                           const char* body,
+                           uint64_t body_size,
+                           const base::StringPiece& id = base::StringPiece(),
+                           uint64_t timestamp = 0) {
+    return PublishOperation(pipeline_, [&](PublishOperation* operation) {
+      Send(operation, message, routing_key, body, body_size, id, timestamp);
+    });
+  }
+
+  void OnAck(uint64_t delivery_tag, bool multiple) {
+    confirms_.OnAck(delivery_tag, multiple);
+  }
+  void OnNack(uint64_t delivery_tag, bool multiple) {
+    confirms_.OnNack(delivery_tag, multiple);
+  }
+  // Fails every pending method and unconfirmed publish.
+  void OnChannelClose(const char* reason);
+
+  ConfirmTracker* confirm_tracker() { return &confirms_; }
+  size_t unconfirmed() const { return confirms_.unconfirmed(); }
+
+ private:
+  void OnConfirm(uint64_t id, bool ack);
+  void Send(PublishOperation* operation,
+            const PublishTemplate& message,
+            const base::StringPiece& routing_key,
+            const char* body,
+            uint64_t body_size,
+            const base::StringPiece& id,
+            uint64_t timestamp);
+
+  ChannelPipeline* pipeline_;
+  ChannelPipeline::Delegate* delegate_;
+  ConfirmTracker confirms_;
+  // Reused for every publish.
+  std::unique_ptr<OutBuffer> publish_buffer_;
+  // Awaiting publishes by confirm id, starting at first_id_; null once
+  // settled.
+  std::deque<PublishOperation*> publishes_;
+  uint64_t first_id_;
+
+  DISALLOW_COPY_AND_ASSIGN(CoroutineChannel);
+};
+
+} // namespace amqp
+
+#endif // __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+#endif // AMQP_COROUTINE_H_
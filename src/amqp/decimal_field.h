@@ -2,7 +2,7 @@
 #define AMQP_DECIMAL_FIELD_H_
 #include "amqp/field.h"
 #include "amqp/out_buffer.h"
-#include "amqp/received_frame.h"
+#include "amqp/in_buffer.h"
 
 #include <cmath>
 #include <ostream>
@@ -15,7 +15,7 @@ class DecimalField : public Field {
     : places_(places),
       number_(number) {}
 
-  DecimalField(ReceivedFrame& frame) {
+  DecimalField(InBuffer& frame) {
     places_ = frame.NextUInt8();
     number_ = frame.NextUInt32();
   }
@@ -0,0 +1,258 @@
+#include "amqp/dedup_window.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "base/string_printf.h"
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+namespace {
+
+const uint64_t kMagic = 0x6e69777075646564ull;  // "dedupwin"
+// Covers the hash function below: change kVersion with it.
+const uint32_t kVersion = 1;
+const uint64_t kHashSeed = 0;
+const int kEntriesPerBucket = 4;
+const int kSlotBits = 24;
+const uint32_t kSlotMask = (1u << kSlotBits) - 1;
+const int kMaxKicks = 500;
+
+uint32_t Entry(uint32_t tag, uint32_t slot) {
+  return (tag << kSlotBits) | (slot + 1);
+}
+
+uint32_t SlotOf(uint32_t entry) {
+  return (entry & kSlotMask) - 1;
+}
+
+// MurmurHash64A. The ring persists these values, so this is a copy pinned
+// to the file format rather than base::HashBytes(), which may change
+// between releases. It matches what version 1 files were written with.
+uint64_t PinnedHash(const char* data, size_t size) {
+  const uint64_t m = 0xc6a4a7935bd1e995ULL;
+  const int r = 47;
+
+  uint64_t h = kHashSeed ^ (size * m);
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+  const unsigned char* end = p + (size & ~static_cast<size_t>(7));
+  for (; p != end; p += 8) {
+    uint64_t k;
+    memcpy(&k, p, sizeof(k));
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    h ^= k;
+    h *= m;
+  }
+
+  switch (size & 7) {
+    case 7: h ^= static_cast<uint64_t>(p[6]) << 48;  // fallthrough
+    case 6: h ^= static_cast<uint64_t>(p[5]) << 40;  // fallthrough
+    case 5: h ^= static_cast<uint64_t>(p[4]) << 32;  // fallthrough
+    case 4: h ^= static_cast<uint64_t>(p[3]) << 24;  // fallthrough
+    case 3: h ^= static_cast<uint64_t>(p[2]) << 16;  // fallthrough
+    case 2: h ^= static_cast<uint64_t>(p[1]) << 8;   // fallthrough
+    case 1: h ^= static_cast<uint64_t>(p[0]);
+            h *= m;
+  }
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  return h;
+}
+
+} // namespace
+
+struct DedupWindow::Header {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t capacity;
+  // Ids ever inserted; the next one goes to slot next % capacity.
+  uint64_t next;
+  uint64_t reserved;
+};
+
+// static
+base::Status DedupWindow::Open(const base::FilePath& path,
+                               uint32_t capacity,
+                               std::unique_ptr<DedupWindow>* window) {
+  if (capacity == 0 || capacity > kMaxCapacity) {
+    return base::Status(base::INVALID_ARGUMENT,
+                        base::StringPrintf("dedup: bad capacity %u",
+                                           capacity));
+  }
+
+  std::unique_ptr<DedupWindow> opened(new DedupWindow(capacity));
+  int64_t size = sizeof(Header) + sizeof(uint64_t) * capacity;
+  if (!opened->file_.Initialize(path,
+                                base::MemoryMappedFile::READ_WRITE_EXTEND,
+                                size)) {
+    return base::Status(base::UNAVAILABLE,
+                        "dedup: cannot map " + path.value());
+  }
+
+  Header* header = reinterpret_cast<Header*>(opened->file_.data());
+  opened->header_ = header;
+  if (header->magic != kMagic || header->version != kVersion ||
+      header->capacity != capacity ||
+      opened->file_.length() < static_cast<size_t>(size)) {
+    if (header->magic != 0) {
+      LOG(WARNING) << "dedup: starting " << path.value() << " afresh";
+    }
+    // The mapping never shrinks the file: after a capacity change the tail
+    // of a longer file stays, unused, and is accepted on later opens.
+    memset(opened->file_.data(), 0, size);
+    header->magic = kMagic;
+    header->version = kVersion;
+    header->capacity = capacity;
+  }
+
+  uint64_t* slots = opened->slots();
+  for (uint32_t slot = 0; slot < capacity; ++slot) {
+    if (slots[slot] != 0) opened->Index(slot, slots[slot]);
+  }
+  *window = std::move(opened);
+  return base::Status::OK();
+}
+
+DedupWindow::DedupWindow(uint32_t capacity)
+  : capacity_(capacity),
+    header_(nullptr),
+    victim_(0),
+    redelivered_only_(false) {
+  // At most 3/4 full, so cuckoo insertion practically never fails.
+  uint32_t buckets = 1;
+  while (buckets * kEntriesPerBucket * 3 < capacity * 4ull) buckets <<= 1;
+  table_.assign(buckets * kEntriesPerBucket, 0);
+  bucket_mask_ = buckets - 1;
+}
+
+DedupWindow::~DedupWindow() {}
+
+// static
+uint64_t DedupWindow::Hash(const base::StringPiece& id) {
+  uint64_t hash = PinnedHash(id.data(), id.size());
+  // 0 marks an empty ring slot.
+  return hash ? hash : 1;
+}
+
+uint64_t* DedupWindow::slots() const {
+  return reinterpret_cast<uint64_t*>(header_ + 1);
+}
+
+uint32_t DedupWindow::Bucket(uint64_t hash, int which) const {
+  return static_cast<uint32_t>(which ? hash >> 24 : hash) & bucket_mask_;
+}
+
+bool DedupWindow::Find(uint64_t hash, uint32_t* bucket, int* entry) const {
+  const uint32_t tag = Tag(hash);
+  const uint64_t* ring = slots();
+  for (int which = 0; which < 2; ++which) {
+    uint32_t b = Bucket(hash, which);
+    const uint32_t* entries = &table_[b * kEntriesPerBucket];
+    for (int i = 0; i < kEntriesPerBucket; ++i) {
+      if (entries[i] != 0 && entries[i] >> kSlotBits == tag &&
+          ring[SlotOf(entries[i])] == hash) {
+        *bucket = b;
+        *entry = i;
+        return true;
+      }
+    }
+  }
+  for (size_t i = 0; i < stash_.size(); ++i) {
+    if (ring[SlotOf(stash_[i])] == hash) {
+      *bucket = kSlotMask;
+      *entry = static_cast<int>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+void DedupWindow::Index(uint32_t slot, uint64_t hash) {
+  uint32_t entry = Entry(Tag(hash), slot);
+  uint32_t bucket = Bucket(hash, 0);
+  for (int kick = 0; kick < kMaxKicks; ++kick) {
+    uint32_t* entries = &table_[bucket * kEntriesPerBucket];
+    for (int i = 0; i < kEntriesPerBucket; ++i) {
+      if (entries[i] == 0) {
+        entries[i] = entry;
+        return;
+      }
+    }
+    if (kick == 0) {
+      uint32_t other = Bucket(hash, 1);
+      uint32_t* alternates = &table_[other * kEntriesPerBucket];
+      for (int i = 0; i < kEntriesPerBucket; ++i) {
+        if (alternates[i] == 0) {
+          alternates[i] = entry;
+          return;
+        }
+      }
+    }
+    // Evict a resident and move it to its other bucket.
+    int i = static_cast<int>(victim_++ % kEntriesPerBucket);
+    std::swap(entry, entries[i]);
+    uint64_t moved = slots()[SlotOf(entry)];
+    bucket = Bucket(moved, 0) == bucket ? Bucket(moved, 1) : Bucket(moved, 0);
+  }
+  stash_.push_back(entry);
+}
+
+void DedupWindow::Unindex(uint32_t slot, uint64_t hash) {
+  uint32_t bucket;
+  int entry;
+  bool found = Find(hash, &bucket, &entry);
+  DCHECK(found);
+  if (!found) return;
+  if (bucket == kSlotMask) {
+    stash_.erase(stash_.begin() + entry);
+    return;
+  }
+  DCHECK_EQ(slot, SlotOf(table_[bucket * kEntriesPerBucket + entry]));
+  table_[bucket * kEntriesPerBucket + entry] = 0;
+}
+
+bool DedupWindow::Contains(const base::StringPiece& id) const {
+  uint32_t bucket;
+  int entry;
+  return Find(Hash(id), &bucket, &entry);
+}
+
+bool DedupWindow::Insert(const base::StringPiece& id) {
+  uint64_t hash = Hash(id);
+  uint32_t bucket;
+  int entry;
+  if (Find(hash, &bucket, &entry)) return false;
+
+  uint32_t slot = static_cast<uint32_t>(header_->next % capacity_);
+  uint64_t* ring = slots();
+  if (ring[slot] != 0) {
+    Unindex(slot, ring[slot]);
+  }
+  ring[slot] = hash;
+  ++header_->next;
+  Index(slot, hash);
+  return true;
+}
+
+bool DedupWindow::Admit(const MetaData& properties, bool redelivered) const {
+  if (redelivered_only_ && !redelivered) return true;
+  if (!properties.Has(MetaData::kMessageId)) return true;
+  return !Contains(properties.message_id());
+}
+
+bool DedupWindow::Sync() {
+  return file_.Flush();
+}
+
+uint32_t DedupWindow::size() const {
+  return static_cast<uint32_t>(
+      std::min<uint64_t>(header_->next, capacity_));
+}
+
+} // namespace amqp
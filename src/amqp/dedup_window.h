@@ -0,0 +1,104 @@
+#ifndef AMQP_DEDUP_WINDOW_H_
+#define AMQP_DEDUP_WINDOW_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "amqp/meta_data.h"
+#include "base/file_path.h"
+#include "base/macros.h"
+#include "base/memory_mapped_file.h"
+#include "base/status.h"
+#include "base/string_piece.h"
+
+namespace amqp {
+
+// Remembers the message-ids of the last |capacity| processed messages so an
+// idempotent consumer can drop redeliveries it has already handled.
+//
+// The ids are kept as 64-bit hashes in a ring in a memory-mapped file,
+// oldest overwritten first, so the window survives a restart (and, once
+// Sync() has run, a machine crash). In memory the ring is indexed by a
+// cuckoo table of 32-bit entries: the ring slot plus an 8-bit tag from the
+// hash. A lookup probes two buckets of four entries, compares tags, and
+// only reads the ring for a tag match, which also makes it exact. An
+// overwritten slot is simply deleted from the table, which is why this is
+// a cuckoo table and not a Bloom filter.
+//
+// Use it in front of the MessageCallback:
+//
+//   if (!window->Admit(properties, redelivered)) { ack; return; }
+//   process(message);
+//   window->Insert(properties.message_id());
+//
+// Inserting only after processing means a crash in between makes the
+// message come back rather than be lost.
+//
+// Not thread-safe.
+class DedupWindow {
+ public:
+  // At most 2^24 - 1 ids.
+  static const uint32_t kMaxCapacity = (1u << 24) - 1;
+
+  // Opens or creates the ring at |path|. A file with another capacity or
+  // format is started afresh.
+  static base::Status Open(const base::FilePath& path,
+                           uint32_t capacity,
+                           std::unique_ptr<DedupWindow>* window);
+  ~DedupWindow();
+
+  bool Contains(const base::StringPiece& id) const;
+  // Returns false, changing nothing, if |id| is already in the window.
+  bool Insert(const base::StringPiece& id);
+
+  // False if the message should be dropped as a duplicate. Messages without
+  // a message-id are always admitted. With |redelivered_only| set (see
+  // set_redelivered_only), first deliveries skip the lookup.
+  bool Admit(const MetaData& properties, bool redelivered) const;
+  void set_redelivered_only(bool redelivered_only) {
+    redelivered_only_ = redelivered_only;
+  }
+
+  // Forces the ring to disk.
+  bool Sync();
+
+  uint32_t capacity() const { return capacity_; }
+  // Ids in the window.
+  uint32_t size() const;
+
+ private:
+  struct Header;
+
+  DedupWindow(uint32_t capacity);
+
+  static uint64_t Hash(const base::StringPiece& id);
+  static uint32_t Tag(uint64_t hash) {
+    return static_cast<uint32_t>(hash >> 56);
+  }
+
+  uint64_t* slots() const;
+  uint32_t Bucket(uint64_t hash, int which) const;
+  bool Find(uint64_t hash, uint32_t* bucket, int* entry) const;
+  void Index(uint32_t slot, uint64_t hash);
+  void Unindex(uint32_t slot, uint64_t hash);
+
+  const uint32_t capacity_;
+  base::MemoryMappedFile file_;
+  Header* header_;
+
+  // kEntriesPerBucket entries per bucket: (tag << 24) | (slot + 1), or 0.
+  std::vector<uint32_t> table_;
+  uint32_t bucket_mask_;
+  // Entries that found no place in the table; almost always empty.
+  std::vector<uint32_t> stash_;
+  uint32_t victim_;
+
+  bool redelivered_only_;
+
+  DISALLOW_COPY_AND_ASSIGN(DedupWindow);
+};
+
+} // namespace amqp
+#endif // AMQP_DEDUP_WINDOW_H_
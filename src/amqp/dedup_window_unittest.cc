@@ -0,0 +1,108 @@
+#include "amqp/dedup_window.h"
+
+#include <memory>
+#include <string>
+
+#include "base/scoped_temp_dir.h"
+
+#include <gtest/gtest.h>
+
+namespace amqp {
+
+namespace {
+
+class DedupWindowTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(dir_.CreateUniqueTempDir());
+    path_ = dir_.path().AppendASCII("window");
+  }
+
+  std::unique_ptr<DedupWindow> Open(uint32_t capacity) {
+    std::unique_ptr<DedupWindow> window;
+    base::Status status = DedupWindow::Open(path_, capacity, &window);
+    EXPECT_TRUE(status.ok()) << status.ToString();
+    return window;
+  }
+
+  base::ScopedTempDir dir_;
+  base::FilePath path_;
+};
+
+TEST_F(DedupWindowTest, InsertAndEvictOldest) {
+  std::unique_ptr<DedupWindow> window = Open(3);
+  ASSERT_TRUE(window);
+  EXPECT_TRUE(window->Insert("a"));
+  EXPECT_FALSE(window->Insert("a"));
+  EXPECT_TRUE(window->Insert("b"));
+  EXPECT_TRUE(window->Insert("c"));
+  EXPECT_EQ(3u, window->size());
+  EXPECT_TRUE(window->Insert("d"));
+  EXPECT_EQ(3u, window->size());
+  EXPECT_FALSE(window->Contains("a"));
+  EXPECT_TRUE(window->Contains("b"));
+  EXPECT_TRUE(window->Contains("d"));
+}
+
+TEST_F(DedupWindowTest, AdmitDropsSeenIds) {
+  std::unique_ptr<DedupWindow> window = Open(16);
+  ASSERT_TRUE(window);
+  MetaData properties;
+  EXPECT_TRUE(window->Admit(properties, true));
+  properties.set_message_id("m1");
+  EXPECT_TRUE(window->Admit(properties, false));
+  window->Insert("m1");
+  EXPECT_FALSE(window->Admit(properties, false));
+  window->set_redelivered_only(true);
+  EXPECT_TRUE(window->Admit(properties, false));
+  EXPECT_FALSE(window->Admit(properties, true));
+}
+
+TEST_F(DedupWindowTest, SurvivesRestart) {
+  {
+    std::unique_ptr<DedupWindow> window = Open(1000);
+    ASSERT_TRUE(window);
+    for (int i = 0; i < 1500; ++i) window->Insert(std::to_string(i));
+    EXPECT_TRUE(window->Sync());
+  }
+  std::unique_ptr<DedupWindow> window = Open(1000);
+  ASSERT_TRUE(window);
+  EXPECT_EQ(1000u, window->size());
+  EXPECT_FALSE(window->Contains("499"));
+  EXPECT_TRUE(window->Contains("500"));
+  EXPECT_TRUE(window->Contains("1499"));
+}
+
+TEST_F(DedupWindowTest, CapacityChangeStartsAfreshOnce) {
+  {
+    std::unique_ptr<DedupWindow> window = Open(1000);
+    ASSERT_TRUE(window);
+    window->Insert("old");
+  }
+  {
+    // The file stays longer than a 500-id ring needs.
+    std::unique_ptr<DedupWindow> window = Open(500);
+    ASSERT_TRUE(window);
+    EXPECT_EQ(0u, window->size());
+    EXPECT_FALSE(window->Contains("old"));
+    window->Insert("new");
+  }
+  {
+    std::unique_ptr<DedupWindow> window = Open(500);
+    ASSERT_TRUE(window);
+    EXPECT_EQ(1u, window->size());
+    EXPECT_TRUE(window->Contains("new"));
+  }
+  // Growing again starts afresh too.
+  std::unique_ptr<DedupWindow> window = Open(2000);
+  ASSERT_TRUE(window);
+  EXPECT_EQ(0u, window->size());
+  window->Insert("grown");
+  window.reset();
+  window = Open(2000);
+  EXPECT_TRUE(window->Contains("grown"));
+}
+
+} // namespace
+
+} // namespace amqp
@@ -0,0 +1,58 @@
+#include "amqp/deferred.h"
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+void Deferred::Resolve() {
+  if (success_) success_();
+  Finish();
+}
+
+void Deferred::Reject(const char* message) {
+  if (error_) error_(message);
+  Finish();
+}
+
+void Deferred::Finish() {
+  if (finalize_) finalize_();
+  slab_->Release(this);
+}
+
+const size_t DeferredSlab::kBlockSize;
+
+DeferredSlab::DeferredSlab() : free_(nullptr), outstanding_(0) {}
+
+DeferredSlab::~DeferredSlab() {}
+
+Deferred& DeferredSlab::Allocate() {
+  if (free_ == nullptr) {
+    blocks_.emplace_back(new Block);
+    Block* block = blocks_.back().get();
+    // Thread the new block onto the free list in address order.
+    for (size_t i = kBlockSize; i-- > 0;) {
+      block->items[i].slab_ = this;
+      block->items[i].next_free_ = free_;
+      free_ = &block->items[i];
+    }
+  }
+  Deferred* deferred = free_;
+  free_ = deferred->next_free_;
+  deferred->next_free_ = nullptr;
+  ++outstanding_;
+  return *deferred;
+}
+
+void DeferredSlab::Release(Deferred* deferred) {
+  DCHECK_EQ(deferred->slab_, this);
+  DCHECK_GT(outstanding_, 0u);
+  // Drop what the callbacks captured now rather than on reuse.
+  deferred->success_ = nullptr;
+  deferred->error_ = nullptr;
+  deferred->finalize_ = nullptr;
+  deferred->next_free_ = free_;
+  free_ = deferred;
+  --outstanding_;
+}
+
+} // namespace amqp
@@ -0,0 +1,114 @@
+#ifndef AMQP_DEFERRED_H_
+#define AMQP_DEFERRED_H_
+
+#include <stddef.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "amqp/callbacks.h"
+#include "base/macros.h"
+#include "base/small_function.h"
+
+namespace amqp {
+
+class DeferredSlab;
+
+// The pending outcome of a channel operation, on which the caller chains
+// what to run next:
+//
+//   pipeline.BindQueue("jobs", "events", "job.#", Table())
+//       .OnSuccess([this]() { bound_ = true; })
+//       .OnError([](const char* message) { LOG(ERROR) << message; })
+//       .OnFinalize([this]() { Next(); });
+//
+// Exactly one of the success and error callbacks runs, then the finalize
+// callback. Each accepts a SuccessCallback, ErrorCallback or
+// FinalizeCallback, or any callable with the same signature, and keeps it
+// in inline storage; a lambda capturing a few pointers or one of those
+// std::functions costs no allocation. Setting a callback again replaces it.
+//
+// Deferreds come from their channel's DeferredSlab and go back to it after
+// the finalize callback, so the reference is only good until then.
+class Deferred {
+ public:
+  template <typename F>
+  Deferred& OnSuccess(F&& callback) {
+    success_ = Success(std::forward<F>(callback));
+    return *this;
+  }
+  template <typename F>
+  Deferred& OnError(F&& callback) {
+    error_ = Error(std::forward<F>(callback));
+    return *this;
+  }
+  template <typename F>
+  Deferred& OnFinalize(F&& callback) {
+    finalize_ = Finalize(std::forward<F>(callback));
+    return *this;
+  }
+
+  // For the channel. Either one reports the outcome and releases the
+  // deferred.
+  void Resolve();
+  void Reject(const char* message);
+
+ private:
+  friend class DeferredSlab;
+
+  typedef base::SmallFunction<void()> Success;
+  typedef base::SmallFunction<void(const char*)> Error;
+  typedef base::SmallFunction<void()> Finalize;
+
+  Deferred() : slab_(nullptr), next_free_(nullptr) {}
+  ~Deferred() {}
+
+  void Finish();
+
+  Success success_;
+  Error error_;
+  Finalize finalize_;
+  DeferredSlab* slab_;
+  Deferred* next_free_;
+
+  DISALLOW_COPY_AND_ASSIGN(Deferred);
+};
+
+// Hands out a channel's Deferreds from blocks of kBlockSize, reusing the
+// released ones through an intrusive free list, so the bookkeeping of an
+// operation does not allocate once the channel has warmed up.
+//
+// Not thread-safe; use it on the channel's thread. Deferreds still
+// outstanding when the slab goes away are dropped without running their
+// callbacks.
+class DeferredSlab {
+ public:
+  static const size_t kBlockSize = 64;
+
+  DeferredSlab();
+  ~DeferredSlab();
+
+  Deferred& Allocate();
+
+  // Deferreds handed out and not yet resolved or rejected.
+  size_t outstanding() const { return outstanding_; }
+  size_t capacity() const { return blocks_.size() * kBlockSize; }
+
+ private:
+  friend class Deferred;
+
+  struct Block {
+    Deferred items[kBlockSize];
+  };
+
+  void Release(Deferred* deferred);
+
+  std::vector<std::unique_ptr<Block>> blocks_;
+  Deferred* free_;
+  size_t outstanding_;
+
+  DISALLOW_COPY_AND_ASSIGN(DeferredSlab);
+};
+
+} // namespace amqp
+#endif // AMQP_DEFERRED_H_
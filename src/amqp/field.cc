@@ -0,0 +1,58 @@
+#include "amqp/field.h"
+
+#include <string>
+
+#include "amqp/array.h"
+#include "amqp/boolean_set.h"
+#include "amqp/decimal_field.h"
+#include "amqp/numeric_field.h"
+#include "amqp/string_field.h"
+#include "amqp/table.h"
+
+namespace amqp {
+
+Field::operator const std::string& () const {
+  static const std::string* empty = new std::string;
+  return *empty;
+}
+
+Field::operator const Table& () const {
+  // Table itself can not override this: a conversion to its own type is
+  // never used.
+  if (IsTable()) return static_cast<const Table&>(*this);
+  static const Table* empty = new Table;
+  return *empty;
+}
+
+Field::operator const Array& () const {
+  if (IsArray()) return static_cast<const Array&>(*this);
+  static const Array* empty = new Array;
+  return *empty;
+}
+
+// static
+Field* Field::Decode(InBuffer& frame) {
+  char type = static_cast<char>(frame.NextUInt8());
+  switch (type) {
+    case 't': return new BooleanSet(frame);
+    case 'b': return new Octet(frame);
+    case 'B': return new UOctet(frame);
+    case 'U': return new Short(frame);
+    case 'u': return new UShort(frame);
+    case 'I': return new Long(frame);
+    case 'i': return new ULong(frame);
+    case 'L': return new LongLong(frame);
+    case 'l': return new ULongLong(frame);
+    case 'T': return new Timestamp(frame);
+    case 'f': return new Float(frame);
+    case 'd': return new Double(frame);
+    case 'D': return new DecimalField(frame);
+    case 's': return new ShortString(frame);
+    case 'S': return new LongString(frame);
+    case 'A': return new Array(frame);
+    case 'F': return new Table(frame);
+    default:  return nullptr;
+  }
+}
+
+} // namespace amqp
@@ -8,7 +8,7 @@
 
 namespace amqp {
 
-class ReceivedFrame;
+class InBuffer;
 class OutBuffer;
 class Array;
 class Table;
@@ -46,7 +46,7 @@ class Field {
   virtual bool IsString()  const { return false; }
 
  protected:
-  static Field* Decode(ReceivedFrame& frame);
+  static Field* Decode(InBuffer& frame);
 };
 
 inline std::ostream& operator<<(std::ostream& os, const Field& field) {
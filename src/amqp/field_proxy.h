@@ -69,6 +69,16 @@ class FieldProxy {
     return *this;
   }
 
+  FieldProxy& operator=(const std::string& value) {
+    source_->Set(index_, LongString(value));
+    return *this;
+  }
+
+  FieldProxy& operator=(const char* value) {
+    source_->Set(index_, LongString(std::string(value)));
+    return *this;
+  }
+
   
  private:
   T* source_;
@@ -0,0 +1,124 @@
+#include "amqp/frame_batch.h"
+
+#include <mutex>
+
+namespace amqp {
+
+const size_t FrameBatch::kDefaultCapacity;
+const size_t FrameBatch::kTransferBatches;
+
+// Per-thread free list of batches, backed by a shared depot.
+class FrameBatchCache {
+ public:
+  static const size_t kMaxCached = 2 * FrameBatch::kTransferBatches;
+
+  FrameBatchCache() : head_(nullptr), count_(0) {}
+  ~FrameBatchCache();
+
+  static FrameBatchCache& Current() {
+    static thread_local FrameBatchCache cache;
+    return cache;
+  }
+
+  FrameBatch* Get();
+  void Put(FrameBatch* batch);
+
+ private:
+  // Shared overflow; lists move in and out whole.
+  class Depot {
+   public:
+    Depot() : head_(nullptr) {}
+
+    void Put(FrameBatch* first, FrameBatch* last);
+    // Detaches up to |max| batches into |*list|; returns their number.
+    size_t Take(size_t max, FrameBatch** list);
+
+   private:
+    std::mutex lock_;
+    FrameBatch* head_;
+  };
+
+  static Depot& GetDepot() {
+    CR_DEFINE_STATIC_LOCAL(Depot, depot, ());
+    return depot;
+  }
+
+  static FrameBatch*& Next(FrameBatch* batch) { return batch->next_free_; }
+
+  FrameBatch* head_;
+  size_t count_;
+};
+
+void FrameBatchCache::Depot::Put(FrameBatch* first, FrameBatch* last) {
+  std::lock_guard<std::mutex> lock(lock_);
+  Next(last) = head_;
+  head_ = first;
+}
+
+size_t FrameBatchCache::Depot::Take(size_t max, FrameBatch** list) {
+  std::lock_guard<std::mutex> lock(lock_);
+  *list = head_;
+  FrameBatch* last = nullptr;
+  size_t taken = 0;
+  while (head_ != nullptr && taken < max) {
+    last = head_;
+    head_ = Next(head_);
+    ++taken;
+  }
+  if (last != nullptr) Next(last) = nullptr;
+  return taken;
+}
+
+FrameBatchCache::~FrameBatchCache() {
+  // Whatever an exiting thread holds goes to the depot for the others.
+  if (head_ == nullptr) return;
+  FrameBatch* last = head_;
+  while (Next(last) != nullptr) last = Next(last);
+  GetDepot().Put(head_, last);
+}
+
+FrameBatch* FrameBatchCache::Get() {
+  if (head_ == nullptr) {
+    count_ = GetDepot().Take(FrameBatch::kTransferBatches, &head_);
+    if (head_ == nullptr) return new FrameBatch;
+  }
+  FrameBatch* batch = head_;
+  head_ = Next(batch);
+  --count_;
+  return batch;
+}
+
+void FrameBatchCache::Put(FrameBatch* batch) {
+  Next(batch) = head_;
+  head_ = batch;
+  if (++count_ <= kMaxCached) return;
+
+  // Spill the newest kTransferBatches, keep the rest here.
+  FrameBatch* first = head_;
+  FrameBatch* last = head_;
+  for (size_t i = 1; i < FrameBatch::kTransferBatches; ++i) {
+    last = Next(last);
+  }
+  head_ = Next(last);
+  count_ -= FrameBatch::kTransferBatches;
+  GetDepot().Put(first, last);
+}
+
+FrameBatch::FrameBatch()
+  : buffer_(kDefaultCapacity),
+    frames_(0),
+    next_free_(nullptr) {}
+
+// static
+FrameBatch* FrameBatch::Acquire() {
+  return FrameBatchCache::Current().Get();
+}
+
+// static
+void FrameBatch::Release(FrameBatch* batch) {
+  batch->buffer_.Clear();
+  batch->frames_ = 0;
+  FrameBatchCache::Current().Put(batch);
+}
+
+} // namespace amqp
@@ -0,0 +1,54 @@
+#ifndef AMQP_FRAME_BATCH_H_
+#define AMQP_FRAME_BATCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "amqp/out_buffer.h"
+#include "base/macros.h"
+#include "base/mpsc_queue.h"
+
+namespace amqp {
+
+// A chunk of already encoded frames on its way from an application thread to
+// a connection's writer thread.
+//
+// Batches are recycled through a per-thread cache, so the steady state
+// allocates nothing: the producer takes one with Acquire(), encodes into
+// buffer(), hands it to a PublishQueue, and the writer calls Release() once
+// the bytes are on the socket. A thread whose cache grows past a limit (the
+// writer, typically) spills half of it into a shared depot, and a producer
+// whose cache runs dry refills from there, so the depot lock is taken once
+// per kTransferBatches batches, not once per batch.
+class FrameBatch : public base::MpscNode {
+ public:
+  static const size_t kDefaultCapacity = 64 * 1024;
+  static const size_t kTransferBatches = 32;
+
+  // Returns an empty batch of kDefaultCapacity bytes.
+  static FrameBatch* Acquire();
+  // Any thread may release any batch.
+  static void Release(FrameBatch* batch);
+
+  OutBuffer& buffer() { return buffer_; }
+  const OutBuffer& buffer() const { return buffer_; }
+
+  // Number of frames encoded into the buffer; informational only.
+  uint32_t frames() const { return frames_; }
+  void AddFrame() { ++frames_; }
+
+ private:
+  friend class FrameBatchCache;
+
+  FrameBatch();
+  ~FrameBatch() {}
+
+  OutBuffer buffer_;
+  uint32_t frames_;
+  FrameBatch* next_free_;
+
+  DISALLOW_COPY_AND_ASSIGN(FrameBatch);
+};
+
+} // namespace amqp
+#endif // AMQP_FRAME_BATCH_H_
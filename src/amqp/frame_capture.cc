@@ -0,0 +1,157 @@
+#include "amqp/frame_capture.h"
+
+#include <string.h>
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+namespace {
+
+const char kMagic[8] = {'A', 'M', 'Q', 'P', 'C', 'A', 'P', 1};
+
+void AppendVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+} // namespace
+
+// static
+base::Status FrameCapture::Create(const base::FilePath& path,
+                                  std::unique_ptr<FrameCapture>* capture) {
+  base::File file(path, base::File::FLAG_CREATE_ALWAYS |
+                        base::File::FLAG_WRITE);
+  if (!file.IsValid()) {
+    return base::Status(base::UNAVAILABLE,
+                        "capture: cannot create " + path.value() + ": " +
+                            base::File::ErrorToString(file.error_details()));
+  }
+  capture->reset(new FrameCapture(std::move(file)));
+  return base::Status::OK();
+}
+
+FrameCapture::FrameCapture(base::File file)
+  : file_(std::move(file)), frames_(0), failed_(false) {
+  buffer_.reserve(kBufferSize);
+  buffer_.append(kMagic, sizeof(kMagic));
+}
+
+FrameCapture::~FrameCapture() {
+  Flush();
+}
+
+void FrameCapture::Record(CaptureDirection direction,
+                          const char* frame,
+                          size_t size,
+                          base::TimeTicks now) {
+  std::lock_guard<std::mutex> lock(lock_);
+  if (failed_) return;
+
+  // The two threads' clocks may interleave slightly out of order.
+  int64_t delta = frames_ ? (now - last_).InMicroseconds() : 0;
+  if (delta > 0 || frames_ == 0) last_ = now;
+  AppendVarint(delta > 0 ? delta : 0, &buffer_);
+  buffer_.push_back(static_cast<char>(direction));
+  AppendVarint(size, &buffer_);
+  buffer_.append(frame, size);
+  ++frames_;
+
+  if (buffer_.size() >= kBufferSize) FlushLocked();
+}
+
+bool FrameCapture::Flush() {
+  std::lock_guard<std::mutex> lock(lock_);
+  return FlushLocked();
+}
+
+uint64_t FrameCapture::frames() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return frames_;
+}
+
+bool FrameCapture::failed() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return failed_;
+}
+
+bool FrameCapture::FlushLocked() {
+  if (failed_) return false;
+  if (buffer_.empty()) return true;
+  int size = static_cast<int>(buffer_.size());
+  if (file_.WriteAtCurrentPos(buffer_.data(), size) != size) {
+    PLOG(ERROR) << "capture: write failed, capture stopped";
+    failed_ = true;
+    buffer_.clear();
+    return false;
+  }
+  buffer_.clear();
+  return true;
+}
+
+FrameCaptureReader::FrameCaptureReader()
+  : position_(0), elapsed_us_(0), ok_(true) {}
+
+FrameCaptureReader::~FrameCaptureReader() {}
+
+base::Status FrameCaptureReader::Open(const base::FilePath& path) {
+  if (!file_.Initialize(path)) {
+    return base::Status(base::UNAVAILABLE,
+                        "capture: cannot map " + path.value());
+  }
+  if (file_.length() < sizeof(kMagic) ||
+      memcmp(file_.data(), kMagic, sizeof(kMagic)) != 0) {
+    return base::Status(base::INVALID_ARGUMENT,
+                        "capture: not a capture file: " + path.value());
+  }
+  Rewind();
+  return base::Status::OK();
+}
+
+void FrameCaptureReader::Rewind() {
+  position_ = sizeof(kMagic);
+  elapsed_us_ = 0;
+  ok_ = true;
+}
+
+bool FrameCaptureReader::ReadVarint(uint64_t* value) {
+  uint64_t result = 0;
+  for (int shift = 0; shift < 64 && position_ < file_.length(); shift += 7) {
+    uint8_t byte = file_.data()[position_++];
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool FrameCaptureReader::Next(Frame* frame) {
+  if (!file_.IsValid() || position_ >= file_.length()) return false;
+
+  uint64_t delta, size;
+  if (!ReadVarint(&delta) || position_ >= file_.length()) {
+    ok_ = false;
+    return false;
+  }
+  uint8_t direction = file_.data()[position_++];
+  if (!ReadVarint(&size) || size > file_.length() - position_ ||
+      direction > CAPTURE_OUTBOUND) {
+    ok_ = false;
+    return false;
+  }
+
+  elapsed_us_ += static_cast<int64_t>(delta);
+  frame->offset = base::TimeDelta::FromMicroseconds(elapsed_us_);
+  frame->direction = static_cast<CaptureDirection>(direction);
+  frame->data = reinterpret_cast<const char*>(file_.data() + position_);
+  frame->size = static_cast<uint32_t>(size);
+  position_ += size;
+  return true;
+}
+
+} // namespace amqp
@@ -0,0 +1,108 @@
+#ifndef AMQP_FRAME_CAPTURE_H_
+#define AMQP_FRAME_CAPTURE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "base/file.h"
+#include "base/file_path.h"
+#include "base/macros.h"
+#include "base/memory_mapped_file.h"
+#include "base/status.h"
+#include "base/time.h"
+
+namespace amqp {
+
+// Capture files of raw AMQP frames, for replaying production traffic into
+// the decoder offline (see tools/amqp_replay.cc).
+//
+// After an 8-byte magic, each frame is stored as
+//
+//   varint microseconds since the previous frame | direction (1) |
+//   varint size | the frame as on the wire
+//
+// so a capture costs little more than the traffic itself.
+
+enum CaptureDirection : uint8_t {
+  CAPTURE_INBOUND = 0,
+  CAPTURE_OUTBOUND = 1,
+};
+
+// A connection tap. Writes are buffered and go to the file when the buffer
+// fills or on Flush(). A failing disk turns the tap off rather than the
+// connection. Thread-safe: the reader and writer threads can both record.
+class FrameCapture {
+ public:
+  static const size_t kBufferSize = 256 * 1024;
+
+  // Truncates |path|.
+  static base::Status Create(const base::FilePath& path,
+                             std::unique_ptr<FrameCapture>* capture);
+  // Flushes.
+  ~FrameCapture();
+
+  void Record(CaptureDirection direction,
+              const char* frame,
+              size_t size,
+              base::TimeTicks now);
+  bool Flush();
+
+  uint64_t frames() const;
+  bool failed() const;
+
+ private:
+  explicit FrameCapture(base::File file);
+
+  // Requires lock_.
+  bool FlushLocked();
+
+  mutable std::mutex lock_;
+  base::File file_;
+  std::string buffer_;
+  base::TimeTicks last_;
+  uint64_t frames_;
+  bool failed_;
+
+  DISALLOW_COPY_AND_ASSIGN(FrameCapture);
+};
+
+// Walks a capture file, memory-mapped.
+class FrameCaptureReader {
+ public:
+  struct Frame {
+    // Since the first frame of the capture.
+    base::TimeDelta offset;
+    CaptureDirection direction;
+    // Points into the mapping.
+    const char* data;
+    uint32_t size;
+  };
+
+  FrameCaptureReader();
+  ~FrameCaptureReader();
+
+  base::Status Open(const base::FilePath& path);
+
+  // False at the end of the capture or at a truncated frame; ok() tells
+  // the two apart.
+  bool Next(Frame* frame);
+  bool ok() const { return ok_; }
+  // Back to the first frame.
+  void Rewind();
+
+ private:
+  bool ReadVarint(uint64_t* value);
+
+  base::MemoryMappedFile file_;
+  size_t position_;
+  int64_t elapsed_us_;
+  bool ok_;
+
+  DISALLOW_COPY_AND_ASSIGN(FrameCaptureReader);
+};
+
+} // namespace amqp
+#endif // AMQP_FRAME_CAPTURE_H_
@@ -0,0 +1,223 @@
+#include "amqp/headers_matcher.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "amqp/numeric_field.h"
+#include "amqp/out_buffer.h"
+#include "base/hash.h"
+
+namespace amqp {
+
+namespace {
+
+bool IsArgument(const std::string& name) {
+  return name.compare(0, 2, "x-") == 0;
+}
+
+void EraseId(std::vector<HeadersMatcher::BindingId>* ids,
+             HeadersMatcher::BindingId id) {
+  auto it = std::find(ids->begin(), ids->end(), id);
+  if (it == ids->end()) return;
+  *it = ids->back();
+  ids->pop_back();
+}
+
+// Values compare by class, as the broker compares them, not by wire tag:
+// integers of any width and sign by value, float and double by value, and
+// short and long strings by their text. Other types stay apart by tag.
+enum ValueClass {
+  CLASS_STRING = 256,
+  CLASS_INTEGER,
+  CLASS_FLOAT,
+};
+
+bool IsSigned(char type) {
+  return type == 'b' || type == 'U' || type == 'I' || type == 'L';
+}
+
+int ClassOf(const Field& value) {
+  if (value.IsString()) return CLASS_STRING;
+  char type = value.TypeId();
+  // Float and Double are NumericFields too, but do not convert to integers.
+  if (type == 'f' || type == 'd') return CLASS_FLOAT;
+  if (value.IsInteger()) return CLASS_INTEGER;
+  return static_cast<uint8_t>(type);
+}
+
+// An integer as its 64-bit pattern plus whether it is negative, so -1 and
+// 2^64 - 1 stay distinct.
+uint64_t IntegerBits(const Field& value, bool* negative) {
+  if (IsSigned(value.TypeId())) {
+    int64_t signed_value = static_cast<int64_t>(value);
+    *negative = signed_value < 0;
+    return static_cast<uint64_t>(signed_value);
+  }
+  *negative = false;
+  return static_cast<uint64_t>(value);
+}
+
+double FloatValue(const Field& value) {
+  double result = value.TypeId() == 'f'
+      ? static_cast<const Float&>(value).value()
+      : static_cast<const Double&>(value).value();
+  // -0.0 == 0.0, so both must hash alike.
+  return result == 0 ? 0 : result;
+}
+
+std::string Encode(const Field& value) {
+  OutBuffer buffer(value.size());
+  value.Fill(buffer);
+  return std::string(buffer.data(), buffer.size());
+}
+
+} // namespace
+
+HeadersMatcher::HeadersMatcher() : binding_count_(0) {}
+
+HeadersMatcher::~HeadersMatcher() {}
+
+// static
+uint64_t HeadersMatcher::HashOf(const std::string& name,
+                                const Field& value) {
+  int value_class = ClassOf(value);
+  uint64_t hash = base::HashCombine(base::HashString(name), value_class);
+  switch (value_class) {
+    case CLASS_STRING:
+      return base::HashCombine(
+          hash, base::HashString(static_cast<const std::string&>(value)));
+    case CLASS_INTEGER: {
+      bool negative;
+      uint64_t bits = IntegerBits(value, &negative);
+      return base::HashCombine(hash + negative, base::HashInt(bits));
+    }
+    case CLASS_FLOAT: {
+      double number = FloatValue(value);
+      uint64_t bits;
+      memcpy(&bits, &number, sizeof(bits));
+      return base::HashCombine(hash, base::HashInt(bits));
+    }
+  }
+  // The rarer types (booleans, decimals, tables) by their encoding.
+  return base::HashCombine(hash, base::HashString(Encode(value)));
+}
+
+// static
+bool HeadersMatcher::SameValue(const Field& a, const Field& b) {
+  int value_class = ClassOf(a);
+  if (value_class != ClassOf(b)) return false;
+  switch (value_class) {
+    case CLASS_STRING:
+      return static_cast<const std::string&>(a) ==
+             static_cast<const std::string&>(b);
+    case CLASS_INTEGER: {
+      bool a_negative, b_negative;
+      uint64_t a_bits = IntegerBits(a, &a_negative);
+      uint64_t b_bits = IntegerBits(b, &b_negative);
+      return a_negative == b_negative && a_bits == b_bits;
+    }
+    case CLASS_FLOAT:
+      return FloatValue(a) == FloatValue(b);
+  }
+  return a.TypeId() == b.TypeId() && Encode(a) == Encode(b);
+}
+
+HeadersMatcher::BindingId HeadersMatcher::Add(const Table& arguments,
+                                              Subscriber subscriber) {
+  BindingId id;
+  if (!free_.empty()) {
+    id = free_.back();
+    free_.pop_back();
+  } else {
+    id = static_cast<BindingId>(bindings_.size());
+    bindings_.push_back(Binding());
+  }
+
+  Binding& binding = bindings_[id];
+  binding.subscriber = subscriber;
+  binding.live = true;
+  const Field& x_match = arguments.Get("x-match");
+  binding.any = static_cast<const std::string&>(x_match) == "any";
+  binding.keys.clear();
+  for (const auto& entry : arguments) {
+    if (IsArgument(entry.first)) continue;
+    Key key;
+    key.name = entry.first;
+    key.value = entry.second->Clone();
+    key.hash = HashOf(entry.first, *entry.second);
+    Posting posting;
+    posting.binding = id;
+    posting.key = static_cast<uint32_t>(binding.keys.size());
+    index_[key.hash].push_back(posting);
+    binding.keys.push_back(std::move(key));
+  }
+  // "any" over nothing never matches, so it is not indexed at all.
+  if (binding.keys.empty() && !binding.any) match_always_.push_back(id);
+  ++binding_count_;
+  return id;
+}
+
+bool HeadersMatcher::Remove(BindingId id) {
+  if (id >= bindings_.size() || !bindings_[id].live) return false;
+  Binding& binding = bindings_[id];
+  for (const Key& key : binding.keys) {
+    auto it = index_.find(key.hash);
+    if (it == index_.end()) continue;
+    std::vector<Posting>& postings = it->second;
+    for (size_t i = 0; i < postings.size(); ++i) {
+      if (postings[i].binding != id) continue;
+      postings[i] = postings.back();
+      postings.pop_back();
+      break;
+    }
+    if (postings.empty()) index_.erase(it);
+  }
+  if (binding.keys.empty()) EraseId(&match_always_, id);
+  binding = Binding();
+  free_.push_back(id);
+  --binding_count_;
+  return true;
+}
+
+void HeadersMatcher::Match(const Table& headers,
+                           std::vector<Subscriber>* subscribers) const {
+  subscribers->clear();
+
+  // Every hit of a binding, then count the runs. Sorting the hits is cheaper
+  // than a per-binding counter array once there are many bindings.
+  std::vector<BindingId> hits;
+  if (!index_.empty()) {
+    for (const auto& entry : headers) {
+      auto it = index_.find(HashOf(entry.first, *entry.second));
+      if (it == index_.end()) continue;
+      for (const Posting& posting : it->second) {
+        const Key& key = bindings_[posting.binding].keys[posting.key];
+        if (key.name == entry.first &&
+            SameValue(*key.value, *entry.second)) {
+          hits.push_back(posting.binding);
+        }
+      }
+    }
+  }
+  std::sort(hits.begin(), hits.end());
+
+  for (size_t i = 0; i < hits.size();) {
+    BindingId id = hits[i];
+    size_t run = i;
+    while (run < hits.size() && hits[run] == id) ++run;
+    const Binding& binding = bindings_[id];
+    if (binding.any || run - i == binding.keys.size()) {
+      subscribers->push_back(binding.subscriber);
+    }
+    i = run;
+  }
+  for (BindingId id : match_always_) {
+    subscribers->push_back(bindings_[id].subscriber);
+  }
+
+  std::sort(subscribers->begin(), subscribers->end());
+  subscribers->erase(std::unique(subscribers->begin(), subscribers->end()),
+                     subscribers->end());
+}
+
+} // namespace amqp
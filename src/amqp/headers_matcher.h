@@ -0,0 +1,90 @@
+#ifndef AMQP_HEADERS_MATCHER_H_
+#define AMQP_HEADERS_MATCHER_H_
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "amqp/table.h"
+#include "base/macros.h"
+
+namespace amqp {
+
+// Matches message headers against many headers-exchange style bindings.
+//
+// A binding is a Table of header values plus an optional "x-match" of "all"
+// (the default: every listed header must be present with an equal value) or
+// "any" (at least one must). Other "x-" arguments are ignored. Values
+// compare as the broker compares them: integers of any width and sign by
+// value, float and double by value, short and long strings by their text,
+// and other types when their type and encoding are equal.
+//
+// Each (header name, value) pair of a binding is entered in an inverted
+// index under a hash of the two. Match() looks up only the pairs present in
+// the message, compares each candidate exactly and counts hits per binding,
+// so a message costs its header count plus the number of hits rather than
+// bindings x headers. String and integer headers are hashed and compared
+// in place, without encoding them.
+//
+// Match() is const and may run concurrently with other Match() calls;
+// Add() and Remove() need external synchronization against everything.
+class HeadersMatcher {
+ public:
+  typedef uint64_t Subscriber;
+  typedef uint32_t BindingId;
+
+  HeadersMatcher();
+  ~HeadersMatcher();
+
+  BindingId Add(const Table& arguments, Subscriber subscriber);
+  // Returns false for an unknown or already removed binding.
+  bool Remove(BindingId binding);
+
+  // Replaces |subscribers| with the distinct subscribers of every binding
+  // matching |headers|, in ascending order.
+  void Match(const Table& headers,
+             std::vector<Subscriber>* subscribers) const;
+
+  size_t binding_count() const { return binding_count_; }
+
+ private:
+  // One header a binding checks for.
+  struct Key {
+    std::string name;
+    std::shared_ptr<Field> value;
+    uint64_t hash;
+  };
+
+  struct Binding {
+    Binding() : subscriber(0), any(false), live(false) {}
+    Subscriber subscriber;
+    bool any;
+    bool live;
+    std::vector<Key> keys;
+  };
+
+  // Key |key| of binding |binding|.
+  struct Posting {
+    BindingId binding;
+    uint32_t key;
+  };
+
+  // Index hash of one header, consistent with SameValue().
+  static uint64_t HashOf(const std::string& name, const Field& value);
+  // Whether |a| and |b| are equal header values (see above).
+  static bool SameValue(const Field& a, const Field& b);
+
+  std::vector<Binding> bindings_;
+  std::vector<BindingId> free_;
+  std::unordered_map<uint64_t, std::vector<Posting>> index_;
+  // "all" bindings with no headers to check; they match every message.
+  std::vector<BindingId> match_always_;
+  size_t binding_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(HeadersMatcher);
+};
+
+} // namespace amqp
+#endif // AMQP_HEADERS_MATCHER_H_
@@ -0,0 +1,124 @@
+#include "amqp/headers_matcher.h"
+
+#include <vector>
+
+#include "amqp/boolean_set.h"
+#include "amqp/numeric_field.h"
+#include "amqp/string_field.h"
+
+#include <gtest/gtest.h>
+
+namespace amqp {
+
+namespace {
+
+typedef std::vector<HeadersMatcher::Subscriber> Subscribers;
+
+Subscribers Match(const HeadersMatcher& matcher, const Table& headers) {
+  Subscribers subscribers;
+  matcher.Match(headers, &subscribers);
+  return subscribers;
+}
+
+TEST(HeadersMatcherTest, AllAndAny) {
+  HeadersMatcher matcher;
+  Table all;
+  all.Set("format", ShortString("pdf"));
+  all.Set("type", ShortString("report"));
+  matcher.Add(all, 1);
+  Table any;
+  any.Set("x-match", ShortString("any"));
+  any.Set("format", ShortString("pdf"));
+  any.Set("type", ShortString("log"));
+  matcher.Add(any, 2);
+
+  Table headers;
+  headers.Set("format", ShortString("pdf"));
+  EXPECT_EQ(Subscribers({2}), Match(matcher, headers));
+  headers.Set("type", ShortString("report"));
+  EXPECT_EQ(Subscribers({1, 2}), Match(matcher, headers));
+  headers.Set("format", ShortString("zip"));
+  EXPECT_EQ(Subscribers(), Match(matcher, headers));
+}
+
+TEST(HeadersMatcherTest, EmptyBindings) {
+  HeadersMatcher matcher;
+  matcher.Add(Table(), 1);
+  Table any;
+  any.Set("x-match", ShortString("any"));
+  matcher.Add(any, 2);
+  EXPECT_EQ(Subscribers({1}), Match(matcher, Table()));
+}
+
+TEST(HeadersMatcherTest, IntegersCompareAcrossWidths) {
+  HeadersMatcher matcher;
+  Table binding;
+  binding.Set("n", Long(1));
+  matcher.Add(binding, 1);
+  Table negative;
+  negative.Set("n", LongLong(-1));
+  matcher.Add(negative, 2);
+
+  Table headers;
+  headers.Set("n", LongLong(1));
+  EXPECT_EQ(Subscribers({1}), Match(matcher, headers));
+  headers.Set("n", UOctet(1));
+  EXPECT_EQ(Subscribers({1}), Match(matcher, headers));
+  headers.Set("n", ULongLong(1));
+  EXPECT_EQ(Subscribers({1}), Match(matcher, headers));
+  headers.Set("n", Long(2));
+  EXPECT_EQ(Subscribers(), Match(matcher, headers));
+
+  headers.Set("n", Octet(-1));
+  EXPECT_EQ(Subscribers({2}), Match(matcher, headers));
+  // Same bit pattern as -1, but not the same number.
+  headers.Set("n", ULongLong(~0ull));
+  EXPECT_EQ(Subscribers(), Match(matcher, headers));
+}
+
+TEST(HeadersMatcherTest, ValueClassesStayApart) {
+  HeadersMatcher matcher;
+  Table floating;
+  floating.Set("v", Double(1.5));
+  matcher.Add(floating, 1);
+  Table text;
+  text.Set("v", ShortString("1"));
+  matcher.Add(text, 2);
+  Table flag;
+  flag.Set("v", BooleanSet(true));
+  matcher.Add(flag, 3);
+
+  Table headers;
+  headers.Set("v", Float(1.5f));
+  EXPECT_EQ(Subscribers({1}), Match(matcher, headers));
+  headers.Set("v", LongString("1"));
+  EXPECT_EQ(Subscribers({2}), Match(matcher, headers));
+  headers.Set("v", Long(1));
+  EXPECT_EQ(Subscribers(), Match(matcher, headers));
+  headers.Set("v", BooleanSet(true));
+  EXPECT_EQ(Subscribers({3}), Match(matcher, headers));
+}
+
+TEST(HeadersMatcherTest, Remove) {
+  HeadersMatcher matcher;
+  Table binding;
+  binding.Set("k", ShortString("v"));
+  HeadersMatcher::BindingId first = matcher.Add(binding, 1);
+  matcher.Add(binding, 2);
+  EXPECT_EQ(2u, matcher.binding_count());
+
+  Table headers;
+  headers.Set("k", ShortString("v"));
+  EXPECT_EQ(Subscribers({1, 2}), Match(matcher, headers));
+  EXPECT_TRUE(matcher.Remove(first));
+  EXPECT_FALSE(matcher.Remove(first));
+  EXPECT_EQ(Subscribers({2}), Match(matcher, headers));
+
+  // The freed id is reused.
+  EXPECT_EQ(first, matcher.Add(binding, 3));
+  EXPECT_EQ(Subscribers({2, 3}), Match(matcher, headers));
+}
+
+} // namespace
+
+} // namespace amqp
@@ -0,0 +1,88 @@
+#ifndef AMQP_IN_BUFFER_H_
+#define AMQP_IN_BUFFER_H_
+#include <stdint.h>
+#include <cstring>
+
+#include "base/byteorder.h"
+
+namespace amqp {
+
+// Read cursor over a contiguous span of encoded bytes; the counterpart of
+// OutBuffer. Does not own the bytes.
+//
+// Reading past the end yields zeros (NextData() yields nullptr) and clears
+// ok(), so a truncated field decodes to something harmless and the caller
+// checks once at the end.
+class InBuffer {
+ public:
+  InBuffer(const char* data, uint32_t size)
+    : data_(data), size_(size), pos_(0), ok_(true) {}
+
+  virtual ~InBuffer() {}
+
+  const char* data() const { return data_; }
+  uint32_t size() const { return size_; }
+  uint32_t position() const { return pos_; }
+  uint32_t remaining() const { return size_ - pos_; }
+  bool ok() const { return ok_; }
+
+  uint8_t NextUInt8() { return Next<uint8_t>(); }
+  int8_t NextInt8() { return Next<int8_t>(); }
+  uint16_t NextUInt16() { return base::NetToHost16(Next<uint16_t>()); }
+  int16_t NextInt16() { return base::NetToHost16(Next<uint16_t>()); }
+  uint32_t NextUInt32() { return base::NetToHost32(Next<uint32_t>()); }
+  int32_t NextInt32() { return base::NetToHost32(Next<uint32_t>()); }
+  uint64_t NextUInt64() { return base::NetToHost64(Next<uint64_t>()); }
+  int64_t NextInt64() { return base::NetToHost64(Next<uint64_t>()); }
+  // Floating point goes out unswapped in OutBuffer; read it back the same.
+  float NextFloat() { return Next<float>(); }
+  double NextDouble() { return Next<double>(); }
+
+  const char* NextData(uint32_t size) {
+    if (!Take(size)) return nullptr;
+    const char* data = data_ + pos_;
+    pos_ += size;
+    return data;
+  }
+
+  void Skip(uint32_t size) {
+    if (Take(size)) pos_ += size;
+  }
+
+ protected:
+  // For subclasses that learn their span after construction.
+  void Reset(const char* data, uint32_t size) {
+    data_ = data;
+    size_ = size;
+    pos_ = 0;
+    ok_ = true;
+  }
+
+ private:
+  bool Take(uint32_t size) {
+    if (size > remaining()) {
+      pos_ = size_;
+      ok_ = false;
+      return false;
+    }
+    return true;
+  }
+
+  template <typename T>
+  T Next() {
+    T value = 0;
+    if (Take(sizeof(T))) {
+      memcpy(&value, data_ + pos_, sizeof(T));
+      pos_ += sizeof(T);
+    }
+    return value;
+  }
+
+  const char* data_;
+  uint32_t size_;
+  uint32_t pos_;
+  bool ok_;
+};
+
+} // namespace amqp
+#endif // AMQP_IN_BUFFER_H_
@@ -0,0 +1,60 @@
+#ifndef AMQP_MESSAGE_H_
+#define AMQP_MESSAGE_H_
+
+#include <stddef.h>
+#include <string>
+
+#include "amqp/body_buffer.h"
+#include "amqp/meta_data.h"
+
+namespace amqp {
+
+// A delivered message as handed to a MessageCallback: where it was
+// published to, its properties and its body.
+//
+// Copies are cheap and share the body, which makes in-process fan-out to
+// several handlers (e.g. every TopicMatcher hit) cost a reference count per
+// handler rather than a copy of the body:
+//
+//   std::vector<TopicMatcher::Subscriber> hits;
+//   matcher.Match(message.routing_key(), &hits);
+//   for (TopicMatcher::Subscriber hit : hits) {
+//     Message copy(message);
+//     dispatcher.Dispatch(key, [copy, hit] { Handle(hit, copy); });
+//   }
+//
+// The properties are detached from the frame on construction. MetaData
+// decodes lazily into a cache, so give each concurrent reader its own copy,
+// as above; the body needs no such care.
+class Message {
+ public:
+  Message() {}
+  Message(const std::string& exchange,
+          const std::string& routing_key,
+          const MetaData& properties,
+          BodySlice body)
+    : exchange_(exchange),
+      routing_key_(routing_key),
+      properties_(properties),
+      body_(std::move(body)) {
+    properties_.Detach();
+  }
+  virtual ~Message() {}
+
+  const std::string& exchange() const { return exchange_; }
+  const std::string& routing_key() const { return routing_key_; }
+  const MetaData& properties() const { return properties_; }
+  const BodySlice& body() const { return body_; }
+
+  const char* body_data() const { return body_.data(); }
+  size_t body_size() const { return body_.size(); }
+
+ private:
+  std::string exchange_;
+  std::string routing_key_;
+  MetaData properties_;
+  BodySlice body_;
+};
+
+} // namespace amqp
+#endif // AMQP_MESSAGE_H_
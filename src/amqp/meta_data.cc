@@ -0,0 +1,201 @@
+#include "amqp/meta_data.h"
+
+#include "amqp/string_field.h"
+
+namespace amqp {
+
+namespace {
+
+// Properties are indexed in wire order: index 0 is the top flag bit.
+inline uint16_t FlagAt(int index) {
+  return static_cast<uint16_t>(1 << (15 - index));
+}
+
+const int kHeadersIndex = 2;
+const int kDeliveryModeIndex = 3;
+const int kPriorityIndex = 4;
+const int kTimestampIndex = 9;
+
+} // namespace
+
+MetaData::MetaData()
+  : flags_(0),
+    decoded_(0xffff),
+    modified_(0),
+    raw_flags_(0),
+    raw_(nullptr),
+    raw_size_(0),
+    walked_(0),
+    delivery_mode_(0),
+    priority_(0),
+    timestamp_(0) {
+  offsets_[0] = 0;
+}
+
+MetaData::MetaData(InBuffer& frame) : MetaData() {
+  uint16_t flags = frame.NextUInt16();
+  uint32_t size = frame.remaining();
+  const char* data = frame.NextData(size);
+  flags_ = raw_flags_ = flags;
+  raw_ = data;
+  raw_size_ = size;
+  decoded_ = 0;
+}
+
+MetaData::MetaData(uint16_t flags, const char* data, uint32_t size)
+  : MetaData() {
+  flags_ = raw_flags_ = flags;
+  raw_ = data;
+  raw_size_ = size;
+  decoded_ = 0;
+}
+
+void MetaData::Detach() {
+  if (raw_ == nullptr || owned_) return;
+  owned_ = std::make_shared<const std::string>(raw_, raw_size_);
+  raw_ = owned_->data();
+}
+
+void MetaData::Clear(Flag flag) {
+  int index = 0;
+  while (FlagAt(index) != flag) ++index;
+  if (std::string* value = StringAt(index)) {
+    value->clear();
+  } else {
+    switch (index) {
+      case kHeadersIndex:      headers_ = Table(); break;
+      case kDeliveryModeIndex: delivery_mode_ = 0; break;
+      case kPriorityIndex:     priority_ = 0; break;
+      case kTimestampIndex:    timestamp_ = 0; break;
+    }
+  }
+  flags_ &= ~flag;
+  decoded_ |= flag;
+  modified_ |= flag;
+}
+
+std::string* MetaData::StringAt(int index) const {
+  switch (index) {
+    case 0:  return &content_type_;
+    case 1:  return &content_encoding_;
+    case 5:  return &correlation_id_;
+    case 6:  return &reply_to_;
+    case 7:  return &expiration_;
+    case 8:  return &message_id_;
+    case 10: return &type_;
+    case 11: return &user_id_;
+    case 12: return &app_id_;
+    case 13: return &cluster_id_;
+    default: return nullptr;
+  }
+}
+
+uint32_t MetaData::RawSizeAt(int index, uint32_t offset) const {
+  if (offset >= raw_size_) return 0;
+  uint32_t available = raw_size_ - offset;
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(raw_ + offset);
+  uint32_t size;
+  switch (index) {
+    case kHeadersIndex:
+      if (available < 4) return available;
+      size = 4 + ((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+                  (uint32_t)p[2] << 8 | p[3]);
+      break;
+    case kDeliveryModeIndex:
+    case kPriorityIndex:
+      size = 1;
+      break;
+    case kTimestampIndex:
+      size = 8;
+      break;
+    default:
+      size = 1 + p[0];
+      break;
+  }
+  return size < available ? size : available;
+}
+
+uint32_t MetaData::OffsetOf(int index) const {
+  while (walked_ < index) {
+    uint32_t offset = offsets_[walked_];
+    if (raw_flags_ & FlagAt(walked_)) offset += RawSizeAt(walked_, offset);
+    offsets_[++walked_] = offset;
+  }
+  return offsets_[index];
+}
+
+bool MetaData::CopiesRaw(int index) const {
+  uint16_t flag = FlagAt(index);
+  return raw_ != nullptr && (raw_flags_ & flag) && !(modified_ & flag);
+}
+
+void MetaData::Decode(Flag flag) const {
+  decoded_ |= flag;
+  if (raw_ == nullptr || !(raw_flags_ & flag) || (modified_ & flag)) return;
+
+  int index = 0;
+  while (FlagAt(index) != flag) ++index;
+  uint32_t offset = OffsetOf(index);
+  InBuffer in(raw_ + offset, RawSizeAt(index, offset));
+
+  if (std::string* value = StringAt(index)) {
+    *value = ShortString(in).value();
+    return;
+  }
+  switch (index) {
+    case kHeadersIndex:      headers_ = Table(in); break;
+    case kDeliveryModeIndex: delivery_mode_ = in.NextUInt8(); break;
+    case kPriorityIndex:     priority_ = in.NextUInt8(); break;
+    case kTimestampIndex:    timestamp_ = in.NextUInt64(); break;
+  }
+}
+
+uint32_t MetaData::PropertySize(int index) const {
+  if (CopiesRaw(index)) return RawSizeAt(index, OffsetOf(index));
+  Load(static_cast<Flag>(FlagAt(index)));
+  if (const std::string* value = StringAt(index)) return 1 + value->size();
+  switch (index) {
+    case kHeadersIndex:   return headers_.size();
+    case kTimestampIndex: return 8;
+    default:              return 1;
+  }
+}
+
+void MetaData::FillProperty(int index, OutBuffer& buffer) const {
+  if (CopiesRaw(index)) {
+    uint32_t offset = OffsetOf(index);
+    buffer.Add(raw_ + offset, RawSizeAt(index, offset));
+    return;
+  }
+  Load(static_cast<Flag>(FlagAt(index)));
+  if (const std::string* value = StringAt(index)) {
+    ShortString(*value).Fill(buffer);
+    return;
+  }
+  switch (index) {
+    case kHeadersIndex:      headers_.Fill(buffer); break;
+    case kDeliveryModeIndex: buffer.Add(delivery_mode_); break;
+    case kPriorityIndex:     buffer.Add(priority_); break;
+    case kTimestampIndex:    buffer.Add(timestamp_); break;
+  }
+}
+
+uint32_t MetaData::SizeOf(uint16_t mask, bool with_flags) const {
+  uint16_t present = flags_ & mask;
+  uint32_t size = with_flags ? 2 : 0;
+  for (int i = 0; i < kPropertyCount; ++i) {
+    if (present & FlagAt(i)) size += PropertySize(i);
+  }
+  return size;
+}
+
+void MetaData::FillOnly(uint16_t mask, OutBuffer& buffer,
+                        bool with_flags) const {
+  uint16_t present = flags_ & mask;
+  if (with_flags) buffer.Add(present);
+  for (int i = 0; i < kPropertyCount; ++i) {
+    if (present & FlagAt(i)) FillProperty(i, buffer);
+  }
+}
+
+} // namespace amqp
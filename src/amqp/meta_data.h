@@ -0,0 +1,219 @@
+#ifndef AMQP_META_DATA_H_
+#define AMQP_META_DATA_H_
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+#include "amqp/in_buffer.h"
+#include "amqp/out_buffer.h"
+#include "amqp/table.h"
+
+namespace amqp {
+
+// Basic content properties, as carried by a content header frame: a 16-bit
+// flags word saying which properties are present, followed by the present
+// ones in flag order.
+//
+// A MetaData decoded from a frame keeps the raw flags and a pointer to the
+// encoded property bytes, and decodes a property on its first access; the
+// start offset of each property is cached as the list is walked. Properties
+// that were never touched are re-encoded by copying their bytes. Until
+// Detach() is called the bytes are borrowed from the frame, so keep the
+// MetaData (or a copy of it) past the frame only after detaching. Lazy
+// accessors write to the cache: concurrent readers need their own copy.
+class MetaData {
+ public:
+  enum Flag : uint16_t {
+    kContentType     = 1 << 15,
+    kContentEncoding = 1 << 14,
+    kHeaders         = 1 << 13,
+    kDeliveryMode    = 1 << 12,
+    kPriority        = 1 << 11,
+    kCorrelationId   = 1 << 10,
+    kReplyTo         = 1 << 9,
+    kExpiration      = 1 << 8,
+    kMessageId       = 1 << 7,
+    kTimestamp       = 1 << 6,
+    kType            = 1 << 5,
+    kUserId          = 1 << 4,
+    kAppId           = 1 << 3,
+    kClusterId       = 1 << 2,
+  };
+
+  MetaData();
+  // Reads the flags word and borrows the rest of |frame| as the encoded
+  // property list.
+  explicit MetaData(InBuffer& frame);
+  MetaData(uint16_t flags, const char* data, uint32_t size);
+  virtual ~MetaData() {}
+
+  uint16_t flags() const { return flags_; }
+  bool Has(Flag flag) const { return (flags_ & flag) != 0; }
+  // Removes the property and resets its value, so the accessor returns an
+  // empty string, an empty table or 0 until it is set again.
+  void Clear(Flag flag);
+
+  // Copies the borrowed property bytes so this MetaData (and its copies) no
+  // longer depend on the frame. Cheap: one allocation, no decoding.
+  void Detach();
+
+  const std::string& content_type() const {
+    Load(kContentType);
+    return content_type_;
+  }
+  const std::string& content_encoding() const {
+    Load(kContentEncoding);
+    return content_encoding_;
+  }
+  const Table& headers() const {
+    Load(kHeaders);
+    return headers_;
+  }
+  uint8_t delivery_mode() const {
+    Load(kDeliveryMode);
+    return delivery_mode_;
+  }
+  bool persistent() const { return delivery_mode() == 2; }
+  uint8_t priority() const {
+    Load(kPriority);
+    return priority_;
+  }
+  const std::string& correlation_id() const {
+    Load(kCorrelationId);
+    return correlation_id_;
+  }
+  const std::string& reply_to() const {
+    Load(kReplyTo);
+    return reply_to_;
+  }
+  const std::string& expiration() const {
+    Load(kExpiration);
+    return expiration_;
+  }
+  const std::string& message_id() const {
+    Load(kMessageId);
+    return message_id_;
+  }
+  uint64_t timestamp() const {
+    Load(kTimestamp);
+    return timestamp_;
+  }
+  const std::string& type() const {
+    Load(kType);
+    return type_;
+  }
+  const std::string& user_id() const {
+    Load(kUserId);
+    return user_id_;
+  }
+  const std::string& app_id() const {
+    Load(kAppId);
+    return app_id_;
+  }
+  const std::string& cluster_id() const {
+    Load(kClusterId);
+    return cluster_id_;
+  }
+
+  void set_content_type(const std::string& v) {
+    Assign(kContentType, &content_type_, v);
+  }
+  void set_content_encoding(const std::string& v) {
+    Assign(kContentEncoding, &content_encoding_, v);
+  }
+  void set_headers(const Table& v) { headers_ = v; Touch(kHeaders); }
+  void set_delivery_mode(uint8_t v) {
+    delivery_mode_ = v;
+    Touch(kDeliveryMode);
+  }
+  void set_persistent(bool v) { set_delivery_mode(v ? 2 : 1); }
+  void set_priority(uint8_t v) { priority_ = v; Touch(kPriority); }
+  void set_correlation_id(const std::string& v) {
+    Assign(kCorrelationId, &correlation_id_, v);
+  }
+  void set_reply_to(const std::string& v) { Assign(kReplyTo, &reply_to_, v); }
+  void set_expiration(const std::string& v) {
+    Assign(kExpiration, &expiration_, v);
+  }
+  void set_message_id(const std::string& v) {
+    Assign(kMessageId, &message_id_, v);
+  }
+  void set_timestamp(uint64_t v) { timestamp_ = v; Touch(kTimestamp); }
+  void set_type(const std::string& v) { Assign(kType, &type_, v); }
+  void set_user_id(const std::string& v) { Assign(kUserId, &user_id_, v); }
+  void set_app_id(const std::string& v) { Assign(kAppId, &app_id_, v); }
+  void set_cluster_id(const std::string& v) {
+    Assign(kClusterId, &cluster_id_, v);
+  }
+
+  // Encoded size of the property list, flags word included.
+  uint32_t size() const { return SizeOf(flags_); }
+  void Fill(OutBuffer& buffer) const { FillOnly(flags_, buffer); }
+
+  // As above, restricted to the present properties in |mask|, with or
+  // without the flags word. Used to encode a property list in pieces.
+  uint32_t SizeOf(uint16_t mask, bool with_flags = true) const;
+  void FillOnly(uint16_t mask, OutBuffer& buffer,
+                bool with_flags = true) const;
+
+ private:
+  enum { kPropertyCount = 14 };
+
+  void Assign(Flag flag, std::string* field, const std::string& value) {
+    *field = value;
+    Touch(flag);
+  }
+
+  void Touch(Flag flag) {
+    flags_ |= flag;
+    decoded_ |= flag;
+    modified_ |= flag;
+  }
+
+  void Load(Flag flag) const {
+    if (!(decoded_ & flag)) Decode(flag);
+  }
+
+  void Decode(Flag flag) const;
+  // Byte offset of property |index| (0 = content-type) in the raw list.
+  uint32_t OffsetOf(int index) const;
+  uint32_t RawSizeAt(int index, uint32_t offset) const;
+  std::string* StringAt(int index) const;
+  // Whether property |index| is re-encoded by copying its raw bytes.
+  bool CopiesRaw(int index) const;
+  uint32_t PropertySize(int index) const;
+  void FillProperty(int index, OutBuffer& buffer) const;
+
+  uint16_t flags_;
+  // Properties held in the members below; the rest still live in |raw_|.
+  mutable uint16_t decoded_;
+  // Properties set or cleared since decoding; their raw bytes are stale.
+  uint16_t modified_;
+
+  uint16_t raw_flags_;
+  const char* raw_;
+  uint32_t raw_size_;
+  std::shared_ptr<const std::string> owned_;
+  // offsets_[i] is valid for i <= walked_.
+  mutable uint32_t offsets_[kPropertyCount + 1];
+  mutable int walked_;
+
+  mutable std::string content_type_;
+  mutable std::string content_encoding_;
+  mutable Table headers_;
+  mutable uint8_t delivery_mode_;
+  mutable uint8_t priority_;
+  mutable std::string correlation_id_;
+  mutable std::string reply_to_;
+  mutable std::string expiration_;
+  mutable std::string message_id_;
+  mutable uint64_t timestamp_;
+  mutable std::string type_;
+  mutable std::string user_id_;
+  mutable std::string app_id_;
+  mutable std::string cluster_id_;
+};
+
+} // namespace amqp
+#endif // AMQP_META_DATA_H_
@@ -0,0 +1,146 @@
+#include "amqp/meta_data.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include "amqp/in_buffer.h"
+#include "amqp/numeric_field.h"
+#include "amqp/out_buffer.h"
+#include "amqp/string_field.h"
+
+#include <gtest/gtest.h>
+
+namespace amqp {
+
+namespace {
+
+std::string Encode(const MetaData& properties) {
+  OutBuffer buffer(properties.size());
+  properties.Fill(buffer);
+  EXPECT_EQ(properties.size(), buffer.size());
+  return std::string(buffer.data(), buffer.size());
+}
+
+// Decodes |bytes|, which must outlive the result until it is detached.
+std::unique_ptr<MetaData> Decode(const std::string& bytes) {
+  InBuffer in(bytes.data(), bytes.size());
+  return std::unique_ptr<MetaData>(new MetaData(in));
+}
+
+MetaData Sample() {
+  MetaData properties;
+  properties.set_content_type("application/json");
+  Table headers;
+  headers.Set("attempt", Long(3));
+  headers.Set("origin", ShortString("eu-west"));
+  properties.set_headers(headers);
+  properties.set_persistent(true);
+  properties.set_priority(5);
+  properties.set_correlation_id("corr-1");
+  properties.set_reply_to("replies");
+  properties.set_message_id("msg-1");
+  properties.set_timestamp(1700000000);
+  properties.set_app_id("billing");
+  return properties;
+}
+
+TEST(MetaDataTest, EncodesAndDecodesEveryProperty) {
+  MetaData properties = Sample();
+  properties.set_content_encoding("gzip");
+  properties.set_expiration("60000");
+  properties.set_type("invoice");
+  properties.set_user_id("guest");
+  properties.set_cluster_id("c1");
+  EXPECT_EQ(0xfffc, properties.flags());
+
+  std::string bytes = Encode(properties);
+  std::unique_ptr<MetaData> decoded = Decode(bytes);
+  EXPECT_EQ(properties.flags(), decoded->flags());
+  EXPECT_EQ("application/json", decoded->content_type());
+  EXPECT_EQ("gzip", decoded->content_encoding());
+  EXPECT_EQ(3, static_cast<int32_t>(decoded->headers()["attempt"]));
+  EXPECT_EQ("eu-west", static_cast<const std::string&>(
+                           decoded->headers()["origin"]));
+  EXPECT_TRUE(decoded->persistent());
+  EXPECT_EQ(5, decoded->priority());
+  EXPECT_EQ("corr-1", decoded->correlation_id());
+  EXPECT_EQ("replies", decoded->reply_to());
+  EXPECT_EQ("60000", decoded->expiration());
+  EXPECT_EQ("msg-1", decoded->message_id());
+  EXPECT_EQ(1700000000u, decoded->timestamp());
+  EXPECT_EQ("invoice", decoded->type());
+  EXPECT_EQ("guest", decoded->user_id());
+  EXPECT_EQ("billing", decoded->app_id());
+  EXPECT_EQ("c1", decoded->cluster_id());
+  EXPECT_EQ(bytes, Encode(*decoded));
+}
+
+TEST(MetaDataTest, UntouchedDecodeReencodesVerbatim) {
+  std::string bytes = Encode(Sample());
+  std::unique_ptr<MetaData> decoded = Decode(bytes);
+  // Reading one property leaves the others encoded.
+  EXPECT_EQ("msg-1", decoded->message_id());
+  EXPECT_EQ(bytes, Encode(*decoded));
+}
+
+TEST(MetaDataTest, EditsSurviveDetachAndReencode) {
+  std::string bytes = Encode(Sample());
+  std::unique_ptr<MetaData> decoded = Decode(bytes);
+  EXPECT_EQ("corr-1", decoded->correlation_id());
+
+  decoded->Clear(MetaData::kReplyTo);
+  decoded->Clear(MetaData::kHeaders);
+  decoded->Clear(MetaData::kPriority);
+  EXPECT_FALSE(decoded->Has(MetaData::kReplyTo));
+  EXPECT_TRUE(decoded->reply_to().empty());
+  EXPECT_TRUE(decoded->headers().empty());
+  EXPECT_EQ(0, decoded->priority());
+
+  decoded->set_message_id("msg-2");
+  decoded->set_type("retry");
+  decoded->set_timestamp(1700000060);
+  decoded->Detach();
+  // The frame the properties were borrowed from goes away.
+  std::fill(bytes.begin(), bytes.end(), '\xff');
+
+  std::string edited = Encode(*decoded);
+  std::unique_ptr<MetaData> again = Decode(edited);
+  EXPECT_EQ(decoded->flags(), again->flags());
+  EXPECT_FALSE(again->Has(MetaData::kReplyTo));
+  EXPECT_FALSE(again->Has(MetaData::kHeaders));
+  EXPECT_FALSE(again->Has(MetaData::kPriority));
+  EXPECT_EQ("application/json", again->content_type());
+  EXPECT_TRUE(again->persistent());
+  EXPECT_EQ("corr-1", again->correlation_id());
+  EXPECT_EQ("msg-2", again->message_id());
+  EXPECT_EQ(1700000060u, again->timestamp());
+  EXPECT_EQ("retry", again->type());
+  EXPECT_EQ("billing", again->app_id());
+
+  // Setting a cleared property brings it back.
+  again->set_reply_to("other");
+  std::string restored_bytes = Encode(*again);
+  std::unique_ptr<MetaData> restored = Decode(restored_bytes);
+  EXPECT_EQ("other", restored->reply_to());
+}
+
+TEST(MetaDataTest, EncodesInPieces) {
+  MetaData properties = Sample();
+  uint16_t head = MetaData::kContentType | MetaData::kHeaders;
+  uint16_t tail = static_cast<uint16_t>(properties.flags() & ~head);
+  OutBuffer buffer(properties.size());
+  properties.FillOnly(head, buffer);
+  properties.FillOnly(tail, buffer, false);
+  EXPECT_EQ(properties.SizeOf(head) + properties.SizeOf(tail, false),
+            buffer.size());
+  // Pieces cover the whole list but carry only the first piece's flags.
+  std::string pieces(buffer.data(), buffer.size());
+  std::string whole = Encode(properties);
+  EXPECT_EQ(whole.size(), pieces.size());
+  EXPECT_EQ(whole.substr(2), pieces.substr(2));
+}
+
+} // namespace
+
+} // namespace amqp
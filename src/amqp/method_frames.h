@@ -0,0 +1,305 @@
+#ifndef AMQP_METHOD_FRAMES_H_
+#define AMQP_METHOD_FRAMES_H_
+
+#include <stdint.h>
+#include <string>
+
+#include "amqp/boolean_set.h"
+#include "amqp/out_buffer.h"
+#include "amqp/protocol.h"
+#include "amqp/string_field.h"
+#include "amqp/table.h"
+
+namespace amqp {
+
+// An outgoing method frame. Subclasses describe the arguments; size() is
+// exact, so a caller can check OutBuffer::available() before Fill().
+class MethodFrame {
+ public:
+  MethodFrame(uint16_t channel, uint16_t class_id, uint16_t method_id)
+    : channel_(channel),
+      class_id_(class_id),
+      method_id_(method_id) {}
+
+  virtual ~MethodFrame() {}
+
+  uint16_t channel() const { return channel_; }
+  uint16_t class_id() const { return class_id_; }
+  uint16_t method_id() const { return method_id_; }
+
+  uint32_t size() const { return kFrameOverhead + 4 + ArgumentsSize(); }
+
+  void Fill(OutBuffer& buffer) const {
+    buffer.Add(kFrameMethod);
+    buffer.Add(channel_);
+    buffer.Add(static_cast<uint32_t>(4 + ArgumentsSize()));
+    buffer.Add(class_id_);
+    buffer.Add(method_id_);
+    FillArguments(buffer);
+    buffer.Add(kFrameEnd);
+  }
+
+ protected:
+  virtual uint32_t ArgumentsSize() const = 0;
+  virtual void FillArguments(OutBuffer& buffer) const = 0;
+
+ private:
+  uint16_t channel_;
+  uint16_t class_id_;
+  uint16_t method_id_;
+};
+
+class ChannelFlowFrame : public MethodFrame {
+ public:
+  ChannelFlowFrame(uint16_t channel, bool active)
+    : MethodFrame(channel, kClassChannel, kChannelFlow),
+      active_(active) {}
+
+  bool active() const { return active_.Get(0); }
+
+ protected:
+  virtual uint32_t ArgumentsSize() const override { return 1; }
+  virtual void FillArguments(OutBuffer& buffer) const override {
+    active_.Fill(buffer);
+  }
+
+ private:
+  BooleanSet active_;
+};
+
+class BasicQosFrame : public MethodFrame {
+ public:
+  BasicQosFrame(uint16_t channel, uint16_t prefetch_count, bool global = false)
+    : MethodFrame(channel, kClassBasic, kBasicQos),
+      prefetch_count_(prefetch_count),
+      global_(global) {}
+
+  uint16_t prefetch_count() const { return prefetch_count_; }
+  bool global() const { return global_.Get(0); }
+
+ protected:
+  // prefetch-size(4) + prefetch-count(2) + global(1)
+  virtual uint32_t ArgumentsSize() const override { return 7; }
+  virtual void FillArguments(OutBuffer& buffer) const override {
+    // prefetch-size is not implemented by RabbitMQ; always 0.
+    buffer.Add(static_cast<uint32_t>(0));
+    buffer.Add(prefetch_count_);
+    global_.Fill(buffer);
+  }
+
+ private:
+  uint16_t prefetch_count_;
+  BooleanSet global_;
+};
+
+// Options of the declare, bind and consume frames below. Each frame encodes
+// the ones its method has and ignores the rest.
+enum MethodFlags : uint32_t {
+  kPassive    = 1 << 0,
+  kDurable    = 1 << 1,
+  kAutoDelete = 1 << 2,
+  kExclusive  = 1 << 3,
+  kInternal   = 1 << 4,
+  kNoWait     = 1 << 5,
+  kNoLocal    = 1 << 6,
+  kNoAck      = 1 << 7,
+};
+
+class ChannelOpenFrame : public MethodFrame {
+ public:
+  explicit ChannelOpenFrame(uint16_t channel)
+    : MethodFrame(channel, kClassChannel, kChannelOpen) {}
+
+ protected:
+  // reserved short string
+  virtual uint32_t ArgumentsSize() const override { return 1; }
+  virtual void FillArguments(OutBuffer& buffer) const override {
+    buffer.Add(static_cast<uint8_t>(0));
+  }
+};
+
+class ConfirmSelectFrame : public MethodFrame {
+ public:
+  explicit ConfirmSelectFrame(uint16_t channel, bool no_wait = false)
+    : MethodFrame(channel, kClassConfirm, kConfirmSelect),
+      no_wait_(no_wait) {}
+
+ protected:
+  virtual uint32_t ArgumentsSize() const override { return 1; }
+  virtual void FillArguments(OutBuffer& buffer) const override {
+    no_wait_.Fill(buffer);
+  }
+
+ private:
+  BooleanSet no_wait_;
+};
+
+class ExchangeDeclareFrame : public MethodFrame {
+ public:
+  ExchangeDeclareFrame(uint16_t channel,
+                       const std::string& name,
+                       const std::string& type,
+                       uint32_t flags,
+                       const Table& arguments)
+    : MethodFrame(channel, kClassExchange, kExchangeDeclare),
+      name_(name),
+      type_(type),
+      bits_(flags & kPassive, flags & kDurable, flags & kAutoDelete,
+            flags & kInternal, flags & kNoWait),
+      arguments_(arguments) {}
+
+ protected:
+  // reserved(2) + name + type + bits(1) + arguments
+  virtual uint32_t ArgumentsSize() const override {
+    return 2 + name_.size() + type_.size() + 1 + arguments_.size();
+  }
+  virtual void FillArguments(OutBuffer& buffer) const override {
+    buffer.Add(static_cast<uint16_t>(0));
+    name_.Fill(buffer);
+    type_.Fill(buffer);
+    bits_.Fill(buffer);
+    arguments_.Fill(buffer);
+  }
+
+ private:
+  ShortString name_;
+  ShortString type_;
+  BooleanSet bits_;
+  Table arguments_;
+};
+
+class QueueDeclareFrame : public MethodFrame {
+ public:
+  QueueDeclareFrame(uint16_t channel,
+                    const std::string& name,
+                    uint32_t flags,
+                    const Table& arguments)
+    : MethodFrame(channel, kClassQueue, kQueueDeclare),
+      name_(name),
+      bits_(flags & kPassive, flags & kDurable, flags & kExclusive,
+            flags & kAutoDelete, flags & kNoWait),
+      arguments_(arguments) {}
+
+ protected:
+  // reserved(2) + name + bits(1) + arguments
+  virtual uint32_t ArgumentsSize() const override {
+    return 2 + name_.size() + 1 + arguments_.size();
+  }
+  virtual void FillArguments(OutBuffer& buffer) const override {
+    buffer.Add(static_cast<uint16_t>(0));
+    name_.Fill(buffer);
+    bits_.Fill(buffer);
+    arguments_.Fill(buffer);
+  }
+
+ private:
+  ShortString name_;
+  BooleanSet bits_;
+  Table arguments_;
+};
+
+class QueueBindFrame : public MethodFrame {
+ public:
+  QueueBindFrame(uint16_t channel,
+                 const std::string& queue,
+                 const std::string& exchange,
+                 const std::string& routing_key,
+                 uint32_t flags,
+                 const Table& arguments)
+    : MethodFrame(channel, kClassQueue, kQueueBind),
+      queue_(queue),
+      exchange_(exchange),
+      routing_key_(routing_key),
+      bits_(flags & kNoWait),
+      arguments_(arguments) {}
+
+ protected:
+  // reserved(2) + queue + exchange + routing key + bits(1) + arguments
+  virtual uint32_t ArgumentsSize() const override {
+    return 2 + queue_.size() + exchange_.size() + routing_key_.size() + 1 +
+           arguments_.size();
+  }
+  virtual void FillArguments(OutBuffer& buffer) const override {
+    buffer.Add(static_cast<uint16_t>(0));
+    queue_.Fill(buffer);
+    exchange_.Fill(buffer);
+    routing_key_.Fill(buffer);
+    bits_.Fill(buffer);
+    arguments_.Fill(buffer);
+  }
+
+ private:
+  ShortString queue_;
+  ShortString exchange_;
+  ShortString routing_key_;
+  BooleanSet bits_;
+  Table arguments_;
+};
+
+class BasicConsumeFrame : public MethodFrame {
+ public:
+  BasicConsumeFrame(uint16_t channel,
+                    const std::string& queue,
+                    const std::string& consumer_tag,
+                    uint32_t flags,
+                    const Table& arguments)
+    : MethodFrame(channel, kClassBasic, kBasicConsume),
+      queue_(queue),
+      consumer_tag_(consumer_tag),
+      bits_(flags & kNoLocal, flags & kNoAck, flags & kExclusive,
+            flags & kNoWait),
+      arguments_(arguments) {}
+
+ protected:
+  // reserved(2) + queue + consumer tag + bits(1) + arguments
+  virtual uint32_t ArgumentsSize() const override {
+    return 2 + queue_.size() + consumer_tag_.size() + 1 + arguments_.size();
+  }
+  virtual void FillArguments(OutBuffer& buffer) const override {
+    buffer.Add(static_cast<uint16_t>(0));
+    queue_.Fill(buffer);
+    consumer_tag_.Fill(buffer);
+    bits_.Fill(buffer);
+    arguments_.Fill(buffer);
+  }
+
+ private:
+  ShortString queue_;
+  ShortString consumer_tag_;
+  BooleanSet bits_;
+  Table arguments_;
+};
+
+class BasicAckFrame : public MethodFrame {
+ public:
+  BasicAckFrame(uint16_t channel, uint64_t delivery_tag, bool multiple = false)
+    : MethodFrame(channel, kClassBasic, kBasicAck),
+      delivery_tag_(delivery_tag),
+      multiple_(multiple) {}
+
+ protected:
+  // delivery-tag(8) + multiple(1)
+  virtual uint32_t ArgumentsSize() const override { return 9; }
+  virtual void FillArguments(OutBuffer& buffer) const override {
+    buffer.Add(delivery_tag_);
+    multiple_.Fill(buffer);
+  }
+
+ private:
+  uint64_t delivery_tag_;
+  BooleanSet multiple_;
+};
+
+// Tx.Select, Tx.Commit and Tx.Rollback have no arguments.
+class TxFrame : public MethodFrame {
+ public:
+  TxFrame(uint16_t channel, TxMethod method)
+    : MethodFrame(channel, kClassTx, method) {}
+
+ protected:
+  virtual uint32_t ArgumentsSize() const override { return 0; }
+  virtual void FillArguments(OutBuffer& /* buffer */) const override {}
+};
+
+} // namespace amqp
+#endif // AMQP_METHOD_FRAMES_H_
@@ -0,0 +1,241 @@
+#include "amqp/metrics.h"
+
+#include <inttypes.h>
+#include <algorithm>
+
+#include "amqp/protocol.h"
+#include "base/string_printf.h"
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+namespace {
+
+const char* const kChannelCounterNames[] = {
+  "publishes",
+  "confirms",
+  "nacks",
+  "returns",
+  "deliveries",
+  "redeliveries",
+  "acks",
+  "rejects",
+  "flow_events",
+  "unconfirmed",
+};
+static_assert(arraysize(kChannelCounterNames) ==
+                  ChannelMetrics::kCounterCount,
+              "kChannelCounterNames out of date");
+
+const char* const kLatencyNames[] = {
+  "confirm_latency",
+  "dispatch_latency",
+  "ack_latency",
+};
+static_assert(arraysize(kLatencyNames) == ChannelMetrics::kLatencyCount,
+              "kLatencyNames out of date");
+
+const char* const kConnectionCounterNames[] = {
+  "method_frames_in",
+  "header_frames_in",
+  "body_frames_in",
+  "heartbeats_in",
+  "method_frames_out",
+  "header_frames_out",
+  "body_frames_out",
+  "heartbeats_out",
+  "bytes_in",
+  "bytes_out",
+  "flow_events",
+  "outbound_queue_frames",
+  "outbound_queue_bytes",
+};
+static_assert(arraysize(kConnectionCounterNames) ==
+                  ConnectionMetrics::kCounterCount,
+              "kConnectionCounterNames out of date");
+
+void AppendText(const ChannelMetrics::Stats& stats,
+                const char* indent,
+                std::string* out) {
+  for (int i = 0; i < ChannelMetrics::kCounterCount; ++i) {
+    base::StringAppendF(out, "%s%s %" PRId64 "\n", indent,
+                        kChannelCounterNames[i], stats.values[i]);
+  }
+}
+
+void AppendLatencyText(const ChannelMetrics::Stats& stats,
+                       const char* indent,
+                       std::string* out) {
+  for (int i = 0; i < ChannelMetrics::kLatencyCount; ++i) {
+    const ChannelMetrics::LatencyStats& l = stats.latency[i];
+    base::StringAppendF(out,
+                        "%s%s_us count=%" PRIu64 " p50=%" PRIu64
+                        " p99=%" PRIu64 " p999=%" PRIu64 " max=%" PRIu64 "\n",
+                        indent, kLatencyNames[i], l.count, l.p50, l.p99,
+                        l.p999, l.max);
+  }
+}
+
+void AppendJson(const ChannelMetrics::Stats& stats,
+                bool with_latency,
+                std::string* out) {
+  out->push_back('{');
+  for (int i = 0; i < ChannelMetrics::kCounterCount; ++i) {
+    base::StringAppendF(out, "%s\"%s\":%" PRId64, i ? "," : "",
+                        kChannelCounterNames[i], stats.values[i]);
+  }
+  if (with_latency) {
+    for (int i = 0; i < ChannelMetrics::kLatencyCount; ++i) {
+      const ChannelMetrics::LatencyStats& l = stats.latency[i];
+      base::StringAppendF(out,
+                          ",\"%s_us\":{\"count\":%" PRIu64
+                          ",\"p50\":%" PRIu64 ",\"p99\":%" PRIu64
+                          ",\"p999\":%" PRIu64 ",\"max\":%" PRIu64 "}",
+                          kLatencyNames[i], l.count, l.p50, l.p99, l.p999,
+                          l.max);
+    }
+  }
+  out->push_back('}');
+}
+
+void Accumulate(const ChannelMetrics::Stats& stats,
+                ChannelMetrics::Stats* total) {
+  for (int i = 0; i < ChannelMetrics::kCounterCount; ++i)
+    total->values[i] += stats.values[i];
+}
+
+} // namespace
+
+// static
+const char* ChannelMetrics::CounterName(Counter counter) {
+  DCHECK_LT(counter, kCounterCount);
+  return kChannelCounterNames[counter];
+}
+
+// static
+const char* ChannelMetrics::LatencyName(Latency latency) {
+  DCHECK_LT(latency, kLatencyCount);
+  return kLatencyNames[latency];
+}
+
+ChannelMetrics::Stats ChannelMetrics::Snapshot() const {
+  Stats stats;
+  stats.channel = channel_;
+  std::vector<int64_t> values;
+  counters_.SumAll(&values);
+  std::copy(values.begin(), values.end(), stats.values);
+
+  for (int i = 0; i < kLatencyCount; ++i) {
+    base::Histogram::Snapshot snapshot = histograms_[i].TakeSnapshot();
+    LatencyStats& latency = stats.latency[i];
+    latency.count = snapshot.count();
+    latency.p50 = snapshot.Percentile(50);
+    latency.p99 = snapshot.Percentile(99);
+    latency.p999 = snapshot.Percentile(99.9);
+    latency.max = snapshot.max();
+  }
+  return stats;
+}
+
+// static
+const char* ConnectionMetrics::CounterName(Counter counter) {
+  DCHECK_LT(counter, kCounterCount);
+  return kConnectionCounterNames[counter];
+}
+
+ConnectionMetrics::ConnectionMetrics() : counters_(kCounterCount) {}
+
+ConnectionMetrics::~ConnectionMetrics() {}
+
+// static
+ConnectionMetrics::Counter ConnectionMetrics::FrameCounter(uint8_t type,
+                                                           bool in) {
+  int offset = in ? 0 : METHOD_FRAMES_OUT - METHOD_FRAMES_IN;
+  switch (type) {
+    case kFrameHeader:
+      return static_cast<Counter>(HEADER_FRAMES_IN + offset);
+    case kFrameBody:
+      return static_cast<Counter>(BODY_FRAMES_IN + offset);
+    case kFrameHeartbeat:
+      return static_cast<Counter>(HEARTBEATS_IN + offset);
+    default:
+      return static_cast<Counter>(METHOD_FRAMES_IN + offset);
+  }
+}
+
+void ConnectionMetrics::OnFrameIn(uint8_t type, size_t size) {
+  counters_.Add(FrameCounter(type, true));
+  counters_.Add(BYTES_IN, static_cast<int64_t>(size));
+}
+
+void ConnectionMetrics::OnFrameOut(uint8_t type, size_t size) {
+  counters_.Add(FrameCounter(type, false));
+  counters_.Add(BYTES_OUT, static_cast<int64_t>(size));
+}
+
+ChannelMetrics* ConnectionMetrics::AddChannel(uint16_t channel) {
+  std::lock_guard<std::mutex> lock(lock_);
+  std::unique_ptr<ChannelMetrics>& metrics = channels_[channel];
+  if (!metrics) metrics.reset(new ChannelMetrics(channel));
+  return metrics.get();
+}
+
+void ConnectionMetrics::RemoveChannel(uint16_t channel) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = channels_.find(channel);
+  if (it == channels_.end()) return;
+  Accumulate(it->second->Snapshot(), &retired_);
+  channels_.erase(it);
+}
+
+ConnectionMetrics::Stats ConnectionMetrics::Snapshot() const {
+  Stats stats;
+  std::vector<int64_t> values;
+  counters_.SumAll(&values);
+  std::copy(values.begin(), values.end(), stats.values);
+
+  std::lock_guard<std::mutex> lock(lock_);
+  stats.channel_totals = retired_;
+  stats.channels.reserve(channels_.size());
+  for (const auto& entry : channels_) {
+    stats.channels.push_back(entry.second->Snapshot());
+    Accumulate(stats.channels.back(), &stats.channel_totals);
+  }
+  return stats;
+}
+
+std::string ConnectionMetrics::Stats::ToText() const {
+  std::string out;
+  for (int i = 0; i < kCounterCount; ++i) {
+    base::StringAppendF(&out, "%s %" PRId64 "\n", kConnectionCounterNames[i],
+                        values[i]);
+  }
+  out += "channel_totals\n";
+  AppendText(channel_totals, "  ", &out);
+  for (const ChannelMetrics::Stats& channel : channels) {
+    base::StringAppendF(&out, "channel %u\n", channel.channel);
+    AppendText(channel, "  ", &out);
+    AppendLatencyText(channel, "  ", &out);
+  }
+  return out;
+}
+
+std::string ConnectionMetrics::Stats::ToJson() const {
+  std::string out = "{";
+  for (int i = 0; i < kCounterCount; ++i) {
+    base::StringAppendF(&out, "\"%s\":%" PRId64 ",",
+                        kConnectionCounterNames[i], values[i]);
+  }
+  out += "\"channel_totals\":";
+  AppendJson(channel_totals, false, &out);
+  out += ",\"channels\":{";
+  for (size_t i = 0; i < channels.size(); ++i) {
+    base::StringAppendF(&out, "%s\"%u\":", i ? "," : "", channels[i].channel);
+    AppendJson(channels[i], true, &out);
+  }
+  out += "}}";
+  return out;
+}
+
+} // namespace amqp
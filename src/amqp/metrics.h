@@ -0,0 +1,174 @@
+#ifndef AMQP_METRICS_H_
+#define AMQP_METRICS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "base/histogram.h"
+#include "base/macros.h"
+#include "base/sharded_counter.h"
+
+namespace amqp {
+
+// Hot-path counters of a connection and its channels.
+//
+// Counting is a relaxed atomic add on a per-thread shard (see
+// base::ShardedCounters), so the reader, writer and application threads
+// never contend; totals are only formed by Snapshot(). Gauges such as the
+// outbound queue depth are counters moved both ways.
+//
+// Channels also keep latency histograms. Hand histogram() to the component
+// that measures it: ConfirmTracker, OrderedDispatcher, PrefetchController.
+
+class ChannelMetrics {
+ public:
+  enum Counter {
+    PUBLISHES,
+    CONFIRMS,
+    NACKS,
+    RETURNS,
+    DELIVERIES,
+    REDELIVERIES,
+    ACKS,
+    REJECTS,
+    FLOW_EVENTS,
+    // Gauge: publishes awaiting a confirm.
+    UNCONFIRMED,
+    kCounterCount,
+  };
+
+  enum Latency {
+    // Publish to Basic.Ack / Nack from the broker.
+    CONFIRM_LATENCY,
+    // Delivery frame received to MessageCallback entry.
+    DISPATCH_LATENCY,
+    // Delivery to the consumer's ack.
+    ACK_LATENCY,
+    kLatencyCount,
+  };
+
+  // In microseconds.
+  struct LatencyStats {
+    LatencyStats() : count(0), p50(0), p99(0), p999(0), max(0) {}
+
+    uint64_t count;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t max;
+  };
+
+  struct Stats {
+    Stats() : channel(0), values() {}
+    int64_t operator[](Counter counter) const { return values[counter]; }
+
+    uint16_t channel;
+    int64_t values[kCounterCount];
+    LatencyStats latency[kLatencyCount];
+  };
+
+  static const char* CounterName(Counter counter);
+  static const char* LatencyName(Latency latency);
+
+  explicit ChannelMetrics(uint16_t channel)
+    : channel_(channel), counters_(kCounterCount) {}
+
+  void Add(Counter counter, int64_t delta = 1) {
+    counters_.Add(counter, delta);
+  }
+
+  base::Histogram* histogram(Latency latency) {
+    return &histograms_[latency];
+  }
+  const base::Histogram& histogram(Latency latency) const {
+    return histograms_[latency];
+  }
+
+  uint16_t channel() const { return channel_; }
+  Stats Snapshot() const;
+
+ private:
+  const uint16_t channel_;
+  base::ShardedCounters counters_;
+  base::Histogram histograms_[kLatencyCount];
+
+  DISALLOW_COPY_AND_ASSIGN(ChannelMetrics);
+};
+
+class ConnectionMetrics {
+ public:
+  enum Counter {
+    METHOD_FRAMES_IN,
+    HEADER_FRAMES_IN,
+    BODY_FRAMES_IN,
+    HEARTBEATS_IN,
+    METHOD_FRAMES_OUT,
+    HEADER_FRAMES_OUT,
+    BODY_FRAMES_OUT,
+    HEARTBEATS_OUT,
+    BYTES_IN,
+    BYTES_OUT,
+    // Connection.Blocked / Unblocked from the broker.
+    FLOW_EVENTS,
+    // Gauges: encoded data waiting for the socket.
+    OUTBOUND_QUEUE_FRAMES,
+    OUTBOUND_QUEUE_BYTES,
+    kCounterCount,
+  };
+
+  struct Stats {
+    Stats() : values() {}
+    int64_t operator[](Counter counter) const { return values[counter]; }
+
+    // Plain text, one "name value" line per counter, channels indented.
+    std::string ToText() const;
+    std::string ToJson() const;
+
+    int64_t values[kCounterCount];
+    // Counters summed over every channel the connection has had; the
+    // latencies are not summed and stay empty.
+    ChannelMetrics::Stats channel_totals;
+    // Open channels, by number.
+    std::vector<ChannelMetrics::Stats> channels;
+  };
+
+  static const char* CounterName(Counter counter);
+
+  ConnectionMetrics();
+  ~ConnectionMetrics();
+
+  void Add(Counter counter, int64_t delta = 1) {
+    counters_.Add(counter, delta);
+  }
+  // Counts a whole frame of |type| (kFrameMethod, ...) and its bytes.
+  void OnFrameIn(uint8_t type, size_t size);
+  void OnFrameOut(uint8_t type, size_t size);
+
+  // The returned metrics live until RemoveChannel(); hand the pointer to
+  // the channel's hot path. Adding an open channel returns the same object.
+  ChannelMetrics* AddChannel(uint16_t channel);
+  // Folds the channel's counts into the totals.
+  void RemoveChannel(uint16_t channel);
+
+  Stats Snapshot() const;
+
+ private:
+  static Counter FrameCounter(uint8_t type, bool in);
+
+  base::ShardedCounters counters_;
+
+  // Guards the channel map, not the counters.
+  mutable std::mutex lock_;
+  std::map<uint16_t, std::unique_ptr<ChannelMetrics>> channels_;
+  ChannelMetrics::Stats retired_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConnectionMetrics);
+};
+
+} // namespace amqp
+#endif // AMQP_METRICS_H_
@@ -1,9 +1,10 @@
 #ifndef AMQP_NUMERIC_FIELD_H_
 #define AMQP_NUMERIC_FIELD_H_
-#include "amqp/received_frame.h"
+#include "amqp/in_buffer.h"
 #include "amqp/out_buffer.h"
 #include "amqp/field.h"
 
+#include <limits>
 #include <memory>
 #include <ostream>
 
@@ -20,7 +21,7 @@ class NumericField : public Field {
   NumericField() : value_(0) {}
   NumericField(T value) : value_(value) {}
 
-  NumericField(ReceivedFrame& frame) {
+  NumericField(InBuffer& frame) {
     if (std::is_same<int8_t, typename std::remove_cv<T>::type>::value) {
       value_ = frame.NextInt8();
     } else if (std::is_same<int16_t, typename std::remove_cv<T>::type>::value) {
@@ -67,6 +68,8 @@ class NumericField : public Field {
 
   T value() const { return value_; }
 
+  constexpr static T max() { return std::numeric_limits<T>::max(); }
+
   virtual bool IsInteger() const override { return true; }
   virtual size_t size() const override { return sizeof(value_); }  
 
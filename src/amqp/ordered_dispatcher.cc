@@ -0,0 +1,76 @@
+#include "amqp/ordered_dispatcher.h"
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+const size_t OrderedDispatcher::kMaxTasksPerTurn;
+const unsigned OrderedDispatcher::kPriorities;
+
+OrderedDispatcher::OrderedDispatcher(base::WorkStealingPool* pool)
+  : pool_(pool) {
+  DCHECK(pool_);
+}
+
+OrderedDispatcher::~OrderedDispatcher() {}
+
+void OrderedDispatcher::Dispatch(uint64_t key, Task task) {
+  Dispatch(key, 0, std::move(task));
+}
+
+void OrderedDispatcher::Dispatch(uint64_t key,
+                                 unsigned priority,
+                                 Task task,
+                                 base::TimeTicks received,
+                                 base::Histogram* latency) {
+  std::shared_ptr<Strand> strand;
+  {
+    std::lock_guard<std::mutex> lock(strands_lock_);
+    std::shared_ptr<Strand>& slot = strands_[key];
+    if (!slot) slot = std::make_shared<Strand>();
+    strand = slot;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(strand->lock);
+    strand->tasks.Push(priority, Entry{std::move(task), received, latency});
+    if (strand->scheduled) return;
+    strand->scheduled = true;
+  }
+  pool_->PostTask(std::bind(&OrderedDispatcher::RunStrand, this, strand));
+}
+
+void OrderedDispatcher::Forget(uint64_t key) {
+  // A key with work in flight is kept: a fresh strand for it could run
+  // alongside the old one and break the order.
+  std::lock_guard<std::mutex> lock(strands_lock_);
+  auto it = strands_.find(key);
+  if (it == strands_.end()) return;
+  std::lock_guard<std::mutex> strand_lock(it->second->lock);
+  if (!it->second->scheduled) strands_.erase(it);
+}
+
+void OrderedDispatcher::RunStrand(std::shared_ptr<Strand> strand) {
+  for (size_t i = 0; i < kMaxTasksPerTurn; ++i) {
+    Entry entry;
+    {
+      std::lock_guard<std::mutex> lock(strand->lock);
+      if (strand->tasks.empty()) {
+        strand->scheduled = false;
+        return;
+      }
+      entry = strand->tasks.Pop();
+    }
+    if (entry.latency) {
+      entry.latency->Record(
+          (base::TimeTicks::Now() - entry.received).InMicroseconds());
+    }
+    entry.task();
+  }
+
+  // Still busy: yield the worker and queue the rest as a new turn behind
+  // whatever was posted meanwhile, so other keys get to run first.
+  pool_->PostTaskLast(std::bind(&OrderedDispatcher::RunStrand, this, strand));
+}
+
+} // namespace amqp
@@ -0,0 +1,99 @@
+#ifndef AMQP_ORDERED_DISPATCHER_H_
+#define AMQP_ORDERED_DISPATCHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "base/bucket_queue.h"
+#include "base/histogram.h"
+#include "base/macros.h"
+#include "base/string_piece.h"
+#include "base/time.h"
+#include "base/work_stealing_pool.h"
+
+namespace amqp {
+
+// Moves consumer callbacks off the I/O thread onto a WorkStealingPool.
+//
+// Callbacks are grouped by key, usually the channel id (ChannelKey()) or the
+// consumer tag (ConsumerKey()). Callbacks with the same key run one at a
+// time, in the order they were dispatched; different keys run in parallel.
+// A slow MessageCallback therefore only holds up its own channel, never the
+// socket reads of the others.
+//
+// Within a key, queued callbacks run by the AMQP priority property (0-9)
+// of their message, highest first, and in dispatch order among equal
+// priorities. With a large prefetch window an urgent message therefore
+// overtakes the bulk already buffered on the client. Dispatch without a
+// priority means 0, which keeps plain dispatch order.
+//
+// Delivery tags then no longer complete in order, so ack each message on
+// its own. A multiple ack sent after a message that overtook others would
+// also ack the lower tags still waiting in the queue, and those messages
+// are lost if the consumer dies before running them. Set
+// PrefetchController::Options::single_acks to have that checked.
+//
+// Keys that stay active get a bounded run per turn on the pool so one busy
+// channel cannot starve the rest.
+class OrderedDispatcher {
+ public:
+  typedef std::function<void()> Task;
+
+  static const size_t kMaxTasksPerTurn = 64;
+  static const unsigned kPriorities = 10;
+
+  explicit OrderedDispatcher(base::WorkStealingPool* pool);
+  ~OrderedDispatcher();
+
+  static uint64_t ChannelKey(uint16_t channel) { return channel; }
+  // Tags are hashed into the upper range, clear of channel ids. Two tags that
+  // collide share an order, which is safe, just less parallel.
+  static uint64_t ConsumerKey(const base::StringPiece& consumer_tag) {
+    return (static_cast<uint64_t>(base::StringPieceHash()(consumer_tag))
+            << 16) | 0xffff;
+  }
+
+  // Thread-safe.
+  void Dispatch(uint64_t key, Task task);
+  // |priority| is usually MetaData::priority(); above 9 counts as 9. If
+  // |latency| is given, the time from |received| (when the frame came off
+  // the socket) to the start of |task| is recorded into it, in
+  // microseconds.
+  void Dispatch(uint64_t key, unsigned priority, Task task,
+                base::TimeTicks received = base::TimeTicks(),
+                base::Histogram* latency = nullptr);
+
+  // Drops the bookkeeping of an idle key, e.g. once its channel is closed.
+  // Does nothing while the key still has tasks queued or running.
+  void Forget(uint64_t key);
+
+ private:
+  struct Entry {
+    Task task;
+    base::TimeTicks received;
+    base::Histogram* latency;
+  };
+
+  struct Strand {
+    Strand() : scheduled(false) {}
+    std::mutex lock;
+    base::BucketQueue<Entry, kPriorities> tasks;
+    bool scheduled;
+  };
+
+  void RunStrand(std::shared_ptr<Strand> strand);
+
+  base::WorkStealingPool* pool_;
+
+  std::mutex strands_lock_;
+  std::unordered_map<uint64_t, std::shared_ptr<Strand>> strands_;
+
+  DISALLOW_COPY_AND_ASSIGN(OrderedDispatcher);
+};
+
+} // namespace amqp
+#endif // AMQP_ORDERED_DISPATCHER_H_
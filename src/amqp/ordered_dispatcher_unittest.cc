@@ -0,0 +1,82 @@
+#include "amqp/ordered_dispatcher.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "base/work_stealing_pool.h"
+
+#include <gtest/gtest.h>
+
+namespace amqp {
+
+namespace {
+
+TEST(OrderedDispatcherTest, KeepsOrderPerKey) {
+  const int kKeys = 8;
+  const int kTasksPerKey = 2000;
+  std::vector<std::vector<int>> seen(kKeys);
+  {
+    base::WorkStealingPool pool(4);
+    pool.Start();
+    OrderedDispatcher dispatcher(&pool);
+    for (int i = 0; i < kTasksPerKey; ++i) {
+      for (int key = 0; key < kKeys; ++key) {
+        // Only one task per key runs at a time, so no lock is needed.
+        dispatcher.Dispatch(key, [&seen, key, i]() {
+          seen[key].push_back(i);
+        });
+      }
+    }
+    // The pool drains its queue before it joins; the dispatcher must
+    // outlive that.
+    pool.Stop();
+  }
+  for (int key = 0; key < kKeys; ++key) {
+    ASSERT_EQ(static_cast<size_t>(kTasksPerKey), seen[key].size());
+    for (int i = 0; i < kTasksPerKey; ++i) EXPECT_EQ(i, seen[key][i]);
+  }
+}
+
+TEST(OrderedDispatcherTest, BusyKeyYieldsToOthers) {
+  const int kBusyTasks = 1000;
+  std::vector<uint64_t> ran;
+  {
+    // One worker, so the order the pool runs strands in is observable.
+    base::WorkStealingPool pool(1);
+    OrderedDispatcher dispatcher(&pool);
+    for (int i = 0; i < kBusyTasks; ++i) {
+      dispatcher.Dispatch(1, [&dispatcher, &ran, i]() {
+        ran.push_back(1);
+        // Another key's work arrives while key 1 is running.
+        if (i == 0) dispatcher.Dispatch(2, [&ran]() { ran.push_back(2); });
+      });
+    }
+    pool.Start();
+    pool.Stop();
+  }
+  ASSERT_EQ(static_cast<size_t>(kBusyTasks + 1), ran.size());
+  size_t position = 0;
+  while (ran[position] != 2) ++position;
+  // Key 2 runs after key 1's first turn, not after its whole backlog.
+  EXPECT_EQ(OrderedDispatcher::kMaxTasksPerTurn, position);
+}
+
+TEST(OrderedDispatcherTest, HigherPriorityRunsFirst) {
+  std::vector<int> ran;
+  {
+    base::WorkStealingPool pool(1);
+    OrderedDispatcher dispatcher(&pool);
+    dispatcher.Dispatch(7, 0, [&ran]() { ran.push_back(0); });
+    dispatcher.Dispatch(7, 5, [&ran]() { ran.push_back(5); });
+    dispatcher.Dispatch(7, 9, [&ran]() { ran.push_back(9); });
+    dispatcher.Dispatch(7, 5, [&ran]() { ran.push_back(50); });
+    pool.Start();
+    pool.Stop();
+  }
+  EXPECT_EQ((std::vector<int>{9, 5, 50, 0}), ran);
+}
+
+} // namespace
+
+} // namespace amqp
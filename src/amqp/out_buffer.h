@@ -1,7 +1,9 @@
 #ifndef AMQP_OUT_BUFFER_H_
 #define AMQP_OUT_BUFFER_H_
+#include <stdint.h>
 #include <memory>
 #include <cstring>
+#include <string>
 
 #include "base/byteorder.h"
 
@@ -30,6 +32,22 @@ class OutBuffer {
 
   const char* data() const { return buffer_.get(); }  
   size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  size_t available() const { return capacity_ - size_; }
+
+  // Forgets the contents but keeps the allocation, so chunks can be reused.
+  void Clear() {
+    current_ = buffer_.get();
+    size_ = 0;
+  }
+
+  // For producers that write in place (e.g. a compressor): up to
+  // available() bytes may be written at tail(), then Advance() counts them.
+  char* tail() { return current_; }
+  void Advance(size_t size) {
+    current_ += size;
+    size_ += size;
+  }
 
   void Add(const char* str, uint32_t size) {
     // Not Check length???
@@ -0,0 +1,135 @@
+#include "amqp/prefetch_controller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+PrefetchController::PrefetchController(const Options& options,
+                                       const PrefetchCallback& callback)
+  : options_(options),
+    callback_(callback),
+    prefetch_(options.initial_prefetch),
+    ack_rate_(0),
+    acks_since_rate_(0),
+    ack_histogram_(nullptr) {
+  DCHECK_LE(options_.min_prefetch, options_.max_prefetch);
+}
+
+PrefetchController::~PrefetchController() {}
+
+void PrefetchController::OnDelivery(uint64_t delivery_tag,
+                                    base::TimeTicks now) {
+  DCHECK(outstanding_.empty() ||
+         outstanding_.back().delivery_tag < delivery_tag);
+  if (rate_started_.is_null()) rate_started_ = now;
+  outstanding_.push_back(Outstanding{delivery_tag, now, false});
+  MaybeAdjust(now);
+}
+
+void PrefetchController::OnAck(uint64_t delivery_tag, bool multiple,
+                               base::TimeTicks now) {
+  DCHECK(!multiple || !options_.single_acks)
+      << "multiple ack of " << delivery_tag << " under priority dispatch";
+  base::TimeTicks earliest;
+  size_t acked = Complete(delivery_tag, multiple, now, &earliest);
+  if (acked > 0) {
+    ack_latency_ = Average(ack_latency_, now - earliest);
+    // The consumer could not start before the delivery, nor before it was
+    // done with the previous message.
+    base::TimeTicks start = std::max(earliest, last_ack_);
+    if (now > start) {
+      service_time_ = Average(service_time_, (now - start) / acked);
+    }
+    last_ack_ = now;
+    acks_since_rate_ += acked;
+  }
+  MaybeAdjust(now);
+}
+
+void PrefetchController::OnReject(uint64_t delivery_tag, bool multiple) {
+  base::TimeTicks earliest;
+  Complete(delivery_tag, multiple, base::TimeTicks(), &earliest);
+}
+
+void PrefetchController::OnRoundTrip(base::TimeDelta rtt) {
+  rtt_ = Average(rtt_, rtt);
+}
+
+size_t PrefetchController::Complete(uint64_t delivery_tag, bool multiple,
+                                    base::TimeTicks now,
+                                    base::TimeTicks* earliest) {
+  base::Histogram* histogram = now.is_null() ? nullptr : ack_histogram_;
+  size_t completed = 0;
+  if (multiple) {
+    for (Outstanding& entry : outstanding_) {
+      if (entry.delivery_tag > delivery_tag) break;
+      if (entry.done) continue;
+      entry.done = true;
+      if (completed++ == 0) *earliest = entry.delivered;
+      if (histogram)
+        histogram->Record((now - entry.delivered).InMicroseconds());
+    }
+  } else {
+    auto it = std::lower_bound(
+        outstanding_.begin(), outstanding_.end(), delivery_tag,
+        [](const Outstanding& entry, uint64_t tag) {
+          return entry.delivery_tag < tag;
+        });
+    if (it != outstanding_.end() && it->delivery_tag == delivery_tag &&
+        !it->done) {
+      it->done = true;
+      completed = 1;
+      *earliest = it->delivered;
+      if (histogram) histogram->Record((now - it->delivered).InMicroseconds());
+    }
+  }
+
+  while (!outstanding_.empty() && outstanding_.front().done) {
+    outstanding_.pop_front();
+  }
+  return completed;
+}
+
+base::TimeDelta PrefetchController::Average(base::TimeDelta average,
+                                            base::TimeDelta sample) const {
+  if (average == base::TimeDelta()) return sample;
+  double w = options_.ewma_weight;
+  return base::TimeDelta::FromMicroseconds(static_cast<int64_t>(
+      (1 - w) * average.InMicroseconds() + w * sample.InMicroseconds()));
+}
+
+void PrefetchController::MaybeAdjust(base::TimeTicks now) {
+  if (rate_started_.is_null()) return;
+  base::TimeDelta elapsed = now - rate_started_;
+  if (elapsed < options_.adjust_interval) return;
+
+  double rate = acks_since_rate_ / elapsed.InSecondsF();
+  ack_rate_ = ack_rate_ == 0
+      ? rate : (1 - options_.ewma_weight) * ack_rate_ +
+               options_.ewma_weight * rate;
+  acks_since_rate_ = 0;
+  rate_started_ = now;
+
+  // Without an RTT and a service time sample there is nothing to go on yet.
+  if (rtt_ == base::TimeDelta() || service_time_ == base::TimeDelta())
+    return;
+
+  double loop = (rtt_ + service_time_).InSecondsF();
+  double target = std::ceil(options_.headroom * ack_rate_ * loop);
+  target = std::max<double>(target, options_.min_prefetch);
+  target = std::min<double>(target, options_.max_prefetch);
+
+  double change = std::fabs(target - prefetch_) / prefetch_;
+  if (change < options_.min_change) return;
+  if (!last_adjust_.is_null() && now - last_adjust_ < options_.adjust_interval)
+    return;
+
+  prefetch_ = static_cast<uint16_t>(target);
+  last_adjust_ = now;
+  callback_(prefetch_);
+}
+
+} // namespace amqp
@@ -0,0 +1,126 @@
+#ifndef AMQP_PREFETCH_CONTROLLER_H_
+#define AMQP_PREFETCH_CONTROLLER_H_
+
+#include <stdint.h>
+#include <deque>
+#include <functional>
+
+#include "base/histogram.h"
+#include "base/macros.h"
+#include "base/time.h"
+
+namespace amqp {
+
+// Tunes one consumer's Basic.Qos prefetch count from what it observes.
+//
+// The prefetch window has to cover the whole loop a message slot travels:
+// the ack on its way to the broker and the next delivery on its way back
+// (one RTT), plus the time the consumer needs to process a message. At an
+// ack rate of R messages/s the window that keeps the pipeline full is
+//
+//   prefetch = headroom * R * (rtt + service_time)
+//
+// Anything above that only sits in client memory. The service time is not
+// the delivery-to-ack latency, which includes the time a message waits in
+// the prefetch buffer and so grows with the prefetch itself; it is the time
+// from when the consumer could have started on a message (its delivery or
+// the previous ack, whichever is later) to its ack.
+//
+// Changes are applied through the callback, which is expected to send
+// Basic.Qos; small changes are suppressed to avoid Qos churn.
+//
+// Not thread-safe; call from the consumer's channel thread.
+class PrefetchController {
+ public:
+  typedef std::function<void(uint16_t prefetch)> PrefetchCallback;
+
+  struct Options {
+    Options()
+      : initial_prefetch(32),
+        min_prefetch(1),
+        max_prefetch(4096),
+        headroom(1.5),
+        min_change(0.25),
+        ewma_weight(0.1),
+        adjust_interval(base::TimeDelta::FromMilliseconds(500)),
+        single_acks(false) {}
+
+    uint16_t initial_prefetch;
+    uint16_t min_prefetch;
+    uint16_t max_prefetch;
+    double headroom;
+    // Relative change below which the prefetch is left alone.
+    double min_change;
+    // Weight of a new sample in the moving averages.
+    double ewma_weight;
+    base::TimeDelta adjust_interval;
+    // Set when deliveries are dispatched by priority (OrderedDispatcher):
+    // acks must then name one delivery tag each, and a multiple ack is a
+    // bug that DCHECKs.
+    bool single_acks;
+  };
+
+  PrefetchController(const Options& options, const PrefetchCallback& callback);
+  ~PrefetchController();
+
+  void OnDelivery(uint64_t delivery_tag, base::TimeTicks now);
+  void OnAck(uint64_t delivery_tag, bool multiple, base::TimeTicks now);
+  // Rejected and nacked messages leave the window without a latency sample.
+  void OnReject(uint64_t delivery_tag, bool multiple);
+  // Any request/response round trip to the broker, e.g. Basic.Qos-Ok.
+  void OnRoundTrip(base::TimeDelta rtt);
+
+  uint16_t prefetch() const { return prefetch_; }
+  size_t outstanding() const { return outstanding_.size(); }
+  double ack_rate() const { return ack_rate_; }
+  base::TimeDelta rtt() const { return rtt_; }
+  base::TimeDelta service_time() const { return service_time_; }
+  // Delivery-to-ack, including the wait in the prefetch buffer.
+  base::TimeDelta ack_latency() const { return ack_latency_; }
+
+  // Optional; gets every delivery-to-ack latency, in microseconds.
+  void set_ack_latency_histogram(base::Histogram* histogram) {
+    ack_histogram_ = histogram;
+  }
+
+ private:
+  struct Outstanding {
+    uint64_t delivery_tag;
+    base::TimeTicks delivered;
+    bool done;
+  };
+
+  // Marks |delivery_tag| (and older ones if |multiple|) done; returns how
+  // many were newly marked. |earliest| gets the oldest delivery time among
+  // them. Each is sampled into ack_histogram_ unless |now| is null.
+  size_t Complete(uint64_t delivery_tag, bool multiple, base::TimeTicks now,
+                  base::TimeTicks* earliest);
+  base::TimeDelta Average(base::TimeDelta average,
+                          base::TimeDelta sample) const;
+  void MaybeAdjust(base::TimeTicks now);
+
+  const Options options_;
+  PrefetchCallback callback_;
+  uint16_t prefetch_;
+
+  // Ordered by delivery tag.
+  std::deque<Outstanding> outstanding_;
+
+  double ack_rate_;
+  base::TimeTicks rate_started_;
+  size_t acks_since_rate_;
+
+  base::TimeDelta rtt_;
+  base::TimeDelta service_time_;
+  base::TimeDelta ack_latency_;
+  base::TimeTicks last_ack_;
+
+  base::TimeTicks last_adjust_;
+
+  base::Histogram* ack_histogram_;
+
+  DISALLOW_COPY_AND_ASSIGN(PrefetchController);
+};
+
+} // namespace amqp
+#endif // AMQP_PREFETCH_CONTROLLER_H_
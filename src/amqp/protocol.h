@@ -0,0 +1,100 @@
+#ifndef AMQP_PROTOCOL_H_
+#define AMQP_PROTOCOL_H_
+
+#include <stdint.h>
+
+namespace amqp {
+
+// AMQP 0-9-1 wire constants.
+
+const uint8_t kFrameMethod    = 1;
+const uint8_t kFrameHeader    = 2;
+const uint8_t kFrameBody      = 3;
+const uint8_t kFrameHeartbeat = 8;
+const uint8_t kFrameEnd       = 0xCE;
+
+// type(1) + channel(2) + size(4) before the payload, end octet after it.
+const uint32_t kFrameOverhead = 8;
+const uint32_t kFrameHeaderSize = 7;
+const uint32_t kFrameMinSize = 4096;
+
+enum ClassId : uint16_t {
+  kClassConnection = 10,
+  kClassChannel    = 20,
+  kClassExchange   = 40,
+  kClassQueue      = 50,
+  kClassBasic      = 60,
+  kClassConfirm    = 85,
+  kClassTx         = 90,
+};
+
+enum ChannelMethod : uint16_t {
+  kChannelOpen    = 10,
+  kChannelOpenOk  = 11,
+  kChannelFlow    = 20,
+  kChannelFlowOk  = 21,
+  kChannelClose   = 40,
+  kChannelCloseOk = 41,
+};
+
+enum ExchangeMethod : uint16_t {
+  kExchangeDeclare   = 10,
+  kExchangeDeclareOk = 11,
+  kExchangeDelete    = 20,
+  kExchangeDeleteOk  = 21,
+  kExchangeBind      = 30,
+  kExchangeBindOk    = 31,
+  kExchangeUnbind    = 40,
+  kExchangeUnbindOk  = 51,
+};
+
+enum QueueMethod : uint16_t {
+  kQueueDeclare   = 10,
+  kQueueDeclareOk = 11,
+  kQueueBind      = 20,
+  kQueueBindOk    = 21,
+  kQueuePurge     = 30,
+  kQueuePurgeOk   = 31,
+  kQueueDelete    = 40,
+  kQueueDeleteOk  = 41,
+  kQueueUnbind    = 50,
+  kQueueUnbindOk  = 51,
+};
+
+enum BasicMethod : uint16_t {
+  kBasicQos          = 10,
+  kBasicQosOk        = 11,
+  kBasicConsume      = 20,
+  kBasicConsumeOk    = 21,
+  kBasicCancel       = 30,
+  kBasicCancelOk     = 31,
+  kBasicPublish      = 40,
+  kBasicReturn       = 50,
+  kBasicDeliver      = 60,
+  kBasicGet          = 70,
+  kBasicGetOk        = 71,
+  kBasicGetEmpty     = 72,
+  kBasicAck          = 80,
+  kBasicReject       = 90,
+  kBasicRecoverAsync = 100,
+  kBasicRecover      = 110,
+  kBasicRecoverOk    = 111,
+  kBasicNack         = 120,
+};
+
+enum ConfirmMethod : uint16_t {
+  kConfirmSelect   = 10,
+  kConfirmSelectOk = 11,
+};
+
+enum TxMethod : uint16_t {
+  kTxSelect     = 10,
+  kTxSelectOk   = 11,
+  kTxCommit     = 20,
+  kTxCommitOk   = 21,
+  kTxRollback   = 30,
+  kTxRollbackOk = 31,
+};
+
+} // namespace amqp
+#endif // AMQP_PROTOCOL_H_
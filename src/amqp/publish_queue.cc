@@ -0,0 +1,71 @@
+#include "amqp/publish_queue.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "amqp/metrics.h"
+#include "base/eintr_wrapper.h"
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+PublishQueue::PublishQueue(size_t max_batches)
+  : max_batches_(max_batches),
+    size_(0),
+    wakeup_pending_(false),
+    wakeup_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+    metrics_(nullptr) {
+  DCHECK_GT(max_batches_, 0u);
+  PCHECK(wakeup_fd_.is_valid()) << "eventfd";
+}
+
+PublishQueue::~PublishQueue() {
+  while (FrameBatch* batch = queue_.Pop()) {
+    FrameBatch::Release(batch);
+  }
+}
+
+bool PublishQueue::Enqueue(FrameBatch* batch) {
+  // Reserve a slot first; the bound holds without a lock.
+  if (size_.fetch_add(1, std::memory_order_relaxed) >= max_batches_) {
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // Counted before the push: the writer may drain it right away.
+  if (metrics_) {
+    metrics_->Add(ConnectionMetrics::OUTBOUND_QUEUE_FRAMES, batch->frames());
+    metrics_->Add(ConnectionMetrics::OUTBOUND_QUEUE_BYTES,
+                  batch->buffer().size());
+  }
+  queue_.Push(batch);
+  if (!wakeup_pending_.exchange(true, std::memory_order_acq_rel)) {
+    uint64_t one = 1;
+    ignore_result(HANDLE_EINTR(write(wakeup_fd_.get(), &one, sizeof(one))));
+  }
+  return true;
+}
+
+size_t PublishQueue::Drain(std::vector<FrameBatch*>* batches) {
+  uint64_t count;
+  ignore_result(HANDLE_EINTR(read(wakeup_fd_.get(), &count, sizeof(count))));
+  // Clear before draining: an enqueue that lands after this wakes us again.
+  wakeup_pending_.exchange(false, std::memory_order_acq_rel);
+
+  size_t drained = 0;
+  while (FrameBatch* batch = queue_.Pop()) {
+    if (metrics_) {
+      metrics_->Add(ConnectionMetrics::OUTBOUND_QUEUE_FRAMES,
+                    -static_cast<int64_t>(batch->frames()));
+      metrics_->Add(ConnectionMetrics::OUTBOUND_QUEUE_BYTES,
+                    -static_cast<int64_t>(batch->buffer().size()));
+    }
+    batches->push_back(batch);
+    ++drained;
+  }
+  size_.fetch_sub(drained, std::memory_order_relaxed);
+  return drained;
+}
+
+} // namespace amqp
@@ -0,0 +1,64 @@
+#ifndef AMQP_PUBLISH_QUEUE_H_
+#define AMQP_PUBLISH_QUEUE_H_
+
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+#include "amqp/frame_batch.h"
+#include "base/macros.h"
+#include "base/mpsc_queue.h"
+#include "base/scoped_file.h"
+
+namespace amqp {
+
+class ConnectionMetrics;
+
+// Bounded lock-free handoff of encoded frame batches from any number of
+// application threads to the single thread that writes a connection's
+// socket.
+//
+//   // Application thread:
+//   FrameBatch* batch = FrameBatch::Acquire();
+//   ... encode frames into batch->buffer() ...
+//   if (!queue->Enqueue(batch)) { ... full: back off, retry ... }
+//
+//   // Writer thread, when wakeup_fd() is readable:
+//   queue->Drain(&batches);
+//   ... writev() them, then FrameBatch::Release() each ...
+//
+// Producers write the eventfd only when the writer is not already due to
+// wake up, so a burst of enqueues costs the writer one wakeup.
+class PublishQueue {
+ public:
+  explicit PublishQueue(size_t max_batches);
+  ~PublishQueue();
+
+  // Any thread. Takes ownership of |batch| on success; on failure (queue
+  // full) the caller keeps it.
+  bool Enqueue(FrameBatch* batch);
+
+  // Writer thread only. Appends queued batches to |batches| in FIFO order
+  // per producer; returns how many were appended.
+  size_t Drain(std::vector<FrameBatch*>* batches);
+
+  int wakeup_fd() const { return wakeup_fd_.get(); }
+  size_t max_batches() const { return max_batches_; }
+  size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+  // Optional; keeps the OUTBOUND_QUEUE_* gauges. Set before use.
+  void set_metrics(ConnectionMetrics* metrics) { metrics_ = metrics; }
+
+ private:
+  const size_t max_batches_;
+  std::atomic<size_t> size_;
+  std::atomic<bool> wakeup_pending_;
+  base::MpscQueue<FrameBatch> queue_;
+  base::ScopedFD wakeup_fd_;
+  ConnectionMetrics* metrics_;
+
+  DISALLOW_COPY_AND_ASSIGN(PublishQueue);
+};
+
+} // namespace amqp
+#endif // AMQP_PUBLISH_QUEUE_H_
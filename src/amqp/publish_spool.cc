@@ -0,0 +1,362 @@
+#include "amqp/publish_spool.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "base/crc32c.h"
+#include "base/file_enumerator.h"
+#include "base/file_util.h"
+#include "base/pickle.h"
+#include "base/string_printf.h"
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+namespace {
+
+const char kSuffix[] = ".spool";
+const char kMarkName[] = "released";
+// sequence (8) + masked CRC of it (4)
+const int kMarkSize = 12;
+// length + masked CRC
+const int64_t kRecordHeaderSize = 8;
+// Anything longer is a corrupt length field.
+const uint32_t kMaxRecordSize = 1u << 30;
+
+base::Status FileError(const char* what, const base::FilePath& path) {
+  return base::Status(base::UNAVAILABLE,
+                      base::StringPrintf("%s %s: %s", what,
+                                         path.value().c_str(),
+                                         strerror(errno)));
+}
+
+} // namespace
+
+// static
+base::Status PublishSpool::Open(const base::FilePath& dir,
+                                const Options& options,
+                                std::unique_ptr<PublishSpool>* spool) {
+  std::unique_ptr<PublishSpool> opened(new PublishSpool(dir, options));
+  base::Status status = opened->Recover();
+  if (status.ok()) *spool = std::move(opened);
+  return status;
+}
+
+PublishSpool::PublishSpool(const base::FilePath& dir, const Options& options)
+  : dir_(dir),
+    options_(options),
+    written_(0),
+    next_sequence_(1),
+    released_(0),
+    mark_dirty_(false),
+    replayed_(0),
+    read_first_(0),
+    read_offset_(0) {}
+
+PublishSpool::~PublishSpool() {
+  if (buffer_.empty()) return;
+  base::Status status = Sync();
+  LOG_IF(ERROR, !status.ok()) << "spool: " << status.ToString();
+}
+
+base::Status PublishSpool::Recover() {
+  if (!base::DirectoryExists(dir_) && !base::CreateDirectory(dir_))
+    return FileError("cannot create", dir_);
+
+  base::FilePath mark_path = dir_.AppendASCII(kMarkName);
+  mark_.Initialize(mark_path, base::File::FLAG_OPEN_ALWAYS |
+                              base::File::FLAG_READ |
+                              base::File::FLAG_WRITE);
+  if (!mark_.IsValid()) return FileError("cannot open", mark_path);
+
+  base::FileEnumerator files(dir_, false, base::FileEnumerator::FILES,
+                             std::string("*") + kSuffix);
+  for (base::FilePath path = files.Next(); !path.empty();
+       path = files.Next()) {
+    const std::string name = path.BaseName().value();
+    char* end = nullptr;
+    uint64_t first = strtoull(name.c_str(), &end, 16);
+    if (first == 0 || strcmp(end, kSuffix) != 0) {
+      LOG(WARNING) << "spool: ignoring " << path.value();
+      continue;
+    }
+    Segment segment;
+    segment.path = path;
+    segment.first = first;
+    segment.last = first - 1;
+    segment.size = 0;
+    segments_.push_back(segment);
+  }
+  std::sort(segments_.begin(), segments_.end(),
+            [](const Segment& a, const Segment& b) {
+              return a.first < b.first;
+            });
+
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    base::Status status = Scan(&segments_[i], i + 1 == segments_.size());
+    if (!status.ok()) return status;
+    if (i > 0 && segments_[i].first != segments_[i - 1].last + 1) {
+      return base::Status(base::DATA_LOSS,
+                          "spool: records missing before " +
+                              segments_[i].path.value());
+    }
+  }
+
+  if (segments_.empty()) return StartSegment(next_sequence_);
+
+  const Segment& back = segments_.back();
+  writer_.Initialize(back.path, base::File::FLAG_OPEN |
+                                base::File::FLAG_WRITE);
+  if (!writer_.IsValid()) return FileError("cannot open", back.path);
+  written_ = back.size;
+  next_sequence_ = back.last + 1;
+  // The mark may trail the segments (a crash before it was synced) or, once
+  // everything was released, run ahead of what the files still hold.
+  released_ = std::max(segments_.front().first - 1,
+                       std::min(ReadMark(), next_sequence_ - 1));
+  replayed_ = released_;
+  return base::Status::OK();
+}
+
+base::Status PublishSpool::Scan(Segment* segment, bool tail) {
+  base::File file(segment->path, base::File::FLAG_OPEN |
+                                 base::File::FLAG_READ);
+  if (!file.IsValid()) return FileError("cannot open", segment->path);
+
+  std::string record;
+  uint64_t sequence;
+  base::StringPiece frames;
+  int64_t offset = 0;
+  uint64_t expected = segment->first;
+  while (ReadRecord(&file, offset, &record, &sequence, &frames) &&
+         sequence == expected) {
+    offset += kRecordHeaderSize + record.size();
+    ++expected;
+  }
+  segment->last = expected - 1;
+  segment->size = offset;
+
+  int64_t length = file.GetLength();
+  if (length == offset) return base::Status::OK();
+  if (!tail) {
+    return base::Status(base::DATA_LOSS,
+                        base::StringPrintf("spool: bad record at %s:%" PRId64,
+                                           segment->path.value().c_str(),
+                                           offset));
+  }
+  LOG(WARNING) << "spool: truncating " << segment->path.value() << " from "
+               << length << " to " << offset << " bytes";
+  base::File truncate(segment->path, base::File::FLAG_OPEN |
+                                     base::File::FLAG_WRITE);
+  if (!truncate.SetLength(offset) || !truncate.Flush())
+    return FileError("cannot truncate", segment->path);
+  return base::Status::OK();
+}
+
+bool PublishSpool::ReadRecord(base::File* file,
+                              int64_t offset,
+                              std::string* record,
+                              uint64_t* sequence,
+                              base::StringPiece* frames) const {
+  char header[kRecordHeaderSize];
+  if (file->Read(offset, header, sizeof(header)) != sizeof(header))
+    return false;
+  uint32_t length, masked_crc;
+  memcpy(&length, header, 4);
+  memcpy(&masked_crc, header + 4, 4);
+  if (length == 0 || length > kMaxRecordSize) return false;
+
+  record->resize(length);
+  if (file->Read(offset + kRecordHeaderSize, &(*record)[0], length) !=
+      static_cast<int>(length)) {
+    return false;
+  }
+  if (base::UnmaskCrc32c(masked_crc) != base::Crc32c(record->data(), length))
+    return false;
+
+  base::Pickle pickle(record->data(), length);
+  base::PickleIterator it(pickle);
+  const char* data;
+  int size;
+  if (!it.ReadUInt64(sequence) || !it.ReadData(&data, &size)) return false;
+  *frames = base::StringPiece(data, size);
+  return true;
+}
+
+base::Status PublishSpool::StartSegment(uint64_t first) {
+  base::FilePath path = dir_.AppendASCII(
+      base::StringPrintf("%016" PRIx64 "%s", first, kSuffix));
+  writer_.Close();
+  writer_.Initialize(path, base::File::FLAG_CREATE_ALWAYS |
+                           base::File::FLAG_WRITE);
+  if (!writer_.IsValid()) return FileError("cannot create", path);
+
+  // Make the new name itself durable.
+  base::File dir(dir_, base::File::FLAG_OPEN | base::File::FLAG_READ);
+  if (!dir.IsValid() || !dir.Flush()) return FileError("cannot sync", dir_);
+
+  Segment segment;
+  segment.path = path;
+  segment.first = first;
+  segment.last = first - 1;
+  segment.size = 0;
+  segments_.push_back(segment);
+  written_ = 0;
+  return base::Status::OK();
+}
+
+base::Status PublishSpool::Append(const base::StringPiece& frames,
+                                  uint64_t* sequence) {
+  base::Pickle pickle;
+  pickle.WriteUInt64(next_sequence_);
+  pickle.WriteData(frames.data(), static_cast<int>(frames.size()));
+  int64_t record_size = kRecordHeaderSize + pickle.size();
+
+  if (segments_.back().size > 0 &&
+      segments_.back().size + record_size >
+          static_cast<int64_t>(options_.segment_bytes)) {
+    base::Status status = Sync();
+    if (!status.ok()) return status;
+    status = StartSegment(next_sequence_);
+    if (!status.ok()) return status;
+  }
+
+  uint32_t length = static_cast<uint32_t>(pickle.size());
+  uint32_t masked_crc = base::MaskCrc32c(
+      base::Crc32c(static_cast<const char*>(pickle.data()), length));
+  buffer_.append(reinterpret_cast<const char*>(&length), 4);
+  buffer_.append(reinterpret_cast<const char*>(&masked_crc), 4);
+  buffer_.append(static_cast<const char*>(pickle.data()), length);
+
+  Segment& back = segments_.back();
+  back.last = next_sequence_;
+  back.size += record_size;
+  if (sequence) *sequence = next_sequence_;
+  ++next_sequence_;
+
+  if (buffer_.size() >= options_.sync_bytes) return Sync();
+  return base::Status::OK();
+}
+
+base::Status PublishSpool::WriteBuffered() {
+  if (buffer_.empty()) return base::Status::OK();
+  // Positional, so a failed write is simply retried at the same offset.
+  int size = static_cast<int>(buffer_.size());
+  if (writer_.Write(written_, buffer_.data(), size) != size)
+    return FileError("cannot write", segments_.back().path);
+  written_ += size;
+  buffer_.clear();
+  return base::Status::OK();
+}
+
+base::Status PublishSpool::Sync() {
+  base::Status status = WriteBuffered();
+  if (!status.ok()) return status;
+  if (!writer_.Flush()) return FileError("cannot sync", segments_.back().path);
+  if (mark_dirty_) {
+    if (!mark_.Flush()) return FileError("cannot sync", dir_);
+    mark_dirty_ = false;
+  }
+  return base::Status::OK();
+}
+
+uint64_t PublishSpool::ReadMark() {
+  char mark[kMarkSize];
+  if (mark_.Read(0, mark, kMarkSize) != kMarkSize) return 0;
+  uint64_t sequence;
+  uint32_t masked_crc;
+  memcpy(&sequence, mark, 8);
+  memcpy(&masked_crc, mark + 8, 4);
+  if (base::UnmaskCrc32c(masked_crc) != base::Crc32c(mark, 8)) {
+    LOG(WARNING) << "spool: ignoring a bad release mark in " << dir_.value();
+    return 0;
+  }
+  return sequence;
+}
+
+base::Status PublishSpool::WriteMark() {
+  char mark[kMarkSize];
+  memcpy(mark, &released_, 8);
+  uint32_t masked_crc = base::MaskCrc32c(base::Crc32c(mark, 8));
+  memcpy(mark + 8, &masked_crc, 4);
+  if (mark_.Write(0, mark, kMarkSize) != kMarkSize)
+    return FileError("cannot write", dir_.AppendASCII(kMarkName));
+  mark_dirty_ = true;
+  return base::Status::OK();
+}
+
+base::Status PublishSpool::Replay(const ReplayCallback& callback) {
+  base::Status status = WriteBuffered();
+  if (!status.ok()) return status;
+
+  std::string record;
+  uint64_t sequence;
+  base::StringPiece frames;
+  for (size_t i = 0; i < segments_.size() && replayed_ + 1 < next_sequence_;
+       ++i) {
+    const Segment& segment = segments_[i];
+    if (segment.last <= replayed_) continue;
+    if (segment.first != read_first_) {
+      read_first_ = segment.first;
+      read_offset_ = 0;
+    }
+
+    base::File file(segment.path, base::File::FLAG_OPEN |
+                                  base::File::FLAG_READ);
+    if (!file.IsValid()) return FileError("cannot open", segment.path);
+    while (read_offset_ < segment.size) {
+      if (!ReadRecord(&file, read_offset_, &record, &sequence, &frames)) {
+        return base::Status(base::DATA_LOSS,
+                            base::StringPrintf(
+                                "spool: bad record at %s:%" PRId64,
+                                segment.path.value().c_str(), read_offset_));
+      }
+      if (sequence > replayed_) {
+        if (!callback(sequence, frames)) return base::Status::OK();
+        replayed_ = sequence;
+      }
+      read_offset_ += kRecordHeaderSize + record.size();
+    }
+  }
+  return base::Status::OK();
+}
+
+void PublishSpool::Rewind() {
+  replayed_ = released_;
+  read_first_ = 0;
+}
+
+base::Status PublishSpool::Release(uint64_t sequence) {
+  sequence = std::min(sequence, next_sequence_ - 1);
+  if (sequence <= released_) return base::Status::OK();
+  released_ = sequence;
+  if (replayed_ < released_) {
+    replayed_ = released_;
+    read_first_ = 0;
+  }
+  base::Status status = WriteMark();
+  if (!status.ok()) return status;
+
+  // Start afresh rather than keep a drained segment growing.
+  if (segments_.back().size > 0 && segments_.back().last <= released_) {
+    buffer_.clear();
+    status = StartSegment(next_sequence_);
+    if (!status.ok()) return status;
+  }
+
+  while (segments_.size() > 1 && segments_.front().last <= released_) {
+    if (!base::DeleteFile(segments_.front().path, false)) {
+      PLOG(ERROR) << "spool: cannot delete "
+                  << segments_.front().path.value();
+    }
+    if (read_first_ == segments_.front().first) read_first_ = 0;
+    segments_.pop_front();
+  }
+  return base::Status::OK();
+}
+
+} // namespace amqp
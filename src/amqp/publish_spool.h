@@ -0,0 +1,138 @@
+#ifndef AMQP_PUBLISH_SPOOL_H_
+#define AMQP_PUBLISH_SPOOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "base/file.h"
+#include "base/file_path.h"
+#include "base/macros.h"
+#include "base/status.h"
+#include "base/string_piece.h"
+
+namespace amqp {
+
+// Disk-backed queue of encoded publishes, for when they cannot go to the
+// broker: the connection is down or the confirm window is full.
+//
+// The spool is a directory of append-only segment files, each named after
+// the sequence number of its first record. A record is
+//
+//   length (4) | masked CRC-32C of the pickle (4) | pickle
+//
+// where the pickle holds the record's sequence number and the frames. A
+// torn record at the end of the newest segment (a crash mid-write) is cut
+// off when the spool is opened; corruption anywhere else is reported.
+//
+// Append() only buffers. Sync() writes everything buffered with one write
+// and makes it durable with one fdatasync, so many appends share the cost
+// of a sync; it also runs by itself once sync_bytes are buffered.
+//
+// Replay() hands the spooled publishes to the caller in order, and
+// Release() drops them once the broker has confirmed them; a segment is
+// deleted when all its records are released. After a connection loss,
+// Rewind() makes Replay() start again at the first unreleased record.
+//
+// The release position is kept in a "released" file next to the segments,
+// overwritten by Release() and made durable by the next Sync(), so a
+// restart resumes after the last released record even within a partly
+// released segment. Delivery is at-least-once: records replayed but not yet
+// released when the process stops, and after a machine crash those
+// released since the last Sync(), are replayed again.
+//
+// Not thread-safe. Sync() blocks on the disk.
+class PublishSpool {
+ public:
+  struct Options {
+    Options() : segment_bytes(64 << 20), sync_bytes(1 << 20) {}
+
+    size_t segment_bytes;
+    size_t sync_bytes;
+  };
+
+  // Returns false to stop before |sequence|; it is offered again next time.
+  typedef std::function<bool(uint64_t sequence,
+                             const base::StringPiece& frames)> ReplayCallback;
+
+  // Opens the spool in |dir|, creating the directory if needed, and
+  // recovers the records already there.
+  static base::Status Open(const base::FilePath& dir,
+                           const Options& options,
+                           std::unique_ptr<PublishSpool>* spool);
+
+  // Syncs what is still buffered.
+  ~PublishSpool();
+
+  // |sequence| may be null. Not durable until the next Sync().
+  base::Status Append(const base::StringPiece& frames, uint64_t* sequence);
+  base::Status Sync();
+
+  base::Status Replay(const ReplayCallback& callback);
+  void Rewind();
+  // Releases every record up to and including |sequence|.
+  base::Status Release(uint64_t sequence);
+
+  // Records appended and not released.
+  uint64_t pending() const { return next_sequence_ - 1 - released_; }
+  bool empty() const { return pending() == 0; }
+  uint64_t next_sequence() const { return next_sequence_; }
+  size_t segments() const { return segments_.size(); }
+
+ private:
+  struct Segment {
+    base::FilePath path;
+    uint64_t first;
+    // first - 1 while empty.
+    uint64_t last;
+    // Including records still buffered.
+    int64_t size;
+  };
+
+  PublishSpool(const base::FilePath& dir, const Options& options);
+
+  base::Status Recover();
+  // Checks the records of |segment| and sets its last and size. A bad tail
+  // is truncated if |tail| and an error otherwise.
+  base::Status Scan(Segment* segment, bool tail);
+  base::Status StartSegment(uint64_t first);
+  base::Status WriteBuffered();
+  // Reads the release mark; 0 if there is none or it is unreadable.
+  uint64_t ReadMark();
+  base::Status WriteMark();
+
+  // Reads the record at |offset| of |file|; false at the end or on a bad
+  // record.
+  bool ReadRecord(base::File* file, int64_t offset, std::string* record,
+                  uint64_t* sequence, base::StringPiece* frames) const;
+
+  const base::FilePath dir_;
+  const Options options_;
+
+  // Oldest first; the writer appends to back().
+  std::deque<Segment> segments_;
+  base::File writer_;
+  // Encoded records not yet written, all for back().
+  std::string buffer_;
+  int64_t written_;
+  uint64_t next_sequence_;
+  uint64_t released_;
+
+  // Holds released_; |mark_dirty_| until the next Sync() flushes it.
+  base::File mark_;
+  bool mark_dirty_;
+
+  // Replay position: the next record to offer is replayed_ + 1, at
+  // read_offset_ of the segment starting with read_first_ (0: unknown).
+  uint64_t replayed_;
+  uint64_t read_first_;
+  int64_t read_offset_;
+
+  DISALLOW_COPY_AND_ASSIGN(PublishSpool);
+};
+
+} // namespace amqp
+#endif // AMQP_PUBLISH_SPOOL_H_
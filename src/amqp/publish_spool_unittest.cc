@@ -0,0 +1,176 @@
+#include "amqp/publish_spool.h"
+
+#include <inttypes.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/file_util.h"
+#include "base/scoped_temp_dir.h"
+#include "base/string_printf.h"
+
+#include <gtest/gtest.h>
+
+namespace amqp {
+
+namespace {
+
+class PublishSpoolTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(dir_.CreateUniqueTempDir());
+    path_ = dir_.path().AppendASCII("spool");
+  }
+
+  std::unique_ptr<PublishSpool> Open(
+      const PublishSpool::Options& options = PublishSpool::Options()) {
+    std::unique_ptr<PublishSpool> spool;
+    base::Status status = PublishSpool::Open(path_, options, &spool);
+    EXPECT_TRUE(status.ok()) << status.ToString();
+    return spool;
+  }
+
+  static void AppendRange(PublishSpool* spool, int first, int last) {
+    for (int i = first; i <= last; ++i) {
+      ASSERT_TRUE(spool->Append(Frames(i), nullptr).ok());
+    }
+  }
+
+  static std::string Frames(uint64_t i) {
+    return base::StringPrintf("frames %" PRIu64, i);
+  }
+
+  // Replays everything and checks the frames belong to their sequence.
+  static std::vector<uint64_t> ReplayAll(PublishSpool* spool) {
+    std::vector<uint64_t> sequences;
+    base::Status status = spool->Replay(
+        [&sequences](uint64_t sequence, const base::StringPiece& frames) {
+          EXPECT_EQ(Frames(sequence), frames.as_string());
+          sequences.push_back(sequence);
+          return true;
+        });
+    EXPECT_TRUE(status.ok()) << status.ToString();
+    return sequences;
+  }
+
+  static std::vector<uint64_t> Range(uint64_t first, uint64_t last) {
+    std::vector<uint64_t> range;
+    for (uint64_t i = first; i <= last; ++i) range.push_back(i);
+    return range;
+  }
+
+  base::ScopedTempDir dir_;
+  base::FilePath path_;
+};
+
+TEST_F(PublishSpoolTest, AppendReplayRelease) {
+  std::unique_ptr<PublishSpool> spool = Open();
+  ASSERT_TRUE(spool);
+  EXPECT_TRUE(spool->empty());
+  uint64_t sequence = 0;
+  ASSERT_TRUE(spool->Append(Frames(1), &sequence).ok());
+  EXPECT_EQ(1u, sequence);
+  AppendRange(spool.get(), 2, 5);
+  EXPECT_EQ(5u, spool->pending());
+
+  EXPECT_EQ(Range(1, 5), ReplayAll(spool.get()));
+  // Nothing new to offer.
+  EXPECT_TRUE(ReplayAll(spool.get()).empty());
+
+  ASSERT_TRUE(spool->Release(3).ok());
+  EXPECT_EQ(2u, spool->pending());
+  spool->Rewind();
+  EXPECT_EQ(Range(4, 5), ReplayAll(spool.get()));
+
+  ASSERT_TRUE(spool->Release(100).ok());
+  EXPECT_TRUE(spool->empty());
+  EXPECT_EQ(6u, spool->next_sequence());
+}
+
+TEST_F(PublishSpoolTest, ReplayStopsWhenAsked) {
+  std::unique_ptr<PublishSpool> spool = Open();
+  ASSERT_TRUE(spool);
+  AppendRange(spool.get(), 1, 4);
+  std::vector<uint64_t> seen;
+  ASSERT_TRUE(spool->Replay(
+      [&seen](uint64_t sequence, const base::StringPiece& frames) {
+        if (sequence == 3) return false;
+        seen.push_back(sequence);
+        return true;
+      }).ok());
+  EXPECT_EQ(Range(1, 2), seen);
+  EXPECT_EQ(Range(3, 4), ReplayAll(spool.get()));
+}
+
+TEST_F(PublishSpoolTest, ReopenResumesAfterRelease) {
+  {
+    std::unique_ptr<PublishSpool> spool = Open();
+    ASSERT_TRUE(spool);
+    AppendRange(spool.get(), 1, 20);
+    EXPECT_EQ(Range(1, 20), ReplayAll(spool.get()));
+    ASSERT_TRUE(spool->Release(12).ok());
+    ASSERT_TRUE(spool->Sync().ok());
+  }
+  std::unique_ptr<PublishSpool> spool = Open();
+  ASSERT_TRUE(spool);
+  EXPECT_EQ(8u, spool->pending());
+  EXPECT_EQ(21u, spool->next_sequence());
+  // Released records are not sent again, even in a surviving segment.
+  EXPECT_EQ(Range(13, 20), ReplayAll(spool.get()));
+}
+
+TEST_F(PublishSpoolTest, ReopenAfterEverythingReleased) {
+  {
+    std::unique_ptr<PublishSpool> spool = Open();
+    ASSERT_TRUE(spool);
+    AppendRange(spool.get(), 1, 5);
+    ASSERT_TRUE(spool->Release(5).ok());
+  }
+  std::unique_ptr<PublishSpool> spool = Open();
+  ASSERT_TRUE(spool);
+  EXPECT_TRUE(spool->empty());
+  EXPECT_EQ(6u, spool->next_sequence());
+  AppendRange(spool.get(), 6, 7);
+  EXPECT_EQ(Range(6, 7), ReplayAll(spool.get()));
+}
+
+TEST_F(PublishSpoolTest, DeletesReleasedSegments) {
+  PublishSpool::Options options;
+  options.segment_bytes = 64;
+  std::unique_ptr<PublishSpool> spool = Open(options);
+  ASSERT_TRUE(spool);
+  AppendRange(spool.get(), 1, 10);
+  size_t segments = spool->segments();
+  EXPECT_GT(segments, 2u);
+  ASSERT_TRUE(spool->Release(6).ok());
+  EXPECT_LT(spool->segments(), segments);
+  EXPECT_EQ(Range(7, 10), ReplayAll(spool.get()));
+  spool.reset();
+
+  spool = Open(options);
+  ASSERT_TRUE(spool);
+  EXPECT_EQ(Range(7, 10), ReplayAll(spool.get()));
+}
+
+TEST_F(PublishSpoolTest, TruncatesTornTail) {
+  {
+    std::unique_ptr<PublishSpool> spool = Open();
+    ASSERT_TRUE(spool);
+    AppendRange(spool.get(), 1, 3);
+    ASSERT_TRUE(spool->Sync().ok());
+  }
+  // A record cut short by a crash.
+  base::FilePath segment = path_.AppendASCII("0000000000000001.spool");
+  ASSERT_TRUE(base::PathExists(segment));
+  ASSERT_TRUE(base::AppendToFile(segment, "\x20\0\0\0torn", 8));
+
+  std::unique_ptr<PublishSpool> spool = Open();
+  ASSERT_TRUE(spool);
+  EXPECT_EQ(Range(1, 3), ReplayAll(spool.get()));
+  AppendRange(spool.get(), 4, 4);
+  EXPECT_EQ(Range(4, 4), ReplayAll(spool.get()));
+}
+
+} // namespace
+
+} // namespace amqp
@@ -0,0 +1,170 @@
+#include "amqp/publish_template.h"
+
+#include <algorithm>
+
+#include "amqp/boolean_set.h"
+#include "amqp/protocol.h"
+#include "amqp/string_field.h"
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+namespace {
+
+// Properties after timestamp on the wire.
+const uint16_t kTrailingProperties = 0x003c;
+
+// Property flags strictly above / below |flag| in wire order.
+uint16_t Above(uint16_t flag) { return 0xffff & ~((flag << 1) - 1); }
+uint16_t Below(uint16_t flag) { return flag - 1; }
+
+} // namespace
+
+const uint32_t PublishTemplate::kDefaultFrameMax;
+
+PublishTemplate::PublishTemplate(uint16_t channel,
+                                 const std::string& exchange,
+                                 const MetaData& properties,
+                                 uint16_t per_message,
+                                 bool mandatory,
+                                 uint32_t frame_max)
+  : channel_(channel),
+    exchange_(exchange),
+    source_(properties),
+    mandatory_(mandatory),
+    frame_max_(frame_max),
+    id_flag_(per_message & (MetaData::kMessageId | MetaData::kCorrelationId)),
+    per_message_timestamp_((per_message & MetaData::kTimestamp) != 0) {
+  DCHECK_LE(exchange.size(), ShortString::MaxLength());
+  DCHECK_GT(frame_max_, kFrameOverhead);
+  DCHECK(!(per_message & MetaData::kMessageId) ||
+         !(per_message & MetaData::kCorrelationId))
+      << "only one per-message id property";
+  source_.Detach();
+
+  uint16_t fixed = properties.flags() & ~id_flag_;
+  if (per_message_timestamp_) fixed &= ~MetaData::kTimestamp;
+  property_flags_ = fixed | id_flag_ |
+                    (per_message_timestamp_ ? MetaData::kTimestamp : 0);
+  // The per-message id goes between properties_ and middle_.
+  uint16_t split =
+      id_flag_ ? id_flag_ : static_cast<uint16_t>(MetaData::kMessageId);
+
+  OutBuffer scratch(256 + exchange.size() + properties.size());
+
+  scratch.Add(kFrameMethod);
+  scratch.Add(channel_);
+  method_start_ = Append(scratch);
+
+  scratch.Add(static_cast<uint16_t>(kClassBasic));
+  scratch.Add(static_cast<uint16_t>(kBasicPublish));
+  scratch.Add(static_cast<uint16_t>(0));  // reserved-1 (ticket)
+  ShortString(exchange).Fill(scratch);
+  method_args_ = Append(scratch);
+
+  BooleanSet(mandatory, false).Fill(scratch);
+  scratch.Add(kFrameEnd);
+  scratch.Add(kFrameHeader);
+  scratch.Add(channel_);
+  header_start_ = Append(scratch);
+
+  scratch.Add(static_cast<uint16_t>(kClassBasic));
+  scratch.Add(static_cast<uint16_t>(0));  // weight
+  header_class_ = Append(scratch);
+
+  scratch.Add(property_flags_);
+  properties.FillOnly(fixed & (Above(split) | split), scratch, false);
+  properties_ = Append(scratch);
+
+  properties.FillOnly(fixed & Below(split) & Above(MetaData::kTimestamp),
+                      scratch, false);
+  middle_ = Append(scratch);
+
+  properties.FillOnly(fixed & (MetaData::kTimestamp | kTrailingProperties),
+                      scratch, false);
+  scratch.Add(kFrameEnd);
+  trailer_ = Append(scratch);
+}
+
+PublishTemplate PublishTemplate::WithContentEncoding(
+    const std::string& encoding) const {
+  MetaData properties(source_);
+  properties.set_content_encoding(encoding);
+  uint16_t per_message =
+      id_flag_ | (per_message_timestamp_ ? MetaData::kTimestamp : 0);
+  return PublishTemplate(channel_, exchange_, properties, per_message,
+                         mandatory_, frame_max_);
+}
+
+PublishTemplate::Piece PublishTemplate::Append(const OutBuffer& buffer) {
+  Piece piece;
+  piece.offset = encoded_.size();
+  piece.length = buffer.size() - encoded_.size();
+  encoded_.append(buffer.data() + encoded_.size(), piece.length);
+  return piece;
+}
+
+size_t PublishTemplate::size(const base::StringPiece& routing_key,
+                             const base::StringPiece& id,
+                             uint64_t body_size) const {
+  size_t size = encoded_.size() + 4 + 1 + routing_key.size() + 4 + 8;
+  if (id_flag_) size += 1 + id.size();
+  if (per_message_timestamp_) size += 8;
+
+  uint64_t chunk = frame_max_ - kFrameOverhead;
+  uint64_t frames = (body_size + chunk - 1) / chunk;
+  return size + frames * kFrameOverhead + body_size;
+}
+
+void PublishTemplate::Fill(OutBuffer& buffer,
+                           const base::StringPiece& routing_key,
+                           const char* body,
+                           uint64_t body_size,
+                           const base::StringPiece& id,
+                           uint64_t timestamp) const {
+  DCHECK_LE(routing_key.size(), ShortString::MaxLength());
+  DCHECK_LE(id.size(), ShortString::MaxLength());
+  DCHECK_LE(size(routing_key, id, body_size), buffer.available());
+
+  // Method frame: args + routing key + bits.
+  Copy(method_start_, buffer);
+  buffer.Add(static_cast<uint32_t>(method_args_.length + 1 +
+                                   routing_key.size() + 1));
+  Copy(method_args_, buffer);
+  buffer.Add(static_cast<uint8_t>(routing_key.size()));
+  buffer.Add(routing_key.data(), routing_key.size());
+
+  // Header frame: class + weight + body size + properties.
+  uint32_t header_size = header_class_.length + 8 + properties_.length +
+                         middle_.length + trailer_.length - 1;
+  if (id_flag_) header_size += 1 + id.size();
+  if (per_message_timestamp_) header_size += 8;
+
+  Copy(header_start_, buffer);
+  buffer.Add(header_size);
+  Copy(header_class_, buffer);
+  buffer.Add(body_size);
+  Copy(properties_, buffer);
+  if (id_flag_) {
+    buffer.Add(static_cast<uint8_t>(id.size()));
+    buffer.Add(id.data(), id.size());
+  }
+  Copy(middle_, buffer);
+  if (per_message_timestamp_) buffer.Add(timestamp);
+  Copy(trailer_, buffer);
+
+  // Body frames.
+  uint64_t chunk = frame_max_ - kFrameOverhead;
+  for (uint64_t offset = 0; offset < body_size; offset += chunk) {
+    uint32_t length = static_cast<uint32_t>(
+        std::min(chunk, body_size - offset));
+    buffer.Add(kFrameBody);
+    buffer.Add(channel_);
+    buffer.Add(length);
+    buffer.Add(body + offset, length);
+    buffer.Add(kFrameEnd);
+  }
+}
+
+} // namespace amqp
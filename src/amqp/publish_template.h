@@ -0,0 +1,96 @@
+#ifndef AMQP_PUBLISH_TEMPLATE_H_
+#define AMQP_PUBLISH_TEMPLATE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "amqp/meta_data.h"
+#include "amqp/out_buffer.h"
+#include "base/string_piece.h"
+
+namespace amqp {
+
+// Pre-encoded Basic.Publish + content header for messages that share their
+// exchange and properties.
+//
+// The constructor encodes everything that does not change between messages:
+// both frame headers, the publish arguments, the property flags and the
+// fixed properties (content-type, delivery-mode, app-id, headers, ...).
+// Fill() then only copies those bytes and writes the per-message values in
+// between: routing key, body size, and, when enabled, an id (message-id or
+// correlation-id) and the timestamp. No property is re-encoded and nothing
+// is allocated.
+class PublishTemplate {
+ public:
+  static const uint32_t kDefaultFrameMax = 128 * 1024;
+
+  // |per_message| selects which of MetaData::kTimestamp and one of
+  // kMessageId or kCorrelationId are given to each Fill(); values for them
+  // in |properties| are then ignored.
+  PublishTemplate(uint16_t channel,
+                  const std::string& exchange,
+                  const MetaData& properties,
+                  uint16_t per_message = MetaData::kMessageId |
+                                         MetaData::kTimestamp,
+                  bool mandatory = false,
+                  uint32_t frame_max = kDefaultFrameMax);
+  ~PublishTemplate() {}
+
+  // This template with content-encoding set to |encoding|, for the bodies a
+  // CompressionStage compressed. Build it once per codec, next to the plain
+  // template, and pick one per message.
+  PublishTemplate WithContentEncoding(const std::string& encoding) const;
+
+  // Bytes Fill() will write for this message.
+  size_t size(const base::StringPiece& routing_key,
+              const base::StringPiece& id,
+              uint64_t body_size) const;
+
+  // Writes the method, header and body frames of one message.
+  void Fill(OutBuffer& buffer,
+            const base::StringPiece& routing_key,
+            const char* body,
+            uint64_t body_size,
+            const base::StringPiece& id = base::StringPiece(),
+            uint64_t timestamp = 0) const;
+
+  uint16_t channel() const { return channel_; }
+  uint16_t property_flags() const { return property_flags_; }
+
+ private:
+  // A run of pre-encoded bytes inside encoded_.
+  struct Piece {
+    Piece() : offset(0), length(0) {}
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  Piece Append(const OutBuffer& buffer);
+  void Copy(const Piece& piece, OutBuffer& buffer) const {
+    buffer.Add(encoded_.data() + piece.offset, piece.length);
+  }
+
+  uint16_t channel_;
+  // What the template was built from, for WithContentEncoding().
+  std::string exchange_;
+  MetaData source_;
+  bool mandatory_;
+  uint32_t frame_max_;
+  uint16_t property_flags_;
+  // The per-message id property, if any.
+  uint16_t id_flag_;
+  bool per_message_timestamp_;
+
+  std::string encoded_;
+  Piece method_start_;   // type, channel | size
+  Piece method_args_;    // class, method, reserved, exchange | routing key
+  Piece header_start_;   // bits, end; type, channel | size
+  Piece header_class_;   // class, weight | body size
+  Piece properties_;     // flags, properties up to the id
+  Piece middle_;         // properties between the id and timestamp
+  Piece trailer_;        // properties after timestamp, end
+};
+
+} // namespace amqp
+#endif // AMQP_PUBLISH_TEMPLATE_H_
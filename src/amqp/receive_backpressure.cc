@@ -0,0 +1,91 @@
+#include "amqp/receive_backpressure.h"
+
+#include "amqp/method_frames.h"
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+ReceiveBackpressure::ReceiveBackpressure(const Options& options,
+                                         Delegate* delegate)
+  : options_(options),
+    delegate_(delegate),
+    messages_(0),
+    bytes_(0),
+    paused_(false) {
+  DCHECK(delegate_);
+  DCHECK_LE(options_.low_messages, options_.high_messages);
+  DCHECK_LE(options_.low_bytes, options_.high_bytes);
+}
+
+ReceiveBackpressure::~ReceiveBackpressure() {}
+
+void ReceiveBackpressure::AddChannel(uint16_t channel, uint16_t prefetch) {
+  std::lock_guard<std::mutex> lock(transition_lock_);
+  channels_[channel] = prefetch;
+}
+
+void ReceiveBackpressure::RemoveChannel(uint16_t channel) {
+  std::lock_guard<std::mutex> lock(transition_lock_);
+  channels_.erase(channel);
+}
+
+void ReceiveBackpressure::OnBuffered(size_t bytes) {
+  size_t messages = messages_.fetch_add(1) + 1;
+  size_t total = bytes_.fetch_add(bytes) + bytes;
+  if (paused_.load()) return;
+  if (messages >= options_.high_messages || total >= options_.high_bytes) {
+    Transition();
+  }
+}
+
+void ReceiveBackpressure::OnReleased(size_t bytes) {
+  size_t messages = messages_.fetch_sub(1) - 1;
+  size_t total = bytes_.fetch_sub(bytes) - bytes;
+  if (!paused_.load()) return;
+  if (messages <= options_.low_messages && total <= options_.low_bytes) {
+    Transition();
+  }
+}
+
+void ReceiveBackpressure::Transition() {
+  std::lock_guard<std::mutex> lock(transition_lock_);
+  // Loop until the state matches the counters: a release that raced with a
+  // pause saw paused() == false and left the resume to us. Everything here
+  // is seq_cst so that one of the two sides is guaranteed to notice.
+  for (;;) {
+    bool paused = paused_.load();
+    size_t messages = messages_.load();
+    size_t total = bytes_.load();
+    bool pause;
+    if (paused) {
+      pause = messages > options_.low_messages || total > options_.low_bytes;
+    } else {
+      pause = messages >= options_.high_messages ||
+              total >= options_.high_bytes;
+    }
+    if (pause == paused) return;
+
+    paused_.store(pause);
+    delegate_->SetReading(!pause);
+    SignalBroker(pause);
+  }
+}
+
+void ReceiveBackpressure::SignalBroker(bool pause) {
+  if (options_.signal == SIGNAL_NONE || channels_.empty()) return;
+
+  // Sized for Basic.Qos, the larger of the two frames.
+  OutBuffer frames(channels_.size() * BasicQosFrame(0, 0).size());
+  for (const auto& channel : channels_) {
+    if (options_.signal == SIGNAL_CHANNEL_FLOW) {
+      ChannelFlowFrame(channel.first, !pause).Fill(frames);
+    } else {
+      uint16_t prefetch = pause ? options_.paused_prefetch : channel.second;
+      BasicQosFrame(channel.first, prefetch).Fill(frames);
+    }
+  }
+  delegate_->SendFrames(frames);
+}
+
+} // namespace amqp
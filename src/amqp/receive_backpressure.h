@@ -0,0 +1,102 @@
+#ifndef AMQP_RECEIVE_BACKPRESSURE_H_
+#define AMQP_RECEIVE_BACKPRESSURE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+
+#include "amqp/out_buffer.h"
+#include "base/macros.h"
+
+namespace amqp {
+
+// Stops reading a connection's socket while its consumers are behind.
+//
+// The connection reports every delivery it buffers (OnBuffered) and every
+// one that leaves memory, i.e. is acked or otherwise released (OnReleased).
+// Once the undelivered/unacked messages or bytes cross a high watermark, the
+// delegate is told to stop reading; the kernel socket buffer then fills up
+// and TCP flow control pushes back on the broker. Reading resumes once both
+// drop below their low watermark.
+//
+// Optionally the broker is told as well, with Channel.Flow(active=false) or
+// by lowering Basic.Qos on every registered channel; both are undone on
+// resume.
+//
+// OnBuffered/OnReleased may be called from any thread; the delegate is
+// called on the thread that caused the crossing.
+class ReceiveBackpressure {
+ public:
+  enum BrokerSignal {
+    SIGNAL_NONE,
+    SIGNAL_CHANNEL_FLOW,
+    SIGNAL_LOWER_QOS,
+  };
+
+  class Delegate {
+   public:
+    virtual ~Delegate() {}
+    // Required. Typically posts an EventLoop::Modify() to the I/O thread.
+    virtual void SetReading(bool reading) = 0;
+    // Only used with a BrokerSignal; gets the encoded method frames.
+    virtual void SendFrames(const OutBuffer& /* frames */) {}
+  };
+
+  struct Options {
+    Options()
+      : high_messages(10000),
+        low_messages(5000),
+        high_bytes(64 << 20),
+        low_bytes(32 << 20),
+        signal(SIGNAL_NONE),
+        paused_prefetch(1) {}
+
+    size_t high_messages;
+    size_t low_messages;
+    size_t high_bytes;
+    size_t low_bytes;
+    BrokerSignal signal;
+    // Prefetch count applied while paused with SIGNAL_LOWER_QOS.
+    uint16_t paused_prefetch;
+  };
+
+  ReceiveBackpressure(const Options& options, Delegate* delegate);
+  ~ReceiveBackpressure();
+
+  // Channels the broker signal applies to, with the prefetch to restore.
+  void AddChannel(uint16_t channel, uint16_t prefetch);
+  void RemoveChannel(uint16_t channel);
+
+  void OnBuffered(size_t bytes);
+  void OnReleased(size_t bytes);
+
+  bool paused() const { return paused_.load(std::memory_order_acquire); }
+  size_t buffered_messages() const {
+    return messages_.load(std::memory_order_relaxed);
+  }
+  size_t buffered_bytes() const {
+    return bytes_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  void Transition();
+  void SignalBroker(bool pause);
+
+  const Options options_;
+  Delegate* delegate_;
+
+  std::atomic<size_t> messages_;
+  std::atomic<size_t> bytes_;
+  std::atomic<bool> paused_;
+
+  // Serialises transitions so pause and resume reach the delegate in order.
+  std::mutex transition_lock_;
+  std::map<uint16_t, uint16_t> channels_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReceiveBackpressure);
+};
+
+} // namespace amqp
+#endif // AMQP_RECEIVE_BACKPRESSURE_H_
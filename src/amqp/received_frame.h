@@ -3,12 +3,16 @@
 
 #include <cstdint>
 
+#include "amqp/in_buffer.h"
+
 namespace amqp {
 
 class Buffer;
 class ConnectionImpl;
 
-class ReceivedFrame {
+// A frame off the wire. Reads through the InBuffer interface start at the
+// payload; the constructor positions the cursor past the frame header.
+class ReceivedFrame : public InBuffer {
  public:
   ReceivedFrame(const Buffer& buffer, uint32_t max);
   virtual ~ReceivedFrame() {}
@@ -20,18 +24,6 @@ class ReceivedFrame {
   uint64_t total_size() const { return payload_size_ + 8; }
   uint32_t payload_size() const { return payload_size_; }
 
-  uint8_t NextUInt8();
-  int8_t NextInt8();
-  uint16_t NextUInt16();
-  int16_t NextInt16();
-  uint32_t NextUInt32();
-  int32_t NextInt32();
-  uint64_t NextUInt64();
-  int64_t NextInt64();
-  float NextFloat();
-  double NextDouble();
-  const char* NextData(uint32_t size);
-  
   bool Process(ConnectionImpl* connection);
   
  private:
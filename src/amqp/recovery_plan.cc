@@ -0,0 +1,235 @@
+#include "amqp/recovery_plan.h"
+
+#include <algorithm>
+
+#include "amqp/out_buffer.h"
+
+namespace amqp {
+
+RecoveryPlan::RecoveryPlan() {}
+
+RecoveryPlan::~RecoveryPlan() {}
+
+void RecoveryPlan::RecordChannel(uint16_t channel) {
+  channels_[channel];
+}
+
+void RecoveryPlan::RecordQos(uint16_t channel, uint16_t prefetch_count,
+                             bool global) {
+  ChannelState& state = channels_[channel];
+  state.prefetch_count = prefetch_count;
+  state.global_qos = global;
+}
+
+void RecoveryPlan::RecordConfirm(uint16_t channel, ConfirmTracker* tracker) {
+  channels_[channel].tracker = tracker;
+}
+
+void RecoveryPlan::ForgetChannel(uint16_t channel) {
+  channels_.erase(channel);
+  for (auto it = consumers_.begin(); it != consumers_.end();) {
+    if (it->second.channel == channel) {
+      it = consumers_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void RecoveryPlan::RecordExchange(const std::string& name,
+                                  const std::string& type,
+                                  uint32_t flags,
+                                  const Table& arguments) {
+  // Passive declares and the default exchange create nothing.
+  if (name.empty() || (flags & kPassive)) return;
+  Exchange& exchange = exchanges_[name];
+  exchange.type = type;
+  exchange.flags = flags & ~kNoWait;
+  exchange.arguments = arguments;
+}
+
+void RecoveryPlan::ForgetExchange(const std::string& name) {
+  exchanges_.erase(name);
+  bindings_.erase(
+      std::remove_if(bindings_.begin(), bindings_.end(),
+                     [&name](const Binding& b) { return b.exchange == name; }),
+      bindings_.end());
+}
+
+void RecoveryPlan::RecordQueue(const std::string& name,
+                               uint32_t flags,
+                               const Table& arguments,
+                               bool server_named) {
+  if (name.empty() || (flags & kPassive)) return;
+  Queue& queue = queues_[name];
+  queue.flags = flags & ~kNoWait;
+  queue.arguments = arguments;
+  queue.server_named = server_named;
+}
+
+void RecoveryPlan::ForgetQueue(const std::string& name) {
+  queues_.erase(name);
+  bindings_.erase(
+      std::remove_if(bindings_.begin(), bindings_.end(),
+                     [&name](const Binding& b) { return b.queue == name; }),
+      bindings_.end());
+  for (auto it = consumers_.begin(); it != consumers_.end();) {
+    if (it->second.queue == name) {
+      it = consumers_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void RecoveryPlan::RecordBinding(const std::string& queue,
+                                 const std::string& exchange,
+                                 const std::string& routing_key,
+                                 const Table& arguments) {
+  ForgetBinding(queue, exchange, routing_key);
+  Binding binding;
+  binding.queue = queue;
+  binding.exchange = exchange;
+  binding.routing_key = routing_key;
+  binding.arguments = arguments;
+  bindings_.push_back(std::move(binding));
+}
+
+void RecoveryPlan::ForgetBinding(const std::string& queue,
+                                 const std::string& exchange,
+                                 const std::string& routing_key) {
+  bindings_.erase(
+      std::remove_if(bindings_.begin(), bindings_.end(),
+                     [&](const Binding& b) {
+                       return b.queue == queue && b.exchange == exchange &&
+                              b.routing_key == routing_key;
+                     }),
+      bindings_.end());
+}
+
+void RecoveryPlan::RecordConsumer(uint16_t channel,
+                                  const std::string& queue,
+                                  const std::string& consumer_tag,
+                                  uint32_t flags,
+                                  const Table& arguments) {
+  Consumer& consumer = consumers_[consumer_tag];
+  consumer.channel = channel;
+  consumer.queue = queue;
+  consumer.flags = flags & ~kNoWait;
+  consumer.arguments = arguments;
+}
+
+void RecoveryPlan::ForgetConsumer(const std::string& consumer_tag) {
+  consumers_.erase(consumer_tag);
+}
+
+bool RecoveryPlan::IsServerNamed(const std::string& queue) const {
+  auto it = queues_.find(queue);
+  return it != queues_.end() && it->second.server_named;
+}
+
+// static
+void RecoveryPlan::Append(const MethodFrame& frame, bool reply,
+                          Batch* batch) {
+  OutBuffer buffer(frame.size());
+  frame.Fill(buffer);
+  batch->data.append(buffer.data(), buffer.size());
+  // Every method recovered here answers with the method id that follows.
+  if (reply) {
+    batch->replies.push_back(
+        Reply(frame.channel(), frame.class_id(), frame.method_id() + 1));
+  }
+}
+
+void RecoveryPlan::AppendBindingsAndConsumers(bool server_named,
+                                              Batch* batch) const {
+  uint16_t topology_channel = channels_.begin()->first;
+  for (const Binding& b : bindings_) {
+    if (IsServerNamed(b.queue) != server_named) continue;
+    Append(QueueBindFrame(topology_channel, b.queue, b.exchange,
+                          b.routing_key, 0, b.arguments),
+           true, batch);
+  }
+  for (const auto& entry : consumers_) {
+    const Consumer& c = entry.second;
+    if (IsServerNamed(c.queue) != server_named) continue;
+    Append(BasicConsumeFrame(c.channel, c.queue, entry.first, c.flags,
+                             c.arguments),
+           true, batch);
+  }
+}
+
+void RecoveryPlan::AppendRepublish(Batch* batch) {
+  for (auto& entry : channels_) {
+    ConfirmTracker* tracker = entry.second.tracker;
+    if (tracker == nullptr) continue;
+    tracker->Rebase([batch](const std::string& frames) {
+      batch->data.append(frames);
+    });
+  }
+}
+
+RecoveryPlan::Batch RecoveryPlan::Begin() {
+  Batch batch;
+  server_named_.clear();
+  if (channels_.empty()) return batch;
+
+  for (const auto& entry : channels_) {
+    uint16_t channel = entry.first;
+    const ChannelState& state = entry.second;
+    Append(ChannelOpenFrame(channel), true, &batch);
+    if (state.prefetch_count != 0) {
+      Append(BasicQosFrame(channel, state.prefetch_count, state.global_qos),
+             true, &batch);
+    }
+    if (state.tracker != nullptr) {
+      Append(ConfirmSelectFrame(channel), true, &batch);
+    }
+  }
+
+  uint16_t topology_channel = channels_.begin()->first;
+  for (const auto& entry : exchanges_) {
+    const Exchange& e = entry.second;
+    Append(ExchangeDeclareFrame(topology_channel, entry.first, e.type,
+                                e.flags, e.arguments),
+           true, &batch);
+  }
+  for (const auto& entry : queues_) {
+    const Queue& q = entry.second;
+    if (q.server_named) server_named_.push_back(entry.first);
+    Append(QueueDeclareFrame(topology_channel,
+                             q.server_named ? std::string() : entry.first,
+                             q.flags, q.arguments),
+           true, &batch);
+  }
+  AppendBindingsAndConsumers(false, &batch);
+  if (server_named_.empty()) AppendRepublish(&batch);
+  return batch;
+}
+
+void RecoveryPlan::RenameQueue(const std::string& old_name,
+                               const std::string& new_name) {
+  auto it = queues_.find(old_name);
+  if (it == queues_.end() || old_name == new_name) return;
+  Queue queue = std::move(it->second);
+  queues_.erase(it);
+  queues_[new_name] = std::move(queue);
+  for (Binding& b : bindings_) {
+    if (b.queue == old_name) b.queue = new_name;
+  }
+  for (auto& entry : consumers_) {
+    if (entry.second.queue == old_name) entry.second.queue = new_name;
+  }
+  std::replace(server_named_.begin(), server_named_.end(), old_name,
+               new_name);
+}
+
+RecoveryPlan::Batch RecoveryPlan::Finish() {
+  Batch batch;
+  if (server_named_.empty()) return batch;
+  AppendBindingsAndConsumers(true, &batch);
+  AppendRepublish(&batch);
+  return batch;
+}
+
+} // namespace amqp
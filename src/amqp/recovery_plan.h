@@ -0,0 +1,145 @@
+#ifndef AMQP_RECOVERY_PLAN_H_
+#define AMQP_RECOVERY_PLAN_H_
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "amqp/confirm_tracker.h"
+#include "amqp/method_frames.h"
+#include "amqp/table.h"
+#include "base/macros.h"
+
+namespace amqp {
+
+// Records what a connection has set up so it can be restored after the
+// socket fails, and encodes the restore as pipelined batches.
+//
+// Serial recovery costs a round trip per declaration. None of them need the
+// previous reply, so the plan writes them back to back: every channel is
+// reopened with its Basic.Qos and Confirm.Select, the topology is declared
+// on the lowest channel, consumers are re-issued on their own channels, and
+// unconfirmed publishes are sent again from each channel's ConfirmTracker.
+// Only a server-named queue forces a second batch, because its bindings and
+// consumers need the name the broker hands out on redeclaration.
+//
+//   Batch first = plan.Begin();
+//   Send(first.data);  // then match first.replies as they come in
+//   for each Queue.Declare-Ok of a server-named queue, in order:
+//     plan.RenameQueue(plan.server_named_queues()[i], declare_ok.name);
+//   Send(plan.Finish().data);
+//
+// Reconnect attempts themselves are paced with base::Backoff.
+//
+// Not thread-safe.
+class RecoveryPlan {
+ public:
+  // A -Ok the broker will send for one of the batched methods.
+  struct Reply {
+    Reply(uint16_t c, uint16_t cls, uint16_t m)
+      : channel(c), class_id(cls), method_id(m) {}
+    uint16_t channel;
+    uint16_t class_id;
+    uint16_t method_id;
+  };
+
+  struct Batch {
+    std::string data;
+    std::vector<Reply> replies;
+  };
+
+  RecoveryPlan();
+  ~RecoveryPlan();
+
+  void RecordChannel(uint16_t channel);
+  void RecordQos(uint16_t channel, uint16_t prefetch_count, bool global);
+  // |tracker| is not owned and must outlive the plan's use of the channel.
+  void RecordConfirm(uint16_t channel, ConfirmTracker* tracker);
+  // Also forgets the channel's consumers.
+  void ForgetChannel(uint16_t channel);
+
+  void RecordExchange(const std::string& name, const std::string& type,
+                      uint32_t flags, const Table& arguments);
+  // Also forgets the bindings on |name|.
+  void ForgetExchange(const std::string& name);
+
+  // |server_named| queues were declared with an empty name; |name| is the
+  // one the broker assigned.
+  void RecordQueue(const std::string& name, uint32_t flags,
+                   const Table& arguments, bool server_named = false);
+  // Also forgets the queue's bindings and consumers.
+  void ForgetQueue(const std::string& name);
+
+  void RecordBinding(const std::string& queue, const std::string& exchange,
+                     const std::string& routing_key, const Table& arguments);
+  void ForgetBinding(const std::string& queue, const std::string& exchange,
+                     const std::string& routing_key);
+
+  void RecordConsumer(uint16_t channel, const std::string& queue,
+                      const std::string& consumer_tag, uint32_t flags,
+                      const Table& arguments);
+  void ForgetConsumer(const std::string& consumer_tag);
+
+  // Everything that does not depend on a server-named queue.
+  Batch Begin();
+  // Server-named queues, in the order Begin() redeclared them.
+  const std::vector<std::string>& server_named_queues() const {
+    return server_named_;
+  }
+  void RenameQueue(const std::string& old_name, const std::string& new_name);
+  // The bindings and consumers of server-named queues, then the republished
+  // messages. Empty apart from the republish when there are none.
+  Batch Finish();
+
+ private:
+  struct ChannelState {
+    ChannelState() : prefetch_count(0), global_qos(false), tracker(nullptr) {}
+    uint16_t prefetch_count;
+    bool global_qos;
+    ConfirmTracker* tracker;
+  };
+
+  struct Exchange {
+    std::string type;
+    uint32_t flags;
+    Table arguments;
+  };
+
+  struct Queue {
+    uint32_t flags;
+    Table arguments;
+    bool server_named;
+  };
+
+  struct Binding {
+    std::string queue;
+    std::string exchange;
+    std::string routing_key;
+    Table arguments;
+  };
+
+  struct Consumer {
+    uint16_t channel;
+    std::string queue;
+    uint32_t flags;
+    Table arguments;
+  };
+
+  bool IsServerNamed(const std::string& queue) const;
+  static void Append(const MethodFrame& frame, bool reply, Batch* batch);
+  void AppendBindingsAndConsumers(bool server_named, Batch* batch) const;
+  void AppendRepublish(Batch* batch);
+
+  std::map<uint16_t, ChannelState> channels_;
+  std::map<std::string, Exchange> exchanges_;
+  std::map<std::string, Queue> queues_;
+  std::vector<Binding> bindings_;
+  std::map<std::string, Consumer> consumers_;
+  std::vector<std::string> server_named_;
+
+  DISALLOW_COPY_AND_ASSIGN(RecoveryPlan);
+};
+
+} // namespace amqp
+#endif // AMQP_RECOVERY_PLAN_H_
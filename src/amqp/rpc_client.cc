@@ -0,0 +1,176 @@
+#include "amqp/rpc_client.h"
+
+#include <algorithm>
+
+#include "amqp/method_frames.h"
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+namespace {
+
+// URL-safe base64 digits, least significant first: ids stay short.
+const char kDigits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+int DigitValue(char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '-') return 62;
+  if (c == '_') return 63;
+  return -1;
+}
+
+MetaData WithReplyTo(MetaData properties) {
+  properties.set_reply_to(RpcClient::kReplyTo);
+  return properties;
+}
+
+} // namespace
+
+const char RpcClient::kReplyTo[] = "amq.rabbitmq.reply-to";
+
+RpcClient::RpcClient(uint16_t channel,
+                     const Options& options,
+                     Delegate* delegate,
+                     base::TimerWheel* timers)
+  : channel_(channel),
+    options_(options),
+    delegate_(delegate),
+    timers_(timers),
+    publish_(channel, options.exchange, WithReplyTo(options.properties),
+             MetaData::kCorrelationId, false, options.frame_max),
+    pending_(0) {
+  DCHECK(delegate_);
+  DCHECK(timers_);
+}
+
+RpcClient::~RpcClient() {
+  for (Slot& slot : slots_) {
+    if (slot.busy) timers_->Cancel(slot.timer);
+  }
+}
+
+// static
+std::string RpcClient::EncodeCorrelationId(uint32_t index,
+                                           uint32_t generation) {
+  uint64_t value = (static_cast<uint64_t>(generation) << 32) | index;
+  std::string id;
+  do {
+    id.push_back(kDigits[value & 63]);
+    value >>= 6;
+  } while (value != 0);
+  return id;
+}
+
+// static
+bool RpcClient::DecodeCorrelationId(const base::StringPiece& id,
+                                    uint32_t* index,
+                                    uint32_t* generation) {
+  // 64 bits fit in 11 digits.
+  if (id.empty() || id.size() > 11) return false;
+  uint64_t value = 0;
+  for (size_t i = id.size(); i-- > 0;) {
+    int digit = DigitValue(id[i]);
+    if (digit < 0) return false;
+    value = (value << 6) | static_cast<uint64_t>(digit);
+  }
+  *index = static_cast<uint32_t>(value);
+  *generation = static_cast<uint32_t>(value >> 32);
+  return true;
+}
+
+void RpcClient::Start() {
+  BasicConsumeFrame consume(channel_, kReplyTo, options_.consumer_tag,
+                            kNoAck, Table());
+  OutBuffer* buffer = Buffer(consume.size());
+  consume.Fill(*buffer);
+  delegate_->SendFrames(*buffer);
+}
+
+bool RpcClient::Call(const base::StringPiece& routing_key,
+                     const base::StringPiece& body,
+                     base::TimeTicks now,
+                     const ResponseCallback& callback,
+                     base::TimeDelta timeout) {
+  uint32_t index;
+  if (!free_.empty()) {
+    index = free_.back();
+    free_.pop_back();
+  } else {
+    if (slots_.size() >= options_.max_pending) return false;
+    index = static_cast<uint32_t>(slots_.size());
+    slots_.push_back(Slot());
+  }
+
+  Slot& slot = slots_[index];
+  slot.busy = true;
+  slot.callback = callback;
+  uint32_t generation = slot.generation;
+  if (timeout == base::TimeDelta()) timeout = options_.timeout;
+  slot.timer = timers_->Schedule(now + timeout, [this, index, generation]() {
+    Expire(index, generation);
+  });
+  ++pending_;
+
+  std::string id = EncodeCorrelationId(index, generation);
+  OutBuffer* buffer = Buffer(publish_.size(routing_key, id, body.size()));
+  publish_.Fill(*buffer, routing_key, body.data(), body.size(), id);
+  delegate_->SendFrames(*buffer);
+  return true;
+}
+
+bool RpcClient::OnReply(const MetaData& properties,
+                        const char* body,
+                        size_t size) {
+  uint32_t index, generation;
+  if (!properties.Has(MetaData::kCorrelationId) ||
+      !DecodeCorrelationId(properties.correlation_id(), &index,
+                           &generation)) {
+    return false;
+  }
+  if (index >= slots_.size() || !slots_[index].busy ||
+      slots_[index].generation != generation) {
+    return false;
+  }
+  timers_->Cancel(slots_[index].timer);
+  Release(index).Run(OK, base::StringPiece(body, size));
+  return true;
+}
+
+void RpcClient::Expire(uint32_t index, uint32_t generation) {
+  if (!slots_[index].busy || slots_[index].generation != generation) return;
+  Release(index).Run(TIMED_OUT, base::StringPiece());
+}
+
+void RpcClient::FailAll() {
+  for (uint32_t index = 0; index < slots_.size(); ++index) {
+    if (!slots_[index].busy) continue;
+    timers_->Cancel(slots_[index].timer);
+    Release(index).Run(FAILED, base::StringPiece());
+  }
+}
+
+RpcClient::ResponseCallback RpcClient::Release(uint32_t index) {
+  Slot& slot = slots_[index];
+  ResponseCallback callback = slot.callback;
+  slot.callback.Reset();
+  slot.busy = false;
+  slot.timer = 0;
+  ++slot.generation;
+  free_.push_back(index);
+  --pending_;
+  return callback;
+}
+
+OutBuffer* RpcClient::Buffer(size_t size) {
+  if (!buffer_ || buffer_->capacity() < size) {
+    buffer_.reset(new OutBuffer(std::max<size_t>(size, 4096)));
+  }
+  buffer_->Clear();
+  return buffer_.get();
+}
+
+} // namespace amqp
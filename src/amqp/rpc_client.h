@@ -0,0 +1,134 @@
+#ifndef AMQP_RPC_CLIENT_H_
+#define AMQP_RPC_CLIENT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "amqp/meta_data.h"
+#include "amqp/out_buffer.h"
+#include "amqp/publish_template.h"
+#include "base/callback.h"
+#include "base/macros.h"
+#include "base/string_piece.h"
+#include "base/time.h"
+#include "base/timer_wheel.h"
+
+namespace amqp {
+
+// Request/response over one channel using RabbitMQ's direct reply-to.
+//
+// Start() consumes from the amq.rabbitmq.reply-to pseudo queue in no-ack
+// mode; each Call() publishes with reply-to set to it and a correlation-id
+// naming a slot in the pending table. The id packs the slot index with the
+// slot's generation, so a reply resolves with an array index and a late
+// reply for a reused slot is recognised and dropped. Deadlines live in the
+// event loop's TimerWheel.
+//
+// Everything runs on the channel's I/O thread; there is no lock. Post Call()
+// there from other threads. The server must copy the correlation-id of the
+// request into its reply.
+class RpcClient {
+ public:
+  enum Status {
+    OK,
+    TIMED_OUT,
+    // The channel went away (FailAll()). A full table is reported by
+    // Call() returning false instead.
+    FAILED,
+  };
+
+  // |body| is only valid during the call.
+  typedef base::Callback<void(Status status, const base::StringPiece& body)>
+      ResponseCallback;
+
+  static const char kReplyTo[];
+
+  class Delegate {
+   public:
+    virtual ~Delegate() {}
+    virtual void SendFrames(const OutBuffer& frames) = 0;
+  };
+
+  struct Options {
+    Options()
+      : timeout(base::TimeDelta::FromSeconds(5)),
+        max_pending(1 << 16),
+        consumer_tag("rpc-client"),
+        frame_max(PublishTemplate::kDefaultFrameMax) {}
+
+    std::string exchange;
+    // Sent with every request; reply-to and correlation-id are set per call.
+    MetaData properties;
+    base::TimeDelta timeout;
+    size_t max_pending;
+    std::string consumer_tag;
+    uint32_t frame_max;
+  };
+
+  // |delegate| and |timers| must outlive the client.
+  RpcClient(uint16_t channel, const Options& options, Delegate* delegate,
+            base::TimerWheel* timers);
+  ~RpcClient();
+
+  // Sends the Basic.Consume for the reply pseudo queue; must precede Call().
+  void Start();
+
+  // Returns false, without calling |callback|, if too many calls are
+  // pending. A zero |timeout| uses the default.
+  bool Call(const base::StringPiece& routing_key,
+            const base::StringPiece& body,
+            base::TimeTicks now,
+            const ResponseCallback& callback,
+            base::TimeDelta timeout = base::TimeDelta());
+
+  // A delivery to the reply consumer. Returns false if it answers no
+  // pending call (unknown, timed out or malformed correlation-id).
+  bool OnReply(const MetaData& properties, const char* body, size_t size);
+
+  // Fails every pending call, e.g. when the channel closes.
+  void FailAll();
+
+  size_t pending() const { return pending_; }
+  const std::string& consumer_tag() const { return options_.consumer_tag; }
+
+  // Exposed for tests: slot <-> correlation-id.
+  static std::string EncodeCorrelationId(uint32_t index, uint32_t generation);
+  static bool DecodeCorrelationId(const base::StringPiece& id,
+                                  uint32_t* index,
+                                  uint32_t* generation);
+
+ private:
+  struct Slot {
+    Slot() : generation(0), timer(0), busy(false) {}
+    uint32_t generation;
+    ResponseCallback callback;
+    base::TimerWheel::TimerId timer;
+    bool busy;
+  };
+
+  void Expire(uint32_t index, uint32_t generation);
+  // Frees the slot and hands back its callback.
+  ResponseCallback Release(uint32_t index);
+  OutBuffer* Buffer(size_t size);
+
+  const uint16_t channel_;
+  Options options_;
+  Delegate* delegate_;
+  base::TimerWheel* timers_;
+  PublishTemplate publish_;
+
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_;
+  size_t pending_;
+
+  // Reused across calls; regrown for bigger requests.
+  std::unique_ptr<OutBuffer> buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(RpcClient);
+};
+
+} // namespace amqp
+#endif // AMQP_RPC_CLIENT_H_
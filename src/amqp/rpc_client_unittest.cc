@@ -0,0 +1,184 @@
+#include "amqp/rpc_client.h"
+
+#include <string.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "amqp/in_buffer.h"
+#include "amqp/protocol.h"
+#include "base/bind.h"
+#include "base/bind_helpers.h"
+#include "base/byteorder.h"
+
+#include <gtest/gtest.h>
+
+namespace amqp {
+
+namespace {
+
+base::TimeTicks At(int64_t ms) {
+  return base::TimeTicks::FromInternalValue(1000000) +
+         base::TimeDelta::FromMilliseconds(ms);
+}
+
+// Keeps the correlation-id of every request published.
+class RecordingDelegate : public RpcClient::Delegate {
+ public:
+  void SendFrames(const OutBuffer& frames) override {
+    const char* p = frames.data();
+    const char* end = p + frames.size();
+    while (p < end) {
+      uint32_t size;
+      memcpy(&size, p + 3, 4);
+      size = base::NetToHost32(size);
+      if (static_cast<uint8_t>(p[0]) == kFrameHeader) {
+        // class, weight, body size
+        InBuffer in(p + kFrameHeaderSize + 12, size - 12);
+        MetaData properties(in);
+        EXPECT_EQ(RpcClient::kReplyTo, properties.reply_to());
+        ids.push_back(properties.correlation_id());
+      }
+      p += kFrameOverhead + size;
+    }
+  }
+
+  std::vector<std::string> ids;
+};
+
+struct Response {
+  int call;
+  RpcClient::Status status;
+  std::string body;
+};
+
+class RpcClientTest : public testing::Test {
+ protected:
+  RpcClientTest()
+    : timers_(base::TimeDelta::FromMilliseconds(10), 64, At(0)) {
+    options_.timeout = base::TimeDelta::FromMilliseconds(100);
+  }
+
+  void SetUp() override {
+    client_.reset(new RpcClient(1, options_, &delegate_, &timers_));
+    client_->Start();
+  }
+
+  RpcClient::ResponseCallback Record(int call) {
+    return base::Bind(&RpcClientTest::OnResponse, base::Unretained(this),
+                      call);
+  }
+
+  void OnResponse(int call, RpcClient::Status status,
+                  const base::StringPiece& body) {
+    responses_.push_back(Response{call, status, body.as_string()});
+  }
+
+  bool Reply(const std::string& id, const std::string& body) {
+    MetaData properties;
+    properties.set_correlation_id(id);
+    return client_->OnReply(properties, body.data(), body.size());
+  }
+
+  RpcClient::Options options_;
+  RecordingDelegate delegate_;
+  base::TimerWheel timers_;
+  std::unique_ptr<RpcClient> client_;
+  std::vector<Response> responses_;
+};
+
+TEST(RpcClientIdTest, CorrelationIdsRoundTrip) {
+  const uint32_t values[] = {0, 1, 63, 64, 4095, 65536, 0x7fffffff,
+                             0xffffffff};
+  for (uint32_t index : values) {
+    for (uint32_t generation : values) {
+      std::string id = RpcClient::EncodeCorrelationId(index, generation);
+      EXPECT_LE(id.size(), 11u);
+      uint32_t decoded_index = 1, decoded_generation = 1;
+      ASSERT_TRUE(RpcClient::DecodeCorrelationId(id, &decoded_index,
+                                                 &decoded_generation));
+      EXPECT_EQ(index, decoded_index) << id;
+      EXPECT_EQ(generation, decoded_generation) << id;
+    }
+  }
+  EXPECT_EQ("A", RpcClient::EncodeCorrelationId(0, 0));
+}
+
+TEST(RpcClientIdTest, RejectsForeignIds) {
+  uint32_t index, generation;
+  EXPECT_FALSE(RpcClient::DecodeCorrelationId("", &index, &generation));
+  EXPECT_FALSE(RpcClient::DecodeCorrelationId("ab+c", &index,
+                                              &generation));
+  EXPECT_FALSE(RpcClient::DecodeCorrelationId(
+      "550e8400-e29b-41d4-a716-446655440000", &index, &generation));
+}
+
+TEST_F(RpcClientTest, RepliesResolveTheirCall) {
+  ASSERT_TRUE(client_->Call("svc", "one", At(0), Record(1)));
+  ASSERT_TRUE(client_->Call("svc", "two", At(0), Record(2)));
+  ASSERT_EQ(2u, delegate_.ids.size());
+  EXPECT_EQ(2u, client_->pending());
+
+  EXPECT_TRUE(Reply(delegate_.ids[1], "second"));
+  EXPECT_FALSE(Reply(delegate_.ids[1], "again"));
+  EXPECT_FALSE(Reply("nonsense!", ""));
+  EXPECT_TRUE(Reply(delegate_.ids[0], "first"));
+  ASSERT_EQ(2u, responses_.size());
+  EXPECT_EQ(2, responses_[0].call);
+  EXPECT_EQ(RpcClient::OK, responses_[0].status);
+  EXPECT_EQ("second", responses_[0].body);
+  EXPECT_EQ(1, responses_[1].call);
+  EXPECT_EQ("first", responses_[1].body);
+  EXPECT_EQ(0u, client_->pending());
+  // Answered calls leave no timers behind.
+  EXPECT_TRUE(timers_.empty());
+}
+
+TEST_F(RpcClientTest, TimesOutThroughTheWheel) {
+  ASSERT_TRUE(client_->Call("svc", "slow", At(0), Record(1)));
+  ASSERT_TRUE(client_->Call("svc", "quick", At(0), Record(2),
+                            base::TimeDelta::FromMilliseconds(20)));
+  EXPECT_EQ(2u, timers_.size());
+
+  timers_.Advance(At(19));
+  EXPECT_TRUE(responses_.empty());
+  timers_.Advance(At(20));
+  ASSERT_EQ(1u, responses_.size());
+  EXPECT_EQ(2, responses_[0].call);
+  EXPECT_EQ(RpcClient::TIMED_OUT, responses_[0].status);
+  // A late reply is dropped, even once the slot is reused.
+  EXPECT_FALSE(Reply(delegate_.ids[1], "late"));
+  ASSERT_TRUE(client_->Call("svc", "next", At(20), Record(3)));
+  EXPECT_NE(delegate_.ids[1], delegate_.ids[2]);
+  EXPECT_FALSE(Reply(delegate_.ids[1], "late"));
+
+  timers_.Advance(At(100));
+  ASSERT_EQ(2u, responses_.size());
+  EXPECT_EQ(1, responses_[1].call);
+  EXPECT_EQ(RpcClient::TIMED_OUT, responses_[1].status);
+  EXPECT_TRUE(Reply(delegate_.ids[2], "done"));
+  EXPECT_EQ(RpcClient::OK, responses_[2].status);
+  EXPECT_TRUE(timers_.empty());
+}
+
+TEST_F(RpcClientTest, FullTableAndFailAll) {
+  options_.max_pending = 2;
+  SetUp();
+  ASSERT_TRUE(client_->Call("svc", "a", At(0), Record(1)));
+  ASSERT_TRUE(client_->Call("svc", "b", At(0), Record(2)));
+  EXPECT_FALSE(client_->Call("svc", "c", At(0), Record(3)));
+  EXPECT_EQ(2u, delegate_.ids.size());
+
+  client_->FailAll();
+  ASSERT_EQ(2u, responses_.size());
+  EXPECT_EQ(RpcClient::FAILED, responses_[0].status);
+  EXPECT_EQ(RpcClient::FAILED, responses_[1].status);
+  EXPECT_EQ(0u, client_->pending());
+  EXPECT_TRUE(timers_.empty());
+  EXPECT_EQ(0u, timers_.Advance(At(1000)));
+  EXPECT_EQ(2u, responses_.size());
+}
+
+} // namespace
+
+} // namespace amqp
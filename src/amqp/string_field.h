@@ -3,7 +3,7 @@
 
 #include "amqp/field.h"
 #include "amqp/numeric_field.h"
-#include "amqp/received_frame.h"
+#include "amqp/in_buffer.h"
 #include "amqp/out_buffer.h"
 
 namespace amqp {
@@ -19,9 +19,10 @@ class StringField : public Field {
   StringField(const std::string& value) : data_(value) {}
   StringField(std::string&& value) : data_(std::move(value)) {}  
 
-  StringField(ReceivedFrame& frame) {
+  StringField(InBuffer& frame) {
     T size(frame);
-    data_ = std::string(frame.NextData(size.value()), (size_t)size.value());
+    const char* data = frame.NextData(size.value());
+    if (data) data_.assign(data, (size_t)size.value());
   }
 
   virtual ~StringField() {}
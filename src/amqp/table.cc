@@ -0,0 +1,81 @@
+#include "amqp/table.h"
+
+#include "amqp/string_field.h"
+
+namespace amqp {
+
+Table::Table(InBuffer& frame) {
+  uint32_t remaining = frame.NextUInt32();
+  while (remaining > 0) {
+    ShortString name(frame);
+    // name + type octet
+    uint32_t consumed = name.size() + 1;
+    if (consumed > remaining) break;
+
+    std::unique_ptr<Field> field(Field::Decode(frame));
+    if (!field) break;
+
+    consumed += field->size();
+    if (consumed > remaining) break;
+    remaining -= consumed;
+
+    fields_[name.value()] = std::shared_ptr<Field>(field.release());
+  }
+}
+
+Table::Table(const Table& other) {
+  for (const auto& entry : other.fields_) {
+    fields_[entry.first] = entry.second->Clone();
+  }
+}
+
+Table& Table::operator=(const Table& other) {
+  if (this == &other) return *this;
+  fields_.clear();
+  for (const auto& entry : other.fields_) {
+    fields_[entry.first] = entry.second->Clone();
+  }
+  return *this;
+}
+
+Table& Table::operator=(Table&& other) {
+  if (this != &other) fields_ = std::move(other.fields_);
+  return *this;
+}
+
+const Field& Table::Get(const std::string& name) const {
+  static const Field* empty = new ShortString;
+  auto it = fields_.find(name);
+  return it == fields_.end() ? *empty : *it->second;
+}
+
+size_t Table::size() const {
+  size_t size = 4;
+  for (const auto& entry : fields_) {
+    size += ShortString(entry.first).size();
+    size += 1;
+    size += entry.second->size();
+  }
+  return size;
+}
+
+void Table::Fill(OutBuffer& buffer) const {
+  buffer.Add(static_cast<uint32_t>(size() - 4));
+  for (const auto& entry : fields_) {
+    ShortString(entry.first).Fill(buffer);
+    buffer.Add(static_cast<uint8_t>(entry.second->TypeId()));
+    entry.second->Fill(buffer);
+  }
+}
+
+void Table::Output(std::ostream& os) const {
+  os << "table(";
+  bool first = true;
+  for (const auto& entry : fields_) {
+    os << (first ? "" : ",") << entry.first << ":" << *entry.second;
+    first = false;
+  }
+  os << ")";
+}
+
+} // namespace amqp
@@ -0,0 +1,87 @@
+#ifndef AMQP_TABLE_H_
+#define AMQP_TABLE_H_
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "amqp/field.h"
+#include "amqp/field_proxy.h"
+#include "amqp/out_buffer.h"
+#include "amqp/in_buffer.h"
+
+namespace amqp {
+
+// AMQP field table: name -> typed field, encoded as a long size followed by
+// (short-string name, type octet, value) entries.
+class Table : public Field {
+ public:
+  typedef std::map<std::string, std::shared_ptr<Field>> Fields;
+  typedef Fields::const_iterator const_iterator;
+
+  Table() {}
+  Table(InBuffer& frame);
+  Table(const Table& other);
+  Table(Table&& other) : fields_(std::move(other.fields_)) {}
+
+  virtual ~Table() {}
+
+  Table& operator=(const Table& other);
+  Table& operator=(Table&& other);
+
+  virtual std::shared_ptr<Field> Clone() const override {
+    return std::make_shared<Table>(*this);
+  }
+
+  Table& Set(const std::string& name, const Field& value) {
+    fields_[name] = value.Clone();
+    return *this;
+  }
+
+  // Returns an empty string field when |name| is not set.
+  const Field& Get(const std::string& name) const;
+
+  bool Contains(const std::string& name) const {
+    return fields_.find(name) != fields_.end();
+  }
+
+  void Erase(const std::string& name) { fields_.erase(name); }
+
+  FieldProxy<Table, std::string> operator[](const std::string& name) {
+    return FieldProxy<Table, std::string>(this, name);
+  }
+
+  const Field& operator[](const std::string& name) const {
+    return Get(name);
+  }
+
+  // Without these, table["name"] is ambiguous with the built-in subscript
+  // through Field's integer conversions.
+  FieldProxy<Table, std::string> operator[](const char* name) {
+    return FieldProxy<Table, std::string>(this, name);
+  }
+
+  const Field& operator[](const char* name) const {
+    return Get(name);
+  }
+
+  const_iterator begin() const { return fields_.begin(); }
+  const_iterator end() const { return fields_.end(); }
+  size_t count() const { return fields_.size(); }
+  bool empty() const { return fields_.empty(); }
+
+  virtual size_t size() const override;
+  virtual void Fill(OutBuffer& buffer) const override;
+
+  virtual char TypeId() const override { return 'F'; }
+  virtual bool IsTable() const override { return true; }
+
+  virtual void Output(std::ostream& os) const override;
+
+ private:
+  Fields fields_;
+};
+
+} // namespace amqp
+#endif // AMQP_TABLE_H_
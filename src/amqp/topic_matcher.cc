@@ -0,0 +1,189 @@
+#include "amqp/topic_matcher.h"
+
+#include <algorithm>
+
+namespace amqp {
+
+namespace {
+
+// Calls |visit| with each dot-separated word of |key|; empty words count.
+template <typename Visitor>
+void ForEachWord(const base::StringPiece& key, Visitor visit) {
+  size_t begin = 0;
+  while (true) {
+    size_t end = key.find('.', begin);
+    if (end == base::StringPiece::npos) end = key.size();
+    if (!visit(base::StringPiece(key.data() + begin, end - begin))) return;
+    if (end == key.size()) return;
+    begin = end + 1;
+  }
+}
+
+void SortUnique(std::vector<uint32_t>* v) {
+  std::sort(v->begin(), v->end());
+  v->erase(std::unique(v->begin(), v->end()), v->end());
+}
+
+} // namespace
+
+TopicMatcher::TopicMatcher() : nodes_(1), pattern_count_(0) {}
+
+TopicMatcher::~TopicMatcher() {}
+
+TopicMatcher::NodeId TopicMatcher::NewNode() {
+  if (!free_.empty()) {
+    NodeId id = free_.back();
+    free_.pop_back();
+    return id;
+  }
+  nodes_.push_back(Node());
+  return static_cast<NodeId>(nodes_.size() - 1);
+}
+
+void TopicMatcher::Add(const base::StringPiece& pattern,
+                       Subscriber subscriber) {
+  NodeId node = 0;
+  ++nodes_[node].refs;
+  ForEachWord(pattern, [this, &node](const base::StringPiece& word) {
+    NodeId child;
+    if (word == "*") {
+      child = nodes_[node].star;
+      if (child == 0) {
+        child = NewNode();
+        nodes_[node].star = child;
+      }
+    } else if (word == "#") {
+      child = nodes_[node].hash;
+      if (child == 0) {
+        child = NewNode();
+        nodes_[child].is_hash = true;
+        nodes_[node].hash = child;
+      }
+    } else {
+      // Not a reference: NewNode() may reallocate nodes_.
+      auto it = nodes_[node].words.find(word.as_string());
+      if (it != nodes_[node].words.end()) {
+        child = it->second;
+      } else {
+        child = NewNode();
+        nodes_[node].words[word.as_string()] = child;
+      }
+    }
+    node = child;
+    ++nodes_[node].refs;
+    return true;
+  });
+  nodes_[node].subscribers.push_back(subscriber);
+  ++pattern_count_;
+}
+
+bool TopicMatcher::Remove(const base::StringPiece& pattern,
+                          Subscriber subscriber) {
+  // Find the path first; nothing changes unless the binding exists.
+  std::vector<NodeId> path(1, 0);
+  ForEachWord(pattern, [this, &path](const base::StringPiece& word) {
+    const Node& node = nodes_[path.back()];
+    NodeId child = 0;
+    if (word == "*") {
+      child = node.star;
+    } else if (word == "#") {
+      child = node.hash;
+    } else {
+      auto it = node.words.find(word.as_string());
+      if (it != node.words.end()) child = it->second;
+    }
+    if (child == 0) {
+      path.clear();
+      return false;
+    }
+    path.push_back(child);
+    return true;
+  });
+  if (path.empty()) return false;
+
+  std::vector<Subscriber>& subscribers = nodes_[path.back()].subscribers;
+  auto it = std::find(subscribers.begin(), subscribers.end(), subscriber);
+  if (it == subscribers.end()) return false;
+  *it = subscribers.back();
+  subscribers.pop_back();
+  --pattern_count_;
+
+  // Release the path, unlinking nodes no binding goes through any more.
+  for (size_t i = path.size(); i-- > 0;) {
+    NodeId id = path[i];
+    if (--nodes_[id].refs > 0 || id == 0) continue;
+    Node& parent = nodes_[path[i - 1]];
+    if (parent.star == id) {
+      parent.star = 0;
+    } else if (parent.hash == id) {
+      parent.hash = 0;
+    } else {
+      for (auto w = parent.words.begin(); w != parent.words.end(); ++w) {
+        if (w->second == id) {
+          parent.words.erase(w);
+          break;
+        }
+      }
+    }
+    nodes_[id] = Node();
+    free_.push_back(id);
+  }
+  return true;
+}
+
+void TopicMatcher::AddState(NodeId node, std::vector<NodeId>* states) const {
+  states->push_back(node);
+  NodeId hash = nodes_[node].hash;
+  if (hash != 0) AddState(hash, states);
+}
+
+void TopicMatcher::Walk(const base::StringPiece& routing_key,
+                        std::vector<NodeId>* states) const {
+  states->clear();
+  AddState(0, states);
+
+  std::vector<NodeId> next;
+  std::string scratch;
+  ForEachWord(routing_key,
+              [this, states, &next, &scratch](const base::StringPiece& word) {
+    next.clear();
+    word.CopyToString(&scratch);
+    for (NodeId id : *states) {
+      const Node& node = nodes_[id];
+      if (node.is_hash) AddState(id, &next);
+      if (node.star != 0) AddState(node.star, &next);
+      if (!node.words.empty()) {
+        auto it = node.words.find(scratch);
+        if (it != node.words.end()) AddState(it->second, &next);
+      }
+    }
+    SortUnique(&next);
+    states->swap(next);
+    return !states->empty();
+  });
+}
+
+void TopicMatcher::Match(const base::StringPiece& routing_key,
+                         std::vector<Subscriber>* subscribers) const {
+  subscribers->clear();
+  std::vector<NodeId> states;
+  Walk(routing_key, &states);
+  for (NodeId id : states) {
+    const std::vector<Subscriber>& here = nodes_[id].subscribers;
+    subscribers->insert(subscribers->end(), here.begin(), here.end());
+  }
+  std::sort(subscribers->begin(), subscribers->end());
+  subscribers->erase(std::unique(subscribers->begin(), subscribers->end()),
+                     subscribers->end());
+}
+
+bool TopicMatcher::Matches(const base::StringPiece& routing_key) const {
+  std::vector<NodeId> states;
+  Walk(routing_key, &states);
+  for (NodeId id : states) {
+    if (!nodes_[id].subscribers.empty()) return true;
+  }
+  return false;
+}
+
+} // namespace amqp
@@ -0,0 +1,83 @@
+#ifndef AMQP_TOPIC_MATCHER_H_
+#define AMQP_TOPIC_MATCHER_H_
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/string_piece.h"
+
+namespace amqp {
+
+// Matches a routing key against many AMQP topic patterns at once.
+//
+// Patterns are dot-separated words where "*" stands for exactly one word and
+// "#" for zero or more. They are compiled into a trie shared by common
+// prefixes; Match() walks the routing key once, carrying the set of live trie
+// nodes (a "#" node stays live while it absorbs words), so the cost depends
+// on the key and the branching of the trie, not on the number of patterns.
+//
+//   TopicMatcher matcher;
+//   matcher.Add("*.orders.#", kOrderHandler);
+//   matcher.Add("eu.#", kEuHandler);
+//   std::vector<TopicMatcher::Subscriber> hits;
+//   matcher.Match("eu.orders.created", &hits);  // both
+//
+// Match() is const and may run concurrently with other Match() calls;
+// Add() and Remove() need external synchronization against everything.
+class TopicMatcher {
+ public:
+  typedef uint64_t Subscriber;
+
+  TopicMatcher();
+  ~TopicMatcher();
+
+  // Binding the same (pattern, subscriber) twice counts twice; each Add()
+  // needs its own Remove().
+  void Add(const base::StringPiece& pattern, Subscriber subscriber);
+  // Returns false if the pair was not bound.
+  bool Remove(const base::StringPiece& pattern, Subscriber subscriber);
+
+  // Replaces |subscribers| with the distinct subscribers of every pattern
+  // matching |routing_key|, in ascending order.
+  void Match(const base::StringPiece& routing_key,
+             std::vector<Subscriber>* subscribers) const;
+  bool Matches(const base::StringPiece& routing_key) const;
+
+  size_t pattern_count() const { return pattern_count_; }
+  bool empty() const { return pattern_count_ == 0; }
+
+ private:
+  // Index into nodes_. The root is node 0 and never anyone's child, so 0
+  // doubles as "no child".
+  typedef uint32_t NodeId;
+
+  struct Node {
+    Node() : star(0), hash(0), is_hash(false), refs(0) {}
+    std::unordered_map<std::string, NodeId> words;
+    NodeId star;
+    NodeId hash;
+    bool is_hash;
+    // Bindings whose pattern passes through or ends here.
+    uint32_t refs;
+    std::vector<Subscriber> subscribers;
+  };
+
+  NodeId NewNode();
+  // Adds |node| and everything reachable from it by "#" matching no words.
+  void AddState(NodeId node, std::vector<NodeId>* states) const;
+  // Runs the key through the trie; |states| ends as the accepting set.
+  void Walk(const base::StringPiece& routing_key,
+            std::vector<NodeId>* states) const;
+
+  std::vector<Node> nodes_;
+  std::vector<NodeId> free_;
+  size_t pattern_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(TopicMatcher);
+};
+
+} // namespace amqp
+#endif // AMQP_TOPIC_MATCHER_H_
@@ -0,0 +1,158 @@
+#include "amqp/topic_matcher.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/string_split.h"
+
+#include <gtest/gtest.h>
+
+namespace amqp {
+
+namespace {
+
+typedef std::vector<TopicMatcher::Subscriber> Subscribers;
+
+Subscribers Match(const TopicMatcher& matcher, const std::string& key) {
+  Subscribers subscribers;
+  matcher.Match(key, &subscribers);
+  return subscribers;
+}
+
+std::vector<std::string> Words(const std::string& s) {
+  return base::SplitString(s, ".", base::KEEP_WHITESPACE,
+                           base::SPLIT_WANT_ALL);
+}
+
+// The textbook definition, one pattern at a time.
+bool NaiveMatch(const std::vector<std::string>& pattern, size_t p,
+                const std::vector<std::string>& key, size_t k) {
+  if (p == pattern.size()) return k == key.size();
+  if (pattern[p] == "#") {
+    return NaiveMatch(pattern, p + 1, key, k) ||
+           (k < key.size() && NaiveMatch(pattern, p, key, k + 1));
+  }
+  if (k == key.size()) return false;
+  if (pattern[p] != "*" && pattern[p] != key[k]) return false;
+  return NaiveMatch(pattern, p + 1, key, k + 1);
+}
+
+bool NaiveMatch(const std::string& pattern, const std::string& key) {
+  return NaiveMatch(Words(pattern), 0, Words(key), 0);
+}
+
+std::string Join(const std::vector<std::string>& words) {
+  std::string joined;
+  for (size_t i = 0; i < words.size(); ++i) {
+    if (i > 0) joined += '.';
+    joined += words[i];
+  }
+  return joined;
+}
+
+std::string RandomKey(std::mt19937* rng, bool pattern) {
+  static const char* const kWords[] = {"a", "b", "c", "*", "#"};
+  size_t choices = pattern ? 5 : 3;
+  size_t length = 1 + (*rng)() % 5;
+  std::vector<std::string> words;
+  for (size_t i = 0; i < length; ++i) {
+    words.push_back(kWords[(*rng)() % choices]);
+  }
+  return Join(words);
+}
+
+TEST(TopicMatcherTest, Wildcards) {
+  TopicMatcher matcher;
+  matcher.Add("*.orders.#", 1);
+  matcher.Add("eu.#", 2);
+  matcher.Add("eu.*", 3);
+  matcher.Add("#", 4);
+  EXPECT_EQ(4u, matcher.pattern_count());
+
+  EXPECT_EQ(Subscribers({1, 2, 4}), Match(matcher, "eu.orders.created"));
+  EXPECT_EQ(Subscribers({1, 2, 3, 4}), Match(matcher, "eu.orders"));
+  EXPECT_EQ(Subscribers({1, 4}), Match(matcher, "us.orders"));
+  EXPECT_EQ(Subscribers({4}), Match(matcher, "orders"));
+  EXPECT_TRUE(matcher.Matches("anything.at.all"));
+}
+
+TEST(TopicMatcherTest, HashMatchesZeroWords) {
+  TopicMatcher matcher;
+  matcher.Add("a.#", 1);
+  matcher.Add("#.b", 2);
+  matcher.Add("a.#.b", 3);
+  matcher.Add("a.#.#.b", 4);
+
+  EXPECT_EQ(Subscribers({1}), Match(matcher, "a"));
+  EXPECT_EQ(Subscribers({2}), Match(matcher, "b"));
+  EXPECT_EQ(Subscribers({1, 2, 3, 4}), Match(matcher, "a.b"));
+  EXPECT_EQ(Subscribers({1, 2, 3, 4}), Match(matcher, "a.x.y.b"));
+  EXPECT_EQ(Subscribers(), Match(matcher, "x"));
+  EXPECT_FALSE(matcher.Matches("b.a"));
+}
+
+TEST(TopicMatcherTest, SamePatternAddedTwice) {
+  TopicMatcher matcher;
+  matcher.Add("a.*.c", 1);
+  matcher.Add("a.*.c", 1);
+  matcher.Add("a.*.c", 2);
+  EXPECT_EQ(3u, matcher.pattern_count());
+  // Reported once however often it is bound.
+  EXPECT_EQ(Subscribers({1, 2}), Match(matcher, "a.b.c"));
+
+  EXPECT_TRUE(matcher.Remove("a.*.c", 1));
+  EXPECT_EQ(Subscribers({1, 2}), Match(matcher, "a.b.c"));
+  EXPECT_TRUE(matcher.Remove("a.*.c", 1));
+  EXPECT_EQ(Subscribers({2}), Match(matcher, "a.b.c"));
+  EXPECT_FALSE(matcher.Remove("a.*.c", 1));
+  EXPECT_FALSE(matcher.Remove("a.b.c", 2));
+  EXPECT_FALSE(matcher.Remove("a.*", 2));
+  EXPECT_TRUE(matcher.Remove("a.*.c", 2));
+  EXPECT_TRUE(matcher.empty());
+  EXPECT_FALSE(matcher.Matches("a.b.c"));
+
+  // The freed nodes are reused without stale links.
+  matcher.Add("a.#", 3);
+  EXPECT_EQ(Subscribers({3}), Match(matcher, "a.b.c"));
+  EXPECT_EQ(Subscribers({3}), Match(matcher, "a"));
+}
+
+TEST(TopicMatcherTest, AgreesWithNaiveMatcher) {
+  std::mt19937 rng(42);
+  TopicMatcher matcher;
+  std::vector<std::pair<std::string, TopicMatcher::Subscriber>> bound;
+  for (TopicMatcher::Subscriber s = 0; s < 200; ++s) {
+    std::string pattern = RandomKey(&rng, true);
+    matcher.Add(pattern, s % 50);
+    bound.push_back(std::make_pair(pattern, s % 50));
+  }
+
+  for (int round = 0; round < 2; ++round) {
+    for (int i = 0; i < 500; ++i) {
+      std::string key = RandomKey(&rng, false);
+      Subscribers expected;
+      for (const auto& binding : bound) {
+        if (NaiveMatch(binding.first, key)) expected.push_back(binding.second);
+      }
+      std::sort(expected.begin(), expected.end());
+      expected.erase(std::unique(expected.begin(), expected.end()),
+                     expected.end());
+      ASSERT_EQ(expected, Match(matcher, key)) << key;
+      ASSERT_EQ(!expected.empty(), matcher.Matches(key)) << key;
+    }
+    // Unbind half and check again.
+    std::shuffle(bound.begin(), bound.end(), rng);
+    for (size_t i = bound.size() / 2; i < bound.size(); ++i) {
+      ASSERT_TRUE(matcher.Remove(bound[i].first, bound[i].second));
+    }
+    bound.resize(bound.size() / 2);
+    EXPECT_EQ(bound.size(), matcher.pattern_count());
+  }
+}
+
+} // namespace
+
+} // namespace amqp
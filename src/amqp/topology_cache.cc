@@ -0,0 +1,222 @@
+#include "amqp/topology_cache.h"
+
+#include <vector>
+
+#include "amqp/out_buffer.h"
+#include "base/hash.h"
+
+namespace amqp {
+
+const uint32_t TopologyCache::kComparedFlags;
+
+namespace {
+
+// Exchanges every broker has and that cannot be deleted: the default
+// exchange and the amq.* ones.
+bool IsPredeclared(const base::StringPiece& exchange) {
+  return exchange.empty() || exchange.starts_with("amq.");
+}
+
+void AppendPart(const base::StringPiece& part, std::string* key) {
+  // Length-prefixed so no name can run into the next one.
+  uint32_t size = static_cast<uint32_t>(part.size());
+  key->append(reinterpret_cast<const char*>(&size), sizeof(size));
+  part.AppendToString(key);
+}
+
+} // namespace
+
+TopologyCache::TopologyCache() : generation_(0) {}
+
+TopologyCache::~TopologyCache() {}
+
+// static
+uint64_t TopologyCache::HashArguments(const Table& arguments) {
+  if (arguments.empty()) return 0;
+  // Table keeps its fields sorted, so equal tables encode identically.
+  OutBuffer buffer(arguments.size());
+  arguments.Fill(buffer);
+  return base::HashBytes(buffer.data(), buffer.size());
+}
+
+// static
+std::string TopologyCache::ExchangeKey(const base::StringPiece& name) {
+  std::string key("e");
+  AppendPart(name, &key);
+  return key;
+}
+
+// static
+std::string TopologyCache::QueueKey(const base::StringPiece& name) {
+  std::string key("q");
+  AppendPart(name, &key);
+  return key;
+}
+
+// static
+std::string TopologyCache::BindingKey(const base::StringPiece& queue,
+                                      const base::StringPiece& exchange,
+                                      const base::StringPiece& routing_key,
+                                      uint64_t arguments_hash) {
+  std::string key("b");
+  AppendPart(queue, &key);
+  AppendPart(exchange, &key);
+  AppendPart(routing_key, &key);
+  key.append(reinterpret_cast<const char*>(&arguments_hash),
+             sizeof(arguments_hash));
+  return key;
+}
+
+uint64_t TopologyCache::generation() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return generation_;
+}
+
+void TopologyCache::Invalidate() {
+  std::lock_guard<std::mutex> lock(lock_);
+  ++generation_;
+  entries_.clear();
+}
+
+size_t TopologyCache::size() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return entries_.size();
+}
+
+bool TopologyCache::Matches(const std::string& key,
+                            const base::StringPiece& type,
+                            uint32_t flags,
+                            uint64_t arguments_hash) const {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = entries_.find(key);
+  return it != entries_.end() &&
+         it->second.flags == (flags & kComparedFlags) &&
+         type == it->second.type &&
+         it->second.arguments_hash == arguments_hash;
+}
+
+bool TopologyCache::HasExchange(const base::StringPiece& name,
+                                const base::StringPiece& type,
+                                uint32_t flags,
+                                const Table& arguments) const {
+  if (!Cacheable(name, flags)) return false;
+  return Matches(ExchangeKey(name), type, flags, HashArguments(arguments));
+}
+
+void TopologyCache::AddExchange(const base::StringPiece& name,
+                                const base::StringPiece& type,
+                                uint32_t flags,
+                                const Table& arguments,
+                                uint64_t generation) {
+  if (!Cacheable(name, flags)) {
+    // Whatever was cached under the name is no longer what the broker has.
+    if (!name.empty() && !(flags & kPassive)) RemoveExchange(name);
+    return;
+  }
+  Entry entry;
+  entry.flags = flags & kComparedFlags;
+  type.CopyToString(&entry.type);
+  entry.arguments_hash = HashArguments(arguments);
+  std::lock_guard<std::mutex> lock(lock_);
+  if (generation != generation_) return;
+  // A declare that reached the broker may have recreated the exchange.
+  RemoveBindingsLocked(base::StringPiece(), name);
+  entries_[ExchangeKey(name)] = std::move(entry);
+}
+
+void TopologyCache::RemoveExchange(const base::StringPiece& name) {
+  std::lock_guard<std::mutex> lock(lock_);
+  entries_.erase(ExchangeKey(name));
+  RemoveBindingsLocked(base::StringPiece(), name);
+}
+
+bool TopologyCache::HasQueue(const base::StringPiece& name,
+                             uint32_t flags,
+                             const Table& arguments) const {
+  if (!Cacheable(name, flags)) return false;
+  return Matches(QueueKey(name), base::StringPiece(), flags,
+                 HashArguments(arguments));
+}
+
+void TopologyCache::AddQueue(const base::StringPiece& name,
+                             uint32_t flags,
+                             const Table& arguments,
+                             uint64_t generation) {
+  if (!Cacheable(name, flags)) {
+    if (!name.empty() && !(flags & kPassive)) RemoveQueue(name);
+    return;
+  }
+  Entry entry;
+  entry.flags = flags & kComparedFlags;
+  entry.arguments_hash = HashArguments(arguments);
+  std::lock_guard<std::mutex> lock(lock_);
+  if (generation != generation_) return;
+  RemoveBindingsLocked(name, base::StringPiece());
+  entries_[QueueKey(name)] = std::move(entry);
+}
+
+void TopologyCache::RemoveQueue(const base::StringPiece& name) {
+  std::lock_guard<std::mutex> lock(lock_);
+  entries_.erase(QueueKey(name));
+  RemoveBindingsLocked(name, base::StringPiece());
+}
+
+bool TopologyCache::HasBinding(const base::StringPiece& queue,
+                               const base::StringPiece& exchange,
+                               const base::StringPiece& routing_key,
+                               const Table& arguments) const {
+  if (queue.empty()) return false;
+  uint64_t hash = HashArguments(arguments);
+  std::string key = BindingKey(queue, exchange, routing_key, hash);
+  std::lock_guard<std::mutex> lock(lock_);
+  return BindableLocked(queue, exchange) && entries_.count(key) != 0;
+}
+
+void TopologyCache::AddBinding(const base::StringPiece& queue,
+                               const base::StringPiece& exchange,
+                               const base::StringPiece& routing_key,
+                               const Table& arguments,
+                               uint64_t generation) {
+  if (queue.empty()) return;
+  Entry entry;
+  entry.arguments_hash = HashArguments(arguments);
+  queue.CopyToString(&entry.queue);
+  exchange.CopyToString(&entry.exchange);
+  std::string key =
+      BindingKey(queue, exchange, routing_key, entry.arguments_hash);
+  std::lock_guard<std::mutex> lock(lock_);
+  if (generation != generation_ || !BindableLocked(queue, exchange)) return;
+  entries_[std::move(key)] = std::move(entry);
+}
+
+void TopologyCache::RemoveBinding(const base::StringPiece& queue,
+                                  const base::StringPiece& exchange,
+                                  const base::StringPiece& routing_key,
+                                  const Table& arguments) {
+  std::string key =
+      BindingKey(queue, exchange, routing_key, HashArguments(arguments));
+  std::lock_guard<std::mutex> lock(lock_);
+  entries_.erase(key);
+}
+
+bool TopologyCache::BindableLocked(const base::StringPiece& queue,
+                                   const base::StringPiece& exchange) const {
+  if (entries_.count(QueueKey(queue)) == 0) return false;
+  return IsPredeclared(exchange) || entries_.count(ExchangeKey(exchange)) != 0;
+}
+
+void TopologyCache::RemoveBindingsLocked(const base::StringPiece& queue,
+                                         const base::StringPiece& exchange) {
+  // Deletes are rare next to declares; a scan keeps the entries simple.
+  std::vector<std::string> doomed;
+  for (const auto& entry : entries_) {
+    if (entry.first[0] != 'b') continue;
+    if ((!queue.empty() && queue == entry.second.queue) ||
+        (!exchange.empty() && exchange == entry.second.exchange)) {
+      doomed.push_back(entry.first);
+    }
+  }
+  for (const std::string& key : doomed) entries_.erase(key);
+}
+
+} // namespace amqp
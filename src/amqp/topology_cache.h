@@ -0,0 +1,143 @@
+#ifndef AMQP_TOPOLOGY_CACHE_H_
+#define AMQP_TOPOLOGY_CACHE_H_
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+
+#include "amqp/method_frames.h"
+#include "amqp/table.h"
+#include "base/flat_hash_map.h"
+#include "base/macros.h"
+#include "base/string_piece.h"
+
+namespace amqp {
+
+// Remembers which exchanges, queues and bindings a connection has already
+// declared, so an identical Exchange.Declare / Queue.Declare / Queue.Bind can
+// complete locally instead of costing a round trip.
+// ChannelPipeline::set_topology_cache() puts one in front of a channel.
+//
+// An entry is keyed on the name and must match on everything the broker
+// would compare: the declare flags, the exchange type and a hash of the
+// arguments table. A declaration that differs from a cached one is sent to
+// the broker as usual, which will then either accept it or close the
+// channel; either way the outcome reaches the cache.
+//
+// Invalidate() forgets everything; call it on reconnect and on any channel
+// error, since the error may mean something the cache holds is gone.
+// Declarations sent before an Invalidate() are dropped when their -Ok
+// arrives: pass the generation() read at send time to the Add*() calls.
+//
+// Auto-delete entities can disappear without this connection's involvement
+// and server-named queues are never redeclared by name, so neither is
+// cached. Passive declares are checks, not declarations, and are neither
+// answered from nor recorded in the cache.
+//
+// A binding is cached only while its queue and its exchange are: a binding
+// to an auto-delete queue would otherwise outlive the queue and a rebind
+// after the queue comes back would never reach the broker. The default and
+// amq.* exchanges always exist and need no entry. Recording a queue or
+// exchange again drops its bindings, since the declare that reached the
+// broker may have created it anew.
+//
+// A locally completed Queue.Declare has no fresh message and consumer counts.
+//
+// Thread-safe.
+class TopologyCache {
+ public:
+  // Flags are the MethodFlags given to the declare itself. Only these take
+  // part in the comparison; kNoWait and the like do not change what gets
+  // declared.
+  static const uint32_t kComparedFlags =
+      kDurable | kAutoDelete | kExclusive | kInternal;
+
+  TopologyCache();
+  ~TopologyCache();
+
+  uint64_t generation() const;
+  void Invalidate();
+
+  bool HasExchange(const base::StringPiece& name,
+                   const base::StringPiece& type,
+                   uint32_t flags,
+                   const Table& arguments) const;
+  void AddExchange(const base::StringPiece& name,
+                   const base::StringPiece& type,
+                   uint32_t flags,
+                   const Table& arguments,
+                   uint64_t generation);
+  // Also forgets the queue bindings to |name|.
+  void RemoveExchange(const base::StringPiece& name);
+
+  bool HasQueue(const base::StringPiece& name,
+                uint32_t flags,
+                const Table& arguments) const;
+  void AddQueue(const base::StringPiece& name,
+                uint32_t flags,
+                const Table& arguments,
+                uint64_t generation);
+  // Also forgets the bindings of |name|.
+  void RemoveQueue(const base::StringPiece& name);
+
+  bool HasBinding(const base::StringPiece& queue,
+                  const base::StringPiece& exchange,
+                  const base::StringPiece& routing_key,
+                  const Table& arguments) const;
+  void AddBinding(const base::StringPiece& queue,
+                  const base::StringPiece& exchange,
+                  const base::StringPiece& routing_key,
+                  const Table& arguments,
+                  uint64_t generation);
+  void RemoveBinding(const base::StringPiece& queue,
+                     const base::StringPiece& exchange,
+                     const base::StringPiece& routing_key,
+                     const Table& arguments);
+
+  size_t size() const;
+
+  static uint64_t HashArguments(const Table& arguments);
+
+ private:
+  struct Entry {
+    Entry() : flags(0), arguments_hash(0) {}
+    uint32_t flags;
+    std::string type;
+    uint64_t arguments_hash;
+    // Bindings only: the names they depend on.
+    std::string queue;
+    std::string exchange;
+  };
+
+  static bool Cacheable(const base::StringPiece& name, uint32_t flags) {
+    return !name.empty() && !(flags & (kAutoDelete | kPassive));
+  }
+
+  static std::string ExchangeKey(const base::StringPiece& name);
+  static std::string QueueKey(const base::StringPiece& name);
+  // Binding identity includes the arguments (headers exchange bindings
+  // differ only in them).
+  static std::string BindingKey(const base::StringPiece& queue,
+                                const base::StringPiece& exchange,
+                                const base::StringPiece& routing_key,
+                                uint64_t arguments_hash);
+
+  bool Matches(const std::string& key, const base::StringPiece& type,
+               uint32_t flags, uint64_t arguments_hash) const;
+  // Whether a binding of |queue| to |exchange| may be cached: both must be
+  // cached themselves, unless the exchange is predeclared.
+  bool BindableLocked(const base::StringPiece& queue,
+                      const base::StringPiece& exchange) const;
+  // Drops every binding naming |exchange| (as source) or |queue|.
+  void RemoveBindingsLocked(const base::StringPiece& queue,
+                            const base::StringPiece& exchange);
+
+  mutable std::mutex lock_;
+  uint64_t generation_;
+  base::FlatHashMap<std::string, Entry> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(TopologyCache);
+};
+
+} // namespace amqp
+#endif // AMQP_TOPOLOGY_CACHE_H_
@@ -0,0 +1,164 @@
+#include "amqp/topology_cache.h"
+
+#include <string>
+
+#include "amqp/channel_pipeline.h"
+#include "amqp/numeric_field.h"
+#include "amqp/protocol.h"
+#include "amqp/string_field.h"
+
+#include <gtest/gtest.h>
+
+namespace amqp {
+
+namespace {
+
+class CountingDelegate : public ChannelPipeline::Delegate {
+ public:
+  CountingDelegate() : sends(0) {}
+  void SendFrames(const OutBuffer& frames) override { ++sends; }
+  int sends;
+};
+
+Table Arguments(const std::string& name, int32_t value) {
+  Table table;
+  table.Set(name, Long(value));
+  return table;
+}
+
+bool AnswerOk(ChannelPipeline* pipeline, uint16_t class_id,
+              uint16_t method_id) {
+  InBuffer none("", 0);
+  return pipeline->OnMethod(class_id, method_id, none);
+}
+
+bool AnswerQueueOk(ChannelPipeline* pipeline, const std::string& name) {
+  OutBuffer buffer(64);
+  ShortString(name).Fill(buffer);
+  buffer.Add(static_cast<uint32_t>(0));
+  buffer.Add(static_cast<uint32_t>(0));
+  InBuffer arguments(buffer.data(), buffer.size());
+  return pipeline->OnMethod(kClassQueue, kQueueDeclareOk, arguments);
+}
+
+TEST(TopologyCacheTest, MatchesOnFlagsTypeAndArguments) {
+  TopologyCache cache;
+  Table arguments = Arguments("x-max-length", 10);
+  cache.AddExchange("ex", "topic", kDurable, arguments, cache.generation());
+  cache.AddQueue("jobs", kDurable, arguments, cache.generation());
+
+  EXPECT_TRUE(cache.HasExchange("ex", "topic", kDurable | kNoWait,
+                                arguments));
+  EXPECT_FALSE(cache.HasExchange("ex", "direct", kDurable, arguments));
+  EXPECT_FALSE(cache.HasExchange("ex", "topic", 0, arguments));
+  EXPECT_FALSE(cache.HasExchange("ex", "topic", kDurable,
+                                 Arguments("x-max-length", 11)));
+  EXPECT_TRUE(cache.HasQueue("jobs", kDurable, arguments));
+  EXPECT_FALSE(cache.HasQueue("jobs", kDurable | kExclusive, arguments));
+  // Passive declares are always sent.
+  EXPECT_FALSE(cache.HasQueue("jobs", kDurable | kPassive, arguments));
+}
+
+TEST(TopologyCacheTest, SkipsAutoDeleteAndServerNamed) {
+  TopologyCache cache;
+  cache.AddQueue("tmp", kAutoDelete, Table(), cache.generation());
+  cache.AddQueue("", 0, Table(), cache.generation());
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_FALSE(cache.HasQueue("tmp", kAutoDelete, Table()));
+}
+
+TEST(TopologyCacheTest, BindingNeedsCachedQueueAndExchange) {
+  TopologyCache cache;
+  uint64_t generation = cache.generation();
+  cache.AddQueue("tmp", kAutoDelete, Table(), generation);
+  cache.AddQueue("jobs", kDurable, Table(), generation);
+
+  // Auto-delete queue: not cached, so neither is its binding.
+  cache.AddBinding("tmp", "amq.topic", "k", Table(), generation);
+  EXPECT_FALSE(cache.HasBinding("tmp", "amq.topic", "k", Table()));
+
+  // Undeclared exchange.
+  cache.AddBinding("jobs", "ex", "k", Table(), generation);
+  EXPECT_FALSE(cache.HasBinding("jobs", "ex", "k", Table()));
+
+  // Predeclared exchanges need no entry.
+  cache.AddBinding("jobs", "amq.direct", "k", Table(), generation);
+  cache.AddBinding("jobs", "", "jobs", Table(), generation);
+  EXPECT_TRUE(cache.HasBinding("jobs", "amq.direct", "k", Table()));
+  EXPECT_TRUE(cache.HasBinding("jobs", "", "jobs", Table()));
+
+  cache.AddExchange("ex", "direct", kDurable, Table(), generation);
+  cache.AddBinding("jobs", "ex", "k", Table(), generation);
+  EXPECT_TRUE(cache.HasBinding("jobs", "ex", "k", Table()));
+  EXPECT_FALSE(cache.HasBinding("jobs", "ex", "k", Arguments("a", 1)));
+}
+
+TEST(TopologyCacheTest, RecordingAgainDropsBindings) {
+  TopologyCache cache;
+  uint64_t generation = cache.generation();
+  cache.AddExchange("ex", "direct", kDurable, Table(), generation);
+  cache.AddQueue("jobs", kDurable, Table(), generation);
+  cache.AddBinding("jobs", "ex", "k", Table(), generation);
+  ASSERT_TRUE(cache.HasBinding("jobs", "ex", "k", Table()));
+
+  cache.AddQueue("jobs", kDurable, Table(), generation);
+  EXPECT_TRUE(cache.HasQueue("jobs", kDurable, Table()));
+  EXPECT_FALSE(cache.HasBinding("jobs", "ex", "k", Table()));
+
+  cache.AddBinding("jobs", "ex", "k", Table(), generation);
+  cache.AddExchange("ex", "direct", kDurable, Table(), generation);
+  EXPECT_FALSE(cache.HasBinding("jobs", "ex", "k", Table()));
+
+  // Redeclared as auto-delete: the durable entry is stale.
+  cache.AddQueue("jobs", kAutoDelete, Table(), generation);
+  EXPECT_FALSE(cache.HasQueue("jobs", kDurable, Table()));
+}
+
+TEST(TopologyCacheTest, DropsDeclaresFromBeforeInvalidate) {
+  TopologyCache cache;
+  uint64_t generation = cache.generation();
+  cache.AddQueue("jobs", kDurable, Table(), generation);
+  cache.Invalidate();
+  EXPECT_EQ(0u, cache.size());
+  cache.AddQueue("jobs", kDurable, Table(), generation);
+  EXPECT_FALSE(cache.HasQueue("jobs", kDurable, Table()));
+  cache.AddQueue("jobs", kDurable, Table(), cache.generation());
+  EXPECT_TRUE(cache.HasQueue("jobs", kDurable, Table()));
+}
+
+TEST(TopologyCacheTest, RebindToRecreatedAutoDeleteQueueIsSent) {
+  TopologyCache cache;
+  CountingDelegate delegate;
+  ChannelPipeline pipeline(1, &delegate);
+  pipeline.set_topology_cache(&cache);
+
+  pipeline.DeclareExchange("ex", "direct", kDurable, Table(), nullptr,
+                           nullptr);
+  pipeline.DeclareQueue("tmp", kAutoDelete, Table(), nullptr, nullptr);
+  pipeline.BindQueue("tmp", "ex", "k", Table(), nullptr, nullptr);
+  pipeline.Flush();
+  ASSERT_TRUE(AnswerOk(&pipeline, kClassExchange, kExchangeDeclareOk));
+  ASSERT_TRUE(AnswerQueueOk(&pipeline, "tmp"));
+  ASSERT_TRUE(AnswerOk(&pipeline, kClassQueue, kQueueBindOk));
+  EXPECT_EQ(1, delegate.sends);
+
+  // The queue went away with its last consumer; declare and bind it again.
+  bool bound = false;
+  pipeline.DeclareExchange("ex", "direct", kDurable, Table(), nullptr,
+                           nullptr);
+  pipeline.DeclareQueue("tmp", kAutoDelete, Table(), nullptr, nullptr);
+  pipeline.BindQueue("tmp", "ex", "k", Table(),
+                     [&bound]() { bound = true; }, nullptr);
+  pipeline.Flush();
+  EXPECT_EQ(2, delegate.sends);
+  // The exchange was answered locally; the queue and binding were sent.
+  EXPECT_EQ(2u, pipeline.outstanding());
+  EXPECT_FALSE(bound);
+  ASSERT_TRUE(AnswerQueueOk(&pipeline, "tmp"));
+  ASSERT_TRUE(AnswerOk(&pipeline, kClassQueue, kQueueBindOk));
+  EXPECT_TRUE(bound);
+}
+
+} // namespace
+
+} // namespace amqp
@@ -0,0 +1,155 @@
+#include "amqp/tx_batch.h"
+
+#include <algorithm>
+
+#include "amqp/method_frames.h"
+
+#include <glog/logging.h>
+
+namespace amqp {
+
+namespace {
+
+// Room for the Tx.Commit closing a batch.
+const size_t kCommitSize = kFrameOverhead + 4;
+
+} // namespace
+
+TxBatch::TxBatch(uint16_t channel,
+                 const Options& options,
+                 const CommitCallback& callback,
+                 Delegate* delegate,
+                 base::TimerWheel* timers)
+  : channel_(channel),
+    options_(options),
+    callback_(callback),
+    delegate_(delegate),
+    timers_(timers),
+    open_id_(1),
+    open_entries_(0),
+    timer_(0),
+    select_pending_(false) {
+  DCHECK(delegate_);
+  options_.max_messages = std::max<size_t>(options_.max_messages, 1);
+  options_.max_bytes = std::max<size_t>(options_.max_bytes, kFrameMinSize);
+}
+
+TxBatch::~TxBatch() {
+  if (timer_) timers_->Cancel(timer_);
+}
+
+void TxBatch::Start() {
+  TxFrame select(channel_, kTxSelect);
+  OutBuffer buffer(select.size());
+  select.Fill(buffer);
+  select_pending_ = true;
+  delegate_->SendFrames(buffer);
+}
+
+uint64_t TxBatch::Publish(const PublishTemplate& message,
+                          const base::StringPiece& routing_key,
+                          const char* body,
+                          uint64_t body_size,
+                          const base::StringPiece& id,
+                          uint64_t timestamp) {
+  DCHECK_EQ(channel_, message.channel());
+  OutBuffer& buffer = Reserve(message.size(routing_key, id, body_size));
+  message.Fill(buffer, routing_key, body, body_size, id, timestamp);
+  return Added();
+}
+
+uint64_t TxBatch::Ack(uint64_t delivery_tag, bool multiple) {
+  BasicAckFrame ack(channel_, delivery_tag, multiple);
+  ack.Fill(Reserve(ack.size()));
+  return Added();
+}
+
+OutBuffer& TxBatch::Reserve(size_t size) {
+  if (buffer_ && buffer_->available() < size + kCommitSize) Commit();
+  if (!buffer_ || buffer_->capacity() < size + kCommitSize) {
+    // Sized so a full batch never has to be committed early; a single
+    // oversized message gets a buffer of its own.
+    size_t capacity = std::max(options_.max_bytes, size) + kCommitSize;
+    buffer_.reset(new OutBuffer(capacity));
+  }
+  return *buffer_;
+}
+
+uint64_t TxBatch::Added() {
+  uint64_t id = open_id_;
+  if (++open_entries_ == 1 && timers_) {
+    timer_ = timers_->Schedule(base::TimeTicks::Now() + options_.max_delay,
+                               [this]() {
+                                 timer_ = 0;
+                                 Commit();
+                               });
+  }
+  if (open_entries_ >= options_.max_messages ||
+      buffer_->size() >= options_.max_bytes) {
+    Commit();
+  }
+  return id;
+}
+
+void TxBatch::Commit() {
+  if (open_entries_ == 0) return;
+  if (timer_) {
+    timers_->Cancel(timer_);
+    timer_ = 0;
+  }
+
+  TxFrame(channel_, kTxCommit).Fill(*buffer_);
+  InFlight commit;
+  commit.id = open_id_;
+  commit.entries = open_entries_;
+  commit.sent = base::TimeTicks::Now();
+  in_flight_.push_back(commit);
+  ++open_id_;
+  open_entries_ = 0;
+
+  delegate_->SendFrames(*buffer_);
+  buffer_->Clear();
+}
+
+bool TxBatch::OnMethod(uint16_t class_id,
+                       uint16_t method_id,
+                       InBuffer& /* arguments */) {
+  if (class_id != kClassTx) return false;
+  if (method_id == kTxSelectOk && select_pending_) {
+    select_pending_ = false;
+    return true;
+  }
+  if (method_id != kTxCommitOk || in_flight_.empty()) return false;
+
+  InFlight commit = in_flight_.front();
+  in_flight_.pop_front();
+  commit_latency_.Record(
+      (base::TimeTicks::Now() - commit.sent).InMicroseconds());
+  batch_size_.Record(commit.entries);
+  if (callback_) callback_(commit.id, true);
+  return true;
+}
+
+void TxBatch::OnChannelClose() {
+  if (timer_) {
+    timers_->Cancel(timer_);
+    timer_ = 0;
+  }
+  if (buffer_) buffer_->Clear();
+  select_pending_ = false;
+
+  std::deque<InFlight> failed;
+  failed.swap(in_flight_);
+  bool open = open_entries_ != 0;
+  uint64_t open_id = open_id_;
+  if (open) {
+    ++open_id_;
+    open_entries_ = 0;
+  }
+
+  if (!callback_) return;
+  for (const InFlight& commit : failed) callback_(commit.id, false);
+  if (open) callback_(open_id, false);
+}
+
+} // namespace amqp
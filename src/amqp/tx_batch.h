@@ -0,0 +1,136 @@
+#ifndef AMQP_TX_BATCH_H_
+#define AMQP_TX_BATCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include "amqp/in_buffer.h"
+#include "amqp/out_buffer.h"
+#include "amqp/publish_template.h"
+#include "base/histogram.h"
+#include "base/macros.h"
+#include "base/string_piece.h"
+#include "base/time.h"
+#include "base/timer_wheel.h"
+
+namespace amqp {
+
+// Group commit for a channel in transaction (Tx) mode.
+//
+// Publishes and acks are encoded into the open batch; Commit() appends
+// Tx.Commit and sends the whole batch as one write. The batch is committed
+// automatically once it holds max_messages publishes and acks or max_bytes
+// of frames, or max_delay after its first entry. Commits are pipelined: the
+// next batch fills while earlier ones wait for their Tx.Commit-Ok, which the
+// broker sends in order.
+//
+// Everything in a batch takes effect atomically, so an ack of the input
+// message committed together with the publish of its output gives a relay
+// exactly-once hand-off. Committing per message costs a broker round trip
+// (and an fsync, for persistent messages) each time; batching spreads that
+// over the whole batch.
+//
+// commit_latency() is recorded in microseconds from the write to the
+// Commit-Ok, batch_size() in entries per committed batch.
+//
+// Not thread-safe; use it on the channel's I/O thread.
+class TxBatch {
+ public:
+  // |batch| is the id Publish()/Ack() returned for the entries concerned.
+  // |committed| is false if the channel closed first: the broker then rolls
+  // the batch back.
+  typedef std::function<void(uint64_t batch, bool committed)> CommitCallback;
+
+  class Delegate {
+   public:
+    virtual ~Delegate() {}
+    virtual void SendFrames(const OutBuffer& frames) = 0;
+  };
+
+  struct Options {
+    Options()
+      : max_messages(1000),
+        max_bytes(1 << 20),
+        max_delay(base::TimeDelta::FromMilliseconds(10)) {}
+
+    size_t max_messages;
+    size_t max_bytes;
+    // Ignored without a TimerWheel.
+    base::TimeDelta max_delay;
+  };
+
+  // |timers| may be null, in which case batches are only committed on size
+  // and by Commit(). |delegate| and |timers| must outlive the batch.
+  TxBatch(uint16_t channel, const Options& options,
+          const CommitCallback& callback, Delegate* delegate,
+          base::TimerWheel* timers = nullptr);
+  ~TxBatch();
+
+  // Sends Tx.Select; must precede everything else.
+  void Start();
+
+  // |message| must be a template for this channel. Returns the batch id.
+  uint64_t Publish(const PublishTemplate& message,
+                   const base::StringPiece& routing_key,
+                   const char* body,
+                   uint64_t body_size,
+                   const base::StringPiece& id = base::StringPiece(),
+                   uint64_t timestamp = 0);
+  // Leave |multiple| false for consumers dispatched by priority; see
+  // OrderedDispatcher.
+  uint64_t Ack(uint64_t delivery_tag, bool multiple = false);
+
+  // Commits the open batch, if it has anything in it.
+  void Commit();
+
+  // A method received on the channel. Returns false for a Tx method this
+  // batch did not expect; the caller should treat that as a protocol error.
+  bool OnMethod(uint16_t class_id, uint16_t method_id, InBuffer& arguments);
+
+  // The channel closed; every uncommitted batch is reported as failed.
+  void OnChannelClose();
+
+  // The batch the next entry goes into.
+  uint64_t open_batch() const { return open_id_; }
+  size_t open_entries() const { return open_entries_; }
+  size_t commits_in_flight() const { return in_flight_.size(); }
+
+  const base::Histogram& commit_latency() const { return commit_latency_; }
+  const base::Histogram& batch_size() const { return batch_size_; }
+
+ private:
+  struct InFlight {
+    uint64_t id;
+    size_t entries;
+    base::TimeTicks sent;
+  };
+
+  // Makes room for |size| more bytes plus the Tx.Commit.
+  OutBuffer& Reserve(size_t size);
+  // Accounts for an entry just written; may commit.
+  uint64_t Added();
+
+  const uint16_t channel_;
+  Options options_;
+  CommitCallback callback_;
+  Delegate* delegate_;
+  base::TimerWheel* timers_;
+
+  std::unique_ptr<OutBuffer> buffer_;
+  uint64_t open_id_;
+  size_t open_entries_;
+  base::TimerWheel::TimerId timer_;
+  bool select_pending_;
+  std::deque<InFlight> in_flight_;
+
+  base::Histogram commit_latency_;
+  base::Histogram batch_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(TxBatch);
+};
+
+} // namespace amqp
+#endif // AMQP_TX_BATCH_H_
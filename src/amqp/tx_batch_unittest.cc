@@ -0,0 +1,225 @@
+#include "amqp/tx_batch.h"
+
+#include <string.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "amqp/protocol.h"
+#include "base/byteorder.h"
+
+#include <gtest/gtest.h>
+
+namespace amqp {
+
+namespace {
+
+uint32_t Method(uint16_t class_id, uint16_t method_id) {
+  return static_cast<uint32_t>(class_id) << 16 | method_id;
+}
+
+const uint32_t kPublish = Method(kClassBasic, kBasicPublish);
+const uint32_t kAck = Method(kClassBasic, kBasicAck);
+const uint32_t kCommit = Method(kClassTx, kTxCommit);
+
+// Keeps the size and the methods of every write.
+class RecordingDelegate : public TxBatch::Delegate {
+ public:
+  struct Write {
+    size_t size;
+    std::vector<uint32_t> methods;
+  };
+
+  void SendFrames(const OutBuffer& frames) override {
+    Write write;
+    write.size = frames.size();
+    const char* p = frames.data();
+    const char* end = p + frames.size();
+    while (p < end) {
+      uint32_t size;
+      memcpy(&size, p + 3, 4);
+      size = base::NetToHost32(size);
+      if (static_cast<uint8_t>(p[0]) == kFrameMethod) {
+        uint16_t ids[2];
+        memcpy(ids, p + kFrameHeaderSize, 4);
+        write.methods.push_back(Method(base::NetToHost16(ids[0]),
+                                       base::NetToHost16(ids[1])));
+      }
+      p += kFrameOverhead + size;
+    }
+    writes.push_back(write);
+  }
+
+  std::vector<Write> writes;
+};
+
+typedef std::vector<std::pair<uint64_t, bool>> Commits;
+
+std::vector<uint32_t> Repeat(uint32_t method, size_t count) {
+  std::vector<uint32_t> methods(count, method);
+  methods.push_back(kCommit);
+  return methods;
+}
+
+class TxBatchTest : public testing::Test {
+ protected:
+  TxBatchTest()
+    : message_(1, "events", MetaData()),
+      timers_(base::TimeDelta::FromMilliseconds(1), 64,
+              base::TimeTicks::Now()) {}
+
+  void Open(const TxBatch::Options& options, bool with_timers = false) {
+    batch_.reset(new TxBatch(
+        1, options,
+        [this](uint64_t batch, bool committed) {
+          commits_.push_back(std::make_pair(batch, committed));
+        },
+        &delegate_, with_timers ? &timers_ : nullptr));
+    batch_->Start();
+    ASSERT_TRUE(Ok(kTxSelectOk));
+    delegate_.writes.clear();
+  }
+
+  bool Ok(uint16_t method_id) {
+    InBuffer none("", 0);
+    return batch_->OnMethod(kClassTx, method_id, none);
+  }
+
+  uint64_t Publish(size_t body_size) {
+    std::string body(body_size, 'x');
+    return batch_->Publish(message_, "key", body.data(), body.size());
+  }
+
+  PublishTemplate message_;
+  RecordingDelegate delegate_;
+  base::TimerWheel timers_;
+  std::unique_ptr<TxBatch> batch_;
+  Commits commits_;
+};
+
+TEST_F(TxBatchTest, CommitsOnMaxMessages) {
+  TxBatch::Options options;
+  options.max_messages = 3;
+  Open(options);
+  for (uint64_t tag = 1; tag <= 7; ++tag) {
+    EXPECT_EQ((tag + 2) / 3, batch_->Ack(tag));
+  }
+  ASSERT_EQ(2u, delegate_.writes.size());
+  EXPECT_EQ(Repeat(kAck, 3), delegate_.writes[0].methods);
+  EXPECT_EQ(Repeat(kAck, 3), delegate_.writes[1].methods);
+  EXPECT_EQ(3u, batch_->open_batch());
+  EXPECT_EQ(1u, batch_->open_entries());
+  EXPECT_EQ(2u, batch_->commits_in_flight());
+
+  EXPECT_TRUE(Ok(kTxCommitOk));
+  EXPECT_TRUE(Ok(kTxCommitOk));
+  EXPECT_FALSE(Ok(kTxCommitOk));
+  EXPECT_FALSE(Ok(kTxSelectOk));
+  EXPECT_EQ(Commits({{1, true}, {2, true}}), commits_);
+  base::Histogram::Snapshot sizes = batch_->batch_size().TakeSnapshot();
+  EXPECT_EQ(2u, sizes.count());
+  EXPECT_EQ(6u, sizes.sum());
+
+  batch_->Commit();
+  EXPECT_EQ(Repeat(kAck, 1), delegate_.writes[2].methods);
+  // Nothing left to commit.
+  batch_->Commit();
+  EXPECT_EQ(3u, delegate_.writes.size());
+}
+
+TEST_F(TxBatchTest, CommitsOnMaxBytes) {
+  TxBatch::Options options;
+  options.max_bytes = kFrameMinSize;
+  Open(options);
+  size_t entries = 0;
+  while (delegate_.writes.size() < 3) {
+    Publish(1000);
+    ++entries;
+  }
+  size_t published = 0;
+  for (const RecordingDelegate::Write& write : delegate_.writes) {
+    // A batch is never allowed to outgrow max_bytes.
+    EXPECT_LE(write.size, options.max_bytes + kFrameOverhead + 4);
+    EXPECT_GT(write.size, options.max_bytes / 2);
+    ASSERT_GE(write.methods.size(), 2u);
+    EXPECT_EQ(Repeat(kPublish, write.methods.size() - 1), write.methods);
+    published += write.methods.size() - 1;
+  }
+  EXPECT_EQ(entries, published + batch_->open_entries());
+}
+
+TEST_F(TxBatchTest, OversizedMessageGoesAlone) {
+  TxBatch::Options options;
+  options.max_bytes = kFrameMinSize;
+  Open(options);
+  EXPECT_EQ(1u, batch_->Ack(1));
+  // Bigger than a whole batch: the open batch is committed first and the
+  // message gets a write of its own.
+  EXPECT_EQ(2u, Publish(3 * kFrameMinSize));
+  ASSERT_EQ(2u, delegate_.writes.size());
+  EXPECT_EQ(Repeat(kAck, 1), delegate_.writes[0].methods);
+  EXPECT_EQ(Repeat(kPublish, 1), delegate_.writes[1].methods);
+  EXPECT_GT(delegate_.writes[1].size, 3 * kFrameMinSize);
+
+  // Small entries batch normally afterwards.
+  EXPECT_EQ(3u, batch_->Ack(2));
+  EXPECT_EQ(3u, batch_->Ack(3));
+  batch_->Commit();
+  ASSERT_EQ(3u, delegate_.writes.size());
+  EXPECT_EQ(Repeat(kAck, 2), delegate_.writes[2].methods);
+}
+
+TEST_F(TxBatchTest, CommitsAfterMaxDelay) {
+  TxBatch::Options options;
+  options.max_delay = base::TimeDelta::FromMilliseconds(5);
+  Open(options, true);
+  batch_->Ack(1);
+  batch_->Ack(2);
+  EXPECT_EQ(1u, timers_.size());
+  EXPECT_TRUE(delegate_.writes.empty());
+
+  timers_.Advance(base::TimeTicks::Now() +
+                  base::TimeDelta::FromMilliseconds(50));
+  ASSERT_EQ(1u, delegate_.writes.size());
+  EXPECT_EQ(Repeat(kAck, 2), delegate_.writes[0].methods);
+  EXPECT_TRUE(timers_.empty());
+
+  // An explicit commit cancels the timer of its batch.
+  batch_->Ack(3);
+  EXPECT_EQ(1u, timers_.size());
+  batch_->Commit();
+  EXPECT_TRUE(timers_.empty());
+  EXPECT_EQ(2u, delegate_.writes.size());
+}
+
+TEST_F(TxBatchTest, CloseFailsOpenAndInFlightBatches) {
+  TxBatch::Options options;
+  Open(options, true);
+  batch_->Ack(1);
+  batch_->Commit();
+  batch_->Ack(2);
+  batch_->Commit();
+  EXPECT_TRUE(Ok(kTxCommitOk));
+  Publish(10);
+  EXPECT_EQ(1u, batch_->commits_in_flight());
+  EXPECT_EQ(1u, batch_->open_entries());
+
+  batch_->OnChannelClose();
+  EXPECT_EQ(Commits({{1, true}, {2, false}, {3, false}}), commits_);
+  EXPECT_EQ(0u, batch_->commits_in_flight());
+  EXPECT_EQ(0u, batch_->open_entries());
+  EXPECT_EQ(4u, batch_->open_batch());
+  EXPECT_TRUE(timers_.empty());
+  EXPECT_FALSE(Ok(kTxCommitOk));
+
+  // The discarded publish is not sent with the next batch.
+  EXPECT_EQ(4u, batch_->Ack(3));
+  batch_->Commit();
+  ASSERT_EQ(3u, delegate_.writes.size());
+  EXPECT_EQ(Repeat(kAck, 1), delegate_.writes[2].methods);
+}
+
+} // namespace
+
+} // namespace amqp
@@ -0,0 +1,34 @@
+#include "base/backoff.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace base {
+
+Backoff::Backoff(const Policy& policy, uint64_t seed)
+  : policy_(policy),
+    failures_(0),
+    random_(seed ? seed : std::random_device()()) {}
+
+Backoff::~Backoff() {}
+
+TimeDelta Backoff::NextDelay() {
+  int exponent = failures_++;
+  if (policy_.first_retry_immediate) {
+    if (exponent == 0) return TimeDelta();
+    --exponent;
+  }
+
+  double max_us = static_cast<double>(policy_.max_delay.InMicroseconds());
+  double delay_us =
+      static_cast<double>(policy_.initial_delay.InMicroseconds()) *
+      std::pow(policy_.multiplier, exponent);
+  delay_us = std::min(delay_us, max_us);
+
+  double jitter = std::max(0.0, std::min(1.0, policy_.jitter));
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  delay_us *= 1.0 - jitter * unit(random_);
+  return TimeDelta::FromMicroseconds(static_cast<int64_t>(delay_us));
+}
+
+} // namespace base
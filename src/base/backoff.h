@@ -0,0 +1,61 @@
+#ifndef BASE_BACKOFF_H_
+#define BASE_BACKOFF_H_
+
+#include <stdint.h>
+#include <random>
+
+#include "base/macros.h"
+#include "base/time.h"
+
+namespace base {
+
+// Exponential backoff with jitter for retrying a failed operation, such as a
+// reconnect.
+//
+// The n-th delay is initial_delay * multiplier^n, capped at max_delay, and
+// then shortened by a random fraction of up to |jitter| so that many clients
+// failing at once do not retry in lockstep. The first retry can be made
+// immediately: a single dropped connection usually reconnects at once.
+//
+//   base::Backoff backoff(policy);
+//   while (!Connect()) Sleep(backoff.NextDelay());
+//   backoff.Reset();
+class Backoff {
+ public:
+  struct Policy {
+    Policy()
+      : initial_delay(TimeDelta::FromMilliseconds(100)),
+        max_delay(TimeDelta::FromSeconds(30)),
+        multiplier(2.0),
+        jitter(0.5),
+        first_retry_immediate(true) {}
+
+    TimeDelta initial_delay;
+    TimeDelta max_delay;
+    double multiplier;
+    // In [0, 1]: 0 waits exactly the computed delay, 1 anywhere up to it.
+    double jitter;
+    bool first_retry_immediate;
+  };
+
+  // A zero |seed| seeds from std::random_device.
+  explicit Backoff(const Policy& policy, uint64_t seed = 0);
+  ~Backoff();
+
+  // Records a failure and returns how long to wait before the next try.
+  TimeDelta NextDelay();
+  // Call after a success.
+  void Reset() { failures_ = 0; }
+
+  int failures() const { return failures_; }
+
+ private:
+  Policy policy_;
+  int failures_;
+  std::mt19937_64 random_;
+
+  DISALLOW_COPY_AND_ASSIGN(Backoff);
+};
+
+} // namespace base
+#endif // BASE_BACKOFF_H_
@@ -0,0 +1,61 @@
+#include "base/backoff.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+TEST(BackoffTest, GrowsExponentiallyWithoutJitter) {
+  Backoff::Policy policy;
+  policy.initial_delay = TimeDelta::FromMilliseconds(10);
+  policy.max_delay = TimeDelta::FromMilliseconds(100);
+  policy.jitter = 0;
+  policy.first_retry_immediate = false;
+  Backoff backoff(policy, 1);
+
+  EXPECT_EQ(10, backoff.NextDelay().InMilliseconds());
+  EXPECT_EQ(20, backoff.NextDelay().InMilliseconds());
+  EXPECT_EQ(40, backoff.NextDelay().InMilliseconds());
+  EXPECT_EQ(80, backoff.NextDelay().InMilliseconds());
+  EXPECT_EQ(100, backoff.NextDelay().InMilliseconds());
+  EXPECT_EQ(100, backoff.NextDelay().InMilliseconds());
+  EXPECT_EQ(6, backoff.failures());
+
+  backoff.Reset();
+  EXPECT_EQ(10, backoff.NextDelay().InMilliseconds());
+}
+
+TEST(BackoffTest, FirstRetryImmediate) {
+  Backoff::Policy policy;
+  policy.initial_delay = TimeDelta::FromMilliseconds(10);
+  policy.jitter = 0;
+  Backoff backoff(policy, 1);
+
+  EXPECT_EQ(0, backoff.NextDelay().InMicroseconds());
+  EXPECT_EQ(10, backoff.NextDelay().InMilliseconds());
+  EXPECT_EQ(20, backoff.NextDelay().InMilliseconds());
+}
+
+TEST(BackoffTest, JitterStaysWithinBounds) {
+  Backoff::Policy policy;
+  policy.initial_delay = TimeDelta::FromMilliseconds(100);
+  policy.max_delay = TimeDelta::FromMilliseconds(100);
+  policy.jitter = 0.5;
+  policy.first_retry_immediate = false;
+  Backoff backoff(policy, 7);
+
+  bool varied = false;
+  int64_t first = backoff.NextDelay().InMicroseconds();
+  for (int i = 0; i < 1000; ++i) {
+    int64_t delay = backoff.NextDelay().InMicroseconds();
+    EXPECT_GE(delay, 50000);
+    EXPECT_LE(delay, 100000);
+    if (delay != first) varied = true;
+  }
+  EXPECT_TRUE(varied);
+}
+
+} // namespace
+
+} // namespace base
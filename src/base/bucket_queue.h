@@ -0,0 +1,79 @@
+#ifndef BASE_BUCKET_QUEUE_H_
+#define BASE_BUCKET_QUEUE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <utility>
+
+#include "base/macros.h"
+
+#include <glog/logging.h>
+
+namespace base {
+
+// A priority queue over a small range of integer priorities: one FIFO per
+// priority plus a bitmask of the non-empty ones. Push() and Pop() are O(1);
+// the highest priority comes out first and equal priorities come out in
+// the order they went in.
+//
+// Priorities above kMaxPriority are treated as kMaxPriority.
+//
+//   base::BucketQueue<Task, 10> queue;  // priorities 0..9
+//   queue.Push(priority, std::move(task));
+//   while (!queue.empty()) Run(queue.Pop());
+template <typename T, size_t kBuckets>
+class BucketQueue {
+ public:
+  static_assert(kBuckets > 0 && kBuckets <= 32, "one bit per bucket");
+  static const unsigned kMaxPriority = kBuckets - 1;
+
+  BucketQueue() : mask_(0), size_(0) {}
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  void Push(unsigned priority, T value) {
+    if (priority > kMaxPriority) priority = kMaxPriority;
+    buckets_[priority].push_back(std::move(value));
+    mask_ |= 1u << priority;
+    ++size_;
+  }
+
+  // The highest priority present; the queue must not be empty.
+  unsigned top_priority() const {
+    DCHECK(!empty());
+    return 31 - __builtin_clz(mask_);
+  }
+
+  T& front() { return buckets_[top_priority()].front(); }
+
+  T Pop() {
+    unsigned priority = top_priority();
+    std::deque<T>& bucket = buckets_[priority];
+    T value = std::move(bucket.front());
+    bucket.pop_front();
+    if (bucket.empty()) mask_ &= ~(1u << priority);
+    --size_;
+    return value;
+  }
+
+  void clear() {
+    for (std::deque<T>& bucket : buckets_) bucket.clear();
+    mask_ = 0;
+    size_ = 0;
+  }
+
+ private:
+  std::deque<T> buckets_[kBuckets];
+  uint32_t mask_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(BucketQueue);
+};
+
+template <typename T, size_t kBuckets>
+const unsigned BucketQueue<T, kBuckets>::kMaxPriority;
+
+} // namespace base
+#endif // BASE_BUCKET_QUEUE_H_
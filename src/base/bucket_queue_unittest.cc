@@ -0,0 +1,57 @@
+#include "base/bucket_queue.h"
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+TEST(BucketQueueTest, HighestPriorityFirstFifoWithin) {
+  BucketQueue<std::string, 10> queue;
+  EXPECT_TRUE(queue.empty());
+
+  queue.Push(0, "bulk1");
+  queue.Push(5, "mid1");
+  queue.Push(0, "bulk2");
+  queue.Push(9, "urgent");
+  queue.Push(5, "mid2");
+  EXPECT_EQ(5u, queue.size());
+  EXPECT_EQ(9u, queue.top_priority());
+  EXPECT_EQ("urgent", queue.front());
+
+  EXPECT_EQ("urgent", queue.Pop());
+  EXPECT_EQ("mid1", queue.Pop());
+  EXPECT_EQ("mid2", queue.Pop());
+  EXPECT_EQ("bulk1", queue.Pop());
+  EXPECT_EQ("bulk2", queue.Pop());
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(BucketQueueTest, ClampsPriority) {
+  BucketQueue<int, 10> queue;
+  queue.Push(9, 1);
+  queue.Push(255, 2);
+  EXPECT_EQ(9u, queue.top_priority());
+  EXPECT_EQ(1, queue.Pop());
+  EXPECT_EQ(2, queue.Pop());
+}
+
+TEST(BucketQueueTest, MoveOnlyAndClear) {
+  BucketQueue<std::unique_ptr<int>, 4> queue;
+  queue.Push(1, std::unique_ptr<int>(new int(1)));
+  queue.Push(3, std::unique_ptr<int>(new int(3)));
+  EXPECT_EQ(3, *queue.Pop());
+  queue.Push(2, std::unique_ptr<int>(new int(2)));
+  queue.clear();
+  EXPECT_TRUE(queue.empty());
+  queue.Push(0, std::unique_ptr<int>(new int(0)));
+  EXPECT_EQ(0u, queue.top_priority());
+  EXPECT_EQ(0, *queue.Pop());
+}
+
+} // namespace
+
+} // namespace base
@@ -0,0 +1,81 @@
+#include "base/crc32c.h"
+
+#include <string.h>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+namespace base {
+
+namespace {
+
+#if !defined(__SSE4_2__)
+
+const uint32_t kPolynomial = 0x82f63b78;  // reflected
+
+struct Tables {
+  Tables() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit)
+        crc = (crc >> 1) ^ (kPolynomial & (0u - (crc & 1)));
+      table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+      for (int t = 1; t < 8; ++t)
+        table[t][i] = (table[t - 1][i] >> 8) ^ table[0][table[t - 1][i] & 0xff];
+    }
+  }
+  uint32_t table[8][256];
+};
+
+const Tables& GetTables() {
+  static const Tables tables;
+  return tables;
+}
+
+#endif
+
+} // namespace
+
+uint32_t ExtendCrc32c(uint32_t crc, const char* data, size_t size) {
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+  const unsigned char* end = p + size;
+  uint32_t c = ~crc;
+
+#if defined(__SSE4_2__)
+  uint64_t c64 = c;
+  while (end - p >= 8) {
+    uint64_t word;
+    memcpy(&word, p, 8);
+    c64 = _mm_crc32_u64(c64, word);
+    p += 8;
+  }
+  c = static_cast<uint32_t>(c64);
+  while (p != end) c = _mm_crc32_u8(c, *p++);
+#else
+  const uint32_t (*t)[256] = GetTables().table;
+  // The table form below assumes little-endian loads.
+  while (end - p >= 8) {
+    uint32_t low, high;
+    memcpy(&low, p, 4);
+    memcpy(&high, p + 4, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    low = __builtin_bswap32(low);
+    high = __builtin_bswap32(high);
+#endif
+    low ^= c;
+    c = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^
+        t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+        t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^
+        t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+    p += 8;
+  }
+  while (p != end) c = (c >> 8) ^ t[0][(c ^ *p++) & 0xff];
+#endif
+
+  return ~c;
+}
+
+} // namespace base
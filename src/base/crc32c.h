@@ -0,0 +1,33 @@
+#ifndef BASE_CRC32C_H_
+#define BASE_CRC32C_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace base {
+
+// CRC-32C (Castagnoli), as used by iSCSI, ext4 and most storage formats.
+//
+// Uses the SSE4.2 crc32 instruction when the build targets it and a
+// slicing-by-8 table otherwise; both give the same result.
+
+// Extends |crc|, the CRC of some prefix, over |data|.
+uint32_t ExtendCrc32c(uint32_t crc, const char* data, size_t size);
+
+inline uint32_t Crc32c(const char* data, size_t size) {
+  return ExtendCrc32c(0, data, size);
+}
+
+// A CRC stored next to the data it covers is masked, so that the CRC of a
+// string that embeds CRCs is not degenerate.
+inline uint32_t MaskCrc32c(uint32_t crc) {
+  return ((crc >> 15) | (crc << 17)) + 0xa282ead8u;
+}
+
+inline uint32_t UnmaskCrc32c(uint32_t masked) {
+  uint32_t rotated = masked - 0xa282ead8u;
+  return (rotated >> 17) | (rotated << 15);
+}
+
+} // namespace base
+#endif // BASE_CRC32C_H_
@@ -0,0 +1,46 @@
+#include "base/crc32c.h"
+
+#include <string.h>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+TEST(Crc32cTest, KnownValues) {
+  EXPECT_EQ(0u, Crc32c("", 0));
+  EXPECT_EQ(0xe3069283u, Crc32c("123456789", 9));
+
+  // From RFC 3720, section B.4.
+  char buf[32];
+  memset(buf, 0, sizeof(buf));
+  EXPECT_EQ(0x8a9136aau, Crc32c(buf, sizeof(buf)));
+  memset(buf, 0xff, sizeof(buf));
+  EXPECT_EQ(0x62a8ab43u, Crc32c(buf, sizeof(buf)));
+  for (int i = 0; i < 32; ++i) buf[i] = static_cast<char>(i);
+  EXPECT_EQ(0x46dd794eu, Crc32c(buf, sizeof(buf)));
+}
+
+TEST(Crc32cTest, Extend) {
+  std::string data = "hello, spool: some bytes that span several words";
+  uint32_t whole = Crc32c(data.data(), data.size());
+  for (size_t split = 0; split <= data.size(); ++split) {
+    uint32_t crc = Crc32c(data.data(), split);
+    EXPECT_EQ(whole,
+              ExtendCrc32c(crc, data.data() + split, data.size() - split));
+  }
+}
+
+TEST(Crc32cTest, Mask) {
+  uint32_t crc = Crc32c("foo", 3);
+  EXPECT_NE(crc, MaskCrc32c(crc));
+  EXPECT_NE(crc, MaskCrc32c(MaskCrc32c(crc)));
+  EXPECT_EQ(crc, UnmaskCrc32c(MaskCrc32c(crc)));
+  EXPECT_EQ(crc, UnmaskCrc32c(UnmaskCrc32c(MaskCrc32c(MaskCrc32c(crc)))));
+}
+
+} // namespace
+
+} // namespace base
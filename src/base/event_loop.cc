@@ -0,0 +1,153 @@
+#include "base/event_loop.h"
+
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "base/eintr_wrapper.h"
+
+#include <glog/logging.h>
+
+namespace base {
+
+namespace {
+
+const int kMaxEventsPerPoll = 64;
+
+uint64_t CurrentThreadId() {
+  return static_cast<uint64_t>(pthread_self());
+}
+
+uint32_t ToEpollEvents(uint32_t mode) {
+  uint32_t events = 0;
+  if (mode & EventLoop::WATCH_READ) events |= EPOLLIN | EPOLLRDHUP;
+  if (mode & EventLoop::WATCH_WRITE) events |= EPOLLOUT;
+  return events;
+}
+
+uint32_t FromEpollEvents(uint32_t events) {
+  uint32_t mode = 0;
+  // Errors and hangups are reported as readable so the owner sees the EOF.
+  if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+    mode |= EventLoop::WATCH_READ;
+  if (events & EPOLLOUT) mode |= EventLoop::WATCH_WRITE;
+  return mode;
+}
+
+} // namespace
+
+EventLoop::EventLoop()
+  : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
+    wakeup_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+    wakeup_pending_(false),
+    quit_(false),
+    thread_id_(0) {
+  PCHECK(epoll_fd_.is_valid()) << "epoll_create1";
+  PCHECK(wakeup_fd_.is_valid()) << "eventfd";
+
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = wakeup_fd_.get();
+  int rv = epoll_ctl(epoll_fd_.get(), EPOLL_CTL_ADD, wakeup_fd_.get(), &event);
+  PCHECK(rv == 0) << "epoll_ctl";
+}
+
+EventLoop::~EventLoop() {
+  while (PendingTask* pending = incoming_.Pop()) {
+    delete pending;
+  }
+}
+
+void EventLoop::Run() {
+  thread_id_.store(CurrentThreadId(), std::memory_order_release);
+
+  struct epoll_event events[kMaxEventsPerPoll];
+  while (!quit_.load(std::memory_order_acquire)) {
+    int n = HANDLE_EINTR(epoll_wait(epoll_fd_.get(), events,
+                                    kMaxEventsPerPoll, -1));
+    if (n < 0) {
+      PLOG(ERROR) << "epoll_wait";
+      break;
+    }
+    for (int i = 0; i < n; ++i) {
+      int fd = events[i].data.fd;
+      if (fd == wakeup_fd_.get()) {
+        RunPendingTasks();
+        continue;
+      }
+      auto it = watchers_.find(fd);
+      if (it == watchers_.end()) continue;
+      // Copy: the callback may Unwatch() itself.
+      WatchCallback callback = it->second;
+      callback(FromEpollEvents(events[i].events));
+    }
+  }
+
+  RunPendingTasks();
+  thread_id_.store(0, std::memory_order_release);
+}
+
+void EventLoop::Quit() {
+  quit_.store(true, std::memory_order_release);
+  wakeup_pending_.store(true, std::memory_order_release);
+  Wakeup();
+}
+
+void EventLoop::PostTask(Task task) {
+  incoming_.Push(new PendingTask(std::move(task)));
+  if (!wakeup_pending_.exchange(true, std::memory_order_acq_rel)) {
+    Wakeup();
+  }
+}
+
+bool EventLoop::RunsTasksOnCurrentThread() const {
+  return thread_id_.load(std::memory_order_acquire) == CurrentThreadId();
+}
+
+bool EventLoop::Watch(int fd, uint32_t mode, WatchCallback callback) {
+  struct epoll_event event = {};
+  event.events = ToEpollEvents(mode);
+  event.data.fd = fd;
+  if (epoll_ctl(epoll_fd_.get(), EPOLL_CTL_ADD, fd, &event) != 0) {
+    PLOG(ERROR) << "epoll_ctl(ADD, " << fd << ")";
+    return false;
+  }
+  watchers_[fd] = std::move(callback);
+  return true;
+}
+
+bool EventLoop::Modify(int fd, uint32_t mode) {
+  struct epoll_event event = {};
+  event.events = ToEpollEvents(mode);
+  event.data.fd = fd;
+  if (epoll_ctl(epoll_fd_.get(), EPOLL_CTL_MOD, fd, &event) != 0) {
+    PLOG(ERROR) << "epoll_ctl(MOD, " << fd << ")";
+    return false;
+  }
+  return true;
+}
+
+void EventLoop::Unwatch(int fd) {
+  if (watchers_.erase(fd) == 0) return;
+  epoll_ctl(epoll_fd_.get(), EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void EventLoop::Wakeup() {
+  uint64_t one = 1;
+  ignore_result(HANDLE_EINTR(write(wakeup_fd_.get(), &one, sizeof(one))));
+}
+
+void EventLoop::RunPendingTasks() {
+  uint64_t count;
+  ignore_result(HANDLE_EINTR(read(wakeup_fd_.get(), &count, sizeof(count))));
+  // Clear before draining: a post that lands after this wakes us again.
+  wakeup_pending_.exchange(false, std::memory_order_acq_rel);
+
+  while (PendingTask* pending = incoming_.Pop()) {
+    pending->task();
+    delete pending;
+  }
+}
+
+} // namespace base
@@ -0,0 +1,68 @@
+#ifndef BASE_EVENT_LOOP_H_
+#define BASE_EVENT_LOOP_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+
+#include "base/macros.h"
+#include "base/mpsc_queue.h"
+#include "base/scoped_file.h"
+
+namespace base {
+
+// A single-threaded epoll loop.
+//
+// File descriptors are watched from the loop thread. Work from other threads
+// is handed over with PostTask(), which goes through a lock-free MPSC queue;
+// producers only write the eventfd when the loop is not already due to wake
+// up, so a burst of posts costs the loop a single wakeup.
+class EventLoop {
+ public:
+  typedef std::function<void()> Task;
+  typedef std::function<void(uint32_t events)> WatchCallback;
+
+  enum {
+    WATCH_READ  = 1 << 0,
+    WATCH_WRITE = 1 << 1,
+  };
+
+  EventLoop();
+  ~EventLoop();
+
+  // Runs until Quit(). Binds the loop to the calling thread.
+  void Run();
+
+  // Thread-safe.
+  void Quit();
+  void PostTask(Task task);
+  bool RunsTasksOnCurrentThread() const;
+
+  // Loop thread only. |callback| receives a WATCH_* mask.
+  bool Watch(int fd, uint32_t mode, WatchCallback callback);
+  bool Modify(int fd, uint32_t mode);
+  void Unwatch(int fd);
+
+ private:
+  struct PendingTask : public MpscNode {
+    explicit PendingTask(Task t) : task(std::move(t)) {}
+    Task task;
+  };
+
+  void Wakeup();
+  void RunPendingTasks();
+
+  ScopedFD epoll_fd_;
+  ScopedFD wakeup_fd_;
+  MpscQueue<PendingTask> incoming_;
+  std::atomic<bool> wakeup_pending_;
+  std::atomic<bool> quit_;
+  std::atomic<uint64_t> thread_id_;
+  std::unordered_map<int, WatchCallback> watchers_;
+
+  DISALLOW_COPY_AND_ASSIGN(EventLoop);
+};
+
+} // namespace base
+#endif // BASE_EVENT_LOOP_H_
@@ -0,0 +1,48 @@
+#include "base/event_loop_thread.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <glog/logging.h>
+
+namespace base {
+
+EventLoopThread::EventLoopThread(const std::string& name, int cpu)
+  : name_(name),
+    cpu_(cpu) {}
+
+EventLoopThread::~EventLoopThread() {
+  Stop();
+}
+
+void EventLoopThread::Start() {
+  DCHECK(!thread_);
+  thread_.reset(new std::thread(&EventLoopThread::ThreadMain, this));
+}
+
+void EventLoopThread::Stop() {
+  if (!thread_) return;
+  loop_.Quit();
+  thread_->join();
+  thread_.reset();
+}
+
+void EventLoopThread::ThreadMain() {
+  // Thread names are limited to 15 characters plus the terminator.
+  pthread_setname_np(pthread_self(), name_.substr(0, 15).c_str());
+
+  if (cpu_ >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu_, &set);
+    int rv = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rv != 0) {
+      LOG(WARNING) << name_ << ": cannot pin to cpu " << cpu_
+                   << " (error " << rv << ")";
+    }
+  }
+
+  loop_.Run();
+}
+
+} // namespace base
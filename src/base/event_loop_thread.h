@@ -0,0 +1,40 @@
+#ifndef BASE_EVENT_LOOP_THREAD_H_
+#define BASE_EVENT_LOOP_THREAD_H_
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "base/event_loop.h"
+#include "base/macros.h"
+
+namespace base {
+
+// Owns an EventLoop running on its own thread, optionally pinned to a core.
+class EventLoopThread {
+ public:
+  // |cpu| < 0 leaves the thread unpinned.
+  EventLoopThread(const std::string& name, int cpu);
+  ~EventLoopThread();
+
+  void Start();
+  // Quits the loop and joins; pending tasks posted before Stop() still run.
+  void Stop();
+
+  EventLoop* loop() { return &loop_; }
+  int cpu() const { return cpu_; }
+  const std::string& name() const { return name_; }
+
+ private:
+  void ThreadMain();
+
+  std::string name_;
+  int cpu_;
+  EventLoop loop_;
+  std::unique_ptr<std::thread> thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(EventLoopThread);
+};
+
+} // namespace base
+#endif // BASE_EVENT_LOOP_THREAD_H_
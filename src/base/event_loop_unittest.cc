@@ -0,0 +1,84 @@
+#include "base/event_loop.h"
+#include "base/event_loop_thread.h"
+
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+TEST(EventLoopTest, RunsPostedTasksInOrder) {
+  EventLoop loop;
+  std::vector<int> order;
+  for (int i = 0; i < 5; ++i) {
+    loop.PostTask([&order, i]() { order.push_back(i); });
+  }
+  loop.PostTask([&loop]() { loop.Quit(); });
+  loop.Run();
+
+  ASSERT_EQ(5u, order.size());
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(i, order[i]);
+  }
+}
+
+TEST(EventLoopTest, PostFromManyThreads) {
+  const int kThreads = 4;
+  const int kPerThread = 10000;
+
+  EventLoopThread thread("loop-test", -1);
+  thread.Start();
+
+  std::atomic<int> ran(0);
+  std::atomic<bool> on_loop(true);
+  std::vector<std::thread> producers;
+  for (int t = 0; t < kThreads; ++t) {
+    producers.emplace_back([&]() {
+      for (int i = 0; i < kPerThread; ++i) {
+        thread.loop()->PostTask([&]() {
+          if (!thread.loop()->RunsTasksOnCurrentThread())
+            on_loop = false;
+          ran.fetch_add(1);
+        });
+      }
+    });
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  thread.Stop();
+
+  EXPECT_EQ(kThreads * kPerThread, ran.load());
+  EXPECT_TRUE(on_loop.load());
+}
+
+TEST(EventLoopTest, WatchReadable) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+
+  EventLoop loop;
+  char received = 0;
+  loop.PostTask([&]() {
+    loop.Watch(fds[0], EventLoop::WATCH_READ, [&](uint32_t events) {
+      EXPECT_TRUE(events & EventLoop::WATCH_READ);
+      ASSERT_EQ(1, read(fds[0], &received, 1));
+      loop.Unwatch(fds[0]);
+      loop.Quit();
+    });
+    ASSERT_EQ(1, write(fds[1], "x", 1));
+  });
+  loop.Run();
+
+  EXPECT_EQ('x', received);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+} // namespace
+
+} // namespace base
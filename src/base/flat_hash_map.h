@@ -0,0 +1,482 @@
+#ifndef BASE_FLAT_HASH_MAP_H_
+#define BASE_FLAT_HASH_MAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <functional>
+#include <new>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "base/byteorder.h"
+#include "base/hash.h"
+#include "base/string_piece.h"
+
+namespace base {
+
+// Hash and equality used by FlatHashMap by default. Integers are mixed so
+// both ends of the hash carry entropy; std::string keys also accept
+// StringPiece (and so const char*) for lookups that should not allocate.
+template <typename K, typename Enable = void>
+struct FlatHash {
+  size_t operator()(const K& key) const {
+    return HashInt(std::hash<K>()(key));
+  }
+};
+
+template <typename K>
+struct FlatHash<K, typename std::enable_if<std::is_integral<K>::value>::type> {
+  size_t operator()(K key) const {
+    return HashInt(static_cast<uint64_t>(key));
+  }
+};
+
+template <>
+struct FlatHash<std::string> {
+  size_t operator()(const StringPiece& key) const { return HashString(key); }
+};
+
+template <typename K>
+struct FlatEq {
+  bool operator()(const K& a, const K& b) const { return a == b; }
+};
+
+template <>
+struct FlatEq<std::string> {
+  bool operator()(const std::string& a, const StringPiece& b) const {
+    return StringPiece(a) == b;
+  }
+};
+
+namespace flat_hash_internal {
+
+// One control byte per slot: empty, deleted, or the low 7 bits of the hash
+// of the key stored there ("H2"), so a probe rejects almost every
+// non-matching slot without touching it.
+typedef int8_t ctrl_t;
+const ctrl_t kEmpty = -128;   // 0b10000000
+const ctrl_t kDeleted = -2;   // 0b11111110
+
+inline bool IsFull(ctrl_t c) { return c >= 0; }
+
+// The set bits of a group match, lowest slot first.
+template <typename T, int Shift>
+class BitMask {
+ public:
+  explicit BitMask(T mask) : mask_(mask) {}
+  explicit operator bool() const { return mask_ != 0; }
+  int Lowest() const { return __builtin_ctzll(mask_) >> Shift; }
+  int Highest() const {
+    return (63 - __builtin_clzll(static_cast<unsigned long long>(mask_))) >>
+           Shift;
+  }
+  void ClearLowest() { mask_ &= mask_ - 1; }
+
+ private:
+  T mask_;
+};
+
+#if defined(__SSE2__)
+
+// 16 control bytes compared at once.
+struct Group {
+  static const size_t kWidth = 16;
+  typedef BitMask<uint32_t, 0> Mask;
+
+  explicit Group(const ctrl_t* pos)
+    : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos))) {}
+
+  Mask Match(ctrl_t h2) const {
+    return Mask(static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl))));
+  }
+  Mask MatchEmpty() const { return Match(kEmpty); }
+  Mask MatchEmptyOrDeleted() const {
+    // Both have the sign bit set; full slots never do.
+    return Mask(static_cast<uint32_t>(_mm_movemask_epi8(ctrl)));
+  }
+
+  __m128i ctrl;
+};
+
+#else
+
+// Portable fallback: 8 control bytes in a word, compared with bit tricks.
+// Match() may report a false positive right after a true match; callers
+// compare keys anyway.
+struct Group {
+  static const size_t kWidth = 8;
+  typedef BitMask<uint64_t, 3> Mask;
+
+  static const uint64_t kLsbs = 0x0101010101010101ULL;
+  static const uint64_t kMsbs = 0x8080808080808080ULL;
+
+  explicit Group(const ctrl_t* pos) {
+    memcpy(&ctrl, pos, sizeof(ctrl));
+    ctrl = ByteSwapToLE64(ctrl);
+  }
+
+  Mask Match(ctrl_t h2) const {
+    uint64_t x = ctrl ^ (kLsbs * static_cast<uint8_t>(h2));
+    return Mask((x - kLsbs) & ~x & kMsbs);
+  }
+  Mask MatchEmpty() const { return Mask((ctrl & ~(ctrl << 6)) & kMsbs); }
+  Mask MatchEmptyOrDeleted() const { return Mask(ctrl & kMsbs); }
+
+  uint64_t ctrl;
+};
+
+#endif
+
+// Builds a stored key from whatever a lookup was made with.
+template <typename K>
+struct KeyMaker {
+  template <typename L>
+  static K Make(L&& key) { return K(std::forward<L>(key)); }
+};
+
+template <>
+struct KeyMaker<std::string> {
+  static std::string Make(const std::string& key) { return key; }
+  static std::string Make(std::string&& key) { return std::move(key); }
+  static std::string Make(const StringPiece& key) { return key.as_string(); }
+  static std::string Make(const char* key) { return key; }
+};
+
+} // namespace flat_hash_internal
+
+// Open-addressing hash map in the style of SwissTable.
+//
+// Slots live in one flat array next to an array of control bytes. A lookup
+// hashes once, then scans whole groups of control bytes (16 at a time with
+// SSE2) for the 7-bit tag of the hash, so it rarely compares a key that does
+// not match and never chases a pointer. Lookups are templated on the key
+// type: with the default FlatHash/FlatEq, a std::string keyed map can be
+// probed with a StringPiece without building a string.
+//
+// Unlike std::unordered_map, rehashing moves the elements: pointers and
+// iterators are invalidated by any insertion that grows the table. Erasure
+// invalidates only the erased element.
+//
+//   base::FlatHashMap<std::string, Consumer*> consumers;
+//   consumers["ctag-1"] = consumer;
+//   auto it = consumers.find(base::StringPiece(tag_data, tag_size));
+template <typename K,
+          typename V,
+          typename Hash = FlatHash<K>,
+          typename Eq = FlatEq<K>>
+class FlatHashMap {
+ private:
+  typedef flat_hash_internal::ctrl_t ctrl_t;
+  typedef flat_hash_internal::Group Group;
+
+ public:
+  typedef K key_type;
+  typedef V mapped_type;
+  typedef std::pair<const K, V> value_type;
+
+  template <typename Map, typename Value>
+  class Iterator {
+   public:
+    Iterator() : map_(nullptr), index_(0) {}
+    // Lets iterator convert to const_iterator.
+    template <typename M, typename W>
+    Iterator(const Iterator<M, W>& other)
+      : map_(other.map_), index_(other.index_) {}
+
+    Value& operator*() const { return map_->slots_[index_]; }
+    Value* operator->() const { return &map_->slots_[index_]; }
+
+    Iterator& operator++() {
+      ++index_;
+      SkipEmpty();
+      return *this;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return index_ == other.index_;
+    }
+    bool operator!=(const Iterator& other) const {
+      return index_ != other.index_;
+    }
+
+   private:
+    friend class FlatHashMap;
+    template <typename M, typename W> friend class Iterator;
+
+    Iterator(Map* map, size_t index) : map_(map), index_(index) {}
+
+    void SkipEmpty() {
+      while (index_ < map_->capacity_ &&
+             !flat_hash_internal::IsFull(map_->ctrl_[index_])) {
+        ++index_;
+      }
+    }
+
+    Map* map_;
+    size_t index_;
+  };
+
+  typedef Iterator<FlatHashMap, value_type> iterator;
+  typedef Iterator<const FlatHashMap, const value_type> const_iterator;
+
+  FlatHashMap()
+    : ctrl_(nullptr),
+      slots_(nullptr),
+      capacity_(0),
+      size_(0),
+      growth_left_(0) {}
+
+  FlatHashMap(const FlatHashMap& other) : FlatHashMap() {
+    reserve(other.size());
+    for (const value_type& value : other) insert(value);
+  }
+
+  FlatHashMap(FlatHashMap&& other) : FlatHashMap() { swap(other); }
+
+  FlatHashMap& operator=(FlatHashMap other) {
+    swap(other);
+    return *this;
+  }
+
+  ~FlatHashMap() { Destroy(); }
+
+  void swap(FlatHashMap& other) {
+    std::swap(ctrl_, other.ctrl_);
+    std::swap(slots_, other.slots_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(size_, other.size_);
+    std::swap(growth_left_, other.growth_left_);
+    std::swap(hash_, other.hash_);
+    std::swap(eq_, other.eq_);
+  }
+
+  iterator begin() {
+    iterator it(this, 0);
+    if (capacity_) it.SkipEmpty();
+    return it;
+  }
+  iterator end() { return iterator(this, capacity_); }
+  const_iterator begin() const {
+    const_iterator it(this, 0);
+    if (capacity_) it.SkipEmpty();
+    return it;
+  }
+  const_iterator end() const { return const_iterator(this, capacity_); }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t capacity() const { return capacity_; }
+
+  void clear() {
+    for (size_t i = 0; i < capacity_; ++i) {
+      if (flat_hash_internal::IsFull(ctrl_[i])) slots_[i].~value_type();
+    }
+    if (capacity_) ResetCtrl();
+    size_ = 0;
+    growth_left_ = MaxLoad(capacity_);
+  }
+
+  // Makes room for |n| elements without further rehashing.
+  void reserve(size_t n) {
+    if (n <= size_ + growth_left_) return;
+    size_t capacity = Group::kWidth;
+    while (MaxLoad(capacity) < n) capacity *= 2;
+    Rehash(capacity);
+  }
+
+  template <typename L>
+  iterator find(const L& key) {
+    return iterator(this, FindIndex(key));
+  }
+  template <typename L>
+  const_iterator find(const L& key) const {
+    return const_iterator(this, FindIndex(key));
+  }
+  template <typename L>
+  bool contains(const L& key) const {
+    return FindIndex(key) != capacity_;
+  }
+  template <typename L>
+  size_t count(const L& key) const {
+    return contains(key) ? 1 : 0;
+  }
+
+  // Inserts V(args...) under K(key) unless |key| is present. |key| may be
+  // any type the hash and equality accept; K is only constructed from it
+  // when an element is actually added.
+  template <typename L, typename... Args>
+  std::pair<iterator, bool> try_emplace(L&& key, Args&&... args) {
+    size_t hash = hash_(key);
+    size_t index = FindIndex(key, hash);
+    if (index != capacity_) return std::make_pair(iterator(this, index), false);
+    index = PrepareInsert(hash);
+    new (&slots_[index]) value_type(
+        std::piecewise_construct,
+        std::forward_as_tuple(
+            flat_hash_internal::KeyMaker<K>::Make(std::forward<L>(key))),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+    return std::make_pair(iterator(this, index), true);
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) {
+    return try_emplace(value.first, value.second);
+  }
+
+  template <typename L>
+  V& operator[](L&& key) {
+    return try_emplace(std::forward<L>(key)).first->second;
+  }
+
+  template <typename L>
+  size_t erase(const L& key) {
+    size_t index = FindIndex(key);
+    if (index == capacity_) return 0;
+    EraseIndex(index);
+    return 1;
+  }
+
+  void erase(const_iterator it) { EraseIndex(it.index_); }
+
+ private:
+  static size_t MaxLoad(size_t capacity) { return capacity - capacity / 8; }
+
+  static ctrl_t H2(size_t hash) { return static_cast<ctrl_t>(hash & 0x7f); }
+  static size_t H1(size_t hash) { return hash >> 7; }
+
+  template <typename L>
+  size_t FindIndex(const L& key) const {
+    return FindIndex(key, hash_(key));
+  }
+
+  // Returns capacity_ when absent.
+  template <typename L>
+  size_t FindIndex(const L& key, size_t hash) const {
+    if (capacity_ == 0) return capacity_;
+    size_t mask = capacity_ - 1;
+    size_t pos = H1(hash) & mask;
+    ctrl_t h2 = H2(hash);
+    for (size_t step = Group::kWidth;; step += Group::kWidth) {
+      Group group(ctrl_ + pos);
+      for (auto match = group.Match(h2); match; match.ClearLowest()) {
+        size_t index = (pos + match.Lowest()) & mask;
+        if (eq_(slots_[index].first, key)) return index;
+      }
+      if (group.MatchEmpty()) return capacity_;
+      // Triangular probing over groups visits every group once.
+      pos = (pos + step) & mask;
+    }
+  }
+
+  size_t FindFirstNonFull(size_t hash) const {
+    size_t mask = capacity_ - 1;
+    size_t pos = H1(hash) & mask;
+    for (size_t step = Group::kWidth;; step += Group::kWidth) {
+      auto free = Group(ctrl_ + pos).MatchEmptyOrDeleted();
+      if (free) return (pos + free.Lowest()) & mask;
+      pos = (pos + step) & mask;
+    }
+  }
+
+  // Claims a slot for |hash|, growing first if needed. The slot is left
+  // unconstructed.
+  size_t PrepareInsert(size_t hash) {
+    if (capacity_ == 0) Rehash(Group::kWidth);
+    size_t index = FindFirstNonFull(hash);
+    if (growth_left_ == 0 && ctrl_[index] == flat_hash_internal::kEmpty) {
+      // Tombstones count against the load; if they are most of it, a same
+      // size rehash is enough to clear them.
+      Rehash(size_ >= MaxLoad(capacity_) / 2 ? capacity_ * 2 : capacity_);
+      index = FindFirstNonFull(hash);
+    }
+    if (ctrl_[index] == flat_hash_internal::kEmpty) --growth_left_;
+    SetCtrl(index, H2(hash));
+    ++size_;
+    return index;
+  }
+
+  void EraseIndex(size_t index) {
+    slots_[index].~value_type();
+    --size_;
+    // If no kWidth-long run of non-empty slots covers |index|, no probe ever
+    // went past it while looking for a free slot, and it can go straight
+    // back to empty instead of becoming a tombstone.
+    size_t mask = capacity_ - 1;
+    size_t before = (index - Group::kWidth) & mask;
+    auto empty_after = Group(ctrl_ + index).MatchEmpty();
+    auto empty_before = Group(ctrl_ + before).MatchEmpty();
+    if (capacity_ > Group::kWidth && empty_after && empty_before &&
+        (Group::kWidth - 1 - empty_before.Highest()) + empty_after.Lowest() <
+            Group::kWidth) {
+      SetCtrl(index, flat_hash_internal::kEmpty);
+      ++growth_left_;
+    } else {
+      SetCtrl(index, flat_hash_internal::kDeleted);
+    }
+  }
+
+  // The first kWidth control bytes are mirrored after the last slot so a
+  // group load starting anywhere reads valid bytes without wrapping.
+  void SetCtrl(size_t index, ctrl_t value) {
+    ctrl_[index] = value;
+    if (index < Group::kWidth) ctrl_[capacity_ + index] = value;
+  }
+
+  void ResetCtrl() {
+    memset(ctrl_, static_cast<uint8_t>(flat_hash_internal::kEmpty),
+           capacity_ + Group::kWidth);
+  }
+
+  void Rehash(size_t capacity) {
+    ctrl_t* old_ctrl = ctrl_;
+    value_type* old_slots = slots_;
+    size_t old_capacity = capacity_;
+
+    ctrl_ = new ctrl_t[capacity + Group::kWidth];
+    slots_ = static_cast<value_type*>(
+        ::operator new(capacity * sizeof(value_type)));
+    capacity_ = capacity;
+    ResetCtrl();
+    growth_left_ = MaxLoad(capacity) - size_;
+
+    for (size_t i = 0; i < old_capacity; ++i) {
+      if (!flat_hash_internal::IsFull(old_ctrl[i])) continue;
+      size_t hash = hash_(old_slots[i].first);
+      size_t index = FindFirstNonFull(hash);
+      SetCtrl(index, H2(hash));
+      new (&slots_[index]) value_type(std::move(old_slots[i]));
+      old_slots[i].~value_type();
+    }
+    delete[] old_ctrl;
+    ::operator delete(old_slots);
+  }
+
+  void Destroy() {
+    if (capacity_ == 0) return;
+    for (size_t i = 0; i < capacity_; ++i) {
+      if (flat_hash_internal::IsFull(ctrl_[i])) slots_[i].~value_type();
+    }
+    delete[] ctrl_;
+    ::operator delete(slots_);
+  }
+
+  ctrl_t* ctrl_;
+  value_type* slots_;
+  // Zero or a power of two no smaller than Group::kWidth.
+  size_t capacity_;
+  size_t size_;
+  // Insertions into empty slots left before the table must grow.
+  size_t growth_left_;
+  Hash hash_;
+  Eq eq_;
+};
+
+} // namespace base
+#endif // BASE_FLAT_HASH_MAP_H_
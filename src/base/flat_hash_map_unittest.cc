@@ -0,0 +1,131 @@
+#include "base/flat_hash_map.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+TEST(FlatHashMapTest, Empty) {
+  FlatHashMap<int, int> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(0u, map.size());
+  EXPECT_TRUE(map.find(1) == map.end());
+  EXPECT_EQ(0u, map.erase(1));
+  EXPECT_TRUE(map.begin() == map.end());
+}
+
+TEST(FlatHashMapTest, InsertFindErase) {
+  FlatHashMap<uint16_t, int> map;
+  EXPECT_TRUE(map.try_emplace(1, 10).second);
+  EXPECT_FALSE(map.try_emplace(1, 20).second);
+  EXPECT_EQ(10, map.find(1)->second);
+  map[2] = 30;
+  EXPECT_EQ(2u, map.size());
+  EXPECT_EQ(30, map[2]);
+  EXPECT_EQ(1u, map.erase(1));
+  EXPECT_FALSE(map.contains(1));
+  EXPECT_TRUE(map.contains(2));
+  EXPECT_EQ(1u, map.size());
+}
+
+TEST(FlatHashMapTest, StringPieceLookup) {
+  FlatHashMap<std::string, int> map;
+  map["amq.ctag-1"] = 1;
+  map[StringPiece("amq.ctag-2")] = 2;
+
+  const char buffer[] = "xxamq.ctag-1yy";
+  StringPiece tag(buffer + 2, 10);
+  auto it = map.find(tag);
+  ASSERT_TRUE(it != map.end());
+  EXPECT_EQ("amq.ctag-1", it->first);
+  EXPECT_EQ(1, it->second);
+  EXPECT_EQ(2, map.find("amq.ctag-2")->second);
+  EXPECT_EQ(1u, map.erase(tag));
+  EXPECT_EQ(0u, map.count("amq.ctag-1"));
+}
+
+TEST(FlatHashMapTest, IterationVisitsEveryElementOnce) {
+  FlatHashMap<int, int> map;
+  for (int i = 0; i < 1000; ++i) map[i] = i * 2;
+  std::vector<bool> seen(1000, false);
+  size_t count = 0;
+  for (const auto& entry : map) {
+    ASSERT_GE(entry.first, 0);
+    ASSERT_LT(entry.first, 1000);
+    EXPECT_FALSE(seen[entry.first]);
+    EXPECT_EQ(entry.first * 2, entry.second);
+    seen[entry.first] = true;
+    ++count;
+  }
+  EXPECT_EQ(1000u, count);
+}
+
+TEST(FlatHashMapTest, CopyAndMove) {
+  FlatHashMap<std::string, std::unique_ptr<int>> owned;
+  owned["a"].reset(new int(1));
+  FlatHashMap<std::string, std::unique_ptr<int>> moved(std::move(owned));
+  EXPECT_TRUE(owned.empty());
+  EXPECT_EQ(1, *moved["a"]);
+
+  FlatHashMap<std::string, int> map;
+  map["a"] = 1;
+  map["b"] = 2;
+  FlatHashMap<std::string, int> copy(map);
+  map["a"] = 3;
+  EXPECT_EQ(1, copy["a"]);
+  EXPECT_EQ(2u, copy.size());
+  copy = map;
+  EXPECT_EQ(3, copy["a"]);
+}
+
+TEST(FlatHashMapTest, ClearKeepsCapacity) {
+  FlatHashMap<int, std::string> map;
+  map.reserve(100);
+  size_t capacity = map.capacity();
+  for (int i = 0; i < 100; ++i) map[i] = "value";
+  EXPECT_EQ(capacity, map.capacity());
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(capacity, map.capacity());
+  map[5] = "again";
+  EXPECT_EQ("again", map[5]);
+}
+
+// Churn through inserts and erases, including ones that leave tombstones,
+// and compare against std::unordered_map.
+TEST(FlatHashMapTest, MatchesUnorderedMap) {
+  std::mt19937 rng(42);
+  FlatHashMap<uint32_t, uint32_t> map;
+  std::unordered_map<uint32_t, uint32_t> expected;
+  for (int i = 0; i < 200000; ++i) {
+    uint32_t key = rng() % 5000;
+    switch (rng() % 3) {
+      case 0:
+      case 1:
+        map[key] = i;
+        expected[key] = i;
+        break;
+      case 2:
+        EXPECT_EQ(expected.erase(key), map.erase(key));
+        break;
+    }
+  }
+  ASSERT_EQ(expected.size(), map.size());
+  for (const auto& entry : expected) {
+    auto it = map.find(entry.first);
+    ASSERT_TRUE(it != map.end());
+    EXPECT_EQ(entry.second, it->second);
+  }
+  // Deleted slots must not grow the table without bound.
+  EXPECT_LE(map.capacity(), 16384u);
+}
+
+} // namespace
+
+} // namespace base
@@ -0,0 +1,102 @@
+#include "base/frame_pool.h"
+
+#include <new>
+
+#include <glog/logging.h>
+
+namespace base {
+
+namespace {
+
+const size_t kClasses = FramePool::kMaxPooledSize / FramePool::kGranularity;
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+// One per thread; gives its blocks back when the thread exits.
+struct FreeLists {
+  FreeLists() {
+    for (size_t i = 0; i < kClasses; ++i) {
+      heads[i] = nullptr;
+      counts[i] = 0;
+    }
+  }
+  ~FreeLists() { Trim(); }
+
+  void Trim() {
+    for (size_t i = 0; i < kClasses; ++i) {
+      while (FreeBlock* block = heads[i]) {
+        heads[i] = block->next;
+        ::operator delete(block);
+      }
+      counts[i] = 0;
+    }
+  }
+
+  FreeBlock* heads[kClasses];
+  size_t counts[kClasses];
+};
+
+thread_local FreeLists free_lists;
+
+// Size class of a pooled size; class i holds blocks of (i + 1) granules.
+size_t ClassOf(size_t size) {
+  return (size + FramePool::kGranularity - 1) / FramePool::kGranularity - 1;
+}
+
+bool Pooled(size_t size) {
+  return size > 0 && size <= FramePool::kMaxPooledSize;
+}
+
+} // namespace
+
+const size_t FramePool::kGranularity;
+const size_t FramePool::kMaxPooledSize;
+const size_t FramePool::kMaxFreePerClass;
+
+// static
+void* FramePool::Allocate(size_t size) {
+  if (!Pooled(size)) return ::operator new(size);
+  size_t index = ClassOf(size);
+  FreeLists& lists = free_lists;
+  if (FreeBlock* block = lists.heads[index]) {
+    lists.heads[index] = block->next;
+    --lists.counts[index];
+    return block;
+  }
+  return ::operator new((index + 1) * kGranularity);
+}
+
+// static
+void FramePool::Free(void* block, size_t size) {
+  if (block == nullptr) return;
+  if (!Pooled(size)) {
+    ::operator delete(block);
+    return;
+  }
+  size_t index = ClassOf(size);
+  FreeLists& lists = free_lists;
+  if (lists.counts[index] >= kMaxFreePerClass) {
+    ::operator delete(block);
+    return;
+  }
+  FreeBlock* free_block = static_cast<FreeBlock*>(block);
+  free_block->next = lists.heads[index];
+  lists.heads[index] = free_block;
+  ++lists.counts[index];
+}
+
+// static
+size_t FramePool::FreeBlocks() {
+  size_t total = 0;
+  for (size_t i = 0; i < kClasses; ++i) total += free_lists.counts[i];
+  return total;
+}
+
+// static
+void FramePool::Trim() {
+  free_lists.Trim();
+}
+
+} // namespace base
@@ -0,0 +1,39 @@
+#ifndef BASE_FRAME_POOL_H_
+#define BASE_FRAME_POOL_H_
+
+#include <stddef.h>
+
+#include "base/macros.h"
+
+namespace base {
+
+// Recycles short-lived heap blocks, such as coroutine frames, by size class.
+//
+// Sizes are rounded up to kGranularity; blocks up to kMaxPooledSize are kept
+// on per-thread free lists when released, at most kMaxFreePerClass per size,
+// and handed out again without touching malloc. Larger blocks go straight to
+// operator new. Allocate() and Free() need no locking; a block freed on
+// another thread than the one that allocated it simply moves to that
+// thread's list.
+//
+// Free() must be given the size that was passed to Allocate().
+class FramePool {
+ public:
+  static const size_t kGranularity = 64;
+  static const size_t kMaxPooledSize = 4096;
+  static const size_t kMaxFreePerClass = 128;
+
+  static void* Allocate(size_t size);
+  static void Free(void* block, size_t size);
+
+  // Blocks idle on the calling thread's lists.
+  static size_t FreeBlocks();
+  // Releases the calling thread's idle blocks to the system.
+  static void Trim();
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(FramePool);
+};
+
+} // namespace base
+#endif // BASE_FRAME_POOL_H_
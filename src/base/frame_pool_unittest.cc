@@ -0,0 +1,67 @@
+#include "base/frame_pool.h"
+
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+TEST(FramePoolTest, ReusesBlocksOfTheSameClass) {
+  FramePool::Trim();
+  void* block = FramePool::Allocate(200);
+  memset(block, 0xab, 200);
+  FramePool::Free(block, 200);
+  EXPECT_EQ(1u, FramePool::FreeBlocks());
+
+  // 200 and 250 round up to the same four granules.
+  void* again = FramePool::Allocate(250);
+  EXPECT_EQ(block, again);
+  EXPECT_EQ(0u, FramePool::FreeBlocks());
+
+  // A different class does not take it.
+  FramePool::Free(again, 250);
+  void* other = FramePool::Allocate(64);
+  EXPECT_NE(again, other);
+  FramePool::Free(other, 64);
+  EXPECT_EQ(2u, FramePool::FreeBlocks());
+  FramePool::Trim();
+  EXPECT_EQ(0u, FramePool::FreeBlocks());
+}
+
+TEST(FramePoolTest, LargeBlocksAreNotPooled) {
+  FramePool::Trim();
+  void* block = FramePool::Allocate(FramePool::kMaxPooledSize + 1);
+  FramePool::Free(block, FramePool::kMaxPooledSize + 1);
+  EXPECT_EQ(0u, FramePool::FreeBlocks());
+}
+
+TEST(FramePoolTest, FreeListIsBounded) {
+  FramePool::Trim();
+  std::vector<void*> blocks;
+  for (size_t i = 0; i < FramePool::kMaxFreePerClass + 10; ++i)
+    blocks.push_back(FramePool::Allocate(100));
+  for (void* block : blocks) FramePool::Free(block, 100);
+  EXPECT_EQ(FramePool::kMaxFreePerClass, FramePool::FreeBlocks());
+  FramePool::Trim();
+}
+
+TEST(FramePoolTest, FreeOnAnotherThread) {
+  FramePool::Trim();
+  void* block = FramePool::Allocate(128);
+  size_t other_free = 0;
+  std::thread thread([block, &other_free]() {
+    FramePool::Free(block, 128);
+    other_free = FramePool::FreeBlocks();
+  });
+  thread.join();
+  EXPECT_EQ(1u, other_free);
+  EXPECT_EQ(0u, FramePool::FreeBlocks());
+}
+
+} // namespace
+
+} // namespace base
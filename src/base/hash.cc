@@ -0,0 +1,41 @@
+#include "base/hash.h"
+
+#include <string.h>
+
+namespace base {
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed) {
+  const uint64_t m = 0xc6a4a7935bd1e995ULL;
+  const int r = 47;
+
+  uint64_t h = seed ^ (size * m);
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  const unsigned char* end = p + (size & ~static_cast<size_t>(7));
+  for (; p != end; p += 8) {
+    uint64_t k;
+    memcpy(&k, p, sizeof(k));
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    h ^= k;
+    h *= m;
+  }
+
+  switch (size & 7) {
+    case 7: h ^= static_cast<uint64_t>(p[6]) << 48;  // fallthrough
+    case 6: h ^= static_cast<uint64_t>(p[5]) << 40;  // fallthrough
+    case 5: h ^= static_cast<uint64_t>(p[4]) << 32;  // fallthrough
+    case 4: h ^= static_cast<uint64_t>(p[3]) << 24;  // fallthrough
+    case 3: h ^= static_cast<uint64_t>(p[2]) << 16;  // fallthrough
+    case 2: h ^= static_cast<uint64_t>(p[1]) << 8;   // fallthrough
+    case 1: h ^= static_cast<uint64_t>(p[0]);
+            h *= m;
+  }
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  return h;
+}
+
+} // namespace base
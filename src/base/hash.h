@@ -0,0 +1,38 @@
+#ifndef BASE_HASH_H_
+#define BASE_HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "base/string_piece.h"
+
+namespace base {
+
+// Fast non-cryptographic hashes with well-mixed high and low bits, for open
+// addressing tables that take bits from both ends. Not stable across
+// releases; never persist the values.
+
+// MurmurHash64A over |size| bytes.
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+inline uint64_t HashString(const StringPiece& s) {
+  return HashBytes(s.data(), s.size());
+}
+
+// Finalizer of MurmurHash3; a bijection, so distinct ints never collide.
+inline uint64_t HashInt(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+inline uint64_t HashCombine(uint64_t seed, uint64_t value) {
+  return HashInt(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) +
+                         (seed >> 2)));
+}
+
+} // namespace base
+#endif // BASE_HASH_H_
@@ -0,0 +1,133 @@
+#include "base/histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glog/logging.h>
+
+namespace base {
+
+namespace {
+
+const uint64_t kNoMin = std::numeric_limits<uint64_t>::max();
+
+int Log2Floor64(uint64_t n) {
+  return 63 - __builtin_clzll(n);
+}
+
+} // namespace
+
+const int Histogram::kSubBucketBits;
+const uint64_t Histogram::kSubBuckets;
+const size_t Histogram::kBuckets;
+
+Histogram::Snapshot::Snapshot()
+  : count_(0), sum_(0), min_(kNoMin), max_(0), buckets_(kBuckets, 0) {}
+
+double Histogram::Snapshot::Mean() const {
+  return count_ ? static_cast<double>(sum_) / count_ : 0;
+}
+
+uint64_t Histogram::Snapshot::Percentile(double percentile) const {
+  if (count_ == 0) return 0;
+  percentile = std::min(std::max(percentile, 0.0), 100.0);
+  uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100 * count_));
+  rank = std::max<uint64_t>(rank, 1);
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBuckets; ++i) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return std::min(std::max(BucketUpperBound(i), min_), max_);
+    }
+  }
+  // Only reachable if the buckets are ahead of count_ in a racy snapshot.
+  return max_;
+}
+
+void Histogram::Snapshot::Merge(const Snapshot& other) {
+  count_ += other.count_;
+  sum_ += other.sum_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  for (size_t i = 0; i < kBuckets; ++i) buckets_[i] += other.buckets_[i];
+}
+
+Histogram::Snapshot Histogram::Snapshot::Since(const Snapshot& earlier) const {
+  Snapshot delta(*this);
+  delta.count_ -= std::min(delta.count_, earlier.count_);
+  delta.sum_ -= std::min(delta.sum_, earlier.sum_);
+  for (size_t i = 0; i < kBuckets; ++i) {
+    delta.buckets_[i] -= std::min(delta.buckets_[i], earlier.buckets_[i]);
+  }
+  return delta;
+}
+
+Histogram::Histogram() {
+  Reset();
+}
+
+Histogram::~Histogram() {}
+
+// static
+size_t Histogram::BucketFor(uint64_t value) {
+  if (value < kSubBuckets) return static_cast<size_t>(value);
+  int shift = Log2Floor64(value) - kSubBucketBits;
+  // (value >> shift) is in [kSubBuckets, 2 * kSubBuckets).
+  return static_cast<size_t>((shift + 1) * kSubBuckets +
+                             ((value >> shift) - kSubBuckets));
+}
+
+// static
+uint64_t Histogram::BucketLowerBound(size_t bucket) {
+  DCHECK_LT(bucket, kBuckets);
+  if (bucket < kSubBuckets) return bucket;
+  int shift = static_cast<int>(bucket / kSubBuckets) - 1;
+  return (kSubBuckets + bucket % kSubBuckets) << shift;
+}
+
+// static
+uint64_t Histogram::BucketUpperBound(size_t bucket) {
+  if (bucket + 1 == kBuckets) return std::numeric_limits<uint64_t>::max();
+  return BucketLowerBound(bucket + 1) - 1;
+}
+
+void Histogram::Record(uint64_t value) {
+  buckets_[BucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+
+  uint64_t min = min_.load(std::memory_order_relaxed);
+  while (value < min &&
+         !min_.compare_exchange_weak(min, value, std::memory_order_relaxed)) {
+  }
+  uint64_t max = max_.load(std::memory_order_relaxed);
+  while (value > max &&
+         !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+  }
+}
+
+Histogram::Snapshot Histogram::TakeSnapshot() const {
+  Snapshot snapshot;
+  snapshot.count_ = count_.load(std::memory_order_relaxed);
+  snapshot.sum_ = sum_.load(std::memory_order_relaxed);
+  snapshot.min_ = min_.load(std::memory_order_relaxed);
+  snapshot.max_ = max_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < kBuckets; ++i) {
+    snapshot.buckets_[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+void Histogram::Reset() {
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  min_.store(kNoMin, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+  for (size_t i = 0; i < kBuckets; ++i) {
+    buckets_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+} // namespace base
@@ -0,0 +1,92 @@
+#ifndef BASE_HISTOGRAM_H_
+#define BASE_HISTOGRAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#include "base/macros.h"
+
+namespace base {
+
+// A fixed-size log-linear histogram of non-negative integers, typically
+// latencies in microseconds.
+//
+// Every power of two is split into kSubBuckets linear buckets, so a value
+// is placed within 1/kSubBuckets (about 6%) of itself over the whole
+// uint64_t range, with no configuration and no allocation after
+// construction. Values below kSubBuckets are exact.
+//
+// Record() is lock-free (relaxed atomic increments) and may be called from
+// any thread. Readers take a Snapshot(), which is consistent per bucket but
+// not across buckets while writers are active; that is fine for reporting.
+//
+//   base::Histogram commit_latency;
+//   commit_latency.Record((TimeTicks::Now() - start).InMicroseconds());
+//   ...
+//   base::Histogram::Snapshot s = commit_latency.TakeSnapshot();
+//   LOG(INFO) << "p99 " << s.Percentile(99) << "us";
+class Histogram {
+ public:
+  static const int kSubBucketBits = 4;
+  static const uint64_t kSubBuckets = 1 << kSubBucketBits;
+  static const size_t kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  class Snapshot {
+   public:
+    Snapshot();
+
+    uint64_t count() const { return count_; }
+    uint64_t sum() const { return sum_; }
+    // 0 when empty.
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double Mean() const;
+    // |percentile| in [0, 100]. Returns the upper bound of the bucket that
+    // holds it, clamped to [min(), max()]; 0 when empty.
+    uint64_t Percentile(double percentile) const;
+
+    // Per-bucket counts, indexed like BucketFor().
+    const std::vector<uint64_t>& buckets() const { return buckets_; }
+
+    void Merge(const Snapshot& other);
+    // Counts recorded between |earlier| and this snapshot of the same
+    // histogram; min and max stay those of this snapshot.
+    Snapshot Since(const Snapshot& earlier) const;
+
+   private:
+    friend class Histogram;
+
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t min_;
+    uint64_t max_;
+    std::vector<uint64_t> buckets_;
+  };
+
+  Histogram();
+  ~Histogram();
+
+  void Record(uint64_t value);
+  Snapshot TakeSnapshot() const;
+  // Not atomic with respect to concurrent Record()s.
+  void Reset();
+
+  static size_t BucketFor(uint64_t value);
+  // Smallest and largest value that land in |bucket|.
+  static uint64_t BucketLowerBound(size_t bucket);
+  static uint64_t BucketUpperBound(size_t bucket);
+
+ private:
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_;
+  std::atomic<uint64_t> min_;
+  std::atomic<uint64_t> max_;
+  std::atomic<uint64_t> buckets_[kBuckets];
+
+  DISALLOW_COPY_AND_ASSIGN(Histogram);
+};
+
+} // namespace base
+#endif // BASE_HISTOGRAM_H_
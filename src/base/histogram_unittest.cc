@@ -0,0 +1,101 @@
+#include "base/histogram.h"
+
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+TEST(HistogramTest, BucketsCoverTheRangeContiguously) {
+  EXPECT_EQ(0u, Histogram::BucketFor(0));
+  EXPECT_EQ(15u, Histogram::BucketFor(15));
+  EXPECT_EQ(16u, Histogram::BucketFor(16));
+  EXPECT_EQ(Histogram::kBuckets - 1,
+            Histogram::BucketFor(std::numeric_limits<uint64_t>::max()));
+
+  for (size_t i = 0; i + 1 < Histogram::kBuckets; ++i) {
+    uint64_t lower = Histogram::BucketLowerBound(i);
+    uint64_t upper = Histogram::BucketUpperBound(i);
+    ASSERT_LE(lower, upper);
+    ASSERT_EQ(i, Histogram::BucketFor(lower));
+    ASSERT_EQ(i, Histogram::BucketFor(upper));
+    ASSERT_EQ(upper + 1, Histogram::BucketLowerBound(i + 1));
+  }
+}
+
+TEST(HistogramTest, RelativeErrorIsBounded) {
+  for (uint64_t value = 1; value < (1ull << 40); value = value * 3 + 1) {
+    size_t bucket = Histogram::BucketFor(value);
+    uint64_t width = Histogram::BucketUpperBound(bucket) -
+                     Histogram::BucketLowerBound(bucket);
+    EXPECT_LE(width * Histogram::kSubBuckets, value) << value;
+  }
+}
+
+TEST(HistogramTest, Percentiles) {
+  Histogram histogram;
+  EXPECT_EQ(0u, histogram.TakeSnapshot().Percentile(50));
+
+  for (uint64_t i = 1; i <= 1000; ++i) histogram.Record(i);
+  Histogram::Snapshot s = histogram.TakeSnapshot();
+  EXPECT_EQ(1000u, s.count());
+  EXPECT_EQ(500500u, s.sum());
+  EXPECT_EQ(1u, s.min());
+  EXPECT_EQ(1000u, s.max());
+  EXPECT_DOUBLE_EQ(500.5, s.Mean());
+  EXPECT_EQ(1u, s.Percentile(0));
+  EXPECT_EQ(1000u, s.Percentile(100));
+  EXPECT_NEAR(500, s.Percentile(50), 500 / 16);
+  EXPECT_NEAR(990, s.Percentile(99), 990 / 16);
+}
+
+TEST(HistogramTest, MergeAndSince) {
+  Histogram a, b;
+  a.Record(10);
+  b.Record(20);
+  b.Record(30);
+
+  Histogram::Snapshot merged = a.TakeSnapshot();
+  merged.Merge(b.TakeSnapshot());
+  EXPECT_EQ(3u, merged.count());
+  EXPECT_EQ(10u, merged.min());
+  EXPECT_EQ(30u, merged.max());
+
+  Histogram::Snapshot before = b.TakeSnapshot();
+  b.Record(40);
+  Histogram::Snapshot delta = b.TakeSnapshot().Since(before);
+  EXPECT_EQ(1u, delta.count());
+  EXPECT_EQ(40u, delta.sum());
+  EXPECT_EQ(40u, delta.Percentile(50));
+
+  b.Reset();
+  EXPECT_EQ(0u, b.TakeSnapshot().count());
+  EXPECT_EQ(0u, b.TakeSnapshot().min());
+}
+
+TEST(HistogramTest, ConcurrentRecord) {
+  Histogram histogram;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&histogram, t]() {
+      for (int i = 0; i < 10000; ++i) histogram.Record(t * 10000 + i);
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  Histogram::Snapshot s = histogram.TakeSnapshot();
+  EXPECT_EQ(40000u, s.count());
+  EXPECT_EQ(0u, s.min());
+  EXPECT_EQ(39999u, s.max());
+  uint64_t total = 0;
+  for (uint64_t n : s.buckets()) total += n;
+  EXPECT_EQ(40000u, total);
+}
+
+} // namespace
+
+} // namespace base
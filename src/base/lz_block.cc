@@ -0,0 +1,171 @@
+#include "base/lz_block.h"
+
+#include <stdint.h>
+#include <string.h>
+
+namespace base {
+
+namespace {
+
+const size_t kMinMatch = 4;
+// The last literals of a block are never part of a match, and no match
+// starts this close to the end.
+const size_t kLastLiterals = 5;
+const size_t kMatchStartLimit = 12;
+const size_t kMaxOffset = 0xffff;
+const int kHashBits = 12;
+
+uint32_t Load32(const uint8_t* p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+uint32_t Hash(uint32_t v) {
+  return (v * 2654435761u) >> (32 - kHashBits);
+}
+
+// Writes the 255-continued remainder of a length whose nibble was 15.
+uint8_t* PutLength(uint8_t* op, size_t length) {
+  while (length >= 255) {
+    *op++ = 255;
+    length -= 255;
+  }
+  *op++ = static_cast<uint8_t>(length);
+  return op;
+}
+
+uint8_t* PutSequence(uint8_t* op, const uint8_t* literals,
+                     size_t literal_length, size_t offset,
+                     size_t match_length) {
+  uint8_t* token = op++;
+  size_t match_code = match_length - kMinMatch;
+  *token = static_cast<uint8_t>(
+      ((literal_length < 15 ? literal_length : 15) << 4) |
+      (match_code < 15 ? match_code : 15));
+  if (literal_length >= 15) op = PutLength(op, literal_length - 15);
+  memcpy(op, literals, literal_length);
+  op += literal_length;
+  *op++ = static_cast<uint8_t>(offset);
+  *op++ = static_cast<uint8_t>(offset >> 8);
+  if (match_code >= 15) op = PutLength(op, match_code - 15);
+  return op;
+}
+
+uint8_t* PutLastLiterals(uint8_t* op, const uint8_t* literals,
+                         size_t literal_length) {
+  *op++ = static_cast<uint8_t>(
+      (literal_length < 15 ? literal_length : 15) << 4);
+  if (literal_length >= 15) op = PutLength(op, literal_length - 15);
+  memcpy(op, literals, literal_length);
+  return op + literal_length;
+}
+
+// Reads the continuation of a length whose nibble was 15.
+bool GetLength(const uint8_t** ip, const uint8_t* end, size_t* length) {
+  uint8_t byte;
+  do {
+    if (*ip >= end) return false;
+    byte = *(*ip)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+} // namespace
+
+size_t LzCompress(const char* data, size_t size, char* out) {
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(data);
+  uint8_t* op = reinterpret_cast<uint8_t*>(out);
+  size_t anchor = 0;
+
+  if (size > kMatchStartLimit) {
+    // Positions by hash of the four bytes there; stale or colliding
+    // entries are caught by comparing the bytes.
+    uint32_t table[1 << kHashBits];
+    memset(table, 0, sizeof(table));
+
+    const size_t match_limit = size - kLastLiterals;
+    const size_t start_limit = size - kMatchStartLimit;
+    size_t ip = 1;
+    while (ip < start_limit) {
+      uint32_t sequence = Load32(in + ip);
+      uint32_t hash = Hash(sequence);
+      size_t ref = table[hash];
+      table[hash] = static_cast<uint32_t>(ip);
+      if (ip - ref > kMaxOffset || Load32(in + ref) != sequence) {
+        // Step faster through data that does not compress.
+        ip += 1 + ((ip - anchor) >> 6);
+        continue;
+      }
+
+      while (ip > anchor && ref > 0 && in[ip - 1] == in[ref - 1]) {
+        --ip;
+        --ref;
+      }
+      size_t length = kMinMatch;
+      while (ip + length < match_limit && in[ref + length] == in[ip + length])
+        ++length;
+
+      op = PutSequence(op, in + anchor, ip - anchor, ip - ref, length);
+      ip += length;
+      anchor = ip;
+      if (ip < start_limit)
+        table[Hash(Load32(in + ip - 2))] = static_cast<uint32_t>(ip - 2);
+    }
+  }
+
+  op = PutLastLiterals(op, in + anchor, size - anchor);
+  return op - reinterpret_cast<uint8_t*>(out);
+}
+
+bool LzDecompress(const char* data, size_t size, char* out, size_t out_size) {
+  const uint8_t* ip = reinterpret_cast<const uint8_t*>(data);
+  const uint8_t* const in_end = ip + size;
+  uint8_t* const out_start = reinterpret_cast<uint8_t*>(out);
+  uint8_t* op = out_start;
+  uint8_t* const out_end = op + out_size;
+
+  for (;;) {
+    if (ip >= in_end) return false;
+    uint8_t token = *ip++;
+
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !GetLength(&ip, in_end, &literal_length))
+      return false;
+    if (literal_length > static_cast<size_t>(in_end - ip) ||
+        literal_length > static_cast<size_t>(out_end - op)) {
+      return false;
+    }
+    memcpy(op, ip, literal_length);
+    ip += literal_length;
+    op += literal_length;
+
+    // The last sequence has literals only.
+    if (ip == in_end) break;
+
+    if (in_end - ip < 2) return false;
+    size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+    ip += 2;
+    if (offset == 0 || offset > static_cast<size_t>(op - out_start))
+      return false;
+
+    size_t match_length = token & 15;
+    if (match_length == 15 && !GetLength(&ip, in_end, &match_length))
+      return false;
+    match_length += kMinMatch;
+    if (match_length > static_cast<size_t>(out_end - op)) return false;
+
+    const uint8_t* match = op - offset;
+    if (offset >= match_length) {
+      memcpy(op, match, match_length);
+      op += match_length;
+    } else {
+      // Overlapping: a run repeating the last |offset| bytes.
+      for (size_t i = 0; i < match_length; ++i) *op++ = *match++;
+    }
+  }
+  return op == out_end;
+}
+
+} // namespace base
@@ -0,0 +1,31 @@
+#ifndef BASE_LZ_BLOCK_H_
+#define BASE_LZ_BLOCK_H_
+
+#include <stddef.h>
+
+namespace base {
+
+// A fast LZ77 block compressor in the LZ4 mould: greedy matching through a
+// small hash table, byte-aligned sequences of (literal run, 16-bit offset,
+// match length), no entropy coding. It trades ratio for speed; repetitive
+// text such as JSON typically shrinks 3-10x at several hundred MB/s.
+//
+// A block does not record its uncompressed size; callers store it next to
+// the block and hand it back to LzDecompress().
+
+// Upper bound of LzCompress() output for |size| input bytes.
+inline size_t LzMaxCompressedSize(size_t size) {
+  return size + size / 255 + 16;
+}
+
+// Compresses |data| into |out|, which must have room for
+// LzMaxCompressedSize(size) bytes. Returns the compressed size.
+size_t LzCompress(const char* data, size_t size, char* out);
+
+// Decompresses a block into exactly |out_size| bytes at |out|. Returns
+// false if the block is malformed or does not decode to |out_size| bytes;
+// never reads or writes out of bounds.
+bool LzDecompress(const char* data, size_t size, char* out, size_t out_size);
+
+} // namespace base
+#endif // BASE_LZ_BLOCK_H_
@@ -0,0 +1,104 @@
+#include "base/lz_block.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+std::string Compress(const std::string& data) {
+  std::string out(LzMaxCompressedSize(data.size()), '\0');
+  out.resize(LzCompress(data.data(), data.size(), &out[0]));
+  return out;
+}
+
+void ExpectRoundTrip(const std::string& data) {
+  std::string compressed = Compress(data);
+  EXPECT_LE(compressed.size(), LzMaxCompressedSize(data.size()));
+  std::string out(data.size(), '\0');
+  ASSERT_TRUE(LzDecompress(compressed.data(), compressed.size(), &out[0],
+                           out.size()));
+  EXPECT_EQ(data, out);
+}
+
+std::string Json(int records) {
+  std::string json = "[";
+  for (int i = 0; i < records; ++i) {
+    json += "{\"id\":" + std::to_string(i) +
+            ",\"status\":\"active\",\"region\":\"eu-west-1\","
+            "\"tags\":[\"orders\",\"priority\"]},";
+  }
+  json += "]";
+  return json;
+}
+
+std::string Random(size_t size, uint32_t seed) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    seed = seed * 1103515245u + 12345u;
+    data[i] = static_cast<char>(seed >> 24);
+  }
+  return data;
+}
+
+TEST(LzBlockTest, RoundTrips) {
+  ExpectRoundTrip("");
+  ExpectRoundTrip("a");
+  ExpectRoundTrip("hello world");
+  ExpectRoundTrip(std::string(100000, 'x'));
+  ExpectRoundTrip("abcabcabcabcabcabcabcabcabcabcabcabcabc");
+  ExpectRoundTrip(Json(1000));
+  ExpectRoundTrip(Random(70000, 1));
+  // Long literal runs followed by long matches.
+  ExpectRoundTrip(Random(1000, 2) + std::string(5000, 'y') + Random(300, 3));
+}
+
+TEST(LzBlockTest, CompressesRepetitiveText) {
+  std::string json = Json(1000);
+  EXPECT_LT(Compress(json).size() * 5, json.size());
+  EXPECT_LT(Compress(std::string(100000, 'x')).size(), 500u);
+}
+
+TEST(LzBlockTest, IncompressibleDataGrowsLittle) {
+  std::string data = Random(65536, 4);
+  EXPECT_LE(Compress(data).size(), data.size() + data.size() / 255 + 16);
+}
+
+TEST(LzBlockTest, RejectsWrongSize) {
+  std::string data = Json(10);
+  std::string compressed = Compress(data);
+  std::string out(data.size() + 1, '\0');
+  EXPECT_FALSE(LzDecompress(compressed.data(), compressed.size(), &out[0],
+                            data.size() - 1));
+  EXPECT_FALSE(LzDecompress(compressed.data(), compressed.size(), &out[0],
+                            data.size() + 1));
+}
+
+TEST(LzBlockTest, RejectsCorruptInput) {
+  std::string data = Json(50);
+  std::string compressed = Compress(data);
+  std::vector<char> out(data.size());
+  // Truncations and bit flips must fail cleanly or decode to something of
+  // the right size, never run out of bounds.
+  for (size_t cut = 0; cut < compressed.size(); ++cut) {
+    EXPECT_FALSE(LzDecompress(compressed.data(), cut, out.data(),
+                              out.size()));
+  }
+  for (size_t i = 0; i < compressed.size(); ++i) {
+    std::string corrupt = compressed;
+    corrupt[i] ^= 0x5a;
+    LzDecompress(corrupt.data(), corrupt.size(), out.data(), out.size());
+  }
+  EXPECT_FALSE(LzDecompress("", 0, out.data(), out.size()));
+  // An offset reaching before the start of the output.
+  const char bad[] = {0x10, 'a', 0x09, 0x00};
+  EXPECT_FALSE(LzDecompress(bad, sizeof(bad), out.data(), out.size()));
+}
+
+} // namespace
+
+} // namespace base
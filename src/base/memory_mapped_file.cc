@@ -0,0 +1,79 @@
+#include "base/memory_mapped_file.h"
+
+#include <sys/mman.h>
+
+#include <glog/logging.h>
+
+namespace base {
+
+MemoryMappedFile::MemoryMappedFile()
+  : data_(nullptr), length_(0), access_(READ_ONLY) {}
+
+MemoryMappedFile::~MemoryMappedFile() {
+  CloseHandles();
+}
+
+bool MemoryMappedFile::Initialize(const FilePath& path,
+                                  Access access,
+                                  int64_t size) {
+  uint32_t flags = File::FLAG_READ;
+  switch (access) {
+    case READ_ONLY:
+      flags |= File::FLAG_OPEN;
+      break;
+    case READ_WRITE:
+      flags |= File::FLAG_OPEN | File::FLAG_WRITE;
+      break;
+    case READ_WRITE_EXTEND:
+      flags |= File::FLAG_OPEN_ALWAYS | File::FLAG_WRITE;
+      break;
+  }
+  return Initialize(File(path, flags), access, size);
+}
+
+bool MemoryMappedFile::Initialize(File file, Access access, int64_t size) {
+  DCHECK(!IsValid());
+  DCHECK(access != READ_WRITE_EXTEND || size > 0);
+  if (!file.IsValid()) return false;
+
+  int64_t length = file.GetLength();
+  if (length < 0) return false;
+  if (access == READ_WRITE_EXTEND && length < size) {
+    if (!file.SetLength(size)) {
+      PLOG(ERROR) << "ftruncate";
+      return false;
+    }
+    length = size;
+  }
+  // mmap() of an empty file fails; there is nothing to map anyway.
+  if (length == 0) return false;
+
+  int prot = PROT_READ;
+  if (access != READ_ONLY) prot |= PROT_WRITE;
+  void* data = mmap(nullptr, static_cast<size_t>(length), prot, MAP_SHARED,
+                    file.GetPlatformFile(), 0);
+  if (data == MAP_FAILED) {
+    PLOG(ERROR) << "mmap";
+    return false;
+  }
+
+  file_ = std::move(file);
+  data_ = static_cast<uint8_t*>(data);
+  length_ = static_cast<size_t>(length);
+  access_ = access;
+  return true;
+}
+
+bool MemoryMappedFile::Flush() {
+  if (!IsValid() || access_ == READ_ONLY) return IsValid();
+  return msync(data_, length_, MS_SYNC) == 0;
+}
+
+void MemoryMappedFile::CloseHandles() {
+  if (data_) munmap(data_, length_);
+  file_.Close();
+  data_ = nullptr;
+  length_ = 0;
+}
+
+} // namespace base
@@ -0,0 +1,56 @@
+#ifndef BASE_MEMORY_MAPPED_FILE_H_
+#define BASE_MEMORY_MAPPED_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "base/file.h"
+#include "base/file_path.h"
+#include "base/macros.h"
+
+namespace base {
+
+// Maps a whole file into memory with mmap().
+//
+// READ_WRITE maps it shared, so writes through data() reach the file (via
+// the page cache; Flush() forces them to disk). READ_WRITE_EXTEND first
+// grows the file to the requested size, creating it if needed.
+class MemoryMappedFile {
+ public:
+  enum Access {
+    READ_ONLY,
+    READ_WRITE,
+    READ_WRITE_EXTEND,
+  };
+
+  MemoryMappedFile();
+  ~MemoryMappedFile();
+
+  // Opens |path| with the flags |access| needs. |size| is only used, and
+  // required, with READ_WRITE_EXTEND; a larger file is not truncated.
+  bool Initialize(const FilePath& path, Access access = READ_ONLY,
+                  int64_t size = 0);
+  // Takes ownership of |file|, which must be open for the |access| wanted.
+  bool Initialize(File file, Access access = READ_ONLY, int64_t size = 0);
+
+  bool IsValid() const { return data_ != nullptr; }
+  const uint8_t* data() const { return data_; }
+  uint8_t* data() { return data_; }
+  size_t length() const { return length_; }
+
+  // Writes dirty pages back and waits for them (msync MS_SYNC).
+  bool Flush();
+
+ private:
+  void CloseHandles();
+
+  File file_;
+  uint8_t* data_;
+  size_t length_;
+  Access access_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemoryMappedFile);
+};
+
+} // namespace base
+#endif // BASE_MEMORY_MAPPED_FILE_H_
@@ -0,0 +1,71 @@
+#include "base/memory_mapped_file.h"
+
+#include <string.h>
+#include <string>
+
+#include "base/file_util.h"
+#include "base/scoped_temp_dir.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+TEST(MemoryMappedFileTest, MapsExistingFileReadOnly) {
+  ScopedTempDir dir;
+  ASSERT_TRUE(dir.CreateUniqueTempDir());
+  FilePath path = dir.path().AppendASCII("data");
+  const std::string contents = "mapped contents";
+  ASSERT_EQ(static_cast<int>(contents.size()),
+            WriteFile(path, contents.data(), contents.size()));
+
+  MemoryMappedFile map;
+  ASSERT_TRUE(map.Initialize(path));
+  ASSERT_EQ(contents.size(), map.length());
+  EXPECT_EQ(contents, std::string(reinterpret_cast<const char*>(map.data()),
+                                  map.length()));
+}
+
+TEST(MemoryMappedFileTest, MissingOrEmptyFileFails) {
+  ScopedTempDir dir;
+  ASSERT_TRUE(dir.CreateUniqueTempDir());
+  MemoryMappedFile missing;
+  EXPECT_FALSE(missing.Initialize(dir.path().AppendASCII("missing")));
+  EXPECT_FALSE(missing.IsValid());
+
+  FilePath empty = dir.path().AppendASCII("empty");
+  ASSERT_EQ(0, WriteFile(empty, "", 0));
+  MemoryMappedFile map;
+  EXPECT_FALSE(map.Initialize(empty));
+}
+
+TEST(MemoryMappedFileTest, ExtendCreatesAndWritesThrough) {
+  ScopedTempDir dir;
+  ASSERT_TRUE(dir.CreateUniqueTempDir());
+  FilePath path = dir.path().AppendASCII("ring");
+
+  {
+    MemoryMappedFile map;
+    ASSERT_TRUE(map.Initialize(path, MemoryMappedFile::READ_WRITE_EXTEND,
+                               4096));
+    ASSERT_EQ(4096u, map.length());
+    EXPECT_EQ(0, map.data()[4095]);
+    memcpy(map.data() + 100, "hello", 5);
+    EXPECT_TRUE(map.Flush());
+  }
+
+  int64_t size = 0;
+  ASSERT_TRUE(GetFileSize(path, &size));
+  EXPECT_EQ(4096, size);
+
+  // Reopening does not shrink or clear it.
+  MemoryMappedFile map;
+  ASSERT_TRUE(map.Initialize(path, MemoryMappedFile::READ_WRITE_EXTEND, 16));
+  ASSERT_EQ(4096u, map.length());
+  EXPECT_EQ(0, memcmp(map.data() + 100, "hello", 5));
+}
+
+} // namespace
+
+} // namespace base
@@ -0,0 +1,95 @@
+#ifndef BASE_MPSC_QUEUE_H_
+#define BASE_MPSC_QUEUE_H_
+
+#include <atomic>
+
+#include "base/macros.h"
+
+namespace base {
+
+// Intrusive node for MpscQueue. Embed it (by inheritance) in the element type.
+class MpscNode {
+ public:
+  MpscNode() : mpsc_next_(nullptr) {}
+
+ private:
+  template <typename T> friend class MpscQueue;
+  std::atomic<MpscNode*> mpsc_next_;
+};
+
+// Lock-free multi-producer / single-consumer intrusive queue (Vyukov).
+//
+// Push() may be called from any thread and never blocks; it is a single
+// atomic exchange. Pop() must only be called from the owning (consumer)
+// thread. The queue does not own its elements.
+//
+// Pop() may transiently return nullptr while a producer is between its
+// exchange and its link store; callers pair the queue with a wakeup so the
+// consumer will look again once the producer is done.
+//
+//   class Task : public base::MpscNode { ... };
+//   base::MpscQueue<Task> queue;
+//   queue.Push(task);             // producers
+//   while (Task* t = queue.Pop()) // consumer
+//     ...
+template <typename T>
+class MpscQueue {
+ public:
+  MpscQueue() : head_(&stub_), tail_(&stub_) {}
+  ~MpscQueue() {}
+
+  void Push(T* element) {
+    PushNode(element);
+  }
+
+  T* Pop() {
+    MpscNode* tail = tail_;
+    MpscNode* next = tail->mpsc_next_.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (next == nullptr) return nullptr;
+      tail_ = next;
+      tail = next;
+      next = next->mpsc_next_.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+      tail_ = next;
+      return static_cast<T*>(tail);
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+      // A producer is mid-push.
+      return nullptr;
+    }
+    PushNode(&stub_);
+    next = tail->mpsc_next_.load(std::memory_order_acquire);
+    if (next != nullptr) {
+      tail_ = next;
+      return static_cast<T*>(tail);
+    }
+    return nullptr;
+  }
+
+  // Consumer-side only.
+  bool Empty() const {
+    return tail_ == &stub_ &&
+           stub_.mpsc_next_.load(std::memory_order_acquire) == nullptr;
+  }
+
+ private:
+  void PushNode(MpscNode* node) {
+    node->mpsc_next_.store(nullptr, std::memory_order_relaxed);
+    MpscNode* prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->mpsc_next_.store(node, std::memory_order_release);
+  }
+
+  // Producers and the consumer touch different ends; keep them on separate
+  // cache lines.
+  std::atomic<MpscNode*> head_;
+  char padding_[64 - sizeof(std::atomic<MpscNode*>)];
+  MpscNode* tail_;
+  MpscNode stub_;
+
+  DISALLOW_COPY_AND_ASSIGN(MpscQueue);
+};
+
+} // namespace base
+#endif // BASE_MPSC_QUEUE_H_
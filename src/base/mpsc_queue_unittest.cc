@@ -0,0 +1,85 @@
+#include "base/mpsc_queue.h"
+
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+struct Item : public MpscNode {
+  Item(int p, int s) : producer(p), sequence(s) {}
+  int producer;
+  int sequence;
+};
+
+TEST(MpscQueueTest, EmptyQueue) {
+  MpscQueue<Item> queue;
+  EXPECT_TRUE(queue.Empty());
+  EXPECT_EQ(nullptr, queue.Pop());
+}
+
+TEST(MpscQueueTest, FifoSingleProducer) {
+  MpscQueue<Item> queue;
+  Item a(0, 0), b(0, 1), c(0, 2);
+  queue.Push(&a);
+  queue.Push(&b);
+  EXPECT_FALSE(queue.Empty());
+  EXPECT_EQ(&a, queue.Pop());
+  queue.Push(&c);
+  EXPECT_EQ(&b, queue.Pop());
+  EXPECT_EQ(&c, queue.Pop());
+  EXPECT_EQ(nullptr, queue.Pop());
+  EXPECT_TRUE(queue.Empty());
+
+  // Elements can be pushed again once popped.
+  queue.Push(&a);
+  EXPECT_EQ(&a, queue.Pop());
+}
+
+TEST(MpscQueueTest, ManyProducersKeepPerProducerOrder) {
+  const int kProducers = 8;
+  const int kPerProducer = 20000;
+
+  MpscQueue<Item> queue;
+  std::vector<std::deque<Item>> items(kProducers);
+  for (int p = 0; p < kProducers; ++p) {
+    for (int i = 0; i < kPerProducer; ++i) {
+      items[p].emplace_back(p, i);
+    }
+  }
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&queue, &items, p]() {
+      for (Item& item : items[p]) {
+        queue.Push(&item);
+      }
+    });
+  }
+
+  std::vector<int> next(kProducers, 0);
+  int received = 0;
+  while (received < kProducers * kPerProducer) {
+    Item* item = queue.Pop();
+    if (item == nullptr) {
+      std::this_thread::yield();
+      continue;
+    }
+    EXPECT_EQ(next[item->producer], item->sequence);
+    next[item->producer] = item->sequence + 1;
+    ++received;
+  }
+
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  EXPECT_EQ(nullptr, queue.Pop());
+}
+
+} // namespace
+
+} // namespace base
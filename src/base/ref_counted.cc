@@ -12,15 +12,4 @@ RefCountedThreadSafeBase::RefCountedThreadSafeBase()
 
 RefCountedThreadSafeBase::~RefCountedThreadSafeBase() {}
 
-void RefCountedThreadSafeBase::AddRef() const {
-  AtomicRefCountInc(&ref_count_);
-}
-
-bool RefCountedThreadSafeBase::Release() const {
-  if (!AtomicRefCountDec(&ref_count_)) {
-    return true;
-  }
-  return false;
-}
-
 } // namespace base
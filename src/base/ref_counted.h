@@ -45,8 +45,14 @@ class RefCountedThreadSafeBase {
  protected:
   RefCountedThreadSafeBase();
   ~RefCountedThreadSafeBase();
-  void AddRef() const;
-  bool Release() const;
+  // Inline: copying a reference to shared data on a hot path should cost
+  // one atomic instruction, not a call.
+  void AddRef() const {
+    AtomicRefCountInc(&ref_count_);
+  }
+  bool Release() const {
+    return !AtomicRefCountDec(&ref_count_);
+  }
 
  private:
   mutable AtomicRefCount ref_count_;
@@ -72,7 +78,7 @@ class RefCounted : public RefCountedBase {
  protected:
   ~RefCounted() {}
  private:
-  DISALLOW_COPY_AND_ASSIGN(RefCounted<T>);
+  DISALLOW_COPY_AND_ASSIGN(RefCounted);
 };
 
 template<typename T, typename Traits>
@@ -0,0 +1,66 @@
+#include "base/sharded_counter.h"
+
+#include <new>
+
+namespace base {
+
+namespace {
+
+const size_t kCacheLineSize = 64;
+const size_t kPerLine = kCacheLineSize / sizeof(std::atomic<int64_t>);
+const size_t kNoShard = static_cast<size_t>(-1);
+
+std::atomic<size_t> g_next_shard(0);
+thread_local size_t t_shard = kNoShard;
+
+} // namespace
+
+const size_t ShardedCounters::kShards;
+
+ShardedCounters::ShardedCounters(size_t count)
+  : count_(count),
+    stride_((count + kPerLine - 1) / kPerLine * kPerLine),
+    storage_(new char[kShards * stride_ * sizeof(std::atomic<int64_t>) +
+                      kCacheLineSize]) {
+  uintptr_t address = reinterpret_cast<uintptr_t>(storage_.get());
+  address = (address + kCacheLineSize - 1) & ~(kCacheLineSize - 1);
+  shards_ = reinterpret_cast<std::atomic<int64_t>*>(address);
+  for (size_t i = 0; i < kShards * stride_; ++i) {
+    new (&shards_[i]) std::atomic<int64_t>(0);
+  }
+}
+
+ShardedCounters::~ShardedCounters() {}
+
+// static
+size_t ShardedCounters::CurrentShard() {
+  if (t_shard == kNoShard) {
+    t_shard = g_next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+  }
+  return t_shard;
+}
+
+int64_t ShardedCounters::Sum(size_t index) const {
+  int64_t sum = 0;
+  for (size_t shard = 0; shard < kShards; ++shard) {
+    sum += Slot(shard, index).load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+void ShardedCounters::SumAll(std::vector<int64_t>* values) const {
+  values->assign(count_, 0);
+  for (size_t shard = 0; shard < kShards; ++shard) {
+    for (size_t index = 0; index < count_; ++index) {
+      (*values)[index] += Slot(shard, index).load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void ShardedCounters::Reset() {
+  for (size_t i = 0; i < kShards * stride_; ++i) {
+    shards_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+} // namespace base
@@ -0,0 +1,66 @@
+#ifndef BASE_SHARDED_COUNTER_H_
+#define BASE_SHARDED_COUNTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "base/macros.h"
+
+namespace base {
+
+// A fixed set of int64_t counters that many threads bump at once.
+//
+// Every thread is assigned one of kShards shards, and each shard holds its
+// own copy of all the counters on cache lines of its own, so Add() is a
+// relaxed fetch_add on a line that other threads rarely touch. Reads sum
+// the shards; they are meant for metrics, not for synchronization, and may
+// miss adds that are in flight.
+//
+// Counters can go down as well, so a gauge (a queue depth, say) is a
+// counter that is added to and subtracted from.
+//
+//   enum { SENT, RECEIVED, kCount };
+//   base::ShardedCounters counters(kCount);
+//   counters.Add(SENT);            // any thread
+//   int64_t sent = counters.Sum(SENT);
+class ShardedCounters {
+ public:
+  static const size_t kShards = 16;
+
+  explicit ShardedCounters(size_t count);
+  ~ShardedCounters();
+
+  size_t count() const { return count_; }
+
+  void Add(size_t index, int64_t delta = 1) {
+    Slot(CurrentShard(), index).fetch_add(delta, std::memory_order_relaxed);
+  }
+
+  int64_t Sum(size_t index) const;
+  // All counters; |values| is resized to count().
+  void SumAll(std::vector<int64_t>* values) const;
+  // Not atomic with respect to concurrent Add()s.
+  void Reset();
+
+ private:
+  static size_t CurrentShard();
+
+  std::atomic<int64_t>& Slot(size_t shard, size_t index) const {
+    return shards_[shard * stride_ + index];
+  }
+
+  const size_t count_;
+  // Counters per shard, rounded up to whole cache lines.
+  const size_t stride_;
+  std::unique_ptr<char[]> storage_;
+  // Cache-line aligned, inside storage_.
+  std::atomic<int64_t>* shards_;
+
+  DISALLOW_COPY_AND_ASSIGN(ShardedCounters);
+};
+
+} // namespace base
+#endif // BASE_SHARDED_COUNTER_H_
@@ -0,0 +1,53 @@
+#include "base/sharded_counter.h"
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+TEST(ShardedCountersTest, AddSumReset) {
+  ShardedCounters counters(3);
+  EXPECT_EQ(3u, counters.count());
+  EXPECT_EQ(0, counters.Sum(0));
+
+  counters.Add(0);
+  counters.Add(1, 5);
+  counters.Add(1, -2);
+  EXPECT_EQ(1, counters.Sum(0));
+  EXPECT_EQ(3, counters.Sum(1));
+  EXPECT_EQ(0, counters.Sum(2));
+
+  std::vector<int64_t> values;
+  counters.SumAll(&values);
+  EXPECT_EQ((std::vector<int64_t>{1, 3, 0}), values);
+
+  counters.Reset();
+  EXPECT_EQ(0, counters.Sum(1));
+}
+
+TEST(ShardedCountersTest, ConcurrentAdds) {
+  // More counters than fit on a cache line.
+  ShardedCounters counters(11);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&counters]() {
+      for (int i = 0; i < 100000; ++i) {
+        counters.Add(0);
+        counters.Add(10, 2);
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  EXPECT_EQ(800000, counters.Sum(0));
+  EXPECT_EQ(1600000, counters.Sum(10));
+  for (size_t i = 1; i < 10; ++i) EXPECT_EQ(0, counters.Sum(i));
+}
+
+} // namespace
+
+} // namespace base
@@ -0,0 +1,191 @@
+#ifndef BASE_SMALL_FUNCTION_H_
+#define BASE_SMALL_FUNCTION_H_
+
+#include <stddef.h>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "base/macros.h"
+
+#include <glog/logging.h>
+
+namespace base {
+
+namespace internal {
+
+// Empty std::functions and null function pointers are stored as "no
+// function" rather than as a callable that fails when run.
+template <typename F>
+bool IsNullCallable(const F&) { return false; }
+template <typename Signature>
+bool IsNullCallable(const std::function<Signature>& f) { return !f; }
+template <typename R, typename... Args>
+bool IsNullCallable(R (*f)(Args...)) { return f == nullptr; }
+
+} // namespace internal
+
+template <typename Signature, size_t kInlineSize = 4 * sizeof(void*)>
+class SmallFunction;
+
+// A move-only std::function that keeps callables of up to kInlineSize bytes
+// inside the object. The default is sized for a std::function, so callers
+// holding one of the usual callback typedefs can hand it over without a
+// further allocation, and for lambdas capturing a few pointers. Larger or
+// throwing-move callables go to the heap as with std::function.
+//
+//   base::SmallFunction<void(int)> f = [this](int v) { Handle(v); };
+//   if (f) f(42);
+template <typename R, typename... Args, size_t kInlineSize>
+class SmallFunction<R(Args...), kInlineSize> {
+ public:
+  SmallFunction() : ops_(nullptr) {}
+  SmallFunction(std::nullptr_t) : ops_(nullptr) {}
+
+  template <typename F,
+            typename = typename std::enable_if<!std::is_same<
+                typename std::decay<F>::type, SmallFunction>::value>::type>
+  SmallFunction(F&& f) : ops_(nullptr) {
+    Init(std::forward<F>(f));
+  }
+
+  SmallFunction(SmallFunction&& other) : ops_(nullptr) {
+    MoveFrom(other);
+  }
+
+  SmallFunction& operator=(SmallFunction&& other) {
+    if (this != &other) {
+      Reset();
+      MoveFrom(other);
+    }
+    return *this;
+  }
+
+  SmallFunction& operator=(std::nullptr_t) {
+    Reset();
+    return *this;
+  }
+
+  ~SmallFunction() { Reset(); }
+
+  explicit operator bool() const { return ops_ != nullptr; }
+  // False for an empty function too.
+  bool is_inline() const { return ops_ != nullptr && ops_->is_inline; }
+
+  R operator()(Args... args) const {
+    DCHECK(ops_) << "empty SmallFunction called";
+    return ops_->invoke(storage(), std::forward<Args>(args)...);
+  }
+
+  void Reset() {
+    if (ops_ == nullptr) return;
+    ops_->destroy(storage());
+    ops_ = nullptr;
+  }
+
+ private:
+  typedef typename std::aligned_storage<
+      kInlineSize, alignof(std::max_align_t)>::type Storage;
+
+  struct Ops {
+    R (*invoke)(void* storage, Args&&... args);
+    // Move-constructs |to| from |from| and destroys |from|.
+    void (*relocate)(void* from, void* to);
+    void (*destroy)(void* storage);
+    bool is_inline;
+  };
+
+  template <typename F>
+  struct InlineOps {
+    static R Invoke(void* storage, Args&&... args) {
+      return (*static_cast<F*>(storage))(std::forward<Args>(args)...);
+    }
+    static void Relocate(void* from, void* to) {
+      F* source = static_cast<F*>(from);
+      new (to) F(std::move(*source));
+      source->~F();
+    }
+    static void Destroy(void* storage) {
+      static_cast<F*>(storage)->~F();
+    }
+    static const Ops ops;
+  };
+
+  template <typename F>
+  struct HeapOps {
+    static F*& Get(void* storage) { return *static_cast<F**>(storage); }
+    static R Invoke(void* storage, Args&&... args) {
+      return (*Get(storage))(std::forward<Args>(args)...);
+    }
+    static void Relocate(void* from, void* to) {
+      new (to) F*(Get(from));
+    }
+    static void Destroy(void* storage) { delete Get(storage); }
+    static const Ops ops;
+  };
+
+  template <typename F>
+  struct FitsInline {
+    static const bool value =
+        sizeof(F) <= sizeof(Storage) &&
+        alignof(F) <= alignof(Storage) &&
+        std::is_nothrow_move_constructible<F>::value;
+  };
+
+  template <typename F>
+  void Init(F&& f) {
+    typedef typename std::decay<F>::type Callable;
+    if (internal::IsNullCallable(f)) return;
+    Store(std::forward<F>(f),
+          std::integral_constant<bool, FitsInline<Callable>::value>());
+  }
+
+  template <typename F>
+  void Store(F&& f, std::true_type /* inline */) {
+    typedef typename std::decay<F>::type Callable;
+    new (storage()) Callable(std::forward<F>(f));
+    ops_ = &InlineOps<Callable>::ops;
+  }
+
+  template <typename F>
+  void Store(F&& f, std::false_type /* inline */) {
+    typedef typename std::decay<F>::type Callable;
+    new (storage()) Callable*(new Callable(std::forward<F>(f)));
+    ops_ = &HeapOps<Callable>::ops;
+  }
+
+  void MoveFrom(SmallFunction& other) {
+    if (other.ops_ == nullptr) return;
+    other.ops_->relocate(other.storage(), storage());
+    ops_ = other.ops_;
+    other.ops_ = nullptr;
+  }
+
+  void* storage() const { return const_cast<Storage*>(&storage_); }
+
+  const Ops* ops_;
+  Storage storage_;
+
+  DISALLOW_COPY_AND_ASSIGN(SmallFunction);
+};
+
+template <typename R, typename... Args, size_t kInlineSize>
+template <typename F>
+const typename SmallFunction<R(Args...), kInlineSize>::Ops
+    SmallFunction<R(Args...), kInlineSize>::InlineOps<F>::ops = {
+  &InlineOps<F>::Invoke, &InlineOps<F>::Relocate, &InlineOps<F>::Destroy,
+  true,
+};
+
+template <typename R, typename... Args, size_t kInlineSize>
+template <typename F>
+const typename SmallFunction<R(Args...), kInlineSize>::Ops
+    SmallFunction<R(Args...), kInlineSize>::HeapOps<F>::ops = {
+  &HeapOps<F>::Invoke, &HeapOps<F>::Relocate, &HeapOps<F>::Destroy,
+  false,
+};
+
+} // namespace base
+#endif // BASE_SMALL_FUNCTION_H_
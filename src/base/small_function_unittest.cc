@@ -0,0 +1,93 @@
+#include "base/small_function.h"
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+int Triple(int v) { return 3 * v; }
+
+struct MoveOnly {
+  explicit MoveOnly(int v) : value(new int(v)) {}
+  int operator()() const { return *value; }
+  std::unique_ptr<int> value;
+};
+
+TEST(SmallFunctionTest, EmptyAndNull) {
+  SmallFunction<void()> empty;
+  EXPECT_FALSE(empty);
+  EXPECT_FALSE(empty.is_inline());
+
+  std::function<void()> null_function;
+  SmallFunction<void()> from_null(null_function);
+  EXPECT_FALSE(from_null);
+
+  int (*null_pointer)(int) = nullptr;
+  SmallFunction<int(int)> from_pointer(null_pointer);
+  EXPECT_FALSE(from_pointer);
+}
+
+TEST(SmallFunctionTest, SmallCallablesAreInline) {
+  int calls = 0;
+  SmallFunction<void(int)> f = [&calls](int v) { calls += v; };
+  EXPECT_TRUE(f.is_inline());
+  f(2);
+  f(3);
+  EXPECT_EQ(5, calls);
+
+  SmallFunction<int(int)> pointer(&Triple);
+  EXPECT_TRUE(pointer.is_inline());
+  EXPECT_EQ(9, pointer(3));
+
+  // The usual callback typedefs fit as they are.
+  std::function<int(int)> function = [](int v) { return v + 1; };
+  SmallFunction<int(int)> wrapped(function);
+  EXPECT_TRUE(wrapped.is_inline());
+  EXPECT_EQ(2, wrapped(1));
+}
+
+TEST(SmallFunctionTest, LargeCallablesGoToTheHeap) {
+  char big[128] = "large";
+  SmallFunction<std::string()> f = [big]() { return std::string(big); };
+  EXPECT_FALSE(f.is_inline());
+  EXPECT_EQ("large", f());
+}
+
+TEST(SmallFunctionTest, MoveOnlyCallablesAndMoves) {
+  SmallFunction<int()> f = MoveOnly(7);
+  EXPECT_TRUE(f.is_inline());
+  ASSERT_TRUE(f);
+
+  SmallFunction<int()> moved(std::move(f));
+  EXPECT_FALSE(f);
+  EXPECT_EQ(7, moved());
+
+  SmallFunction<int()> assigned;
+  assigned = std::move(moved);
+  EXPECT_FALSE(moved);
+  EXPECT_EQ(7, assigned());
+
+  assigned = nullptr;
+  EXPECT_FALSE(assigned);
+}
+
+TEST(SmallFunctionTest, DestroysItsCallable) {
+  std::shared_ptr<int> shared = std::make_shared<int>(1);
+  {
+    SmallFunction<void()> inline_f = [shared]() {};
+    char big[100] = {};
+    SmallFunction<void()> heap_f = [shared, big]() { (void)big; };
+    EXPECT_EQ(3, shared.use_count());
+    SmallFunction<void()> moved(std::move(heap_f));
+    EXPECT_EQ(3, shared.use_count());
+  }
+  EXPECT_EQ(1, shared.use_count());
+}
+
+} // namespace
+
+} // namespace base
@@ -4,6 +4,7 @@
 #include <ctime>
 #include <iosfwd>
 #include <limits>
+#include <string>
 #include <stdint.h>
 #include "base/macros.h"
 
@@ -0,0 +1,123 @@
+#include "base/timer_wheel.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace base {
+
+const uint32_t TimerWheel::kNil;
+
+TimerWheel::TimerWheel(TimeDelta tick, size_t slots, TimeTicks now)
+  : tick_us_(std::max<int64_t>(1, tick.InMicroseconds())),
+    origin_us_(now.ToInternalValue()),
+    current_(0),
+    slots_(std::max<size_t>(1, slots), kNil),
+    size_(0) {}
+
+TimerWheel::~TimerWheel() {}
+
+int64_t TimerWheel::TickOf(TimeTicks time) const {
+  int64_t us = time.ToInternalValue() - origin_us_;
+  if (us <= 0) return 0;
+  // Round up: never fire before the deadline.
+  return (us + tick_us_ - 1) / tick_us_;
+}
+
+TimerWheel::TimerId TimerWheel::Schedule(TimeTicks deadline, Task task) {
+  uint32_t index;
+  if (!free_.empty()) {
+    index = free_.back();
+    free_.pop_back();
+  } else {
+    index = static_cast<uint32_t>(nodes_.size());
+    CHECK_LT(index, kNil);
+    nodes_.push_back(Node());
+  }
+
+  Node& node = nodes_[index];
+  node.tick = std::max(TickOf(deadline), current_ + 1);
+  node.task = std::move(task);
+  Link(index);
+  ++size_;
+  return (static_cast<uint64_t>(node.generation) << 32) | (index + 1);
+}
+
+bool TimerWheel::Cancel(TimerId id) {
+  uint32_t index = static_cast<uint32_t>(id) - 1;
+  if (id == 0 || index >= nodes_.size()) return false;
+  Node& node = nodes_[index];
+  if (!node.linked || node.generation != static_cast<uint32_t>(id >> 32))
+    return false;
+  Unlink(index);
+  Free(index);
+  return true;
+}
+
+size_t TimerWheel::Advance(TimeTicks now) {
+  // Only whole ticks that have passed count.
+  int64_t target = (now.ToInternalValue() - origin_us_) / tick_us_;
+  if (target <= current_) return 0;
+
+  // Past a full lap every slot is visited once.
+  int64_t steps = std::min<int64_t>(target - current_, slots_.size());
+  std::vector<Task> due;
+  for (int64_t i = 1; i <= steps; ++i) {
+    uint32_t index = slots_[(current_ + i) % slots_.size()];
+    while (index != kNil) {
+      uint32_t next = nodes_[index].next;
+      if (nodes_[index].tick <= target) {
+        Unlink(index);
+        due.push_back(std::move(nodes_[index].task));
+        Free(index);
+      }
+      index = next;
+    }
+  }
+  current_ = target;
+
+  for (Task& task : due) task();
+  return due.size();
+}
+
+TimeTicks TimerWheel::NextDeadline() const {
+  for (size_t i = 1; size_ > 0 && i <= slots_.size(); ++i) {
+    if (slots_[(current_ + i) % slots_.size()] != kNil) {
+      return TimeTicks::FromInternalValue(origin_us_ +
+                                          (current_ + i) * tick_us_);
+    }
+  }
+  return TimeTicks();
+}
+
+void TimerWheel::Link(uint32_t index) {
+  Node& node = nodes_[index];
+  uint32_t& head = slots_[node.tick % slots_.size()];
+  node.prev = kNil;
+  node.next = head;
+  if (head != kNil) nodes_[head].prev = index;
+  head = index;
+  node.linked = true;
+}
+
+void TimerWheel::Unlink(uint32_t index) {
+  Node& node = nodes_[index];
+  if (node.prev != kNil) {
+    nodes_[node.prev].next = node.next;
+  } else {
+    slots_[node.tick % slots_.size()] = node.next;
+  }
+  if (node.next != kNil) nodes_[node.next].prev = node.prev;
+  node.prev = node.next = kNil;
+  node.linked = false;
+}
+
+void TimerWheel::Free(uint32_t index) {
+  Node& node = nodes_[index];
+  node.task = Task();
+  ++node.generation;
+  free_.push_back(index);
+  --size_;
+}
+
+} // namespace base
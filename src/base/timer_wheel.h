@@ -0,0 +1,80 @@
+#ifndef BASE_TIMER_WHEEL_H_
+#define BASE_TIMER_WHEEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/time.h"
+
+namespace base {
+
+// Hashed timing wheel for large numbers of short timeouts that are usually
+// cancelled before they fire, such as per-request deadlines.
+//
+// Time is cut into ticks; a timer goes into slot (deadline tick % slots).
+// Schedule() and Cancel() are O(1) and allocate nothing once the node pool
+// has grown; Advance() visits only the slots of the ticks that passed.
+// Deadlines are rounded up to a tick, so a timer never fires early and at
+// most one tick late (plus however late Advance() is called).
+//
+// Not thread-safe: one wheel per event loop, driven from the loop.
+class TimerWheel {
+ public:
+  typedef std::function<void()> Task;
+  // 0 is never a valid id.
+  typedef uint64_t TimerId;
+
+  TimerWheel(TimeDelta tick, size_t slots, TimeTicks now);
+  ~TimerWheel();
+
+  // A deadline in the past fires on the next Advance().
+  TimerId Schedule(TimeTicks deadline, Task task);
+  // Returns false if the timer already fired or was cancelled.
+  bool Cancel(TimerId id);
+
+  // Runs the tasks of every timer due by |now|; returns how many ran.
+  // Tasks may schedule and cancel timers.
+  size_t Advance(TimeTicks now);
+
+  // When Advance() next has something to do, or a null TimeTicks if no
+  // timer is pending. May be early for timers more than a lap away.
+  TimeTicks NextDeadline() const;
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+ private:
+  static const uint32_t kNil = 0xffffffff;
+
+  struct Node {
+    Node() : tick(0), prev(kNil), next(kNil), generation(0), linked(false) {}
+    int64_t tick;
+    Task task;
+    uint32_t prev;
+    uint32_t next;
+    uint32_t generation;
+    bool linked;
+  };
+
+  int64_t TickOf(TimeTicks time) const;
+  void Link(uint32_t index);
+  void Unlink(uint32_t index);
+  void Free(uint32_t index);
+
+  const int64_t tick_us_;
+  const int64_t origin_us_;
+  // The last tick Advance() has completed.
+  int64_t current_;
+  std::vector<uint32_t> slots_;
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> free_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+} // namespace base
+#endif // BASE_TIMER_WHEEL_H_
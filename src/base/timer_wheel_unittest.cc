@@ -0,0 +1,89 @@
+#include "base/timer_wheel.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+TimeTicks At(int64_t ms) {
+  return TimeTicks::FromInternalValue(1000000) +
+         TimeDelta::FromMilliseconds(ms);
+}
+
+TEST(TimerWheelTest, FiresAtDeadlineNotBefore) {
+  TimerWheel wheel(TimeDelta::FromMilliseconds(10), 8, At(0));
+  int fired = 0;
+  wheel.Schedule(At(25), [&fired]() { ++fired; });
+  EXPECT_EQ(1u, wheel.size());
+  EXPECT_EQ(At(30), wheel.NextDeadline());
+
+  EXPECT_EQ(0u, wheel.Advance(At(20)));
+  EXPECT_EQ(0u, wheel.Advance(At(29)));
+  EXPECT_EQ(0, fired);
+  EXPECT_EQ(1u, wheel.Advance(At(30)));
+  EXPECT_EQ(1, fired);
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_TRUE(wheel.NextDeadline().is_null());
+}
+
+TEST(TimerWheelTest, CancelAndStaleIds) {
+  TimerWheel wheel(TimeDelta::FromMilliseconds(1), 16, At(0));
+  bool fired = false;
+  TimerWheel::TimerId id = wheel.Schedule(At(5), [&fired]() { fired = true; });
+  EXPECT_TRUE(wheel.Cancel(id));
+  EXPECT_FALSE(wheel.Cancel(id));
+  EXPECT_FALSE(wheel.Cancel(0));
+
+  // The node is reused; the old id must not cancel the new timer.
+  TimerWheel::TimerId other = wheel.Schedule(At(5), [&fired]() {
+    fired = true;
+  });
+  EXPECT_NE(id, other);
+  EXPECT_FALSE(wheel.Cancel(id));
+  wheel.Advance(At(10));
+  EXPECT_TRUE(fired);
+  EXPECT_FALSE(wheel.Cancel(other));
+}
+
+TEST(TimerWheelTest, DeadlinesBeyondOneLap) {
+  TimerWheel wheel(TimeDelta::FromMilliseconds(1), 4, At(0));
+  std::vector<int> order;
+  wheel.Schedule(At(2), [&order]() { order.push_back(2); });
+  wheel.Schedule(At(6), [&order]() { order.push_back(6); });
+  wheel.Schedule(At(10), [&order]() { order.push_back(10); });
+
+  wheel.Advance(At(3));
+  EXPECT_EQ(std::vector<int>({2}), order);
+  wheel.Advance(At(7));
+  EXPECT_EQ(std::vector<int>({2, 6}), order);
+  // A jump of several laps still fires what is due.
+  wheel.Advance(At(100));
+  EXPECT_EQ(std::vector<int>({2, 6, 10}), order);
+}
+
+TEST(TimerWheelTest, PastDeadlineFiresOnNextAdvance) {
+  TimerWheel wheel(TimeDelta::FromMilliseconds(1), 8, At(0));
+  wheel.Advance(At(50));
+  int fired = 0;
+  wheel.Schedule(At(10), [&fired]() { ++fired; });
+  EXPECT_EQ(1u, wheel.Advance(At(51)));
+  EXPECT_EQ(1, fired);
+}
+
+TEST(TimerWheelTest, TasksMayReschedule) {
+  TimerWheel wheel(TimeDelta::FromMilliseconds(1), 8, At(0));
+  int fired = 0;
+  std::function<void()> again = [&]() {
+    if (++fired < 3) wheel.Schedule(At(fired * 5), again);
+  };
+  wheel.Schedule(At(1), again);
+  for (int ms = 0; ms <= 20; ++ms) wheel.Advance(At(ms));
+  EXPECT_EQ(3, fired);
+}
+
+} // namespace
+
+} // namespace base
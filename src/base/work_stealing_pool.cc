@@ -0,0 +1,140 @@
+#include "base/work_stealing_pool.h"
+
+#include <unistd.h>
+
+#include <glog/logging.h>
+
+namespace base {
+
+namespace {
+
+// Which pool and worker the current thread belongs to, if any.
+thread_local const WorkStealingPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(size_t num_threads)
+  : pending_(0),
+    idle_(0),
+    next_worker_(0),
+    stopping_(false) {
+  if (num_threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    num_threads = cpus > 0 ? static_cast<size_t>(cpus) : 1;
+  }
+  for (size_t i = 0; i < num_threads; ++i) {
+    workers_.emplace_back(new Worker);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  Stop();
+}
+
+void WorkStealingPool::Start() {
+  DCHECK(threads_.empty());
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    threads_.emplace_back(&WorkStealingPool::WorkerMain, this, i);
+  }
+}
+
+void WorkStealingPool::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_lock_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+}
+
+void WorkStealingPool::PostTask(Task task) {
+  Post(std::move(task), false);
+}
+
+void WorkStealingPool::PostTaskLast(Task task) {
+  Post(std::move(task), true);
+}
+
+void WorkStealingPool::Post(Task task, bool last) {
+  size_t target;
+  if (current_pool == this) {
+    target = current_worker;
+  } else {
+    target = next_worker_.fetch_add(1, std::memory_order_relaxed) %
+             workers_.size();
+  }
+
+  {
+    Worker* worker = workers_[target].get();
+    std::lock_guard<std::mutex> lock(worker->lock);
+    // The owner pops the back, so the front is last in line; thieves
+    // take the front first, which is fine for a task that can wait.
+    if (last) {
+      worker->tasks.push_front(std::move(task));
+    } else {
+      worker->tasks.push_back(std::move(task));
+    }
+  }
+
+  // Pairs with the idle_ increment in WorkerMain(): either we see the
+  // sleeper, or it sees the pending task before it waits.
+  pending_.fetch_add(1);
+  if (idle_.load() > 0) {
+    { std::lock_guard<std::mutex> lock(sleep_lock_); }
+    wake_.notify_one();
+  }
+}
+
+bool WorkStealingPool::TakeTask(size_t self, Task* task) {
+  {
+    Worker* own = workers_[self].get();
+    std::lock_guard<std::mutex> lock(own->lock);
+    if (!own->tasks.empty()) {
+      *task = std::move(own->tasks.back());
+      own->tasks.pop_back();
+      return true;
+    }
+  }
+
+  for (size_t i = 1; i < workers_.size(); ++i) {
+    Worker* victim = workers_[(self + i) % workers_.size()].get();
+    std::lock_guard<std::mutex> lock(victim->lock);
+    if (!victim->tasks.empty()) {
+      *task = std::move(victim->tasks.front());
+      victim->tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingPool::WorkerMain(size_t index) {
+  current_pool = this;
+  current_worker = index;
+
+  Task task;
+  for (;;) {
+    if (TakeTask(index, &task)) {
+      pending_.fetch_sub(1);
+      task();
+      task = nullptr;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_lock_);
+    idle_.fetch_add(1);
+    wake_.wait(lock, [this]() {
+      return pending_.load() > 0 || stopping_;
+    });
+    idle_.fetch_sub(1);
+    if (stopping_ && pending_.load() == 0) break;
+  }
+
+  current_pool = nullptr;
+}
+
+} // namespace base
@@ -0,0 +1,74 @@
+#ifndef BASE_WORK_STEALING_POOL_H_
+#define BASE_WORK_STEALING_POOL_H_
+
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "base/macros.h"
+
+namespace base {
+
+// Fixed-size thread pool with one task deque per worker.
+//
+// A task posted from a worker goes to that worker's own deque and is picked
+// up LIFO, while it is still hot in cache; a task posted from outside is
+// spread round-robin. A worker whose deque is empty steals the oldest task
+// from another worker before going to sleep. Each deque has its own lock, so
+// workers only contend when stealing.
+//
+// Tasks may run in any order and on any worker; use a sequencing layer on
+// top (e.g. amqp::OrderedDispatcher) when order matters.
+class WorkStealingPool {
+ public:
+  typedef std::function<void()> Task;
+
+  // 0 means one worker per online core.
+  explicit WorkStealingPool(size_t num_threads);
+  // Runs every task already posted, then joins.
+  ~WorkStealingPool();
+
+  void Start();
+  void Stop();
+
+  // Thread-safe.
+  void PostTask(Task task);
+  // Like PostTask(), but |task| goes behind everything already queued on
+  // the target deque instead of being picked up next. For work that yields
+  // the worker and must not jump ahead of what arrived meanwhile.
+  void PostTaskLast(Task task);
+
+  size_t size() const { return workers_.size(); }
+
+ private:
+  struct Worker {
+    std::mutex lock;
+    std::deque<Task> tasks;
+  };
+
+  void Post(Task task, bool last);
+  bool TakeTask(size_t self, Task* task);
+  void WorkerMain(size_t index);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+
+  std::atomic<size_t> pending_;
+  std::atomic<size_t> idle_;
+  std::atomic<size_t> next_worker_;
+
+  std::mutex sleep_lock_;
+  std::condition_variable wake_;
+  bool stopping_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkStealingPool);
+};
+
+} // namespace base
+#endif // BASE_WORK_STEALING_POOL_H_
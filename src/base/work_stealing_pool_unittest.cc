@@ -0,0 +1,80 @@
+#include "base/work_stealing_pool.h"
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+TEST(WorkStealingPoolTest, RunsEveryTask) {
+  std::atomic<int> ran(0);
+  {
+    WorkStealingPool pool(4);
+    pool.Start();
+    for (int i = 0; i < 10000; ++i) {
+      pool.PostTask([&ran]() { ran.fetch_add(1); });
+    }
+  }
+  EXPECT_EQ(10000, ran.load());
+}
+
+TEST(WorkStealingPoolTest, TasksPostedFromWorkersRun) {
+  std::atomic<int> ran(0);
+  {
+    WorkStealingPool pool(3);
+    pool.Start();
+    for (int i = 0; i < 100; ++i) {
+      pool.PostTask([&pool, &ran]() {
+        for (int j = 0; j < 100; ++j) {
+          pool.PostTask([&ran]() { ran.fetch_add(1); });
+        }
+      });
+    }
+  }
+  EXPECT_EQ(100 * 100, ran.load());
+}
+
+TEST(WorkStealingPoolTest, IdleWorkersStealFromBusyOne) {
+  const int kTasks = 64;
+  std::mutex lock;
+  std::set<std::thread::id> threads;
+  {
+    WorkStealingPool pool(4);
+    pool.Start();
+    // All children land on one worker's deque; the others must steal them.
+    pool.PostTask([&]() {
+      for (int i = 0; i < kTasks; ++i) {
+        pool.PostTask([&]() {
+          std::this_thread::sleep_for(std::chrono::milliseconds(2));
+          std::lock_guard<std::mutex> hold(lock);
+          threads.insert(std::this_thread::get_id());
+        });
+      }
+    });
+  }
+  EXPECT_GT(threads.size(), 1u);
+}
+
+TEST(WorkStealingPoolTest, PostTaskLastRunsAfterQueuedWork) {
+  std::vector<int> order;
+  {
+    WorkStealingPool pool(1);
+    pool.Start();
+    pool.PostTask([&]() {
+      pool.PostTask([&]() { order.push_back(1); });
+      pool.PostTask([&]() { order.push_back(2); });
+      pool.PostTaskLast([&]() { order.push_back(3); });
+    });
+  }
+  // Own-deque tasks run newest first; the last one after both.
+  EXPECT_EQ((std::vector<int>{2, 1, 3}), order);
+}
+
+} // namespace
+
+} // namespace base
@@ -0,0 +1,169 @@
+// Replays a frame capture (see amqp/frame_capture.h) through the frame
+// decoder as fast as possible and reports its throughput.
+//
+//   amqp_replay [--iterations=N] [--direction=inbound|outbound|all]
+//               [--decode-properties] capture
+//
+// Each frame is split into header, payload and end octet, method frames
+// into their class and method ids, and content headers into a MetaData,
+// which is what a connection does before it hands a frame to its channel.
+// The handler behind that does nothing, so the numbers are the decoder's
+// alone. --decode-properties also reads the usual properties out of every
+// content header, as a consumer would.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "amqp/frame_capture.h"
+#include "amqp/in_buffer.h"
+#include "amqp/meta_data.h"
+#include "amqp/protocol.h"
+#include "base/command_line.h"
+#include "base/numbers.h"
+#include "base/time.h"
+
+namespace {
+
+struct Counts {
+  Counts() : frames(0), bytes(0), methods(0), headers(0), bodies(0),
+             heartbeats(0), malformed(0), checksum(0) {}
+
+  uint64_t frames;
+  uint64_t bytes;
+  uint64_t methods;
+  uint64_t headers;
+  uint64_t bodies;
+  uint64_t heartbeats;
+  uint64_t malformed;
+  // Folds in decoded values so the work cannot be optimized away.
+  uint64_t checksum;
+};
+
+void Decode(const char* data, uint32_t size, bool decode_properties,
+            Counts* counts) {
+  ++counts->frames;
+  counts->bytes += size;
+
+  amqp::InBuffer frame(data, size);
+  uint8_t type = frame.NextUInt8();
+  uint16_t channel = frame.NextUInt16();
+  uint32_t payload_size = frame.NextUInt32();
+  if (!frame.ok() ||
+      static_cast<uint64_t>(payload_size) + amqp::kFrameOverhead != size ||
+      static_cast<uint8_t>(data[size - 1]) != amqp::kFrameEnd) {
+    ++counts->malformed;
+    return;
+  }
+  counts->checksum += channel;
+
+  amqp::InBuffer payload(data + amqp::kFrameHeaderSize, payload_size);
+  switch (type) {
+    case amqp::kFrameMethod: {
+      uint16_t class_id = payload.NextUInt16();
+      uint16_t method_id = payload.NextUInt16();
+      counts->checksum += (static_cast<uint64_t>(class_id) << 16) | method_id;
+      ++counts->methods;
+      break;
+    }
+    case amqp::kFrameHeader: {
+      payload.NextUInt16();  // class
+      payload.NextUInt16();  // weight
+      uint64_t body_size = payload.NextUInt64();
+      amqp::MetaData properties(payload);
+      counts->checksum += body_size + properties.flags();
+      if (decode_properties) {
+        counts->checksum += properties.message_id().size() +
+                            properties.correlation_id().size() +
+                            properties.content_type().size() +
+                            properties.headers().size() +
+                            properties.delivery_mode();
+      }
+      ++counts->headers;
+      break;
+    }
+    case amqp::kFrameBody:
+      ++counts->bodies;
+      break;
+    case amqp::kFrameHeartbeat:
+      ++counts->heartbeats;
+      break;
+    default:
+      ++counts->malformed;
+      return;
+  }
+  if (!payload.ok()) ++counts->malformed;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  base::CommandLine::Init(argc, argv);
+  const base::CommandLine& command_line =
+      *base::CommandLine::ForCurrentProcess();
+  base::CommandLine::StringVector args = command_line.GetArgs();
+  if (args.size() != 1) {
+    fprintf(stderr,
+            "usage: %s [--iterations=N] [--direction=inbound|outbound|all] "
+            "[--decode-properties] capture\n",
+            argv[0]);
+    return 2;
+  }
+
+  int64_t iterations = 1;
+  if (command_line.HasSwitch("iterations")) {
+    iterations = base::atoi64(command_line.GetSwitchValueASCII("iterations"));
+    if (iterations < 1) iterations = 1;
+  }
+  std::string direction = command_line.GetSwitchValueASCII("direction");
+  if (direction.empty()) direction = "inbound";
+  if (direction != "inbound" && direction != "outbound" && direction != "all") {
+    fprintf(stderr, "bad --direction: %s\n", direction.c_str());
+    return 2;
+  }
+  bool decode_properties = command_line.HasSwitch("decode-properties");
+
+  amqp::FrameCaptureReader reader;
+  base::Status status = reader.Open(base::FilePath(args[0]));
+  if (!status.ok()) {
+    fprintf(stderr, "%s\n", status.ToString().c_str());
+    return 1;
+  }
+
+  Counts counts;
+  amqp::FrameCaptureReader::Frame frame;
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (int64_t i = 0; i < iterations; ++i) {
+    reader.Rewind();
+    while (reader.Next(&frame)) {
+      if (direction == "all" ||
+          (frame.direction == amqp::CAPTURE_INBOUND) ==
+              (direction == "inbound")) {
+        Decode(frame.data, frame.size, decode_properties, &counts);
+      }
+    }
+  }
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+
+  if (!reader.ok()) fprintf(stderr, "warning: capture is truncated\n");
+  double seconds = elapsed.InSecondsF();
+  printf("frames      %llu (%llu method, %llu header, %llu body, "
+         "%llu heartbeat, %llu malformed)\n",
+         static_cast<unsigned long long>(counts.frames),
+         static_cast<unsigned long long>(counts.methods),
+         static_cast<unsigned long long>(counts.headers),
+         static_cast<unsigned long long>(counts.bodies),
+         static_cast<unsigned long long>(counts.heartbeats),
+         static_cast<unsigned long long>(counts.malformed));
+  printf("bytes       %llu\n", static_cast<unsigned long long>(counts.bytes));
+  printf("elapsed     %.3f s\n", seconds);
+  if (counts.frames > 0 && seconds > 0) {
+    printf("frames/s    %.0f\n", counts.frames / seconds);
+    printf("ns/frame    %.1f\n", seconds * 1e9 / counts.frames);
+    printf("MB/s        %.1f\n", counts.bytes / seconds / 1e6);
+  }
+  printf("checksum    %llx\n",
+         static_cast<unsigned long long>(counts.checksum));
+  return counts.malformed ? 1 : 0;
+}